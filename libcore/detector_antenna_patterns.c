@@ -29,6 +29,14 @@ detector_antenna_patterns_workspace_t* Detector_Antenna_Patterns_workspace_alloc
 	ws->temp = gsl_matrix_alloc(3, 3);
 	ws->wp_matrix = gsl_matrix_alloc(2, 2);
 
+	/* Each vector and matrix has a block of its size, or size1 * size2, doubles */
+	ws->bytes = sizeof(detector_antenna_patterns_workspace_t);
+	ws->bytes += 3 * (sizeof(gsl_vector) + sizeof(gsl_block));
+	ws->bytes += (ws->n_hat->size + ws->ex_i->size + ws->ey_j->size) * sizeof(double);
+	ws->bytes += 4 * (sizeof(gsl_matrix) + sizeof(gsl_block));
+	ws->bytes += (ws->epsilon_plus->size1 * ws->epsilon_plus->size2 + ws->epsilon_cross->size1 * ws->epsilon_cross->size2
+			+ ws->temp->size1 * ws->temp->size2 + ws->wp_matrix->size1 * ws->wp_matrix->size2) * sizeof(double);
+
 	return ws;
 }
 
@@ -45,6 +53,12 @@ void Detector_Antenna_Patterns_workspace_free( detector_antenna_patterns_workspa
 	ws = NULL;
 }
 
+size_t Detector_Antenna_Patterns_workspace_footprint( const detector_antenna_patterns_workspace_t* ws ) {
+	assert(ws != NULL);
+
+	return ws->bytes;
+}
+
 static int trace(gsl_matrix* A, double* r) {
 	assert(A != NULL);
 	assert(r != NULL);
@@ -30,10 +30,14 @@ typedef struct detector_antenna_patterns_workspace_s {
 	gsl_matrix* temp;
 	gsl_matrix* wp_matrix;
 
+	/* The bytes allocated, see Detector_Antenna_Patterns_workspace_footprint */
+	size_t bytes;
+
 } detector_antenna_patterns_workspace_t;
 
 detector_antenna_patterns_workspace_t* Detector_Antenna_Patterns_workspace_alloc();
 void Detector_Antenna_Patterns_workspace_free( detector_antenna_patterns_workspace_t* workspace );
+size_t Detector_Antenna_Patterns_workspace_footprint( const detector_antenna_patterns_workspace_t* workspace );
 
 int Detector_Antenna_Patterns_compute(detector_t *d, sky_t *sky, double polarization_angle,
 		detector_antenna_patterns_workspace_t *workspace, detector_antenna_patterns_t *ant);
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -17,6 +18,7 @@
 #include "detector_mapping.h"
 #include "detector_network.h"
 #include "detector_antenna_patterns.h"
+#include "fft.h"
 #include "hdf5_file.h"
 #include "sampling_system.h"
 
@@ -66,12 +68,48 @@ void Detector_Network_print(detector_network_t* net) {
 	}
 }
 
+size_t Detector_Network_plan_num_time_samples(size_t num_time_samples, SS_FFT_LENGTH_POLICY policy) {
+	if (SS_is_fft_friendly(num_time_samples)) {
+		return num_time_samples;
+	}
+
+	/* suggest whichever friendly length is closer */
+	size_t padded = SS_fft_friendly_length(num_time_samples, SS_FFT_LENGTH_PAD);
+	size_t cropped = SS_fft_friendly_length(num_time_samples, SS_FFT_LENGTH_CROP);
+	size_t suggested = (padded - num_time_samples <= num_time_samples - cropped) ? padded : cropped;
+	size_t planned = (policy == SS_FFT_LENGTH_KEEP) ? num_time_samples : SS_fft_friendly_length(num_time_samples, policy);
+	size_t compared = (policy == SS_FFT_LENGTH_KEEP) ? suggested : planned;
+
+	double speedup = FFT_cost_estimate(num_time_samples) / FFT_cost_estimate(compared);
+
+	if (policy == SS_FFT_LENGTH_KEEP) {
+		fprintf(stderr, "Warning. %lu time samples are slow to transform. %lu samples would be about %.1fx faster. "
+				"Set fft_length_policy to pad or crop to change the length.\n", num_time_samples, suggested, speedup);
+	} else {
+		fprintf(stderr, "Using %lu time samples instead of %lu (fft_length_policy %s). The transforms should be about %.1fx faster.\n",
+				planned, num_time_samples, SS_fft_length_policy_name(policy), speedup);
+	}
+
+	return planned;
+}
+
 detector_network_t* Detector_Network_load( const char* detector_mapping_file,
 		size_t num_time_samples, double sampling_frequency, double f_low, double f_high ) {
+	return Detector_Network_load_planned( detector_mapping_file, num_time_samples, SS_FFT_LENGTH_KEEP,
+			sampling_frequency, f_low, f_high, NULL );
+}
+
+detector_network_t* Detector_Network_load_planned( const char* detector_mapping_file, size_t num_time_samples,
+		SS_FFT_LENGTH_POLICY policy, double sampling_frequency, double f_low, double f_high, size_t *out_num_time_samples ) {
 	assert(detector_mapping_file != NULL);
 
 	size_t i;
 
+	num_time_samples = Detector_Network_plan_num_time_samples( num_time_samples, policy );
+	if (out_num_time_samples != NULL) {
+		*out_num_time_samples = num_time_samples;
+	}
+
 	detector_network_mapping_t *dmap = Detector_Network_Mapping_load( detector_mapping_file );
 
 	/* sampling frequency */
@@ -107,6 +145,37 @@ detector_network_t* Detector_Network_load( const char* detector_mapping_file,
 	return net;
 }
 
+void Detector_Network_resample_psds( detector_network_t *net, size_t num_time_samples, double sampling_frequency,
+		double f_low, double f_high ) {
+	assert(net != NULL);
+
+	size_t i;
+
+	size_t len = SS_half_size(num_time_samples);
+	double last_f = (len - 1) * sampling_frequency / num_time_samples;
+
+	for (i = 0; i < net->num_detectors; i++) {
+		detector_t *det = net->detector[i];
+
+		/* e.g. the PSDs of Detector_Network_load_planned, which are interpolated at the planned frequencies */
+		if (det->psd->len == len && det->psd->f[0] == 0.0
+				&& fabs(det->psd->f[len - 1] - last_f) <= 1e-12 * sampling_frequency) {
+			continue;
+		}
+
+		psd_t *psd = PSD_resample(det->psd, num_time_samples, sampling_frequency);
+		PSD_flatten_edges(f_low, f_high, psd);
+
+		asd_t *asd = ASD_alloc( psd->len );
+		ASD_init_from_psd( psd, asd );
+
+		PSD_free(det->psd);
+		ASD_free(det->asd);
+		det->psd = psd;
+		det->asd = asd;
+	}
+}
+
 double Detector_Network_condition_number_M(detector_network_t* net, sky_t* sky, double polarization_angle) {
 	size_t i;
 
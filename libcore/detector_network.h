@@ -1,7 +1,10 @@
 #ifndef SRC_C_DETECTOR_NETWORK_H_
 #define SRC_C_DETECTOR_NETWORK_H_
 
+#include <stddef.h>
+
 #include "detector.h"
+#include "sampling_system.h"
 #include "sky.h"
 
 #if defined (__cplusplus)
@@ -21,8 +24,28 @@ void Detector_Network_free(detector_network_t* net);
 
 void Detector_Network_print(detector_network_t* net);
 
+/* Chooses the number of time samples the network is analysed with. A length that is slow to transform is
+ * reported as a warning along with the expected speedup of the FFT friendly length, which is used unless
+ * the policy is SS_FFT_LENGTH_KEEP. */
+size_t Detector_Network_plan_num_time_samples(size_t num_time_samples, SS_FFT_LENGTH_POLICY policy);
+
+/* Loads the network with the PSDs interpolated to the planned length, which is written to out_num_time_samples
+ * if it isn't NULL. The data has to be resized to that length with network_strain_half_fft_resize. The PSDs are
+ * already at the planned frequencies, so its resample leaves them as they are. network_strain_half_fft_load_planned
+ * does both. */
+detector_network_t* Detector_Network_load_planned( const char* detector_mapping_file, size_t num_time_samples,
+		SS_FFT_LENGTH_POLICY policy, double sampling_frequency, double f_low, double f_high, size_t *out_num_time_samples );
+
+/* Same as Detector_Network_load_planned with SS_FFT_LENGTH_KEEP */
 detector_network_t* Detector_Network_load( const char* detector_mapping_file, size_t num_time_samples, double sampling_frequency, double f_low, double f_high );
 
+/* Interpolates the PSDs and ASDs of the detectors to the frequencies of num_time_samples samples, and flattens
+ * them outside of f_low and f_high like Detector_Network_load does. Padding or cropping the data changes the bin
+ * spacing, so the bins of f_low and f_high move: anything built from the old ASDs, like the statistic's
+ * workspaces, has to be allocated again. A PSD that is at those frequencies already is left as it is. */
+void Detector_Network_resample_psds( detector_network_t *net, size_t num_time_samples, double sampling_frequency,
+		double f_low, double f_high );
+
 double Detector_Network_condition_number_M(detector_network_t* net, sky_t* sky, double polarization_angle);
 
 double Detector_Network_condition_number_F(detector_network_t* net, sky_t* sky, double polarization_angle);
@@ -0,0 +1,302 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gsl/gsl_const_mksa.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_sf_trig.h>
+#include <gsl/gsl_vector.h>
+
+#include "detector.h"
+#include "detector_sky_batch.h"
+#include "sky.h"
+#include "vector_math.h"
+#include "vector_math_simd.h"
+
+/* One block of sky positions, and where the results of one detector go (already offset to the block). */
+typedef struct detector_sky_block_s {
+	size_t len;
+	const double *sin_ra;
+	const double *cos_ra;
+	const double *sin_dec;
+	const double *cos_dec;
+
+	double cos_2psi;
+	double sin_2psi;
+
+	double *u;
+	double *v;
+	double *f_plus;
+	double *f_cross;
+	double *time_delay;
+} detector_sky_block_t;
+
+detector_sky_batch_t* Detector_Sky_Batch_alloc(size_t num_detectors, detector_t **detectors) {
+	assert(detectors != NULL);
+
+	size_t i;
+	detector_sky_batch_t *batch = (detector_sky_batch_t*) malloc( sizeof(detector_sky_batch_t) );
+	if (batch == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: Detector_Sky_Batch_alloc(). Exiting.\n");
+		exit(-1);
+	}
+
+	batch->num_detectors = num_detectors;
+	batch->tensor = (double*) malloc( 6 * num_detectors * sizeof(double) );
+	batch->location = (double*) malloc( 3 * num_detectors * sizeof(double) );
+	if (batch->tensor == NULL || batch->location == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: Detector_Sky_Batch_alloc(). Exiting.\n");
+		exit(-1);
+	}
+	batch->bytes = sizeof(detector_sky_batch_t) + (6 + 3) * num_detectors * sizeof(double);
+
+	for (i = 0; i < num_detectors; i++) {
+		gsl_matrix *d = detectors[i]->detector_tensor;
+
+		/* The contraction with a symmetric polarization tensor only sees the symmetric part. */
+		batch->tensor[0*num_detectors + i] = gsl_matrix_get(d, 0, 0);
+		batch->tensor[1*num_detectors + i] = 0.5 * (gsl_matrix_get(d, 0, 1) + gsl_matrix_get(d, 1, 0));
+		batch->tensor[2*num_detectors + i] = 0.5 * (gsl_matrix_get(d, 0, 2) + gsl_matrix_get(d, 2, 0));
+		batch->tensor[3*num_detectors + i] = gsl_matrix_get(d, 1, 1);
+		batch->tensor[4*num_detectors + i] = 0.5 * (gsl_matrix_get(d, 1, 2) + gsl_matrix_get(d, 2, 1));
+		batch->tensor[5*num_detectors + i] = gsl_matrix_get(d, 2, 2);
+
+		batch->location[0*num_detectors + i] = gsl_vector_get(detectors[i]->location, 0);
+		batch->location[1*num_detectors + i] = gsl_vector_get(detectors[i]->location, 1);
+		batch->location[2*num_detectors + i] = gsl_vector_get(detectors[i]->location, 2);
+	}
+
+	return batch;
+}
+
+void Detector_Sky_Batch_free(detector_sky_batch_t *batch) {
+	assert(batch != NULL);
+
+	free(batch->tensor);
+	batch->tensor = NULL;
+	free(batch->location);
+	batch->location = NULL;
+	free(batch);
+}
+
+size_t Detector_Sky_Batch_footprint(const detector_sky_batch_t *batch) {
+	assert(batch != NULL);
+
+	return batch->bytes;
+}
+
+/* With ex = (sin ra, -cos ra, 0) and ey = (-cos ra sin dec, -sin ra sin dec, cos dec) the polarization tensors are
+ *   e_plus = ex ex' - ey ey' and e_cross = ex ey' + ey ex'
+ * so for a symmetric D, u = trace(D e_plus) = ex'D ex - ey'D ey and v = trace(D e_cross) = 2 ey'D ex.
+ * The time delay is the arm vertex projected onto the direction n = (cos dec cos ra, cos dec sin ra, sin dec). */
+static void DSB_contract_scalar(const double *d, const double *l, size_t start, detector_sky_block_t *blk) {
+	size_t k;
+	for (k = start; k < blk->len; k++) {
+		double ex_x = blk->sin_ra[k];
+		double ex_y = -blk->cos_ra[k];
+		double ey_x = -blk->cos_ra[k] * blk->sin_dec[k];
+		double ey_y = -blk->sin_ra[k] * blk->sin_dec[k];
+		double ey_z = blk->cos_dec[k];
+
+		double dex_x = d[0]*ex_x + d[1]*ex_y;
+		double dex_y = d[1]*ex_x + d[3]*ex_y;
+		double dex_z = d[2]*ex_x + d[4]*ex_y;
+
+		double dey_x = d[0]*ey_x + d[1]*ey_y + d[2]*ey_z;
+		double dey_y = d[1]*ey_x + d[3]*ey_y + d[4]*ey_z;
+		double dey_z = d[2]*ey_x + d[4]*ey_y + d[5]*ey_z;
+
+		double u = (ex_x*dex_x + ex_y*dex_y) - (ey_x*dey_x + ey_y*dey_y + ey_z*dey_z);
+		double v = 2.0 * (ey_x*dex_x + ey_y*dex_y + ey_z*dex_z);
+
+		if (blk->u != NULL) blk->u[k] = u;
+		if (blk->v != NULL) blk->v[k] = v;
+		if (blk->f_plus != NULL) blk->f_plus[k] = blk->cos_2psi*u + blk->sin_2psi*v;
+		if (blk->f_cross != NULL) blk->f_cross[k] = -blk->sin_2psi*u + blk->cos_2psi*v;
+		if (blk->time_delay != NULL) {
+			double n_x = blk->cos_dec[k] * blk->cos_ra[k];
+			double n_y = blk->cos_dec[k] * blk->sin_ra[k];
+			double n_z = blk->sin_dec[k];
+			blk->time_delay[k] = (l[0]*n_x + l[1]*n_y + l[2]*n_z) / GSL_CONST_MKSA_SPEED_OF_LIGHT;
+		}
+	}
+}
+
+#if VM_HAVE_X86_SIMD
+static VM_TARGET_AVX2 void DSB_contract_avx2(const double *d, const double *l, detector_sky_block_t *blk) {
+	size_t k;
+	__m256d d0 = _mm256_set1_pd(d[0]), d1 = _mm256_set1_pd(d[1]), d2 = _mm256_set1_pd(d[2]);
+	__m256d d3 = _mm256_set1_pd(d[3]), d4 = _mm256_set1_pd(d[4]), d5 = _mm256_set1_pd(d[5]);
+	__m256d l0 = _mm256_set1_pd(l[0]), l1 = _mm256_set1_pd(l[1]), l2 = _mm256_set1_pd(l[2]);
+	__m256d c2p = _mm256_set1_pd(blk->cos_2psi), s2p = _mm256_set1_pd(blk->sin_2psi);
+	__m256d zero = _mm256_setzero_pd(), two = _mm256_set1_pd(2.0);
+	__m256d speed_of_light = _mm256_set1_pd(GSL_CONST_MKSA_SPEED_OF_LIGHT);
+
+	for (k = 0; k + 4 <= blk->len; k += 4) {
+		__m256d sa = _mm256_loadu_pd(blk->sin_ra + k), ca = _mm256_loadu_pd(blk->cos_ra + k);
+		__m256d sd = _mm256_loadu_pd(blk->sin_dec + k), cd = _mm256_loadu_pd(blk->cos_dec + k);
+
+		__m256d ex_x = sa;
+		__m256d ex_y = _mm256_sub_pd(zero, ca);
+		__m256d ey_x = _mm256_sub_pd(zero, _mm256_mul_pd(ca, sd));
+		__m256d ey_y = _mm256_sub_pd(zero, _mm256_mul_pd(sa, sd));
+		__m256d ey_z = cd;
+
+		__m256d dex_x = _mm256_add_pd(_mm256_mul_pd(d0, ex_x), _mm256_mul_pd(d1, ex_y));
+		__m256d dex_y = _mm256_add_pd(_mm256_mul_pd(d1, ex_x), _mm256_mul_pd(d3, ex_y));
+		__m256d dex_z = _mm256_add_pd(_mm256_mul_pd(d2, ex_x), _mm256_mul_pd(d4, ex_y));
+
+		__m256d dey_x = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(d0, ey_x), _mm256_mul_pd(d1, ey_y)), _mm256_mul_pd(d2, ey_z));
+		__m256d dey_y = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(d1, ey_x), _mm256_mul_pd(d3, ey_y)), _mm256_mul_pd(d4, ey_z));
+		__m256d dey_z = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(d2, ey_x), _mm256_mul_pd(d4, ey_y)), _mm256_mul_pd(d5, ey_z));
+
+		__m256d exdex = _mm256_add_pd(_mm256_mul_pd(ex_x, dex_x), _mm256_mul_pd(ex_y, dex_y));
+		__m256d eydey = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ey_x, dey_x), _mm256_mul_pd(ey_y, dey_y)), _mm256_mul_pd(ey_z, dey_z));
+		__m256d eydex = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ey_x, dex_x), _mm256_mul_pd(ey_y, dex_y)), _mm256_mul_pd(ey_z, dex_z));
+
+		__m256d u = _mm256_sub_pd(exdex, eydey);
+		__m256d v = _mm256_mul_pd(two, eydex);
+
+		if (blk->u != NULL) _mm256_storeu_pd(blk->u + k, u);
+		if (blk->v != NULL) _mm256_storeu_pd(blk->v + k, v);
+		if (blk->f_plus != NULL) {
+			_mm256_storeu_pd(blk->f_plus + k, _mm256_add_pd(_mm256_mul_pd(c2p, u), _mm256_mul_pd(s2p, v)));
+		}
+		if (blk->f_cross != NULL) {
+			_mm256_storeu_pd(blk->f_cross + k, _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(zero, s2p), u), _mm256_mul_pd(c2p, v)));
+		}
+		if (blk->time_delay != NULL) {
+			__m256d p = _mm256_add_pd(_mm256_add_pd(
+					_mm256_mul_pd(l0, _mm256_mul_pd(cd, ca)), _mm256_mul_pd(l1, _mm256_mul_pd(cd, sa))), _mm256_mul_pd(l2, sd));
+			_mm256_storeu_pd(blk->time_delay + k, _mm256_div_pd(p, speed_of_light));
+		}
+	}
+	DSB_contract_scalar(d, l, k, blk);
+}
+
+static VM_TARGET_AVX512 void DSB_contract_avx512(const double *d, const double *l, detector_sky_block_t *blk) {
+	size_t k;
+	__m512d d0 = _mm512_set1_pd(d[0]), d1 = _mm512_set1_pd(d[1]), d2 = _mm512_set1_pd(d[2]);
+	__m512d d3 = _mm512_set1_pd(d[3]), d4 = _mm512_set1_pd(d[4]), d5 = _mm512_set1_pd(d[5]);
+	__m512d l0 = _mm512_set1_pd(l[0]), l1 = _mm512_set1_pd(l[1]), l2 = _mm512_set1_pd(l[2]);
+	__m512d c2p = _mm512_set1_pd(blk->cos_2psi), s2p = _mm512_set1_pd(blk->sin_2psi);
+	__m512d zero = _mm512_setzero_pd(), two = _mm512_set1_pd(2.0);
+	__m512d speed_of_light = _mm512_set1_pd(GSL_CONST_MKSA_SPEED_OF_LIGHT);
+
+	for (k = 0; k + 8 <= blk->len; k += 8) {
+		__m512d sa = _mm512_loadu_pd(blk->sin_ra + k), ca = _mm512_loadu_pd(blk->cos_ra + k);
+		__m512d sd = _mm512_loadu_pd(blk->sin_dec + k), cd = _mm512_loadu_pd(blk->cos_dec + k);
+
+		__m512d ex_x = sa;
+		__m512d ex_y = _mm512_sub_pd(zero, ca);
+		__m512d ey_x = _mm512_sub_pd(zero, _mm512_mul_pd(ca, sd));
+		__m512d ey_y = _mm512_sub_pd(zero, _mm512_mul_pd(sa, sd));
+		__m512d ey_z = cd;
+
+		__m512d dex_x = _mm512_add_pd(_mm512_mul_pd(d0, ex_x), _mm512_mul_pd(d1, ex_y));
+		__m512d dex_y = _mm512_add_pd(_mm512_mul_pd(d1, ex_x), _mm512_mul_pd(d3, ex_y));
+		__m512d dex_z = _mm512_add_pd(_mm512_mul_pd(d2, ex_x), _mm512_mul_pd(d4, ex_y));
+
+		__m512d dey_x = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(d0, ey_x), _mm512_mul_pd(d1, ey_y)), _mm512_mul_pd(d2, ey_z));
+		__m512d dey_y = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(d1, ey_x), _mm512_mul_pd(d3, ey_y)), _mm512_mul_pd(d4, ey_z));
+		__m512d dey_z = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(d2, ey_x), _mm512_mul_pd(d4, ey_y)), _mm512_mul_pd(d5, ey_z));
+
+		__m512d exdex = _mm512_add_pd(_mm512_mul_pd(ex_x, dex_x), _mm512_mul_pd(ex_y, dex_y));
+		__m512d eydey = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(ey_x, dey_x), _mm512_mul_pd(ey_y, dey_y)), _mm512_mul_pd(ey_z, dey_z));
+		__m512d eydex = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(ey_x, dex_x), _mm512_mul_pd(ey_y, dex_y)), _mm512_mul_pd(ey_z, dex_z));
+
+		__m512d u = _mm512_sub_pd(exdex, eydey);
+		__m512d v = _mm512_mul_pd(two, eydex);
+
+		if (blk->u != NULL) _mm512_storeu_pd(blk->u + k, u);
+		if (blk->v != NULL) _mm512_storeu_pd(blk->v + k, v);
+		if (blk->f_plus != NULL) {
+			_mm512_storeu_pd(blk->f_plus + k, _mm512_add_pd(_mm512_mul_pd(c2p, u), _mm512_mul_pd(s2p, v)));
+		}
+		if (blk->f_cross != NULL) {
+			_mm512_storeu_pd(blk->f_cross + k, _mm512_add_pd(_mm512_mul_pd(_mm512_sub_pd(zero, s2p), u), _mm512_mul_pd(c2p, v)));
+		}
+		if (blk->time_delay != NULL) {
+			__m512d p = _mm512_add_pd(_mm512_add_pd(
+					_mm512_mul_pd(l0, _mm512_mul_pd(cd, ca)), _mm512_mul_pd(l1, _mm512_mul_pd(cd, sa))), _mm512_mul_pd(l2, sd));
+			_mm512_storeu_pd(blk->time_delay + k, _mm512_div_pd(p, speed_of_light));
+		}
+	}
+	DSB_contract_scalar(d, l, k, blk);
+}
+#endif
+
+static void DSB_contract(const double *d, const double *l, detector_sky_block_t *blk) {
+	switch (VM_simd_level()) {
+#if VM_HAVE_X86_SIMD
+	case VM_SIMD_AVX512:
+		DSB_contract_avx512(d, l, blk);
+		break;
+	case VM_SIMD_AVX2:
+		DSB_contract_avx2(d, l, blk);
+		break;
+#endif
+	default:
+		DSB_contract_scalar(d, l, 0, blk);
+		break;
+	}
+}
+
+static double* DSB_offset(double *out, size_t offset) {
+	return (out != NULL) ? out + offset : NULL;
+}
+
+void Detector_Sky_Batch_compute(const detector_sky_batch_t *batch, size_t num_skies, const sky_t *skies,
+		double polarization_angle, double *out_u, double *out_v, double *out_f_plus, double *out_f_cross,
+		double *out_time_delay)
+{
+	assert(batch != NULL);
+	assert(skies != NULL || num_skies == 0);
+
+	size_t num_detectors = batch->num_detectors;
+	size_t start, k, i, c;
+	double ra[DETECTOR_SKY_BATCH_BLOCK], dec[DETECTOR_SKY_BATCH_BLOCK];
+	double sin_ra[DETECTOR_SKY_BATCH_BLOCK], cos_ra[DETECTOR_SKY_BATCH_BLOCK];
+	double sin_dec[DETECTOR_SKY_BATCH_BLOCK], cos_dec[DETECTOR_SKY_BATCH_BLOCK];
+	detector_sky_block_t blk;
+
+	blk.sin_ra = sin_ra;
+	blk.cos_ra = cos_ra;
+	blk.sin_dec = sin_dec;
+	blk.cos_dec = cos_dec;
+	blk.cos_2psi = gsl_sf_cos(2 * polarization_angle);
+	blk.sin_2psi = gsl_sf_sin(2 * polarization_angle);
+
+	for (start = 0; start < num_skies; start += DETECTOR_SKY_BATCH_BLOCK) {
+		blk.len = num_skies - start;
+		if (blk.len > DETECTOR_SKY_BATCH_BLOCK) {
+			blk.len = DETECTOR_SKY_BATCH_BLOCK;
+		}
+
+		/* The trig of each position is shared by every detector. */
+		for (k = 0; k < blk.len; k++) {
+			ra[k] = skies[start + k].ra;
+			dec[k] = skies[start + k].dec;
+		}
+		VM_sincos(blk.len, ra, sin_ra, cos_ra);
+		VM_sincos(blk.len, dec, sin_dec, cos_dec);
+
+		for (i = 0; i < num_detectors; i++) {
+			double d[6], l[3];
+			for (c = 0; c < 6; c++) {
+				d[c] = batch->tensor[c*num_detectors + i];
+			}
+			for (c = 0; c < 3; c++) {
+				l[c] = batch->location[c*num_detectors + i];
+			}
+
+			blk.u = DSB_offset(out_u, i*num_skies + start);
+			blk.v = DSB_offset(out_v, i*num_skies + start);
+			blk.f_plus = DSB_offset(out_f_plus, i*num_skies + start);
+			blk.f_cross = DSB_offset(out_f_cross, i*num_skies + start);
+			blk.time_delay = DSB_offset(out_time_delay, i*num_skies + start);
+
+			DSB_contract(d, l, &blk);
+		}
+	}
+}
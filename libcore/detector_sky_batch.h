@@ -0,0 +1,57 @@
+#ifndef SRC_C_DETECTOR_SKY_BATCH_H_
+#define SRC_C_DETECTOR_SKY_BATCH_H_
+
+#include <stddef.h>
+
+#include "detector.h"
+#include "sky.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* Number of sky positions whose trig is computed together. */
+#define DETECTOR_SKY_BATCH_BLOCK 256
+
+/* The detectors of a network laid out for evaluating the antenna patterns and time delays of many sky positions
+ * at once. The detector tensors are contracted with the polarization basis in closed form, instead of forming
+ * the basis tensors and multiplying 3x3 matrices like Detector_Antenna_Patterns_compute does.
+ *
+ * The arrays are structure of arrays: component c of detector i is at [c*num_detectors + i].
+ * It is read-only after Detector_Sky_Batch_alloc, so one can be used by any number of threads.
+ */
+typedef struct detector_sky_batch_s {
+	size_t num_detectors;
+
+	/* The symmetric part of the detector tensors: xx, xy, xz, yy, yz, zz */
+	double *tensor;
+
+	/* The positions of the arm vertices (m): x, y, z */
+	double *location;
+
+	/* The bytes allocated, see Detector_Sky_Batch_footprint */
+	size_t bytes;
+
+} detector_sky_batch_t;
+
+detector_sky_batch_t* Detector_Sky_Batch_alloc(size_t num_detectors, detector_t **detectors);
+
+void Detector_Sky_Batch_free(detector_sky_batch_t *batch);
+
+/* The bytes allocated for the batch, recorded when it was allocated. */
+size_t Detector_Sky_Batch_footprint(const detector_sky_batch_t *batch);
+
+/* Computes, for each detector i and sky position k, the antenna patterns u, v, f_plus and f_cross (with the same
+ * polarization angle for every position) and the time delay, written to out_*[i*num_skies + k].
+ * Any of the outputs can be NULL if it isn't needed. The values agree with Detector_Antenna_Patterns_compute and
+ * Detector_time_delay to a few ulp.
+ */
+void Detector_Sky_Batch_compute(const detector_sky_batch_t *batch, size_t num_skies, const sky_t *skies,
+		double polarization_angle, double *out_u, double *out_v, double *out_f_plus, double *out_f_cross,
+		double *out_time_delay);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* SRC_C_DETECTOR_SKY_BATCH_H_ */
@@ -0,0 +1,312 @@
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gsl/gsl_const_mksa.h>
+#include <gsl/gsl_math.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_vector.h>
+
+#include "detector.h"
+#include "detector_sky_batch.h"
+#include "detector_sky_table.h"
+#include "sky.h"
+
+#define DETECTOR_SKY_TABLE_MAGIC "LDASKYT1"
+#define DETECTOR_SKY_TABLE_BYTE_ORDER 0x01020304u
+
+static detector_sky_table_t* Detector_Sky_Table_alloc(size_t num_detectors, size_t num_ra, size_t num_dec) {
+	detector_sky_table_t *table = (detector_sky_table_t*) malloc( sizeof(detector_sky_table_t) );
+	if (table == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: Detector_Sky_Table_alloc(). Exiting.\n");
+		exit(-1);
+	}
+
+	table->num_detectors = num_detectors;
+	table->num_ra = num_ra;
+	table->num_dec = num_dec;
+	table->ra_step = 2.0 * M_PI / num_ra;
+	table->dec_step = M_PI / (num_dec - 1);
+
+	table->ids = (DETECTOR_ID*) malloc( num_detectors * sizeof(DETECTOR_ID) );
+	table->values = (double*) malloc( num_ra * num_dec * 3 * num_detectors * sizeof(double) );
+	if (table->ids == NULL || table->values == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: Detector_Sky_Table_alloc(). Exiting.\n");
+		exit(-1);
+	}
+
+	table->error_bound_uv = 0.0;
+	table->error_bound_time_delay = 0.0;
+
+	return table;
+}
+
+void Detector_Sky_Table_free(detector_sky_table_t *table) {
+	assert(table != NULL);
+
+	free(table->ids);
+	table->ids = NULL;
+	free(table->values);
+	table->values = NULL;
+	free(table);
+}
+
+detector_sky_table_t* Detector_Sky_Table_build(size_t num_detectors, detector_t **detectors, double resolution) {
+	assert(detectors != NULL);
+	assert(resolution > 0.0);
+
+	size_t num_ra = (size_t) ceil(2.0 * M_PI / resolution);
+	size_t num_dec = (size_t) ceil(M_PI / resolution) + 1;
+	size_t node_len = 3 * num_detectors;
+	size_t i, j, k, r, c;
+	double tensor_norm = 0.0;
+	double location_norm = 0.0;
+
+	if (num_ra < 4) {
+		num_ra = 4;
+	}
+
+	detector_sky_table_t *table = Detector_Sky_Table_alloc(num_detectors, num_ra, num_dec);
+	detector_sky_batch_t *batch = Detector_Sky_Batch_alloc(num_detectors, detectors);
+
+	sky_t *skies = (sky_t*) malloc( num_ra * sizeof(sky_t) );
+	double *row = (double*) malloc( 3 * num_detectors * num_ra * sizeof(double) );
+	if (skies == NULL || row == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: Detector_Sky_Table_build(). Exiting.\n");
+		exit(-1);
+	}
+
+	/* One declination at a time, with the values of each detector in rows of num_ra */
+	for (k = 0; k < num_dec; k++) {
+		for (j = 0; j < num_ra; j++) {
+			skies[j].ra = j * table->ra_step;
+			skies[j].dec = -M_PI_2 + k * table->dec_step;
+		}
+		Detector_Sky_Batch_compute(batch, num_ra, skies, 0.0, row, row + num_detectors * num_ra, NULL, NULL,
+				row + 2 * num_detectors * num_ra);
+
+		for (j = 0; j < num_ra; j++) {
+			double *node = table->values + (k*num_ra + j) * node_len;
+			for (i = 0; i < num_detectors; i++) {
+				node[3*i + 0] = row[i*num_ra + j];
+				node[3*i + 1] = row[(num_detectors + i)*num_ra + j];
+				node[3*i + 2] = row[(2*num_detectors + i)*num_ra + j];
+			}
+		}
+	}
+
+	for (i = 0; i < num_detectors; i++) {
+		double norm = 0.0;
+		double distance = 0.0;
+		for (r = 0; r < 3; r++) {
+			distance += gsl_pow_2(gsl_vector_get(detectors[i]->location, r));
+			for (c = 0; c < 3; c++) {
+				double s = 0.5 * (gsl_matrix_get(detectors[i]->detector_tensor, r, c)
+						+ gsl_matrix_get(detectors[i]->detector_tensor, c, r));
+				norm += s * s;
+			}
+		}
+		tensor_norm = GSL_MAX(tensor_norm, sqrt(norm));
+		location_norm = GSL_MAX(location_norm, sqrt(distance));
+		table->ids[i] = detectors[i]->id;
+	}
+
+	table->error_bound_uv = tensor_norm * (gsl_pow_2(table->ra_step) + 0.5 * gsl_pow_2(table->dec_step));
+	table->error_bound_time_delay = location_norm / GSL_CONST_MKSA_SPEED_OF_LIGHT
+			* (gsl_pow_2(table->ra_step) + gsl_pow_2(table->dec_step)) / 8.0;
+
+	free(row);
+	free(skies);
+	Detector_Sky_Batch_free(batch);
+
+	return table;
+}
+
+static void Detector_Sky_Table_write(FILE *file, const void *data, size_t size, size_t count, const char *filename) {
+	if (fwrite(data, size, count, file) != count) {
+		fprintf(stderr, "Error. Unable to write the sky table to the file (%s). Exiting.\n", filename);
+		exit(-1);
+	}
+}
+
+static void Detector_Sky_Table_read(FILE *file, void *data, size_t size, size_t count, const char *filename) {
+	if (fread(data, size, count, file) != count) {
+		fprintf(stderr, "Error. The sky table file (%s) is truncated. Exiting.\n", filename);
+		exit(-1);
+	}
+}
+
+void Detector_Sky_Table_save(const detector_sky_table_t *table, const char *filename) {
+	assert(table != NULL);
+	assert(filename != NULL);
+
+	uint32_t byte_order = DETECTOR_SKY_TABLE_BYTE_ORDER;
+	uint64_t dims[3];
+	int32_t id;
+	size_t i;
+
+	FILE *file = fopen(filename, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Error. Unable to open the file (%s) for writing the sky table. Exiting.\n", filename);
+		exit(-1);
+	}
+
+	dims[0] = table->num_detectors;
+	dims[1] = table->num_ra;
+	dims[2] = table->num_dec;
+
+	Detector_Sky_Table_write(file, DETECTOR_SKY_TABLE_MAGIC, 1, strlen(DETECTOR_SKY_TABLE_MAGIC), filename);
+	Detector_Sky_Table_write(file, &byte_order, sizeof(byte_order), 1, filename);
+	Detector_Sky_Table_write(file, dims, sizeof(uint64_t), 3, filename);
+	for (i = 0; i < table->num_detectors; i++) {
+		id = table->ids[i];
+		Detector_Sky_Table_write(file, &id, sizeof(id), 1, filename);
+	}
+	Detector_Sky_Table_write(file, &table->error_bound_uv, sizeof(double), 1, filename);
+	Detector_Sky_Table_write(file, &table->error_bound_time_delay, sizeof(double), 1, filename);
+	Detector_Sky_Table_write(file, table->values, sizeof(double),
+			table->num_ra * table->num_dec * 3 * table->num_detectors, filename);
+
+	fclose(file);
+}
+
+detector_sky_table_t* Detector_Sky_Table_load(const char *filename) {
+	assert(filename != NULL);
+
+	char magic[sizeof(DETECTOR_SKY_TABLE_MAGIC)];
+	uint32_t byte_order;
+	uint64_t dims[3];
+	int32_t id;
+	size_t i;
+	detector_sky_table_t *table;
+
+	FILE *file = fopen(filename, "rb");
+	if (file == NULL) {
+		return NULL;
+	}
+
+	memset(magic, '\0', sizeof(magic));
+	Detector_Sky_Table_read(file, magic, 1, strlen(DETECTOR_SKY_TABLE_MAGIC), filename);
+	Detector_Sky_Table_read(file, &byte_order, sizeof(byte_order), 1, filename);
+	if (strcmp(magic, DETECTOR_SKY_TABLE_MAGIC) != 0 || byte_order != DETECTOR_SKY_TABLE_BYTE_ORDER) {
+		fprintf(stderr, "Error. The file (%s) is not a sky table saved on a machine with this byte order. Exiting.\n", filename);
+		exit(-1);
+	}
+
+	Detector_Sky_Table_read(file, dims, sizeof(uint64_t), 3, filename);
+	if (dims[0] == 0 || dims[1] < 4 || dims[2] < 2) {
+		fprintf(stderr, "Error. The sky table file (%s) has an invalid size. Exiting.\n", filename);
+		exit(-1);
+	}
+
+	table = Detector_Sky_Table_alloc(dims[0], dims[1], dims[2]);
+	for (i = 0; i < table->num_detectors; i++) {
+		Detector_Sky_Table_read(file, &id, sizeof(id), 1, filename);
+		table->ids[i] = (DETECTOR_ID) id;
+	}
+	Detector_Sky_Table_read(file, &table->error_bound_uv, sizeof(double), 1, filename);
+	Detector_Sky_Table_read(file, &table->error_bound_time_delay, sizeof(double), 1, filename);
+	Detector_Sky_Table_read(file, table->values, sizeof(double),
+			table->num_ra * table->num_dec * 3 * table->num_detectors, filename);
+
+	fclose(file);
+
+	return table;
+}
+
+int Detector_Sky_Table_matches(const detector_sky_table_t *table, size_t num_detectors, detector_t **detectors) {
+	assert(table != NULL);
+	assert(detectors != NULL);
+
+	size_t i;
+
+	if (table->num_detectors != num_detectors) {
+		return 0;
+	}
+	for (i = 0; i < num_detectors; i++) {
+		if (table->ids[i] != detectors[i]->id) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int Detector_Sky_Table_has_resolution(const detector_sky_table_t *table, double resolution) {
+	assert(table != NULL);
+	assert(resolution > 0.0);
+
+	/* Detector_Sky_Table_build's steps are 2 pi / ceil(2 pi / resolution), which can round to just above it */
+	double tolerance = resolution * 1e-12;
+	return table->ra_step <= resolution + tolerance && table->dec_step <= resolution + tolerance;
+}
+
+int Detector_Sky_Table_lookup(const detector_sky_table_t *table, const sky_t *sky, size_t stride,
+		double *out_u, double *out_v, double *out_time_delay)
+{
+	assert(table != NULL);
+	assert(sky != NULL);
+
+	size_t node_len = 3 * table->num_detectors;
+	size_t i, j0, j1, k;
+	double x, y, fx, fy, w00, w01, w10, w11;
+	const double *n00, *n01, *n10, *n11;
+
+	if (!(sky->dec >= -M_PI_2 && sky->dec <= M_PI_2)) {
+		return -1;
+	}
+
+	/* ra wraps around, the last column is followed by the first */
+	x = fmod(sky->ra, 2.0 * M_PI);
+	if (x < 0.0) {
+		x += 2.0 * M_PI;
+	}
+	x /= table->ra_step;
+	j0 = (size_t) x;
+	fx = x - j0;
+	if (j0 >= table->num_ra) {
+		j0 = 0;
+		fx = 0.0;
+	}
+	j1 = (j0 + 1 == table->num_ra) ? 0 : j0 + 1;
+
+	y = (sky->dec + M_PI_2) / table->dec_step;
+	k = (size_t) y;
+	if (k > table->num_dec - 2) {
+		k = table->num_dec - 2;
+	}
+	fy = y - k;
+
+	w00 = (1.0 - fx) * (1.0 - fy);
+	w01 = fx * (1.0 - fy);
+	w10 = (1.0 - fx) * fy;
+	w11 = fx * fy;
+
+	n00 = table->values + (k*table->num_ra + j0) * node_len;
+	n01 = table->values + (k*table->num_ra + j1) * node_len;
+	n10 = table->values + ((k + 1)*table->num_ra + j0) * node_len;
+	n11 = table->values + ((k + 1)*table->num_ra + j1) * node_len;
+
+	for (i = 0; i < table->num_detectors; i++) {
+		if (out_u != NULL) {
+			out_u[i*stride] = w00*n00[3*i] + w01*n01[3*i] + w10*n10[3*i] + w11*n11[3*i];
+		}
+		if (out_v != NULL) {
+			out_v[i*stride] = w00*n00[3*i + 1] + w01*n01[3*i + 1] + w10*n10[3*i + 1] + w11*n11[3*i + 1];
+		}
+		if (out_time_delay != NULL) {
+			out_time_delay[i*stride] = w00*n00[3*i + 2] + w01*n01[3*i + 2] + w10*n10[3*i + 2] + w11*n11[3*i + 2];
+		}
+	}
+
+	return 0;
+}
+
+size_t Detector_Sky_Table_footprint(const detector_sky_table_t *table) {
+	assert(table != NULL);
+
+	return sizeof(detector_sky_table_t) + table->num_detectors * sizeof(DETECTOR_ID)
+			+ table->num_ra * table->num_dec * 3 * table->num_detectors * sizeof(double);
+}
@@ -0,0 +1,81 @@
+#ifndef SRC_C_DETECTOR_SKY_TABLE_H_
+#define SRC_C_DETECTOR_SKY_TABLE_H_
+
+#include <stddef.h>
+
+#include "detector.h"
+#include "sky.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* A table of the antenna patterns u, v and the time delay of every detector of a network on a grid of sky
+ * positions, which are bilinearly interpolated instead of computed for each template.
+ *
+ * The nodes are at ra = j * ra_step (j < num_ra, wrapping around at 2 pi) and dec = -pi/2 + k * dec_step
+ * (k < num_dec), so that the whole sky is covered with the same spacing. The grid is uniform in ra at every
+ * declination, rather than equal-area, since the polarization basis turns with ra at the same rate near the
+ * poles as at the equator.
+ *
+ * Interpolation error bound: bilinear interpolation is off by at most
+ *   h_ra^2 / 8 * max |d^2 f / d ra^2| + h_dec^2 / 8 * max |d^2 f / d dec^2|
+ * For u and v the second derivatives are at most 8 |D| and 4 |D|, where |D| is the Frobenius norm of the detector
+ * tensor (1/sqrt(2) for perpendicular arms), and for the time delay they are at most |r| / c, the distance of the arm
+ * vertex from the Earth's center divided by the speed of light. So
+ *   error_bound_uv = |D| (h_ra^2 + h_dec^2 / 2) and error_bound_time_delay = |r| / c (h_ra^2 + h_dec^2) / 8
+ * e.g. about 1e-4 and 5e-7 s for a 0.01 radian grid.
+ *
+ * It is read-only after it is built or loaded, so one can be used by any number of threads.
+ */
+typedef struct detector_sky_table_s {
+	/* The detectors the table was computed for, in the network's order */
+	size_t num_detectors;
+	DETECTOR_ID *ids;
+
+	size_t num_ra;
+	size_t num_dec;
+	double ra_step;
+	double dec_step;
+
+	/* u, v and the time delay of each detector at each node: node (j, k) starts at
+	 * (k*num_ra + j) * 3*num_detectors, then u, v, time delay for detector 0, 1, ... */
+	double *values;
+
+	/* The largest interpolation errors, see above */
+	double error_bound_uv;
+	double error_bound_time_delay;
+
+} detector_sky_table_t;
+
+/* Computes the table with nodes at most resolution radians apart. */
+detector_sky_table_t* Detector_Sky_Table_build(size_t num_detectors, detector_t **detectors, double resolution);
+
+void Detector_Sky_Table_free(detector_sky_table_t *table);
+
+/* Writes the table to a binary file in the machine's byte order. */
+void Detector_Sky_Table_save(const detector_sky_table_t *table, const char *filename);
+
+/* Reads a table written by Detector_Sky_Table_save. Returns NULL if the file can't be opened, e.g. it doesn't exist yet. */
+detector_sky_table_t* Detector_Sky_Table_load(const char *filename);
+
+/* Returns non-zero if the table was computed for the detectors, in the same order. */
+int Detector_Sky_Table_matches(const detector_sky_table_t *table, size_t num_detectors, detector_t **detectors);
+
+/* Returns non-zero if the nodes are at most resolution radians apart, as for a table built with that resolution. */
+int Detector_Sky_Table_has_resolution(const detector_sky_table_t *table, double resolution);
+
+/* Interpolates u, v and the time delay of each detector i at the sky position, written to out_*[i*stride].
+ * Any of the outputs can be NULL. Returns -1, without writing anything, if the declination is outside
+ * [-pi/2, pi/2], and 0 otherwise. */
+int Detector_Sky_Table_lookup(const detector_sky_table_t *table, const sky_t *sky, size_t stride,
+		double *out_u, double *out_v, double *out_time_delay);
+
+/* The memory used by the table (bytes) */
+size_t Detector_Sky_Table_footprint(const detector_sky_table_t *table);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* SRC_C_DETECTOR_SKY_TABLE_H_ */
@@ -0,0 +1,686 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+
+#include <gsl/gsl_complex.h>
+#include <gsl/gsl_complex_math.h>
+#include <gsl/gsl_fft_complex.h>
+#include <gsl/gsl_fft_complex_float.h>
+#include <gsl/gsl_fft_halfcomplex.h>
+#include <gsl/gsl_fft_real.h>
+
+#ifdef HAVE_FFTW3
+	#include <fftw3.h>
+#endif
+
+#include "fft.h"
+
+/* The single precision transforms only use fftw3f when the double ones use FFTW as well */
+#if defined(HAVE_FFTW3) && defined(HAVE_FFTW3F)
+	#define FFT_SINGLE_FFTW
+#endif
+
+struct fft_plan_s {
+	size_t n;
+	size_t howmany;
+	FFT_KIND kind;
+
+#ifdef HAVE_FFTW3
+	fftw_plan plan;
+#else
+	gsl_fft_complex_wavetable *complex_wavetable;
+	gsl_fft_real_wavetable *real_wavetable;
+	gsl_fft_halfcomplex_wavetable *halfcomplex_wavetable;
+#endif
+
+	/* FFT_COMPLEX_INVERSE_SINGLE plans only use these */
+#ifdef FFT_SINGLE_FFTW
+	fftwf_plan plan_single;
+#else
+	gsl_fft_complex_wavetable_float *complex_wavetable_single;
+#endif
+
+	struct fft_plan_s *next;
+};
+
+struct fft_workspace_s {
+	size_t n;
+
+	/* The plans of length n that were used with the workspace, so that only the first transform of each kind
+	 * looks in the cache. plans_many holds the last plan of each kind for more than one transform. They are
+	 * looked up again after FFT_plan_cache_clear, which changes fft_plan_cache_generation. */
+	fft_plan_t *plans[FFT_NUM_KINDS];
+	fft_plan_t *plans_many[FFT_NUM_KINDS];
+	unsigned long plan_generation;
+
+#ifdef HAVE_FFTW3
+	/* Aligned copies for arrays that don't have the alignment that the plans were made with.
+	 * buffer holds n complex values and buffer_real n real values. */
+	double *buffer;
+	double *buffer_real;
+#else
+	gsl_fft_complex_workspace *complex_workspace;
+	gsl_fft_real_workspace *real_workspace;
+	/* a real transform in the GSL halfcomplex packed form */
+	double *packed;
+#endif
+
+	/* The scratch memory of the single precision transforms, NULL until they are first used. */
+#ifdef FFT_SINGLE_FFTW
+	float *buffer_single;
+#else
+	gsl_fft_complex_workspace_float *complex_workspace_single;
+#endif
+};
+
+/* Every plan that has been made, most recent first. It is only accessed inside the fft_planner critical
+ * section, which also protects the FFTW planner since it isn't thread safe. */
+static fft_plan_t *fft_plan_cache = NULL;
+
+/* Incremented by FFT_plan_cache_clear. It only changes when no transform is running. */
+static unsigned long fft_plan_cache_generation = 0;
+
+static FFT_PLAN_RIGOR fft_plan_rigor = FFT_PLAN_MEASURE;
+
+const char* FFT_backend_name(void) {
+#ifdef HAVE_FFTW3
+	return "fftw3";
+#else
+	return "gsl";
+#endif
+}
+
+void FFT_set_plan_rigor(FFT_PLAN_RIGOR rigor) {
+	fft_plan_rigor = rigor;
+}
+
+/* Operations per sample of one radix p pass */
+static double FFT_radix_cost(size_t p) {
+#ifdef HAVE_FFTW3
+	/* FFTW has codelets for the small primes */
+	if (p > 13) {
+		return 3.0 * FFT_cost_estimate(p - 1) / (p - 1);
+	}
+#endif
+	return (double) p;
+}
+
+double FFT_cost_estimate(size_t n) {
+	assert(n > 0);
+
+	size_t p;
+	size_t m = n;
+	double cost = 0.0;
+
+	for (p = 2; p * p <= m; p++) {
+		while (m % p == 0) {
+			cost += FFT_radix_cost(p);
+			m /= p;
+		}
+	}
+	if (m > 1) {
+		cost += FFT_radix_cost(m);
+	}
+
+	/* a length of one still has to be copied */
+	if (cost == 0.0) {
+		cost = 1.0;
+	}
+
+	return n * cost;
+}
+
+static void FFT_plan_create_single(fft_plan_t *plan) {
+#ifdef HAVE_FFTW3
+	plan->plan = NULL;
+#else
+	plan->complex_wavetable = NULL;
+	plan->real_wavetable = NULL;
+	plan->halfcomplex_wavetable = NULL;
+#endif
+
+#ifdef FFT_SINGLE_FFTW
+	unsigned flags = (fft_plan_rigor == FFT_PLAN_MEASURE) ? FFTW_MEASURE : FFTW_ESTIMATE;
+	int len = (int) plan->n;
+	fftwf_complex *c = (fftwf_complex*) fftwf_malloc( plan->howmany * plan->n * sizeof(fftwf_complex) );
+	if (c == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory in FFT_plan_create_single(). Exiting.\n");
+		exit(-1);
+	}
+
+	plan->plan_single = fftwf_plan_many_dft(1, &len, (int) plan->howmany,
+			c, NULL, 1, len,
+			c, NULL, 1, len,
+			FFTW_BACKWARD, flags);
+	fftwf_free(c);
+
+	if (plan->plan_single == NULL) {
+		fprintf(stderr, "Error. FFTW was unable to create a single precision plan of length %lu. Exiting.\n", plan->n);
+		exit(-1);
+	}
+#else
+	plan->complex_wavetable_single = gsl_fft_complex_wavetable_float_alloc( plan->n );
+#endif
+}
+
+static fft_plan_t* FFT_plan_create(size_t n, size_t howmany, FFT_KIND kind) {
+	fft_plan_t *plan = (fft_plan_t*) malloc( sizeof(fft_plan_t) );
+	if (plan == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory in FFT_plan_create(). Exiting.\n");
+		exit(-1);
+	}
+
+	plan->n = n;
+	plan->howmany = howmany;
+	plan->kind = kind;
+	plan->next = NULL;
+
+	if (kind == FFT_COMPLEX_INVERSE_SINGLE) {
+		FFT_plan_create_single(plan);
+		return plan;
+	}
+
+#ifdef FFT_SINGLE_FFTW
+	plan->plan_single = NULL;
+#else
+	plan->complex_wavetable_single = NULL;
+#endif
+
+#ifdef HAVE_FFTW3
+	/* The planner may overwrite the arrays, so it is given its own. */
+	unsigned flags = (fft_plan_rigor == FFT_PLAN_MEASURE) ? FFTW_MEASURE : FFTW_ESTIMATE;
+	int len = (int) n;
+	fftw_complex *c = (fftw_complex*) fftw_malloc( howmany * n * sizeof(fftw_complex) );
+	double *r = (double*) fftw_malloc( n * sizeof(double) );
+	if (c == NULL || r == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory in FFT_plan_create(). Exiting.\n");
+		exit(-1);
+	}
+
+	switch (kind) {
+	case FFT_COMPLEX_FORWARD:
+	case FFT_COMPLEX_INVERSE:
+		plan->plan = fftw_plan_many_dft(1, &len, (int) howmany,
+				c, NULL, 1, len,
+				c, NULL, 1, len,
+				(kind == FFT_COMPLEX_FORWARD) ? FFTW_FORWARD : FFTW_BACKWARD, flags);
+		break;
+	case FFT_REAL_FORWARD:
+		plan->plan = fftw_plan_dft_r2c_1d(len, r, c, flags);
+		break;
+	case FFT_REAL_INVERSE:
+		plan->plan = fftw_plan_dft_c2r_1d(len, c, r, flags);
+		break;
+	default:
+		plan->plan = NULL;
+		break;
+	}
+
+	fftw_free(c);
+	fftw_free(r);
+
+	if (plan->plan == NULL) {
+		fprintf(stderr, "Error. FFTW was unable to create a plan of length %lu. Exiting.\n", n);
+		exit(-1);
+	}
+#else
+	plan->complex_wavetable = NULL;
+	plan->real_wavetable = NULL;
+	plan->halfcomplex_wavetable = NULL;
+
+	switch (kind) {
+	case FFT_COMPLEX_FORWARD:
+	case FFT_COMPLEX_INVERSE:
+		plan->complex_wavetable = gsl_fft_complex_wavetable_alloc( n );
+		break;
+	case FFT_REAL_FORWARD:
+		plan->real_wavetable = gsl_fft_real_wavetable_alloc( n );
+		break;
+	case FFT_REAL_INVERSE:
+		plan->halfcomplex_wavetable = gsl_fft_halfcomplex_wavetable_alloc( n );
+		break;
+	default:
+		break;
+	}
+#endif
+
+	return plan;
+}
+
+static void FFT_plan_destroy(fft_plan_t *plan) {
+	assert(plan != NULL);
+
+	if (plan->kind == FFT_COMPLEX_INVERSE_SINGLE) {
+#ifdef FFT_SINGLE_FFTW
+		fftwf_destroy_plan(plan->plan_single);
+#else
+		gsl_fft_complex_wavetable_float_free(plan->complex_wavetable_single);
+#endif
+		free(plan);
+		return;
+	}
+
+#ifdef HAVE_FFTW3
+	fftw_destroy_plan(plan->plan);
+#else
+	if (plan->complex_wavetable != NULL) {
+		gsl_fft_complex_wavetable_free(plan->complex_wavetable);
+	}
+	if (plan->real_wavetable != NULL) {
+		gsl_fft_real_wavetable_free(plan->real_wavetable);
+	}
+	if (plan->halfcomplex_wavetable != NULL) {
+		gsl_fft_halfcomplex_wavetable_free(plan->halfcomplex_wavetable);
+	}
+#endif
+
+	free(plan);
+}
+
+fft_plan_t* FFT_plan_get(size_t n, size_t howmany, FFT_KIND kind) {
+	assert(n > 0);
+	assert(howmany > 0);
+	assert(kind < FFT_NUM_KINDS);
+
+	fft_plan_t *plan;
+
+#ifdef HAVE_OPENMP
+	#pragma omp critical (fft_planner)
+#endif
+	{
+		for (plan = fft_plan_cache; plan != NULL; plan = plan->next) {
+			if (plan->n == n && plan->howmany == howmany && plan->kind == kind) {
+				break;
+			}
+		}
+
+		if (plan == NULL) {
+			plan = FFT_plan_create(n, howmany, kind);
+			plan->next = fft_plan_cache;
+			fft_plan_cache = plan;
+		}
+	}
+
+	return plan;
+}
+
+void FFT_plan_cache_clear(void) {
+#ifdef HAVE_OPENMP
+	#pragma omp critical (fft_planner)
+#endif
+	{
+		while (fft_plan_cache != NULL) {
+			fft_plan_t *next = fft_plan_cache->next;
+			FFT_plan_destroy(fft_plan_cache);
+			fft_plan_cache = next;
+		}
+		fft_plan_cache_generation++;
+	}
+}
+
+/* The plan for howmany transforms of the workspace's length. The planner lock is only taken the first time
+ * the workspace uses each plan. */
+static fft_plan_t* FFT_workspace_plan(fft_workspace_t *workspace, size_t howmany, FFT_KIND kind) {
+	size_t k;
+
+	if (workspace->plan_generation != fft_plan_cache_generation) {
+		for (k = 0; k < FFT_NUM_KINDS; k++) {
+			workspace->plans[k] = NULL;
+			workspace->plans_many[k] = NULL;
+		}
+		workspace->plan_generation = fft_plan_cache_generation;
+	}
+
+	fft_plan_t **plan = (howmany == 1) ? &workspace->plans[kind] : &workspace->plans_many[kind];
+	if (*plan == NULL || (*plan)->howmany != howmany) {
+		*plan = FFT_plan_get(workspace->n, howmany, kind);
+	}
+
+	return *plan;
+}
+
+int FFT_wisdom_import(const char *filename) {
+	assert(filename != NULL);
+
+	int status = -1;
+
+#ifdef HAVE_FFTW3
+	#ifdef HAVE_OPENMP
+	#pragma omp critical (fft_planner)
+	#endif
+	{
+		status = fftw_import_wisdom_from_filename(filename) ? 0 : -1;
+	}
+#endif
+
+	return status;
+}
+
+int FFT_wisdom_export(const char *filename) {
+	assert(filename != NULL);
+
+	int status = -1;
+
+#ifdef HAVE_FFTW3
+	#ifdef HAVE_OPENMP
+	#pragma omp critical (fft_planner)
+	#endif
+	{
+		status = fftw_export_wisdom_to_filename(filename) ? 0 : -1;
+	}
+#endif
+
+	return status;
+}
+
+fft_workspace_t* FFT_workspace_alloc(size_t n) {
+	assert(n > 0);
+
+	fft_workspace_t *workspace = (fft_workspace_t*) malloc( sizeof(fft_workspace_t) );
+	if (workspace == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory in FFT_workspace_alloc(). Exiting.\n");
+		exit(-1);
+	}
+
+	workspace->n = n;
+
+	size_t k;
+	for (k = 0; k < FFT_NUM_KINDS; k++) {
+		workspace->plans[k] = NULL;
+		workspace->plans_many[k] = NULL;
+	}
+	workspace->plan_generation = fft_plan_cache_generation;
+
+#ifdef HAVE_FFTW3
+	workspace->buffer = (double*) fftw_malloc( 2 * n * sizeof(double) );
+	workspace->buffer_real = (double*) fftw_malloc( n * sizeof(double) );
+	if (workspace->buffer == NULL || workspace->buffer_real == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory in FFT_workspace_alloc(). Exiting.\n");
+		exit(-1);
+	}
+#else
+	workspace->complex_workspace = gsl_fft_complex_workspace_alloc( n );
+	workspace->real_workspace = gsl_fft_real_workspace_alloc( n );
+	workspace->packed = (double*) malloc( n * sizeof(double) );
+	if (workspace->packed == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory in FFT_workspace_alloc(). Exiting.\n");
+		exit(-1);
+	}
+#endif
+
+#ifdef FFT_SINGLE_FFTW
+	workspace->buffer_single = NULL;
+#else
+	workspace->complex_workspace_single = NULL;
+#endif
+
+	return workspace;
+}
+
+void FFT_workspace_free(fft_workspace_t *workspace) {
+	assert(workspace != NULL);
+
+#ifdef HAVE_FFTW3
+	fftw_free(workspace->buffer);
+	workspace->buffer = NULL;
+
+	fftw_free(workspace->buffer_real);
+	workspace->buffer_real = NULL;
+#else
+	gsl_fft_complex_workspace_free(workspace->complex_workspace);
+	workspace->complex_workspace = NULL;
+
+	gsl_fft_real_workspace_free(workspace->real_workspace);
+	workspace->real_workspace = NULL;
+
+	free(workspace->packed);
+	workspace->packed = NULL;
+#endif
+
+#ifdef FFT_SINGLE_FFTW
+	if (workspace->buffer_single != NULL) {
+		fftwf_free(workspace->buffer_single);
+		workspace->buffer_single = NULL;
+	}
+#else
+	if (workspace->complex_workspace_single != NULL) {
+		gsl_fft_complex_workspace_float_free(workspace->complex_workspace_single);
+		workspace->complex_workspace_single = NULL;
+	}
+#endif
+
+	free(workspace);
+}
+
+size_t FFT_workspace_footprint(const fft_workspace_t *workspace) {
+	assert(workspace != NULL);
+
+	size_t n = workspace->n;
+	size_t bytes = sizeof(fft_workspace_t);
+
+#ifdef HAVE_FFTW3
+	bytes += 3 * n * sizeof(double);
+#else
+	/* GSL keeps n complex trig values and 2n doubles of scratch for the complex transforms, and n / 2 complex
+	 * trig values and n doubles of scratch for the real ones. */
+	bytes += sizeof(gsl_fft_complex_workspace) + 4 * n * sizeof(double);
+	bytes += sizeof(gsl_fft_real_workspace) + 2 * n * sizeof(double);
+	bytes += n * sizeof(double);
+#endif
+
+#ifdef FFT_SINGLE_FFTW
+	if (workspace->buffer_single != NULL) {
+		bytes += 2 * n * sizeof(float);
+	}
+#else
+	if (workspace->complex_workspace_single != NULL) {
+		bytes += sizeof(gsl_fft_complex_workspace_float) + 2 * n * sizeof(float);
+	}
+#endif
+
+	return bytes;
+}
+
+#ifdef HAVE_FFTW3
+/* The plans were made with arrays from fftw_malloc, so they can only be executed on arrays with the same alignment. */
+static int FFT_is_aligned(void *p) {
+	return fftw_alignment_of( (double*) p ) == 0;
+}
+
+static void FFT_complex_execute(fft_plan_t *plan, size_t n, double *data, fft_workspace_t *workspace) {
+	if (FFT_is_aligned(data)) {
+		fftw_execute_dft(plan->plan, (fftw_complex*) data, (fftw_complex*) data);
+	} else {
+		memcpy(workspace->buffer, data, 2 * n * sizeof(double));
+		fftw_execute_dft(plan->plan, (fftw_complex*) workspace->buffer, (fftw_complex*) workspace->buffer);
+		memcpy(data, workspace->buffer, 2 * n * sizeof(double));
+	}
+}
+
+/* FFTW doesn't normalize the inverse transforms */
+static void FFT_scale(size_t len, double scale, double *data) {
+	size_t i;
+	for (i = 0; i < len; i++) {
+		data[i] *= scale;
+	}
+}
+#endif
+
+void FFT_complex_forward(size_t n, double *data, fft_workspace_t *workspace) {
+	assert(data != NULL);
+	assert(workspace != NULL);
+	assert(workspace->n == n);
+
+	fft_plan_t *plan = FFT_workspace_plan(workspace, 1, FFT_COMPLEX_FORWARD);
+
+#ifdef HAVE_FFTW3
+	FFT_complex_execute(plan, n, data, workspace);
+#else
+	gsl_fft_complex_forward(data, 1, n, plan->complex_wavetable, workspace->complex_workspace);
+#endif
+}
+
+void FFT_complex_inverse(size_t n, double *data, fft_workspace_t *workspace) {
+	assert(data != NULL);
+	assert(workspace != NULL);
+	assert(workspace->n == n);
+
+	fft_plan_t *plan = FFT_workspace_plan(workspace, 1, FFT_COMPLEX_INVERSE);
+
+#ifdef HAVE_FFTW3
+	FFT_complex_execute(plan, n, data, workspace);
+	FFT_scale(2 * n, 1.0 / n, data);
+#else
+	gsl_fft_complex_inverse(data, 1, n, plan->complex_wavetable, workspace->complex_workspace);
+#endif
+}
+
+void FFT_complex_inverse_many(size_t n, size_t howmany, double *data, fft_workspace_t *workspace) {
+	assert(data != NULL);
+	assert(workspace != NULL);
+	assert(workspace->n == n);
+
+	size_t i;
+
+#ifdef HAVE_FFTW3
+	if (howmany > 1 && FFT_is_aligned(data)) {
+		fft_plan_t *plan = FFT_workspace_plan(workspace, howmany, FFT_COMPLEX_INVERSE);
+		fftw_execute_dft(plan->plan, (fftw_complex*) data, (fftw_complex*) data);
+		FFT_scale(2 * n * howmany, 1.0 / n, data);
+		return;
+	}
+#endif
+
+	for (i = 0; i < howmany; i++) {
+		FFT_complex_inverse(n, data + 2*n*i, workspace);
+	}
+}
+
+void FFT_complex_inverse_many_single(size_t n, size_t howmany, float *data, fft_workspace_t *workspace) {
+	assert(data != NULL);
+	assert(workspace != NULL);
+	assert(workspace->n == n);
+
+	size_t i;
+	fft_plan_t *plan;
+
+#ifdef FFT_SINGLE_FFTW
+	if (fftwf_alignment_of(data) == 0) {
+		plan = FFT_workspace_plan(workspace, howmany, FFT_COMPLEX_INVERSE_SINGLE);
+		fftwf_execute_dft(plan->plan_single, (fftwf_complex*) data, (fftwf_complex*) data);
+	} else {
+		if (workspace->buffer_single == NULL) {
+			workspace->buffer_single = (float*) fftwf_malloc( 2 * n * sizeof(float) );
+			if (workspace->buffer_single == NULL) {
+				fprintf(stderr, "Error. Unable to allocate memory in FFT_complex_inverse_many_single(). Exiting.\n");
+				exit(-1);
+			}
+		}
+
+		plan = FFT_workspace_plan(workspace, 1, FFT_COMPLEX_INVERSE_SINGLE);
+		for (i = 0; i < howmany; i++) {
+			memcpy(workspace->buffer_single, data + 2*n*i, 2 * n * sizeof(float));
+			fftwf_execute_dft(plan->plan_single, (fftwf_complex*) workspace->buffer_single,
+					(fftwf_complex*) workspace->buffer_single);
+			memcpy(data + 2*n*i, workspace->buffer_single, 2 * n * sizeof(float));
+		}
+	}
+
+	const float scale = 1.0f / n;
+	for (i = 0; i < 2 * n * howmany; i++) {
+		data[i] *= scale;
+	}
+#else
+	if (workspace->complex_workspace_single == NULL) {
+		workspace->complex_workspace_single = gsl_fft_complex_workspace_float_alloc( n );
+	}
+
+	plan = FFT_workspace_plan(workspace, 1, FFT_COMPLEX_INVERSE_SINGLE);
+	for (i = 0; i < howmany; i++) {
+		gsl_fft_complex_float_inverse(data + 2*n*i, 1, n, plan->complex_wavetable_single,
+				workspace->complex_workspace_single);
+	}
+#endif
+}
+
+void FFT_real_forward(size_t n, double *in, gsl_complex *out_half, fft_workspace_t *workspace) {
+	assert(in != NULL);
+	assert(out_half != NULL);
+	assert(workspace != NULL);
+	assert(workspace->n == n);
+
+	fft_plan_t *plan = FFT_workspace_plan(workspace, 1, FFT_REAL_FORWARD);
+
+#ifdef HAVE_FFTW3
+	/* r2c doesn't modify its input, so only the alignment matters */
+	double *r = in;
+	if (!FFT_is_aligned(in)) {
+		memcpy(workspace->buffer_real, in, n * sizeof(double));
+		r = workspace->buffer_real;
+	}
+
+	if (FFT_is_aligned(out_half)) {
+		fftw_execute_dft_r2c(plan->plan, r, (fftw_complex*) out_half);
+	} else {
+		fftw_execute_dft_r2c(plan->plan, r, (fftw_complex*) workspace->buffer);
+		memcpy(out_half, workspace->buffer, (n/2 + 1) * sizeof(gsl_complex));
+	}
+#else
+	size_t k;
+	double *packed = workspace->packed;
+
+	memcpy(packed, in, n * sizeof(double));
+	gsl_fft_real_transform(packed, 1, n, plan->real_wavetable, workspace->real_workspace);
+
+	/* GSL packs the result as DC, (real, imag) pairs and then the real Nyquist term if n is even. */
+	out_half[0] = gsl_complex_rect(packed[0], 0.0);
+	for (k = 1; 2*k < n; k++) {
+		out_half[k] = gsl_complex_rect(packed[2*k - 1], packed[2*k]);
+	}
+	if (n % 2 == 0) {
+		out_half[n/2] = gsl_complex_rect(packed[n - 1], 0.0);
+	}
+#endif
+}
+
+void FFT_real_inverse(size_t n, gsl_complex *in_half, double *out, fft_workspace_t *workspace) {
+	assert(in_half != NULL);
+	assert(out != NULL);
+	assert(workspace != NULL);
+	assert(workspace->n == n);
+
+	fft_plan_t *plan = FFT_workspace_plan(workspace, 1, FFT_REAL_INVERSE);
+
+#ifdef HAVE_FFTW3
+	/* c2r overwrites its input, so it always works on a copy */
+	memcpy(workspace->buffer, in_half, (n/2 + 1) * sizeof(gsl_complex));
+
+	if (FFT_is_aligned(out)) {
+		fftw_execute_dft_c2r(plan->plan, (fftw_complex*) workspace->buffer, out);
+	} else {
+		fftw_execute_dft_c2r(plan->plan, (fftw_complex*) workspace->buffer, workspace->buffer_real);
+		memcpy(out, workspace->buffer_real, n * sizeof(double));
+	}
+	FFT_scale(n, 1.0 / n, out);
+#else
+	size_t k;
+
+	/* pack into the output and transform it in place */
+	out[0] = GSL_REAL(in_half[0]);
+	for (k = 1; 2*k < n; k++) {
+		out[2*k - 1] = GSL_REAL(in_half[k]);
+		out[2*k] = GSL_IMAG(in_half[k]);
+	}
+	if (n % 2 == 0) {
+		out[n - 1] = GSL_REAL(in_half[n/2]);
+	}
+
+	gsl_fft_halfcomplex_inverse(out, 1, n, plan->halfcomplex_wavetable, workspace->real_workspace);
+#endif
+}
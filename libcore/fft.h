@@ -0,0 +1,92 @@
+#ifndef FFT_H_
+#define FFT_H_
+
+#include <stddef.h>
+
+#include <gsl/gsl_complex.h>
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* All of the transforms in libcore go through these functions. FFTW3 is used when configure finds it,
+ * otherwise GSL. The conventions are GSL's: complex data is interleaved (real, imag) pairs, the forward
+ * transform uses exp(-i...), and the inverse transforms are normalized by 1/n.
+ *
+ * Plans are created once per size and kind and kept in a process-wide cache, so getting a plan is cheap
+ * after the first time. The scratch memory used while a transform runs is in an fft_workspace_t, which
+ * must not be shared between threads. Each workspace also keeps the plans it has used, so the transforms
+ * only take the cache's lock the first time a workspace needs a plan.
+ */
+
+typedef enum {
+	FFT_COMPLEX_FORWARD = 0,
+	FFT_COMPLEX_INVERSE,
+	FFT_REAL_FORWARD,
+	FFT_REAL_INVERSE,
+	FFT_COMPLEX_INVERSE_SINGLE,
+	FFT_NUM_KINDS
+} FFT_KIND;
+
+typedef enum {
+	FFT_PLAN_ESTIMATE = 0,
+	FFT_PLAN_MEASURE
+} FFT_PLAN_RIGOR;
+
+/* The contents depend on the backend, so they are only defined in fft.c */
+typedef struct fft_plan_s fft_plan_t;
+typedef struct fft_workspace_s fft_workspace_t;
+
+/* Returns the name of the backend, "fftw3" or "gsl". */
+const char* FFT_backend_name(void);
+
+/* A rough relative cost of one transform of length n for the configured backend, for comparing lengths.
+ * It counts about n * p operations for every radix p pass. GSL does that for any prime, but FFTW uses
+ * Rader's algorithm for large primes, which costs about three transforms of length p - 1. */
+double FFT_cost_estimate(size_t n);
+
+/* Returns the cached plan for howmany contiguous transforms of length n, creating it if needed.
+ * It is thread safe, and the plan is owned by the cache. */
+fft_plan_t* FFT_plan_get(size_t n, size_t howmany, FFT_KIND kind);
+
+/* Frees every cached plan. No plan can be in use when this is called. The workspaces look their plans up
+ * again on their next transform. */
+void FFT_plan_cache_clear(void);
+
+/* Sets how much effort FFTW spends finding fast plans. It only affects plans created afterwards. */
+void FFT_set_plan_rigor(FFT_PLAN_RIGOR rigor);
+
+/* Loads and saves FFTW wisdom so that measured plans don't have to be found again on every run.
+ * Both return 0 on success, and -1 if the file couldn't be used or the backend isn't FFTW. */
+int FFT_wisdom_import(const char *filename);
+int FFT_wisdom_export(const char *filename);
+
+/* Scratch memory for the transforms of length n. */
+fft_workspace_t* FFT_workspace_alloc(size_t n);
+void FFT_workspace_free(fft_workspace_t *workspace);
+
+/* The bytes allocated for the workspace. The plans are in the cache and aren't counted. */
+size_t FFT_workspace_footprint(const fft_workspace_t *workspace);
+
+/* In-place transforms of n interleaved complex values. */
+void FFT_complex_forward(size_t n, double *data, fft_workspace_t *workspace);
+void FFT_complex_inverse(size_t n, double *data, fft_workspace_t *workspace);
+
+/* In-place inverse transforms of howmany series of n complex values stored one after another. */
+void FFT_complex_inverse_many(size_t n, size_t howmany, double *data, fft_workspace_t *workspace);
+
+/* The same in single precision, with interleaved float pairs. It uses FFTW's fftw3f when configure finds both
+ * libraries, otherwise GSL's float transforms. The scratch memory for it is only allocated by the first call. */
+void FFT_complex_inverse_many_single(size_t n, size_t howmany, float *data, fft_workspace_t *workspace);
+
+/* Transforms n real samples into the n/2 + 1 non-negative frequency bins. */
+void FFT_real_forward(size_t n, double *in, gsl_complex *out_half, fft_workspace_t *workspace);
+
+/* Transforms the n/2 + 1 non-negative frequency bins of a real series back to the n samples. */
+void FFT_real_inverse(size_t n, gsl_complex *in_half, double *out, fft_workspace_t *workspace);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* FFT_H_ */
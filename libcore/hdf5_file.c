@@ -367,3 +367,171 @@ void hdf5_save_array(const char *hdf5_filename, const char* group_name, const ch
 	H5Gclose(group_id);
 	H5Fclose(file_id);
 }
+
+struct hdf5_row_writer_s {
+	hid_t file_id;
+	hid_t dataset_id;
+	hsize_t num_rows;
+	size_t len;
+
+	/* For the error messages */
+	char *filename;
+	char *dataset_name;
+};
+
+static char* hdf5_copy_string(const char *s) {
+	char *copy = (char*) malloc( strlen(s) + 1 );
+	if (copy == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: hdf5_row_writer_open(). Exiting.\n");
+		exit(-1);
+	}
+	strcpy(copy, s);
+	return copy;
+}
+
+hdf5_row_writer_t* hdf5_row_writer_open(const char *hdf5_filename, const char *dataset_name, size_t len) {
+	assert(hdf5_filename != NULL);
+	assert(dataset_name != NULL);
+	assert(len > 0);
+
+	hid_t file_id, dataset_id, file_space_id;
+	hsize_t dims[2];
+
+	/* Only open the file if it is there, so that HDF5 doesn't report an error */
+	FILE *probe = fopen(hdf5_filename, "r");
+	if (probe != NULL) {
+		fclose(probe);
+		file_id = H5Fopen( hdf5_filename, H5F_ACC_RDWR, H5P_DEFAULT);
+	} else {
+		file_id = H5Fcreate( hdf5_filename, H5F_ACC_EXCL, H5P_DEFAULT, H5P_DEFAULT);
+	}
+	if (file_id < 0) {
+		fprintf(stderr, "Error opening (%s) to append to the dataset (%s). Aborting.\n",
+				hdf5_filename, dataset_name);
+		exit(-1);
+	}
+
+	if (H5Lexists(file_id, dataset_name, H5P_DEFAULT) > 0) {
+		dataset_id = H5Dopen2(file_id, dataset_name, H5P_DEFAULT);
+		if (dataset_id < 0) {
+			fprintf(stderr, "Error opening the dataset (%s) in the file (%s). Aborting.\n",
+					dataset_name, hdf5_filename);
+			exit(-1);
+		}
+
+		file_space_id = H5Dget_space(dataset_id);
+		int ndims = H5Sget_simple_extent_ndims(file_space_id);
+		if (ndims == 2) {
+			H5Sget_simple_extent_dims(file_space_id, dims, NULL);
+		}
+		H5Sclose(file_space_id);
+
+		if (ndims != 2 || dims[1] != len) {
+			fprintf(stderr, "Error. The rows of the dataset (%s) in the file (%s) aren't %lu long. Aborting.\n",
+					dataset_name, hdf5_filename, len);
+			exit(-1);
+		}
+	} else {
+		/* Rows are the chunks, so appending one only writes that row */
+		hsize_t initial_dims[2] = {0, len};
+		hsize_t max_dims[2] = {H5S_UNLIMITED, len};
+		hsize_t chunk_dims[2] = {1, len};
+
+		file_space_id = H5Screate_simple(2, initial_dims, max_dims);
+		hid_t properties_id = H5Pcreate(H5P_DATASET_CREATE);
+		H5Pset_chunk(properties_id, 2, chunk_dims);
+
+		dataset_id = H5Dcreate2(file_id, dataset_name, H5T_NATIVE_DOUBLE, file_space_id,
+				H5P_DEFAULT, properties_id, H5P_DEFAULT);
+		if (dataset_id < 0) {
+			fprintf(stderr, "Error creating the dataset (%s) in the file (%s). Aborting.\n",
+					dataset_name, hdf5_filename);
+			exit(-1);
+		}
+
+		H5Pclose(properties_id);
+		H5Sclose(file_space_id);
+
+		dims[0] = 0;
+	}
+
+	hdf5_row_writer_t *writer = (hdf5_row_writer_t*) malloc( sizeof(hdf5_row_writer_t) );
+	if (writer == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: hdf5_row_writer_open(). Exiting.\n");
+		exit(-1);
+	}
+
+	writer->file_id = file_id;
+	writer->dataset_id = dataset_id;
+	writer->num_rows = dims[0];
+	writer->len = len;
+	writer->filename = hdf5_copy_string(hdf5_filename);
+	writer->dataset_name = hdf5_copy_string(dataset_name);
+
+	return writer;
+}
+
+void hdf5_row_writer_append(hdf5_row_writer_t *writer, size_t len, const double *array) {
+	assert(writer != NULL);
+	assert(array != NULL);
+
+	if (len != writer->len) {
+		fprintf(stderr, "Error. The rows of the dataset (%s) in the file (%s) are %lu long, not %lu. Aborting.\n",
+				writer->dataset_name, writer->filename, writer->len, len);
+		exit(-1);
+	}
+
+	hid_t file_space_id, memory_space_id;
+	herr_t status;
+	hsize_t dims[2];
+	hsize_t start[2];
+	hsize_t count[2];
+
+	/* Add a row and write the values to it */
+	dims[0] = writer->num_rows + 1;
+	dims[1] = writer->len;
+	status = H5Dset_extent(writer->dataset_id, dims);
+	if (status < 0) {
+		fprintf(stderr, "Error extending the dataset (%s) in the file (%s). Aborting.\n",
+				writer->dataset_name, writer->filename);
+		exit(-1);
+	}
+
+	start[0] = writer->num_rows;
+	start[1] = 0;
+	count[0] = 1;
+	count[1] = writer->len;
+
+	file_space_id = H5Dget_space(writer->dataset_id);
+	H5Sselect_hyperslab(file_space_id, H5S_SELECT_SET, start, NULL, count, NULL);
+	memory_space_id = H5Screate_simple(2, count, NULL);
+
+	status = H5Dwrite(writer->dataset_id, H5T_NATIVE_DOUBLE, memory_space_id, file_space_id, H5P_DEFAULT, array);
+	if (status < 0) {
+		fprintf(stderr, "Error appending to the dataset (%s) in the file (%s). Aborting.\n",
+				writer->dataset_name, writer->filename);
+		exit(-1);
+	}
+
+	H5Sclose(memory_space_id);
+	H5Sclose(file_space_id);
+
+	writer->num_rows++;
+}
+
+void hdf5_row_writer_close(hdf5_row_writer_t *writer) {
+	assert(writer != NULL);
+
+	H5Dclose(writer->dataset_id);
+	H5Fclose(writer->file_id);
+
+	free(writer->filename);
+	free(writer->dataset_name);
+	free(writer);
+}
+
+void hdf5_append_row(const char *hdf5_filename, const char *dataset_name, size_t len, const double *array) {
+	hdf5_row_writer_t *writer = hdf5_row_writer_open(hdf5_filename, dataset_name, len);
+	hdf5_row_writer_append(writer, len, array);
+	hdf5_row_writer_close(writer);
+}
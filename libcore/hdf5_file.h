@@ -24,6 +24,21 @@ void hdf5_create_group(const char *hdf5_filename, const char* group_name);
 
 void hdf5_save_array(const char *hdf5_filename, const char* group_name, const char *array_name, size_t len, double *array);
 
+/* Appends len values as a new row of a 2-D dataset of doubles. The file is created if it doesn't exist, and the
+ * dataset with an unlimited number of rows of len values if it isn't in the file. */
+void hdf5_append_row(const char *hdf5_filename, const char *dataset_name, size_t len, const double *array);
+
+/* The same for many rows: the file and the dataset stay open from hdf5_row_writer_open to hdf5_row_writer_close,
+ * instead of being opened for every row. */
+typedef struct hdf5_row_writer_s hdf5_row_writer_t;
+
+hdf5_row_writer_t* hdf5_row_writer_open(const char *hdf5_filename, const char *dataset_name, size_t len);
+
+/* Appends len values as a new row. Exits if len isn't the width of the writer's dataset. */
+void hdf5_row_writer_append(hdf5_row_writer_t *writer, size_t len, const double *array);
+
+void hdf5_row_writer_close(hdf5_row_writer_t *writer);
+
 void hdf5_save_attribute_string( const char *hdf5_filename, const char *group_name, const char *attribute_name, const char *data);
 void hdf5_save_attribute_double( const char *hdf5_filename, const char *group_name, const char *attribute_name, size_t len_array, const double *data );
 void hdf5_save_attribute_ulong( const char *hdf5_filename, const char *group_name, const char *attribute_name, size_t len_array, const unsigned long *data );
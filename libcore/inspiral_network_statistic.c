@@ -2,12 +2,21 @@
 #include <math.h>
 #include <memory.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+
+#ifdef HAVE_OPENMP
+	#include <omp.h>
+#endif
 
 #include <gsl/gsl_cblas.h>
 #include <gsl/gsl_complex.h>
 #include <gsl/gsl_complex_math.h>
-#include <gsl/gsl_fft_complex.h>
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_statistics_double.h>
 
@@ -15,6 +24,7 @@
 #include "detector_antenna_patterns.h"
 #include "detector_network.h"
 #include "detector_time_delay.h"
+#include "fft.h"
 #include "inspiral_network_statistic.h"
 #include "sampling_system.h"
 #include "inspiral_chirp.h"
@@ -43,56 +53,140 @@ void CN_template_chirp_time(double f_low, double chirp_time0, double chirp_time1
 	ct->tc = calc_tchirp;
 }
 
-coherent_network_helper_t* CN_helper_alloc(size_t num_time_samples) {
-	size_t i;
-	coherent_network_helper_t *h;
+/* Allocates memory and adds its size to *footprint, so that the footprints report what was allocated. */
+static void* CN_malloc(size_t *footprint, size_t bytes, const char *caller) {
+	void *p = malloc(GSL_MAX(bytes, 1));
 
-	h = (coherent_network_helper_t*) malloc( sizeof(coherent_network_helper_t) );
-	if (h == NULL) {
-		fprintf(stderr, "Error. Unable to allocate memory for coherent_network_helper_t. Exiting.\n");
+	if (p == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: %s(). Exiting.\n", caller);
 		exit(-1);
 	}
+	*footprint += bytes;
+	return p;
+}
 
-	h->c_plus = (gsl_complex*) malloc( num_time_samples * sizeof(gsl_complex) );
-	if (h->c_plus == NULL) {
-		fprintf(stderr, "Error. Unable to allocate memory for h->c_plus. Exiting.\n");
+/* The same with CN_ALIGNMENT aligned memory, which is also freed with free(). */
+static void* CN_aligned_alloc(size_t *footprint, size_t bytes, const char *caller) {
+	void *p = NULL;
+
+	if (posix_memalign(&p, CN_ALIGNMENT, GSL_MAX(bytes, 1)) != 0) {
+		fprintf(stderr, "Error. Unable to allocate memory: %s(). Exiting.\n", caller);
 		exit(-1);
 	}
+	*footprint += bytes;
+	return p;
+}
+
+coherent_network_shared_t* CN_shared_alloc(detector_network_t *net, double f_low, double f_high) {
+	assert(net != NULL);
 
-	h->c_minus = (gsl_complex*) malloc( num_time_samples * sizeof(gsl_complex) );
-	if (h->c_minus == NULL) {
-		fprintf(stderr, "Error. Unable to allocate memory for h->c_minus. Exiting.\n");
+	coherent_network_shared_t *shared;
+	size_t i;
+
+	shared = (coherent_network_shared_t*) malloc(sizeof(coherent_network_shared_t));
+	if (shared == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: CN_shared_alloc(). Exiting.\n");
 		exit(-1);
 	}
 
-	for (i = 0; i < num_time_samples; i++) {
-		h->c_plus[i] = gsl_complex_rect(0.0, 0.0);
-		h->c_minus[i] = gsl_complex_rect(0.0, 0.0);
+	shared->bytes = sizeof(coherent_network_shared_t);
+	shared->num_detectors = net->num_detectors;
+
+	/* Note, the asd is only needed to get the frequency values and the number of frequency bins. This should be the
+	 * same for every ASD used for a detector network, so any detector from the network can be used.
+	 */
+	shared->sp_lookup = SP_workspace_alloc(f_low, f_high, net->detector[0]->asd->len, net->detector[0]->asd->f);
+	shared->bytes += SP_workspace_footprint(shared->sp_lookup);
+
+	/* Each detector has a normalization factor for the stationary phase inner product. */
+	shared->normalization_factors = (double*) CN_malloc( &shared->bytes, net->num_detectors * sizeof(double),
+			"CN_shared_alloc" );
+	for (i = 0; i < net->num_detectors; i++) {
+		shared->normalization_factors[i] = SP_normalization_factor(net->detector[i]->asd, shared->sp_lookup);
+	}
+
+	shared->sky_batch = Detector_Sky_Batch_alloc(net->num_detectors, net->detector);
+	shared->bytes += Detector_Sky_Batch_footprint(shared->sky_batch);
+	shared->sky_table = NULL;
+
+	/* The whitened data is filled in by CN_whiten_data the first time a strain is used. */
+	shared->whitened_data = (gsl_complex**) CN_malloc( &shared->bytes, net->num_detectors * sizeof(gsl_complex*),
+			"CN_shared_alloc" );
+	for (i = 0; i < net->num_detectors; i++) {
+		shared->whitened_data[i] = (gsl_complex*) CN_malloc( &shared->bytes, shared->sp_lookup->len * sizeof(gsl_complex),
+				"CN_shared_alloc" );
 	}
+	shared->whitened_data_generation = 0;
+	shared->whitened_data_version = 0;
+
+	shared->num_references = 1;
 
-	return h;
+	return shared;
 }
 
-void CN_helper_free( coherent_network_helper_t* helper) {
-	assert(helper != NULL);
+void CN_shared_free( coherent_network_shared_t *shared ) {
+	assert(shared != NULL);
+	assert(shared->num_references > 0);
+
+	size_t i;
+
+	if (--shared->num_references > 0) {
+		return;
+	}
+
+	SP_workspace_free(shared->sp_lookup);
+	shared->sp_lookup = NULL;
+
+	free(shared->normalization_factors);
+	shared->normalization_factors = NULL;
+
+	Detector_Sky_Batch_free(shared->sky_batch);
+	shared->sky_batch = NULL;
+
+	if (shared->sky_table != NULL) {
+		Detector_Sky_Table_free(shared->sky_table);
+		shared->sky_table = NULL;
+	}
+
+	for (i = 0; i < shared->num_detectors; i++) {
+		free(shared->whitened_data[i]);
+		shared->whitened_data[i] = NULL;
+	}
+	free(shared->whitened_data);
+	shared->whitened_data = NULL;
 
-	assert(helper->c_plus != NULL);
-	free(helper->c_plus);
-	helper->c_plus = NULL;
+	free(shared);
+}
 
-	assert(helper->c_minus != NULL);
-	free(helper->c_minus);
-	helper->c_minus = NULL;
+void CN_shared_set_sky_table( coherent_network_shared_t *shared, detector_sky_table_t *table ) {
+	assert(shared != NULL);
+	assert(table == NULL || table->num_detectors == shared->num_detectors);
 
-	free(helper);
+	if (shared->sky_table != NULL && shared->sky_table != table) {
+		Detector_Sky_Table_free(shared->sky_table);
+	}
+	shared->sky_table = table;
 }
 
 coherent_network_workspace_t* CN_workspace_alloc(size_t num_time_samples, detector_network_t *net, size_t num_half_freq,
 		double f_low, double f_high) {
 	assert(net != NULL);
 
+	/* The workspace holds the only other reference, so the tables are freed with it */
+	coherent_network_shared_t *shared = CN_shared_alloc(net, f_low, f_high);
+	coherent_network_workspace_t *work = CN_workspace_alloc_shared(num_time_samples, net, num_half_freq, shared);
+	CN_shared_free(shared);
+
+	return work;
+}
+
+coherent_network_workspace_t* CN_workspace_alloc_shared(size_t num_time_samples, detector_network_t *net, size_t num_half_freq,
+		coherent_network_shared_t *shared) {
+	assert(net != NULL);
+	assert(shared != NULL);
+	assert(shared->num_detectors == net->num_detectors);
+
 	coherent_network_workspace_t * work;
-	size_t i, j;
 
 	work = (coherent_network_workspace_t*) malloc(sizeof(coherent_network_workspace_t));
 	if (work == NULL) {
@@ -100,118 +194,129 @@ coherent_network_workspace_t* CN_workspace_alloc(size_t num_time_samples, detect
 		exit(-1);
 	}
 
-	work->num_time_samples = num_time_samples;
-	work->num_helpers = net->num_detectors;
+	work->bytes = sizeof(coherent_network_workspace_t);
+	work->layout_bytes = 0;
+	work->thread_bytes = 0;
+	work->peak_bytes = 0;
 
-	work->helpers = (coherent_network_helper_t**) malloc( work->num_helpers * sizeof(coherent_network_helper_t*));
-	if (work->helpers == NULL) {
-		fprintf(stderr, "Error. Unable to allocate memory: CN_workspace_malloc(). Exiting.\n");
-		exit(-1);
-	}
+	work->num_time_samples = num_time_samples;
+	work->num_half_freq = num_half_freq;
+	work->num_detectors = net->num_detectors;
+
+	work->w_plus_input = (double*) CN_malloc( &work->bytes, work->num_detectors * sizeof(double),
+			"CN_workspace_malloc" );
+	work->w_minus_input = (double*) CN_malloc( &work->bytes, work->num_detectors * sizeof(double),
+			"CN_workspace_malloc" );
+	work->time_delays = (double*) CN_malloc( &work->bytes, work->num_detectors * sizeof(double),
+			"CN_workspace_malloc" );
+
+	shared->num_references++;
+	work->shared = shared;
+	work->whitened_data_version = shared->whitened_data_version;
+	work->sp_lookup = shared->sp_lookup;
+	work->normalization_factors = shared->normalization_factors;
+	work->whitened_data = shared->whitened_data;
 
-	for (i = 0; i < work->num_helpers; i++) {
-		work->helpers[i] = CN_helper_alloc( num_time_samples );
-	}
+	work->sp = SP_alloc( num_half_freq );
+	work->bytes += SP_footprint(work->sp);
 
-	/* Note, the asd is only needed to get the frequency values and the number of frequency bins. This should be the
-	 * same for every ASD used for a detector network, so any detector from the network can be used.
-	 */
-	work->sp_lookup = SP_workspace_alloc(f_low, f_high, net->detector[0]->asd->len, net->detector[0]->asd->f);
+	work->terms = (gsl_complex**) CN_malloc( &work->bytes, 2 * sizeof(gsl_complex*), "CN_workspace_malloc" );
 
-	work->sp = SP_alloc( num_half_freq );
+	/* One block, so that both series can be transformed with one call */
+	work->fs = (double**) CN_malloc( &work->bytes, 2 * sizeof(double*), "CN_workspace_malloc" );
+	work->fs[0] = (double*) CN_aligned_alloc( &work->bytes, 2 * 2 * num_time_samples * sizeof(double),
+			"CN_workspace_malloc" );
+	work->fs[1] = work->fs[0] + 2 * num_time_samples;
 
-	work->temp_array = (gsl_complex*) malloc( num_half_freq * sizeof(gsl_complex) );
-	if (work->temp_array == NULL) {
-		fprintf(stderr, "Error. Unable to allocate memory: CN_workspace_malloc(). Exiting.\n");
-		exit(-1);
-	}
+	/* The compact layout has no buffers of its own, so the default one is set up from it */
+	work->layout = CN_LAYOUT_COMPACT;
+	work->terms[0] = NULL;
+	work->terms[1] = NULL;
+	work->temp_array = work->sp->spa_0;
+	work->temp_ifft = work->fs[0];
 
-	for (i = 0; i < num_half_freq; i++) {
-		work->temp_array[i] = gsl_complex_rect(0.0, 0.0);
-	}
+	work->reduction = CN_REDUCTION_NONE;
+	work->ifft_len = num_time_samples;
+	work->ifft_offset = 0;
+	work->fft_workspace = FFT_workspace_alloc( num_time_samples );
 
-	work->terms = (gsl_complex**) malloc(4 * sizeof(gsl_complex*) );
-	if (work->terms == NULL) {
-		fprintf(stderr, "Error. Unable to allocate memory: CN_workspace_malloc(). Exiting.\n");
-		exit(-1);
-	}
-	for (i = 0; i < 4; i++) {
-		work->terms[i] = (gsl_complex*) malloc( num_time_samples * sizeof(gsl_complex) );
-		for (j = 0; j < num_time_samples; j++) {
-			work->terms[i][j] = gsl_complex_rect(0.0, 0.0);
-		}
-	}
+	work->ap_workspace = Detector_Antenna_Patterns_workspace_alloc();
+	work->bytes += Detector_Antenna_Patterns_workspace_footprint(work->ap_workspace);
 
-	work->fs = (double**) malloc( 4 * sizeof(double*) );
-	if (work->fs == NULL) {
-		fprintf(stderr, "Error. Unable to allocate memory: CN_workspace_malloc(). Exiting.\n");
-		exit(-1);
-	}
+	/* one antenna pattern structure per detector */
+	work->ap = (detector_antenna_patterns_t*) CN_malloc( &work->bytes,
+			net->num_detectors * sizeof(detector_antenna_patterns_t), "CN_workspace_malloc" );
 
-	for (i = 0; i < 4; i++) {
-		work->fs[i] = (double*) malloc( 2 * num_time_samples * sizeof(double) );
-		if (work->fs[i] == NULL) {
-			fprintf(stderr, "Error. Unable to allocate memory: CN_workspace_malloc(). Exiting.\n");
-			exit(-1);
-		}
-	}
+	work->sky_cache = NULL;
+	work->tc_window = NULL;
 
-	work->temp_ifft = (double*) malloc( num_time_samples * sizeof(double) );
-	if (work->temp_ifft == NULL) {
-		fprintf(stderr, "Error. Unable to allocate memory: CN_workspace_malloc(). Exiting.\n");
-		exit(-1);
-	}
+	work->precision = CN_PRECISION_DOUBLE;
+	work->precision_deviation = 0.0;
 
-	work->fft_wavetable = gsl_fft_complex_wavetable_alloc( num_time_samples );
-	work->fft_workspace = gsl_fft_complex_workspace_alloc( num_time_samples );
+	work->peak_interpolation = CN_PEAK_INTERPOLATION_NONE;
+	work->peak.value = 0.0;
+	work->peak.index = 0.0;
+	work->max_num_peaks = 0;
+	work->min_peak_separation = 0.0;
+	work->num_peaks = 0;
+	work->peaks = NULL;
 
-	work->ap_workspace = Detector_Antenna_Patterns_workspace_alloc();
+	work->num_threads = 1;
+	work->detector_sp = NULL;
+	work->detector_filters = NULL;
+	work->fft_workspace_minus = NULL;
 
-	/* one antenna pattern structure per detector */
-	work->ap = (detector_antenna_patterns_t*) malloc (net->num_detectors * sizeof(detector_antenna_patterns_t) );
-	if (work->ap == NULL) {
-		fprintf(stderr, "Error. Unable to allocate memory: CN_workspace_malloc(). Exiting.\n");
-		exit(-1);
-	}
+	work->series_format = CN_SAVE_TEXT;
+	work->series_filename = NULL;
+	work->series_writer = NULL;
 
-	/* Each detector has a normalization factor for the stationary phase inner product. */
-	work->normalization_factors = (double*) malloc( net->num_detectors * sizeof(double) );
-	if (work->normalization_factors == NULL) {
-		fprintf(stderr, "Error. Unable to allocate memory: CN_workspace_malloc(). Exiting.\n");
-		exit(-1);
-	}
-	for (i = 0; i < net->num_detectors; i++) {
-		work->normalization_factors[i] = SP_normalization_factor(net->detector[i]->asd, work->sp_lookup);
-	}
+	CN_workspace_set_layout(work, CN_LAYOUT_DEFAULT);
 
 	return work;
 }
 
-void CN_workspace_free( coherent_network_workspace_t *workspace ) {
-	assert(workspace != NULL);
+static void CN_sky_cache_free( coherent_network_sky_cache_t *cache );
+static void CN_tc_window_build( coherent_network_workspace_t *workspace, double t_min, double t_max );
 
+/* Points band_terms at the sums for the layout, the length and the offset of the inverse FFT. */
+static void CN_workspace_update_band_terms( coherent_network_workspace_t *workspace ) {
+	size_t f_low_index = workspace->sp_lookup->f_low_index;
 	size_t i;
 
-	for (i = 0; i < workspace->num_helpers; i++) {
-		CN_helper_free( workspace->helpers[i] );
-		workspace->helpers[i] = NULL;
+	for (i = 0; i < 2; i++) {
+		if (workspace->layout == CN_LAYOUT_COMPACT) {
+			workspace->band_terms[i] = (gsl_complex*) workspace->fs[i] + (f_low_index - workspace->ifft_offset);
+		} else {
+			workspace->band_terms[i] = workspace->terms[i] + f_low_index;
+		}
 	}
-	free(workspace->helpers);
-	workspace->helpers = NULL;
+}
 
-	SP_workspace_free(workspace->sp_lookup);
-	workspace->sp_lookup = NULL;
+void CN_workspace_free( coherent_network_workspace_t *workspace ) {
+	assert(workspace != NULL);
+
+	free(workspace->w_plus_input);
+	workspace->w_plus_input = NULL;
+
+	free(workspace->w_minus_input);
+	workspace->w_minus_input = NULL;
+
+	free(workspace->time_delays);
+	workspace->time_delays = NULL;
+
+	/* Frees the default layout's buffers */
+	CN_workspace_set_layout(workspace, CN_LAYOUT_COMPACT);
+	workspace->temp_array = NULL;
+	workspace->temp_ifft = NULL;
+	workspace->band_terms[0] = NULL;
+	workspace->band_terms[1] = NULL;
 
 	SP_free(workspace->sp);
 	workspace->sp = NULL;
 
-	for (i = 0; i < 4; i++) {
-		free(workspace->terms[i]);
-		workspace->terms[i] = NULL;
-
-		free(workspace->fs[i]);
-		workspace->fs[i] = NULL;
-	}
+	free(workspace->fs[0]);
+	workspace->fs[0] = NULL;
+	workspace->fs[1] = NULL;
 
 	free(workspace->terms);
 	workspace->terms = NULL;
@@ -219,289 +324,1887 @@ void CN_workspace_free( coherent_network_workspace_t *workspace ) {
 	free(workspace->fs);
 	workspace->fs = NULL;
 
-	free(workspace->temp_ifft);
-	workspace->temp_ifft = NULL;
-
-	free(workspace->temp_array);
-	workspace->temp_array = NULL;
-
-	gsl_fft_complex_workspace_free( workspace->fft_workspace );
+	FFT_workspace_free( workspace->fft_workspace );
 	workspace->fft_workspace = NULL;
 
-	gsl_fft_complex_wavetable_free( workspace->fft_wavetable );
-	workspace->fft_wavetable = NULL;
-
 	Detector_Antenna_Patterns_workspace_free(workspace->ap_workspace);
 	workspace->ap_workspace = NULL;
 
 	free(workspace->ap);
 	workspace->ap = NULL;
 
-	free(workspace->normalization_factors);
+	if (workspace->sky_cache != NULL) {
+		CN_sky_cache_free(workspace->sky_cache);
+		workspace->sky_cache = NULL;
+	}
+
+	CN_workspace_clear_tc_window(workspace);
+
+	free(workspace->peaks);
+	workspace->peaks = NULL;
+
+	CN_workspace_set_num_threads(workspace, 1);
+
+	CN_workspace_close_series(workspace);
+
+	workspace->sp_lookup = NULL;
 	workspace->normalization_factors = NULL;
+	workspace->whitened_data = NULL;
+	CN_shared_free(workspace->shared);
+	workspace->shared = NULL;
 
 	free( workspace );
 }
 
-void CN_do_work(size_t num_time_samples, size_t f_low_index, size_t f_high_index, gsl_complex *spa, asd_t *asd, gsl_complex *half_fft_data, gsl_complex *temp, gsl_complex *out_c) {
-	assert(spa != NULL);
-	assert(asd != NULL);
-	assert(half_fft_data != NULL);
-	assert(temp != NULL);
-	assert(out_c != NULL);
+CN_REDUCTION CN_reduction_from_string(const char *name) {
+	if (name == NULL || strcmp(name, "none") == 0) {
+		return CN_REDUCTION_NONE;
+	}
+	if (strcmp(name, "decimate") == 0) {
+		return CN_REDUCTION_DECIMATE;
+	}
+	if (strcmp(name, "heterodyne") == 0) {
+		return CN_REDUCTION_HETERODYNE;
+	}
 
-	size_t k;
+	fprintf(stderr, "Error. Unknown network statistic reduction (%s). Use none, decimate or heterodyne. Exiting.\n", name);
+	exit(-1);
+}
+
+void CN_workspace_set_reduction( coherent_network_workspace_t *workspace, CN_REDUCTION reduction ) {
+	assert(workspace != NULL);
 
-	// faster version for (k = f_low_index; k <= f_high_index; k++) {
-	for (k = 0; k < asd->len; k++) {
-		temp[k] = gsl_complex_conjugate(spa[k]);
-		temp[k] = gsl_complex_div_real(temp[k], asd->asd[k]);
-		temp[k] = gsl_complex_mul( temp[k], half_fft_data[k] );
+	size_t f_low_index = workspace->sp_lookup->f_low_index;
+	size_t f_high_index = workspace->sp_lookup->f_high_index;
+	size_t len = workspace->num_time_samples;
+	size_t offset = 0;
+
+	/* The analytic series only has positive frequencies, so it isn't aliased as long as every bin that is
+	 * kept has its own index. The buffers were allocated for num_time_samples, so the length can only shrink. */
+	switch (reduction) {
+	case CN_REDUCTION_DECIMATE:
+		len = SS_fft_friendly_length( GSL_MAX(f_high_index + 1, 2), SS_FFT_LENGTH_PAD );
+		break;
+	case CN_REDUCTION_HETERODYNE:
+		len = SS_fft_friendly_length( GSL_MAX(f_high_index - f_low_index + 1, 2), SS_FFT_LENGTH_PAD );
+		offset = f_low_index;
+		break;
+	default:
+		break;
 	}
 
-	/* This should extend the array with a flipped conjugated version. */
-	SS_make_two_sided( asd->len, temp, num_time_samples, out_c);
-}
+	if (len >= workspace->num_time_samples) {
+		len = workspace->num_time_samples;
+		offset = 0;
+	}
 
-void CN_save(char* filename, size_t len, double* tmp_ifft) {
-	assert(filename != NULL);
-	assert(tmp_ifft != NULL);
+	/* The window's indices and tables depend on the length, and its band on the offset */
+	int rebuild_window = workspace->tc_window != NULL && (len != workspace->ifft_len || offset != workspace->ifft_offset);
 
-	FILE* file;
-	size_t i;
+	workspace->reduction = reduction;
+	workspace->ifft_offset = offset;
 
-	file = fopen(filename, "w");
-	if (file == NULL) {
-		fprintf(stderr, "Error. CN_save: Unable to open the file (%s) for writing the network statistic series. Exiting.\n", filename);
-		exit(-1);
+	if (len != workspace->ifft_len) {
+		/* The series saved from now on have another length, so they can't go in the open file's rows */
+		CN_workspace_close_series(workspace);
+
+		workspace->ifft_len = len;
+		workspace->fs[1] = workspace->fs[0] + 2 * len;
+
+		FFT_workspace_free( workspace->fft_workspace );
+		workspace->fft_workspace = FFT_workspace_alloc( len );
+
+		if (workspace->fft_workspace_minus != NULL) {
+			FFT_workspace_free( workspace->fft_workspace_minus );
+			workspace->fft_workspace_minus = FFT_workspace_alloc( len );
+		}
 	}
 
-	for (i = 0; i < len; i++) {
-		fprintf(file, "%e\n", tmp_ifft[i]);
+	if (rebuild_window) {
+		CN_tc_window_build(workspace, workspace->tc_window->t_min, workspace->tc_window->t_max);
 	}
-	fclose(file);
-}
 
-/* DANGER. This assumes that the coalece phase is 0 */
-void coherent_network_statistic(
-		detector_network_t* net,
-		double f_low,
-		double f_high,
-		inspiral_chirp_time_t *chirp,
-		sky_t *sky,
-		network_strain_half_fft_t *network_strain,
-		coherent_network_workspace_t *workspace,
-		double *out_network_css_value,
-		int *out_network_css_index,
-		char *out_network_css_filename)
-{
-	assert(net);
-	assert(chirp);
-	assert(sky);
-	assert(network_strain);
-	assert(workspace);
-	assert(out_network_css_value);
-	assert(out_network_css_index);
+	CN_workspace_update_band_terms(workspace);
+}
 
-	double UdotU_input;
-	double UdotV_input;
-	double VdotV_input;
-	size_t i;
-	double A_input;
-	double B_input;
-	double C_input;
-	double Delta_input;
-	double Delta_factor_input;
-	double D_input;
-	double P1_input;
-	double P2_input;
-	double P3_input;
-	double P4_input;
-	double G1_input;
-	double G2_input;
-	double O11_input;
-	double O12_input;
-	double O21_input;
-	double O22_input;
-	size_t tid;
-	size_t did;
-	size_t fid;
-	size_t j;
-	double max_value;
-	size_t max_index;
+CN_LAYOUT CN_layout_from_string(const char *name) {
+	if (name == NULL || strcmp(name, "default") == 0) {
+		return CN_LAYOUT_DEFAULT;
+	}
+	if (strcmp(name, "compact") == 0) {
+		return CN_LAYOUT_COMPACT;
+	}
 
-	/* WARNING: This assumes that all of the signals have the same lengths. */
-	size_t num_time_samples = network_strain->num_time_samples;
+	fprintf(stderr, "Error. Unknown network statistic workspace layout (%s). Use default or compact. Exiting.\n", name);
+	exit(-1);
+}
 
-	/* Compute the antenna patterns for each detector */
-	for (i = 0; i < net->num_detectors; i++) {
-		double polarization_angle = 0.0; // Shihan said only u and v are needed for templates.
-		Detector_Antenna_Patterns_compute(net->detector[i], sky, polarization_angle,
-				workspace->ap_workspace, &workspace->ap[i]);
-	}
+void CN_workspace_set_layout( coherent_network_workspace_t *workspace, CN_LAYOUT layout ) {
+	assert(workspace != NULL);
 
-	/* We need to make vectors with the same number of dimensions as the number of detectors in the network */
-	UdotU_input = 0.0;
-	UdotV_input = 0.0;
-	VdotV_input = 0.0;
+	size_t num_half_freq = workspace->num_half_freq;
+	size_t i;
 
-	/* dot product */
-	for (i = 0; i < net->num_detectors; i++) {
-		UdotU_input += workspace->ap[i].u * workspace->ap[i].u;
-		UdotV_input += workspace->ap[i].u * workspace->ap[i].v;
-		VdotV_input += workspace->ap[i].v * workspace->ap[i].v;
+	if (layout == workspace->layout) {
+		return;
 	}
 
-	A_input = UdotU_input;
-	B_input = UdotV_input;
-	C_input = VdotV_input;
+	if (layout == CN_LAYOUT_COMPACT) {
+		for (i = 0; i < 2; i++) {
+			free(workspace->terms[i]);
+			workspace->terms[i] = NULL;
+		}
 
-	Delta_input = (A_input*C_input) - (B_input*B_input);
-	Delta_factor_input = 1.0 / sqrt(2.0*Delta_input);
+		free(workspace->temp_array);
+		workspace->temp_array = workspace->sp->spa_0;
 
-	D_input = sqrt( gsl_pow_2(A_input-C_input) + 4.0*gsl_pow_2(B_input) ) ;
+		free(workspace->temp_ifft);
+		workspace->temp_ifft = workspace->fs[0];
 
-	P1_input = (C_input-A_input-D_input);
-	P2_input = (C_input-A_input+D_input);
-	P3_input = sqrt(C_input+A_input+D_input);
-	P4_input = sqrt(C_input+A_input-D_input);
+		workspace->layout_bytes = 0;
+	} else {
+		/* zeroed here since only the analysis band is ever written */
+		for (i = 0; i < 2; i++) {
+			workspace->terms[i] = (gsl_complex*) CN_aligned_alloc( &workspace->layout_bytes,
+					num_half_freq * sizeof(gsl_complex), "CN_workspace_set_layout" );
+			memset( workspace->terms[i], 0, num_half_freq * sizeof(gsl_complex) );
+		}
 
-	G1_input =  sqrt( gsl_pow_2(P1_input) +  4.0*gsl_pow_2(B_input)) / (2.0*B_input) ;
-	G2_input =  sqrt( gsl_pow_2(P2_input) +  4.0*gsl_pow_2(B_input)) / (2.0*B_input) ;
+		workspace->temp_array = (gsl_complex*) CN_aligned_alloc( &workspace->layout_bytes,
+				num_half_freq * sizeof(gsl_complex), "CN_workspace_set_layout" );
+		memset( workspace->temp_array, 0, num_half_freq * sizeof(gsl_complex) );
 
-	O11_input = Delta_factor_input * P3_input / G1_input ;
-	O12_input = Delta_factor_input * P3_input * P1_input / (2.0*B_input*G1_input) ;
-	O21_input = Delta_factor_input * P4_input / G2_input ;
-	O22_input  = Delta_factor_input * P4_input * P2_input / (2.0*B_input*G2_input);
+		workspace->temp_ifft = (double*) CN_aligned_alloc( &workspace->layout_bytes,
+				workspace->num_time_samples * sizeof(double), "CN_workspace_set_layout" );
+	}
 
-	/* Loop over each detector to generate a template and do matched filtering */
-	for (i = 0; i < net->num_detectors; i++) {
-		detector_t* det;
-		double inspiral_coalesce_phase;
-		gsl_complex* whitened_data;
-		double U_vec_input;
-		double V_vec_input;
-		double detector_time_delay;
+	workspace->layout = layout;
+	CN_workspace_update_band_terms(workspace);
+}
 
-		det = net->detector[i];
+CN_PRECISION CN_precision_from_string(const char *name) {
+	if (name == NULL || strcmp(name, "double") == 0) {
+		return CN_PRECISION_DOUBLE;
+	}
+	if (strcmp(name, "single") == 0) {
+		return CN_PRECISION_SINGLE;
+	}
+	if (strcmp(name, "validate") == 0) {
+		return CN_PRECISION_VALIDATE;
+	}
 
-		/* For reconstruction use the phase as 0 */
-		inspiral_coalesce_phase = 0.0;
+	fprintf(stderr, "Error. Unknown network statistic precision (%s). Use double, single or validate. Exiting.\n", name);
+	exit(-1);
+}
 
-		/* Compute time delay */
-		Detector_time_delay(det, sky, &detector_time_delay);
+void CN_workspace_set_precision( coherent_network_workspace_t *workspace, CN_PRECISION precision ) {
+	assert(workspace != NULL);
 
-		/*printf("g = %0.21e\n", workspace->normalization_factors[i]);*/
+	workspace->precision = precision;
+	workspace->precision_deviation = 0.0;
+}
 
-		SP_compute(		detector_time_delay, workspace->normalization_factors[i],
-						inspiral_coalesce_phase, chirp,
-						workspace->sp_lookup,
-						workspace->sp);
+size_t CN_shared_footprint( const coherent_network_shared_t *shared ) {
+	assert(shared != NULL);
 
-		/*
-		printf("Detector SPA_0: %s\n", det->name);
-		for (j = 0; j < workspace->sp->len; j++) {
-			printf("%0.21e \t %0.21e\n", GSL_REAL(workspace->sp->spa_0[j]), GSL_IMAG(workspace->sp->spa_0[j]));
-		}
+	size_t bytes = shared->bytes;
 
-		printf("Detector SPA_90: %s\n", det->name);
-		for (j = 0; j < workspace->sp->len; j++) {
-			printf("%0.21e \t %0.21e\n", GSL_REAL(workspace->sp->spa_90[j]), GSL_IMAG(workspace->sp->spa_90[j]));
-		}*/
+	if (shared->sky_table != NULL) {
+		bytes += Detector_Sky_Table_footprint(shared->sky_table);
+	}
 
-		whitened_data = network_strain->strains[i]->half_fft;
+	return bytes;
+}
 
-		/* compute c_plus */
-		CN_do_work(num_time_samples, workspace->sp_lookup->f_low_index, workspace->sp_lookup->f_high_index, workspace->sp->spa_0, det->asd, whitened_data, workspace->temp_array, workspace->helpers[i]->c_plus);
+size_t CN_workspace_footprint( const coherent_network_workspace_t *workspace ) {
+	assert(workspace != NULL);
 
-		/* compute c_minus */
-		CN_do_work(num_time_samples, workspace->sp_lookup->f_low_index, workspace->sp_lookup->f_high_index, workspace->sp->spa_90, det->asd, whitened_data, workspace->temp_array, workspace->helpers[i]->c_minus);
+	size_t bytes = workspace->bytes + workspace->layout_bytes + workspace->thread_bytes + workspace->peak_bytes;
 
-		U_vec_input = workspace->ap[i].u;
-		V_vec_input = workspace->ap[i].v;
+	bytes += FFT_workspace_footprint(workspace->fft_workspace);
 
-		workspace->helpers[i]->w_plus_input = (O11_input*U_vec_input +  O12_input*V_vec_input);
-		workspace->helpers[i]->w_minus_input = (O21_input*U_vec_input +  O22_input*V_vec_input);
+	if (workspace->fft_workspace_minus != NULL) {
+		bytes += FFT_workspace_footprint(workspace->fft_workspace_minus);
 	}
 
-	/* zero the memory */
-	for (tid = 0; tid < 4; tid++) {
-		memset( workspace->terms[tid], 0, num_time_samples * sizeof(gsl_complex) );
-		memset( workspace->fs[tid], 0, num_time_samples * sizeof(gsl_complex) );
+	if (workspace->sky_cache != NULL) {
+		bytes += workspace->sky_cache->bytes + FFT_workspace_footprint(workspace->sky_cache->fft_workspace);
 	}
 
-	for (did = 0; did < net->num_detectors; did++) {
-		for (fid = 0; fid < num_time_samples; fid++) {
-			gsl_complex t;
+	if (workspace->tc_window != NULL) {
+		bytes += workspace->tc_window->bytes + FFT_workspace_footprint(workspace->tc_window->fft_workspace);
+	}
 
-			t = gsl_complex_mul_real(workspace->helpers[did]->c_plus[fid], workspace->helpers[did]->w_plus_input);
-			workspace->terms[0][fid] = gsl_complex_add( workspace->terms[0][fid], t);
+	return bytes;
+}
 
-			t = gsl_complex_mul_real(workspace->helpers[did]->c_plus[fid], workspace->helpers[did]->w_minus_input);
-			workspace->terms[1][fid] = gsl_complex_add( workspace->terms[1][fid], t);
+void CN_workspace_set_num_threads( coherent_network_workspace_t *workspace, size_t num_threads ) {
+	assert(workspace != NULL);
 
-			t = gsl_complex_mul_real(workspace->helpers[did]->c_minus[fid], workspace->helpers[did]->w_plus_input);
-			workspace->terms[2][fid] = gsl_complex_add( workspace->terms[2][fid], t);
+	size_t i;
 
-			t = gsl_complex_mul_real(workspace->helpers[did]->c_minus[fid], workspace->helpers[did]->w_minus_input);
-			workspace->terms[3][fid] = gsl_complex_add( workspace->terms[3][fid], t);
-		}
+#ifdef HAVE_OPENMP
+	if (num_threads == 0) {
+		num_threads = omp_get_max_threads();
 	}
+#else
+	num_threads = 1;
+#endif
 
-	for (i = 0; i < 4; i++) {
-		for (j = 0; j < num_time_samples; j++) {
-			workspace->fs[i][2*j + 0] = GSL_REAL( workspace->terms[i][j] );
-			workspace->fs[i][2*j + 1] = GSL_IMAG( workspace->terms[i][j] );
-		}
-		gsl_fft_complex_inverse( workspace->fs[i], 1, num_time_samples, workspace->fft_wavetable, workspace->fft_workspace );
-	}
+	if (num_threads <= 1) {
+		if (workspace->detector_sp != NULL) {
+			for (i = 0; i < workspace->num_detectors; i++) {
+				SP_free(workspace->detector_sp[i]);
+			}
+			free(workspace->detector_sp);
+			workspace->detector_sp = NULL;
 
-	memset(workspace->temp_ifft, 0, num_time_samples * sizeof(double));
-	for (i = 0; i < 4; i++) {
-		for (j = 0; j < num_time_samples; j++) {
-			/* Take only the real part. The imaginary part should be zero. */
-			double x = workspace->fs[i][2*j + 0];
-			workspace->temp_ifft[j] += gsl_pow_2(x*num_time_samples);
+			free(workspace->detector_filters);
+			workspace->detector_filters = NULL;
+
+			FFT_workspace_free(workspace->fft_workspace_minus);
+			workspace->fft_workspace_minus = NULL;
+
+			workspace->thread_bytes = 0;
 		}
+		workspace->num_threads = 1;
+		return;
 	}
 
-	/*CN_save("tmp_ifft.dat", s, workspace->temp_ifft);*/
-
-	max_index = 0;
-	max_value = workspace->temp_ifft[0];
+	if (workspace->detector_sp == NULL) {
+		size_t band_len = workspace->sp_lookup->f_high_index - workspace->sp_lookup->f_low_index + 1;
 
-	/* check statistical behavior of this time series */
-	for (i = 1; i < num_time_samples; i++) {
-		double m = workspace->temp_ifft[i];
-		if (m > max_value) {
-			max_value = m;
-			max_index = i;
+		workspace->detector_sp = (stationary_phase_t**) CN_malloc( &workspace->thread_bytes,
+				workspace->num_detectors * sizeof(stationary_phase_t*), "CN_workspace_set_num_threads" );
+		for (i = 0; i < workspace->num_detectors; i++) {
+			workspace->detector_sp[i] = SP_alloc( workspace->num_half_freq );
+			workspace->thread_bytes += SP_footprint(workspace->detector_sp[i]);
 		}
+
+		workspace->detector_filters = (gsl_complex*) CN_malloc( &workspace->thread_bytes,
+				workspace->num_detectors * band_len * sizeof(gsl_complex), "CN_workspace_set_num_threads" );
+
+		workspace->fft_workspace_minus = FFT_workspace_alloc( workspace->ifft_len );
 	}
 
-	/* check, sqrt sbould behave according to chi */
-	/* check, use this with just noise and see if the mean is 4, std should be sqrt(8). Chi-sqre if not sqrt(max). Check 'max' dist.*/
-	double old_snr_definition = sqrt(max_value) / sqrt(2.0);
+	workspace->num_threads = num_threads;
+}
 
-	// temp hack to do this quickly
-	//workspace->temp_ifft[max_index] = 0.0;
-	//double std = gsl_stats_sd (workspace->temp_ifft, 1, workspace->num_time_samples);
-	//workspace->temp_ifft[max_index] = max_value;
+/* The sampling rate of the data, from the frequency spacing of the lookup. The frequency of bin k is k * df,
+ * and chirp_tc_coeff holds 2 pi f for the bins of the band. */
+static double CN_samples_per_second( coherent_network_workspace_t *workspace ) {
+	stationary_phase_workspace_t *lookup = workspace->sp_lookup;
+	double df = lookup->chirp_tc_coeff[lookup->len - 1] / (2.0 * M_PI * lookup->f_high_index);
+	return df * workspace->num_time_samples;
+}
 
-	//double new_snr_definition = max_value / std;
-	*out_network_css_value = old_snr_definition;
-	*out_network_css_index = max_index;
+static void CN_sky_cache_free( coherent_network_sky_cache_t *cache ) {
+	assert(cache != NULL);
 
-	/*
-	if (hdf5_filename != NULL && hdf5_dataset_name != NULL) {
-		hdf5_save_array( hdf5_filename, "/", hdf5_dataset_name, workspace->num_time_samples, workspace->temp_ifft);
+	size_t e;
 
-		for (i = 0; i < workspace->num_time_samples; i++) {
-			printf("%f ", workspace->temp_ifft[i]);
-		}
+	for (e = 0; e < cache->capacity; e++) {
+		free(cache->entries[e].series);
+		cache->entries[e].series = NULL;
 	}
-	*/
+	free(cache->entries);
+	cache->entries = NULL;
+
+	FFT_workspace_free(cache->fft_workspace);
+	cache->fft_workspace = NULL;
+
+	free(cache);
+}
+
+void CN_workspace_enable_sky_cache( coherent_network_workspace_t *workspace, size_t capacity, size_t upsample ) {
+	assert(workspace != NULL);
+
+	coherent_network_sky_cache_t *cache;
+	stationary_phase_workspace_t *lookup = workspace->sp_lookup;
+	size_t band_len = lookup->f_high_index - lookup->f_low_index + 1;
+	size_t e;
+
+	if (workspace->sky_cache != NULL) {
+		CN_sky_cache_free(workspace->sky_cache);
+		workspace->sky_cache = NULL;
+	}
+
+	if (capacity == 0) {
+		return;
+	}
+
+	assert(upsample > 0);
+	assert(lookup->f_high_index > 0);
+
+	cache = (coherent_network_sky_cache_t*) malloc( sizeof(coherent_network_sky_cache_t) );
+	if (cache == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: CN_workspace_enable_sky_cache(). Exiting.\n");
+		exit(-1);
+	}
+
+	cache->bytes = sizeof(coherent_network_sky_cache_t);
+	cache->capacity = capacity;
+	cache->num_detectors = workspace->num_detectors;
+	cache->len = SS_fft_friendly_length( GSL_MAX(upsample * band_len, 2), SS_FFT_LENGTH_PAD );
+	cache->center_index = (lookup->f_low_index + lookup->f_high_index) / 2;
+
+	cache->samples_per_second = CN_samples_per_second(workspace);
+
+	cache->clock = 0;
+	cache->hits = 0;
+	cache->misses = 0;
+
+	cache->entries = (coherent_network_sky_cache_entry_t*) CN_malloc( &cache->bytes,
+			capacity * sizeof(coherent_network_sky_cache_entry_t), "CN_workspace_enable_sky_cache" );
+	for (e = 0; e < capacity; e++) {
+		cache->entries[e].valid = 0;
+		cache->entries[e].last_used = 0;
+		cache->entries[e].series = (gsl_complex*) CN_malloc( &cache->bytes,
+				cache->num_detectors * cache->len * sizeof(gsl_complex), "CN_workspace_enable_sky_cache" );
+	}
+
+	cache->fft_workspace = FFT_workspace_alloc( cache->len );
+
+	workspace->sky_cache = cache;
+}
+
+/* Computes the unshifted analytic series of every detector for the chirp. The spectrum is heterodyned by
+ * center_index bins, so the bins below it wrap around to the end. */
+static void CN_sky_cache_fill(inspiral_chirp_time_t *chirp, coherent_network_workspace_t *workspace,
+		coherent_network_sky_cache_entry_t *entry) {
+	coherent_network_sky_cache_t *cache = workspace->sky_cache;
+	size_t f_low_index = workspace->sp_lookup->f_low_index;
+	size_t f_high_index = workspace->sp_lookup->f_high_index;
+	size_t band_len = f_high_index - f_low_index + 1;
+	size_t len = cache->len;
+	size_t i, k;
+
+	for (i = 0; i < cache->num_detectors; i++) {
+		gsl_complex *series = entry->series + i*len;
+
+		SP_compute(0.0, workspace->normalization_factors[i], 0.0, chirp, workspace->sp_lookup, workspace->sp);
+		CN_do_work_whitened(band_len, workspace->sp->spa_0 + f_low_index, workspace->whitened_data[i],
+				workspace->temp_array + f_low_index);
+
+		/* Same doubling as SS_make_analytic_band. Scaling by len undoes the normalization of the inverse FFT,
+		 * like the multiplication by ifft_len in coherent_network_statistic. */
+		memset(series, 0, len * sizeof(gsl_complex));
+		for (k = f_low_index; k <= f_high_index; k++) {
+			int mirrored = (k == 0) || (SS_has_nyquist_term(workspace->num_time_samples) && k == workspace->num_half_freq - 1);
+			double scale = (mirrored ? 1.0 : 2.0) * len;
+			series[(k + len - cache->center_index) % len] = gsl_complex_mul_real(workspace->temp_array[k], scale);
+		}
+
+		FFT_complex_inverse(len, (double*) series, cache->fft_workspace);
+	}
+}
+
+/* The series depend on every chirp time, not only on chirp_time0 and chirp_time1_5. */
+static int CN_sky_cache_key_equal(const inspiral_chirp_time_t *a, const inspiral_chirp_time_t *b) {
+	return a->chirp_time0 == b->chirp_time0 && a->chirp_time1_5 == b->chirp_time1_5
+			&& a->chirp_time1 == b->chirp_time1 && a->chirp_time2 == b->chirp_time2 && a->tc == b->tc;
+}
+
+/* Returns the cached series for the chirp, computing them in place of the least recently used entry if needed. */
+static coherent_network_sky_cache_entry_t* CN_sky_cache_get(inspiral_chirp_time_t *chirp, coherent_network_workspace_t *workspace) {
+	coherent_network_sky_cache_t *cache = workspace->sky_cache;
+	coherent_network_sky_cache_entry_t *entry = NULL;
+	size_t e;
+
+	cache->clock++;
+
+	for (e = 0; e < cache->capacity; e++) {
+		coherent_network_sky_cache_entry_t *candidate = &cache->entries[e];
+		if (candidate->valid && CN_sky_cache_key_equal(&candidate->chirp, chirp)) {
+			candidate->last_used = cache->clock;
+			cache->hits++;
+			return candidate;
+		}
+	}
+
+	for (e = 0; e < cache->capacity; e++) {
+		coherent_network_sky_cache_entry_t *candidate = &cache->entries[e];
+		if (!candidate->valid) {
+			entry = candidate;
+			break;
+		}
+		if (entry == NULL || candidate->last_used < entry->last_used) {
+			entry = candidate;
+		}
+	}
+
+	CN_sky_cache_fill(chirp, workspace, entry);
+	entry->valid = 1;
+	entry->chirp = *chirp;
+	entry->last_used = cache->clock;
+	cache->misses++;
+
+	return entry;
+}
+
+/* Writes the statistic series to workspace->temp_ifft from the cached detector series, for every index of the
+ * ifft_len series or only those of the tc window. The weights must already be in the workspace. */
+static void CN_sky_cache_series(inspiral_chirp_time_t *chirp, coherent_network_workspace_t *workspace) {
+	coherent_network_sky_cache_t *cache = workspace->sky_cache;
+	coherent_network_sky_cache_entry_t *entry = CN_sky_cache_get(chirp, workspace);
+	size_t num_detectors = cache->num_detectors;
+	size_t len = cache->len;
+	size_t first = 0;
+	size_t count = workspace->ifft_len;
+	size_t i, j;
+
+	if (workspace->tc_window != NULL) {
+		first = workspace->tc_window->start;
+		count = workspace->tc_window->len;
+	}
+
+	/* cache samples per output sample */
+	double step = (double) len / workspace->ifft_len;
+
+	double start[num_detectors];
+	gsl_complex w_plus[num_detectors];
+	gsl_complex w_minus[num_detectors];
+
+	for (i = 0; i < num_detectors; i++) {
+		double detector_time_delay = workspace->time_delays[i];
+
+		/* A delay of td shifts the series by -td, and undoing the heterodyne for it leaves a phase */
+		double shift = detector_time_delay * cache->samples_per_second;
+		gsl_complex rotation = gsl_complex_polar(1.0, -2.0 * M_PI * cache->center_index * shift / workspace->num_time_samples);
+
+		start[i] = -shift * len / workspace->num_time_samples;
+		w_plus[i] = gsl_complex_mul_real(rotation, workspace->w_plus_input[i]);
+		w_minus[i] = gsl_complex_mul_real(rotation, workspace->w_minus_input[i]);
+	}
+
+#ifdef HAVE_OPENMP
+	#pragma omp parallel for private(i) num_threads(workspace->num_threads) if(workspace->num_threads > 1)
+#endif
+	for (j = 0; j < count; j++) {
+		gsl_complex z_plus = gsl_complex_rect(0.0, 0.0);
+		gsl_complex z_minus = gsl_complex_rect(0.0, 0.0);
+		size_t index = (first + j) % workspace->ifft_len;
+
+		for (i = 0; i < num_detectors; i++) {
+			gsl_complex *series = entry->series + i*len;
+			double x = start[i] + index*step;
+			double m = floor(x);
+			double t = x - m;
+			long base = ((long) m - 1) % (long) len;
+			size_t p0, p1, p2, p3;
+
+			if (base < 0) {
+				base += len;
+			}
+			p0 = (size_t) base;
+			p1 = (p0 + 1) % len;
+			p2 = (p0 + 2) % len;
+			p3 = (p0 + 3) % len;
+
+			/* cubic Lagrange interpolation through m - 1, m, m + 1 and m + 2 */
+			double c0 = -t * (t - 1.0) * (t - 2.0) / 6.0;
+			double c1 = (t + 1.0) * (t - 1.0) * (t - 2.0) / 2.0;
+			double c2 = -(t + 1.0) * t * (t - 2.0) / 2.0;
+			double c3 = (t + 1.0) * t * (t - 1.0) / 6.0;
+
+			gsl_complex z = gsl_complex_rect(
+					c0*GSL_REAL(series[p0]) + c1*GSL_REAL(series[p1]) + c2*GSL_REAL(series[p2]) + c3*GSL_REAL(series[p3]),
+					c0*GSL_IMAG(series[p0]) + c1*GSL_IMAG(series[p1]) + c2*GSL_IMAG(series[p2]) + c3*GSL_IMAG(series[p3]));
+
+			z_plus = gsl_complex_add(z_plus, gsl_complex_mul(w_plus[i], z));
+			z_minus = gsl_complex_add(z_minus, gsl_complex_mul(w_minus[i], z));
+		}
+
+		workspace->temp_ifft[j] = gsl_complex_abs2(z_plus) + gsl_complex_abs2(z_minus);
+	}
+}
+
+static void CN_tc_window_free( coherent_network_tc_window_t *window ) {
+	assert(window != NULL);
+
+	free(window->shift);
+	window->shift = NULL;
+
+	free(window->twiddle);
+	window->twiddle = NULL;
+
+	free(window->scratch);
+	window->scratch = NULL;
+
+	FFT_workspace_free(window->fft_workspace);
+	window->fft_workspace = NULL;
+
+	free(window);
+}
+
+/* The estimated cost of a window over the num_blocks blocks of length fft_len, see CN_tc_window_transform. The
+ * blocks with band bins are transformed, and each band bin is shifted and each of their outputs twiddled. */
+static double CN_tc_window_cost( size_t fft_len, size_t num_blocks, size_t band_len, size_t len ) {
+	size_t num_active = GSL_MIN(num_blocks, band_len);
+
+	return num_active * (FFT_cost_estimate(fft_len) + 2.0 * len) + band_len;
+}
+
+/* (Re)computes the window for the current ifft_len and band. */
+static void CN_tc_window_build( coherent_network_workspace_t *workspace, double t_min, double t_max ) {
+	coherent_network_tc_window_t *window;
+	size_t ifft_len = workspace->ifft_len;
+	size_t d, j, a, m;
+
+	if (workspace->tc_window != NULL) {
+		CN_tc_window_free(workspace->tc_window);
+		workspace->tc_window = NULL;
+	}
+
+	window = (coherent_network_tc_window_t*) malloc( sizeof(coherent_network_tc_window_t) );
+	if (window == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: CN_workspace_set_tc_window(). Exiting.\n");
+		exit(-1);
+	}
+
+	window->bytes = sizeof(coherent_network_tc_window_t);
+	window->t_min = t_min;
+	window->t_max = t_max;
+
+	/* The series has ifft_len samples over the duration of the data */
+	double series_per_second = CN_samples_per_second(workspace) * ifft_len / workspace->num_time_samples;
+	long first = (long) floor(t_min * series_per_second);
+	long last = (long) ceil(t_max * series_per_second);
+
+	window->len = (size_t) GSL_MIN(last - first + 1, (long) ifft_len);
+	window->start = (size_t) (((first % (long) ifft_len) + (long) ifft_len) % (long) ifft_len);
+
+	window->band_first = workspace->sp_lookup->f_low_index - workspace->ifft_offset;
+	window->band_len = workspace->sp_lookup->f_high_index - workspace->sp_lookup->f_low_index + 1;
+
+	/* The cheapest split into blocks of at least len, unless the full inverse FFT is cheaper */
+	window->full_cost = FFT_cost_estimate(ifft_len) + window->len;
+	window->cost = window->full_cost;
+	window->fft_len = ifft_len;
+	window->num_blocks = 0;
+	for (d = window->len; d < ifft_len; d++) {
+		if (ifft_len % d == 0) {
+			double cost = CN_tc_window_cost(d, ifft_len / d, window->band_len, window->len);
+			if (cost < window->cost) {
+				window->cost = cost;
+				window->fft_len = d;
+				window->num_blocks = ifft_len / d;
+			}
+		}
+	}
+	window->num_active = GSL_MIN(window->num_blocks, window->band_len);
+
+	window->shift = (gsl_complex*) CN_malloc( &window->bytes,
+			(window->num_blocks > 0 ? window->band_len : 0) * sizeof(gsl_complex), "CN_workspace_set_tc_window" );
+	window->twiddle = (gsl_complex*) CN_malloc( &window->bytes, window->num_active * window->len * sizeof(gsl_complex),
+			"CN_workspace_set_tc_window" );
+	window->scratch = (gsl_complex*) CN_malloc( &window->bytes,
+			(window->num_blocks > 0 ? window->num_active * window->fft_len : window->len) * sizeof(gsl_complex),
+			"CN_workspace_set_tc_window" );
+
+	/* The exponents are reduced modulo ifft_len first so that the phases stay accurate */
+	if (window->num_blocks > 0) {
+		for (j = 0; j < window->band_len; j++) {
+			size_t k = window->band_first + j;
+			window->shift[j] = gsl_complex_polar(1.0, 2.0 * M_PI * ((k * window->start) % ifft_len) / ifft_len);
+		}
+	}
+	for (a = 0; a < window->num_active; a++) {
+		size_t q = (window->band_first + a) % window->num_blocks;
+		for (m = 0; m < window->len; m++) {
+			window->twiddle[a*window->len + m] = gsl_complex_polar(1.0, 2.0 * M_PI * ((q * m) % ifft_len) / ifft_len);
+		}
+	}
+
+	window->fft_workspace = FFT_workspace_alloc( window->fft_len );
+
+	workspace->tc_window = window;
+}
+
+void CN_workspace_set_tc_window( coherent_network_workspace_t *workspace, double t_min, double t_max ) {
+	assert(workspace != NULL);
+
+	if (t_max < t_min) {
+		fprintf(stderr, "Error. The tc window ends (%f) before it starts (%f). Exiting.\n", t_max, t_min);
+		exit(-1);
+	}
+
+	/* The saved series change length */
+	CN_workspace_close_series(workspace);
+	CN_tc_window_build(workspace, t_min, t_max);
+}
+
+void CN_workspace_clear_tc_window( coherent_network_workspace_t *workspace ) {
+	assert(workspace != NULL);
+
+	if (workspace->tc_window != NULL) {
+		CN_workspace_close_series(workspace);
+		CN_tc_window_free(workspace->tc_window);
+		workspace->tc_window = NULL;
+	}
+}
+
+/* Replaces the ifft_len analytic spectrum in data with the window's len values of its inverse FFT, with the same
+ * 1 / ifft_len normalization. With k = num_blocks * r + q, output m of the window is
+ *   sum_q exp(2 pi i q m / ifft_len) * sum_r S_k exp(2 pi i k start / ifft_len) exp(2 pi i r m / fft_len),
+ * so the inner sums are inverse FFTs of length fft_len of every num_blocks'th (shifted) bin. Only the bins of the
+ * band are nonzero, so only the blocks q holding one are transformed. The band's bin band_first + j is in the
+ * active block j % num_blocks. */
+static void CN_tc_window_transform( coherent_network_tc_window_t *window, double *data ) {
+	gsl_complex *spectrum = (gsl_complex*) data;
+	size_t fft_len = window->fft_len;
+	size_t num_blocks = window->num_blocks;
+	size_t j, a, m;
+
+	if (num_blocks == 0) {
+		FFT_complex_inverse( fft_len, data, window->fft_workspace );
+		for (m = 0; m < window->len; m++) {
+			window->scratch[m] = spectrum[(window->start + m) % fft_len];
+		}
+		memcpy( data, window->scratch, window->len * sizeof(gsl_complex) );
+		return;
+	}
+
+	memset( window->scratch, 0, window->num_active * fft_len * sizeof(gsl_complex) );
+	for (j = 0; j < window->band_len; j++) {
+		size_t k = window->band_first + j;
+		window->scratch[(j % num_blocks)*fft_len + k / num_blocks] = gsl_complex_mul(spectrum[k], window->shift[j]);
+	}
+
+	FFT_complex_inverse_many( fft_len, window->num_active, (double*) window->scratch, window->fft_workspace );
+
+	/* Each block is normalized by 1 / fft_len, and 1 / num_blocks more makes it 1 / ifft_len */
+	for (m = 0; m < window->len; m++) {
+		data[2*m + 0] = 0.0;
+		data[2*m + 1] = 0.0;
+	}
+	for (a = 0; a < window->num_active; a++) {
+		gsl_complex *block = window->scratch + a*fft_len;
+		gsl_complex *twiddle = window->twiddle + a*window->len;
+
+		for (m = 0; m < window->len; m++) {
+			gsl_complex t = gsl_complex_mul(block[m], twiddle[m]);
+			data[2*m + 0] += GSL_REAL(t);
+			data[2*m + 1] += GSL_IMAG(t);
+		}
+	}
+	for (m = 0; m < 2*window->len; m++) {
+		data[m] /= num_blocks;
+	}
+}
+
+CN_PEAK_INTERPOLATION CN_peak_interpolation_from_string(const char *name) {
+	if (name == NULL || strcmp(name, "none") == 0) {
+		return CN_PEAK_INTERPOLATION_NONE;
+	}
+	if (strcmp(name, "parabolic") == 0) {
+		return CN_PEAK_INTERPOLATION_PARABOLIC;
+	}
+	if (strcmp(name, "sinc") == 0) {
+		return CN_PEAK_INTERPOLATION_SINC;
+	}
+
+	fprintf(stderr, "Error. Unknown peak interpolation (%s). Use none, parabolic or sinc. Exiting.\n", name);
+	exit(-1);
+}
+
+void CN_workspace_set_peak_interpolation( coherent_network_workspace_t *workspace, CN_PEAK_INTERPOLATION interpolation ) {
+	assert(workspace != NULL);
+
+	workspace->peak_interpolation = interpolation;
+}
+
+void CN_workspace_set_series_format( coherent_network_workspace_t *workspace, CN_SAVE_FORMAT format ) {
+	assert(workspace != NULL);
+
+	CN_workspace_close_series(workspace);
+	workspace->series_format = format;
+}
+
+void CN_workspace_close_series( coherent_network_workspace_t *workspace ) {
+	assert(workspace != NULL);
+
+	if (workspace->series_writer != NULL) {
+		hdf5_row_writer_close(workspace->series_writer);
+		workspace->series_writer = NULL;
+	}
+	free(workspace->series_filename);
+	workspace->series_filename = NULL;
+}
+
+/* Saves a series in the workspace's format. The HDF5 file is kept open for the next series of the same file. */
+static void CN_workspace_save_series( coherent_network_workspace_t *workspace, const char *filename, size_t len,
+		const double *series ) {
+	if (workspace->series_format != CN_SAVE_HDF5) {
+		CN_save_with_format(filename, workspace->series_format, len, series);
+		return;
+	}
+
+	if (workspace->series_writer != NULL && strcmp(workspace->series_filename, filename) != 0) {
+		CN_workspace_close_series(workspace);
+	}
+	if (workspace->series_writer == NULL) {
+		workspace->series_filename = (char*) malloc(strlen(filename) + 1);
+		if (workspace->series_filename == NULL) {
+			fprintf(stderr, "Error. Unable to allocate memory: CN_workspace_save_series(). Exiting.\n");
+			exit(-1);
+		}
+		strcpy(workspace->series_filename, filename);
+		workspace->series_writer = hdf5_row_writer_open(filename, CN_SAVE_HDF5_DATASET, len);
+	}
+	hdf5_row_writer_append(workspace->series_writer, len, series);
+}
+
+void CN_workspace_set_num_peaks( coherent_network_workspace_t *workspace, size_t num_peaks, double min_separation ) {
+	assert(workspace != NULL);
+	assert(min_separation >= 0.0);
+
+	free(workspace->peaks);
+	workspace->peaks = NULL;
+	workspace->peak_bytes = 0;
+
+	if (num_peaks > 0) {
+		workspace->peaks = (coherent_network_peak_t*) CN_malloc( &workspace->peak_bytes,
+				num_peaks * sizeof(coherent_network_peak_t), "CN_workspace_set_num_peaks" );
+	}
+
+	workspace->max_num_peaks = num_peaks;
+	workspace->min_peak_separation = min_separation;
+	workspace->num_peaks = 0;
+}
+
+/* The distance of values a and b of the len values. The whole series wraps around, a tc window of it doesn't. */
+static double CN_series_distance( double a, double b, size_t len, int circular ) {
+	double d = fabs(a - b);
+	return (circular && len - d < d) ? len - d : d;
+}
+
+/* Finds the largest values of the len values that are min_peak_separation apart in one pass, and leaves them in
+ * workspace->peaks with the raw value and the index into values. The first one is the same as CN_series_maximum's. */
+static void CN_series_peaks( coherent_network_workspace_t *workspace, size_t len, double *values ) {
+	coherent_network_peak_t *peaks = workspace->peaks;
+	size_t capacity = workspace->max_num_peaks;
+	double separation = workspace->min_peak_separation * workspace->ifft_len / workspace->num_time_samples;
+	int circular = (len == workspace->ifft_len);
+	size_t num = 0;
+	size_t j, p, q;
+
+	for (j = 0; j < len; j++) {
+		double v = values[j];
+		int suppressed = 0;
+
+		/* most values are smaller than every listed peak */
+		if (num == capacity && v <= peaks[num - 1].value) {
+			continue;
+		}
+
+		for (p = 0; p < num; p++) {
+			if (CN_series_distance((double) j, peaks[p].index, len, circular) < separation && peaks[p].value >= v) {
+				suppressed = 1;
+				break;
+			}
+		}
+		if (suppressed) {
+			continue;
+		}
+
+		/* The nearby peaks are all smaller, so they are replaced */
+		for (p = 0, q = 0; p < num; p++) {
+			if (CN_series_distance((double) j, peaks[p].index, len, circular) >= separation) {
+				peaks[q++] = peaks[p];
+			}
+		}
+		num = q;
+		if (num == capacity) {
+			num--;
+		}
+
+		/* keep them sorted, with equal values in the order they were found */
+		for (p = num; p > 0 && peaks[p - 1].value < v; p--) {
+			peaks[p] = peaks[p - 1];
+		}
+		peaks[p].value = v;
+		peaks[p].index = (double) j;
+		num++;
+	}
+
+	workspace->num_peaks = num;
+}
+
+/* The statistic at a fractional time sample tau of the data, from the one-sided sums of the matched filters, with
+ * its first and second derivatives. Its samples are the values of the series. */
+static void CN_band_statistic( coherent_network_workspace_t *workspace, gsl_complex **terms, double tau,
+		double *out_value, double *out_d1, double *out_d2 ) {
+	size_t f_low_index = workspace->sp_lookup->f_low_index;
+	size_t f_high_index = workspace->sp_lookup->f_high_index;
+	size_t num_time_samples = workspace->num_time_samples;
+	double step = 2.0 * M_PI * tau / num_time_samples;
+	size_t s, k;
+
+	*out_value = 0.0;
+	*out_d1 = 0.0;
+	*out_d2 = 0.0;
+
+	for (s = 0; s < 2; s++) {
+		gsl_complex z = gsl_complex_rect(0.0, 0.0);
+		gsl_complex z1 = gsl_complex_rect(0.0, 0.0);
+		gsl_complex z2 = gsl_complex_rect(0.0, 0.0);
+		gsl_complex rotation = gsl_complex_polar(1.0, step);
+		gsl_complex phasor = gsl_complex_rect(1.0, 0.0);
+
+		for (k = f_low_index; k <= f_high_index; k++) {
+			/* The phasor is recomputed now and then so that the rounding errors don't build up */
+			if ((k - f_low_index) % 256 == 0) {
+				phasor = gsl_complex_polar(1.0, step * k);
+			}
+
+			/* Same weights as SS_make_analytic_shifted */
+			double c = 2.0;
+			if (k == 0 || (SS_has_nyquist_term(num_time_samples) && k == num_time_samples / 2)) {
+				c = 1.0;
+			}
+
+			double w = 2.0 * M_PI * k / num_time_samples;
+			gsl_complex a = gsl_complex_mul(gsl_complex_mul_real(terms[s][k], c), phasor);
+
+			z = gsl_complex_add(z, a);
+			z1 = gsl_complex_add(z1, gsl_complex_mul_imag(a, w));
+			z2 = gsl_complex_add(z2, gsl_complex_mul_real(a, -w * w));
+
+			phasor = gsl_complex_mul(phasor, rotation);
+		}
+
+		*out_value += gsl_complex_abs2(z);
+		*out_d1 += 2.0 * GSL_REAL(gsl_complex_mul(gsl_complex_conjugate(z), z1));
+		*out_d2 += 2.0 * (gsl_complex_abs2(z1) + GSL_REAL(gsl_complex_mul(gsl_complex_conjugate(z), z2)));
+	}
+}
+
+/* Locates the peak around values[m], where values are the series_len values of the series from series_start.
+ * terms are the one-sided sums the series came from, or NULL if they weren't computed. */
+static void CN_interpolate_peak( coherent_network_workspace_t *workspace, gsl_complex **terms,
+		size_t series_start, size_t series_len, double *values, size_t m, coherent_network_peak_t *out_peak ) {
+	size_t ifft_len = workspace->ifft_len;
+	double samples_per_index = (double) workspace->num_time_samples / ifft_len;
+	double value = values[m];
+	double offset = 0.0;
+	CN_PEAK_INTERPOLATION interpolation = workspace->peak_interpolation;
+
+	if (interpolation == CN_PEAK_INTERPOLATION_SINC && terms == NULL) {
+		interpolation = CN_PEAK_INTERPOLATION_PARABOLIC;
+	}
+
+	/* The neighbours wrap around for the whole series, but not at the ends of a window */
+	if (interpolation != CN_PEAK_INTERPOLATION_NONE && (series_len == ifft_len || (m > 0 && m + 1 < series_len))) {
+		double before = values[(m + series_len - 1) % series_len];
+		double after = values[(m + 1) % series_len];
+		double curvature = before - 2.0 * value + after;
+
+		if (curvature < 0.0) {
+			offset = 0.5 * (before - after) / curvature;
+			value -= 0.25 * (before - after) * offset;
+		}
+	}
+
+	double tau = ((series_start + m) % ifft_len + offset) * samples_per_index;
+
+	if (interpolation == CN_PEAK_INTERPOLATION_SINC) {
+		/* Newton's method from the parabola's estimate, kept within one sample of the series of the maximum */
+		double center = ((series_start + m) % ifft_len) * samples_per_index;
+		double v, d1, d2;
+		int iteration;
+
+		for (iteration = 0; iteration < 8; iteration++) {
+			CN_band_statistic(workspace, terms, tau, &v, &d1, &d2);
+			value = v;
+			if (d2 >= 0.0) {
+				break;
+			}
+
+			double next = GSL_MAX(center - samples_per_index, GSL_MIN(center + samples_per_index, tau - d1 / d2));
+			if (fabs(next - tau) < 1e-9 * samples_per_index) {
+				break;
+			}
+			tau = next;
+		}
+		CN_band_statistic(workspace, terms, tau, &v, &d1, &d2);
+		value = v;
+	}
+
+	out_peak->value = sqrt(value) / sqrt(2.0);
+	out_peak->index = fmod(tau + workspace->num_time_samples, (double) workspace->num_time_samples);
+}
+
+/* Maps an index of the (possibly reduced) statistic series to the nearest time sample of the data. */
+static size_t CN_data_index(coherent_network_workspace_t *workspace, size_t ifft_index) {
+	if (workspace->ifft_len == workspace->num_time_samples) {
+		return ifft_index;
+	}
+	return (size_t) floor( (double) ifft_index * workspace->num_time_samples / workspace->ifft_len + 0.5 );
+}
+
+coherent_network_batch_workspace_t* CN_batch_workspace_alloc(size_t capacity, size_t num_time_samples, detector_network_t *net,
+		size_t num_half_freq, double f_low, double f_high) {
+	assert(net != NULL);
+
+	coherent_network_shared_t *shared = CN_shared_alloc(net, f_low, f_high);
+	coherent_network_batch_workspace_t *batch = CN_batch_workspace_alloc_shared(capacity, num_time_samples, net, num_half_freq, shared);
+	CN_shared_free(shared);
+
+	return batch;
+}
+
+coherent_network_batch_workspace_t* CN_batch_workspace_alloc_shared(size_t capacity, size_t num_time_samples,
+		detector_network_t *net, size_t num_half_freq, coherent_network_shared_t *shared) {
+	assert(net != NULL);
+	assert(shared != NULL);
+	assert(capacity > 0);
+
+	coherent_network_batch_workspace_t *batch;
+	size_t b;
+
+	batch = (coherent_network_batch_workspace_t*) malloc(sizeof(coherent_network_batch_workspace_t));
+	if (batch == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: CN_batch_workspace_alloc(). Exiting.\n");
+		exit(-1);
+	}
+
+	batch->bytes = sizeof(coherent_network_batch_workspace_t);
+	batch->layout_bytes = 0;
+
+	batch->capacity = capacity;
+	batch->workspace = CN_workspace_alloc_shared(num_time_samples, net, num_half_freq, shared);
+	batch->band_len = batch->workspace->sp_lookup->len;
+
+	batch->sp_batch = SP_batch_workspace_alloc(capacity, batch->workspace->sp_lookup);
+	batch->bytes += SP_batch_workspace_footprint(batch->sp_batch);
+
+	batch->sp = (stationary_phase_t**) CN_malloc( &batch->bytes, capacity * sizeof(stationary_phase_t*),
+			"CN_batch_workspace_alloc" );
+	for (b = 0; b < capacity; b++) {
+		batch->sp[b] = SP_alloc( num_half_freq );
+		batch->bytes += SP_footprint(batch->sp[b]);
+	}
+
+	batch->antenna_u = (double*) CN_malloc( &batch->bytes, net->num_detectors * capacity * sizeof(double),
+			"CN_batch_workspace_alloc" );
+	batch->antenna_v = (double*) CN_malloc( &batch->bytes, net->num_detectors * capacity * sizeof(double),
+			"CN_batch_workspace_alloc" );
+	batch->time_delays = (double*) CN_malloc( &batch->bytes, net->num_detectors * capacity * sizeof(double),
+			"CN_batch_workspace_alloc" );
+
+	/* For reconstruction use the phase as 0 */
+	batch->coalesce_phases = (double*) CN_malloc( &batch->bytes, capacity * sizeof(double),
+			"CN_batch_workspace_alloc" );
+	memset( batch->coalesce_phases, 0, capacity * sizeof(double) );
+
+	batch->w_plus_input = (double*) CN_malloc( &batch->bytes, capacity * net->num_detectors * sizeof(double),
+			"CN_batch_workspace_alloc" );
+	batch->w_minus_input = (double*) CN_malloc( &batch->bytes, capacity * net->num_detectors * sizeof(double),
+			"CN_batch_workspace_alloc" );
+
+	batch->fs = (double*) CN_aligned_alloc( &batch->bytes, 2 * capacity * 2 * num_time_samples * sizeof(double),
+			"CN_batch_workspace_alloc" );
+
+	/* zeroed here since only the analysis band is ever written */
+	batch->terms = (gsl_complex*) CN_aligned_alloc( &batch->layout_bytes, 2 * capacity * num_half_freq * sizeof(gsl_complex),
+			"CN_batch_workspace_alloc" );
+	memset( batch->terms, 0, 2 * capacity * num_half_freq * sizeof(gsl_complex) );
+
+	return batch;
+}
+
+void CN_batch_workspace_free( coherent_network_batch_workspace_t *batch ) {
+	assert(batch != NULL);
+
+	size_t b;
+
+	for (b = 0; b < batch->capacity; b++) {
+		SP_free(batch->sp[b]);
+		batch->sp[b] = NULL;
+	}
+	free(batch->sp);
+	batch->sp = NULL;
+
+	SP_batch_workspace_free(batch->sp_batch);
+	batch->sp_batch = NULL;
+
+	free(batch->antenna_u);
+	batch->antenna_u = NULL;
+
+	free(batch->antenna_v);
+	batch->antenna_v = NULL;
+
+	free(batch->time_delays);
+	batch->time_delays = NULL;
+
+	free(batch->coalesce_phases);
+	batch->coalesce_phases = NULL;
+
+	free(batch->w_plus_input);
+	batch->w_plus_input = NULL;
+
+	free(batch->w_minus_input);
+	batch->w_minus_input = NULL;
+
+	free(batch->terms);
+	batch->terms = NULL;
+
+	free(batch->fs);
+	batch->fs = NULL;
+
+	CN_workspace_free(batch->workspace);
+	batch->workspace = NULL;
+
+	free(batch);
+}
+
+void CN_batch_workspace_set_layout( coherent_network_batch_workspace_t *batch, CN_LAYOUT layout ) {
+	assert(batch != NULL);
+
+	size_t len = 2 * batch->capacity * batch->workspace->num_half_freq;
+
+	if (layout == batch->workspace->layout) {
+		return;
+	}
+
+	if (layout == CN_LAYOUT_COMPACT) {
+		free(batch->terms);
+		batch->terms = NULL;
+		batch->layout_bytes = 0;
+	} else {
+		/* zeroed here since only the analysis band is ever written */
+		batch->terms = (gsl_complex*) CN_aligned_alloc( &batch->layout_bytes, len * sizeof(gsl_complex),
+				"CN_batch_workspace_set_layout" );
+		memset( batch->terms, 0, len * sizeof(gsl_complex) );
+	}
+
+	CN_workspace_set_layout(batch->workspace, layout);
+}
+
+size_t CN_batch_workspace_footprint( const coherent_network_batch_workspace_t *batch ) {
+	assert(batch != NULL);
+
+	return batch->bytes + batch->layout_bytes + CN_workspace_footprint(batch->workspace);
+}
+
+/* Computes the one-sided spectrum of the whitened matched filter output for one detector.
+ * Only the analysis band [f_low_index, f_high_index] is written, since the template is zero outside of it.
+ */
+void CN_do_work(size_t f_low_index, size_t f_high_index, gsl_complex *spa, asd_t *asd, gsl_complex *half_fft_data, gsl_complex *out_temp) {
+	assert(spa != NULL);
+	assert(asd != NULL);
+	assert(half_fft_data != NULL);
+	assert(out_temp != NULL);
+	assert(f_high_index < asd->len);
+
+	size_t k;
+
+	for (k = f_low_index; k <= f_high_index; k++) {
+		out_temp[k] = gsl_complex_conjugate(spa[k]);
+		out_temp[k] = gsl_complex_div_real(out_temp[k], asd->asd[k]);
+		out_temp[k] = gsl_complex_mul( out_temp[k], half_fft_data[k] );
+	}
+}
+
+/* Same as CN_do_work, but with the data already divided by the ASD. All arrays start at the first bin of the band. */
+void CN_do_work_whitened(size_t band_len, gsl_complex *spa_band, gsl_complex *whitened_data_band, gsl_complex *out_temp_band) {
+	assert(spa_band != NULL);
+	assert(whitened_data_band != NULL);
+	assert(out_temp_band != NULL);
+
+	size_t j;
+
+	for (j = 0; j < band_len; j++) {
+		out_temp_band[j] = gsl_complex_mul( gsl_complex_conjugate(spa_band[j]), whitened_data_band[j] );
+	}
+}
+
+/* Divides the data of each detector by its ASD over the analysis band and stores it in the workspace.
+ * This only needs to be done once per generation of the strain, since neither changes during a search.
+ */
+void CN_whiten_data(detector_network_t *net, network_strain_half_fft_t *network_strain, coherent_network_workspace_t *workspace) {
+	assert(net != NULL);
+	assert(network_strain != NULL);
+	assert(workspace != NULL);
+	assert(network_strain->num_strains == workspace->num_detectors);
+
+	coherent_network_shared_t *shared = workspace->shared;
+
+	size_t i, k;
+	size_t f_low_index = workspace->sp_lookup->f_low_index;
+	size_t f_high_index = workspace->sp_lookup->f_high_index;
+
+	for (i = 0; i < workspace->num_detectors; i++) {
+		asd_t *asd = net->detector[i]->asd;
+		gsl_complex *half_fft_data = network_strain->strains[i]->half_fft;
+		gsl_complex *out = workspace->whitened_data[i];
+
+		assert(f_high_index < asd->len);
+
+		for (k = f_low_index; k <= f_high_index; k++) {
+			out[k - f_low_index] = gsl_complex_div_real( half_fft_data[k], asd->asd[k] );
+		}
+	}
+
+	shared->whitened_data_generation = network_strain->generation;
+	shared->whitened_data_version++;
+}
+
+/* Whitens a new strain, or one modified since, once for all of the workspaces sharing the tables, and clears the
+ * workspace's sky cache when the whitened data has changed since it was filled. The shared generation and version
+ * are only read and written inside the critical section, since other threads may be whitening at the same time. */
+static void CN_update_whitened_data(detector_network_t *net, network_strain_half_fft_t *network_strain,
+		coherent_network_workspace_t *workspace) {
+	coherent_network_shared_t *shared = workspace->shared;
+	unsigned long version;
+	size_t i;
+
+#ifdef HAVE_OPENMP
+	#pragma omp critical (cn_whiten_data)
+#endif
+	{
+		if (shared->whitened_data_generation != network_strain->generation) {
+			CN_whiten_data(net, network_strain, workspace);
+		}
+		version = shared->whitened_data_version;
+	}
+
+	if (workspace->whitened_data_version != version) {
+		if (workspace->sky_cache != NULL) {
+			for (i = 0; i < workspace->sky_cache->capacity; i++) {
+				workspace->sky_cache->entries[i].valid = 0;
+			}
+		}
+		workspace->whitened_data_version = version;
+	}
+}
+
+CN_SAVE_FORMAT CN_save_format_from_string(const char *name) {
+	if (name == NULL || strcmp(name, "text") == 0) {
+		return CN_SAVE_TEXT;
+	}
+	if (strcmp(name, "bin") == 0) {
+		return CN_SAVE_BINARY;
+	}
+	if (strcmp(name, "h5") == 0) {
+		return CN_SAVE_HDF5;
+	}
+
+	fprintf(stderr, "Error. Unknown network statistic series format (%s). Use text, bin or h5. Exiting.\n", name);
+	exit(-1);
+}
+
+const char* CN_save_format_extension(CN_SAVE_FORMAT format) {
+	switch (format) {
+	case CN_SAVE_BINARY: return ".bin";
+	case CN_SAVE_HDF5: return ".h5";
+	default: return "";
+	}
+}
+
+/* Appends the values as little-endian doubles, swapping the bytes a block at a time on big-endian machines. */
+static void CN_save_binary(const char *filename, size_t len, const double *series) {
+	const uint16_t endian_probe = 1;
+	int little_endian = *((const uint8_t*) &endian_probe) == 1;
+	unsigned char block[512 * sizeof(double)];
+	size_t written = 0;
+	size_t i, b;
+
+	FILE *file = fopen(filename, "ab");
+	if (file == NULL) {
+		fprintf(stderr, "Error. CN_save: Unable to open the file (%s) for writing the network statistic series. Exiting.\n", filename);
+		exit(-1);
+	}
+
+	if (little_endian) {
+		written = fwrite(series, sizeof(double), len, file);
+	} else {
+		for (i = 0; i < len; i += 512) {
+			size_t count = GSL_MIN(512, len - i);
+			for (b = 0; b < count * sizeof(double); b++) {
+				block[b] = ((const unsigned char*) (series + i + b / sizeof(double)))[sizeof(double) - 1 - b % sizeof(double)];
+			}
+			written += fwrite(block, sizeof(double), count, file);
+		}
+	}
+
+	if (written != len) {
+		fprintf(stderr, "Error. CN_save: Unable to write the network statistic series to the file (%s). Exiting.\n", filename);
+		exit(-1);
+	}
+	fclose(file);
+}
+
+void CN_save_with_format(const char *filename, CN_SAVE_FORMAT format, size_t len, const double *series) {
+	assert(filename != NULL);
+	assert(series != NULL);
+
+	FILE* file;
+	size_t i;
+
+	switch (format) {
+	case CN_SAVE_BINARY:
+		CN_save_binary(filename, len, series);
+		break;
+
+	case CN_SAVE_HDF5:
+		hdf5_append_row(filename, CN_SAVE_HDF5_DATASET, len, series);
+		break;
+
+	default:
+		file = fopen(filename, "w");
+		if (file == NULL) {
+			fprintf(stderr, "Error. CN_save: Unable to open the file (%s) for writing the network statistic series. Exiting.\n", filename);
+			exit(-1);
+		}
+
+		for (i = 0; i < len; i++) {
+			fprintf(file, "%e\n", series[i]);
+		}
+		fclose(file);
+		break;
+	}
+}
+
+void CN_save(char* filename, size_t len, double* tmp_ifft) {
+	assert(filename != NULL);
+	assert(tmp_ifft != NULL);
+
+	CN_save_with_format(filename, CN_SAVE_TEXT, len, tmp_ifft);
+}
+
+/* The matched filter stage of coherent_network_statistic with the detectors split between threads. The weighted
+ * sums are then formed bin by bin, adding the detectors in the same order as the serial loop. */
+static void CN_matched_filters_parallel(inspiral_chirp_time_t *chirp, coherent_network_workspace_t *workspace) {
+	size_t f_low_index = workspace->sp_lookup->f_low_index;
+	size_t band_len = workspace->sp_lookup->f_high_index - f_low_index + 1;
+	size_t num_detectors = workspace->num_detectors;
+	size_t i, fid;
+
+#ifdef HAVE_OPENMP
+	#pragma omp parallel private(i, fid) num_threads(workspace->num_threads)
+#endif
+	{
+#ifdef HAVE_OPENMP
+		#pragma omp for schedule(static)
+#endif
+		for (i = 0; i < num_detectors; i++) {
+			/* For reconstruction use the phase as 0 */
+			SP_compute(workspace->time_delays[i], workspace->normalization_factors[i], 0.0, chirp,
+					workspace->sp_lookup, workspace->detector_sp[i]);
+
+			CN_do_work_whitened(band_len, workspace->detector_sp[i]->spa_0 + f_low_index, workspace->whitened_data[i],
+					workspace->detector_filters + i*band_len);
+		}
+
+#ifdef HAVE_OPENMP
+		#pragma omp for schedule(static)
+#endif
+		for (fid = 0; fid < band_len; fid++) {
+			gsl_complex plus = gsl_complex_rect(0.0, 0.0);
+			gsl_complex minus = gsl_complex_rect(0.0, 0.0);
+
+			for (i = 0; i < num_detectors; i++) {
+				gsl_complex c = workspace->detector_filters[i*band_len + fid];
+				plus = gsl_complex_add( plus, gsl_complex_mul_real(c, workspace->w_plus_input[i]) );
+				minus = gsl_complex_add( minus, gsl_complex_mul_real(c, workspace->w_minus_input[i]) );
+			}
+
+			workspace->band_terms[0][fid] = plus;
+			workspace->band_terms[1][fid] = minus;
+		}
+	}
+}
+
+/* Returns the first index of the largest of the len values. With more than one thread each one searches
+ * a contiguous chunk, and ties go to the lower index, so the result is the same as the serial search. */
+static void CN_series_maximum(size_t num_threads, size_t len, double *values, double *out_max_value, size_t *out_max_index) {
+	size_t max_index = 0;
+	double max_value = values[0];
+
+#ifdef HAVE_OPENMP
+	#pragma omp parallel num_threads(num_threads) if(num_threads > 1)
+#endif
+	{
+		size_t j;
+		size_t local_index = 0;
+		double local_value = values[0];
+
+#ifdef HAVE_OPENMP
+		#pragma omp for schedule(static)
+#endif
+		for (j = 0; j < len; j++) {
+			if (values[j] > local_value) {
+				local_value = values[j];
+				local_index = j;
+			}
+		}
+
+#ifdef HAVE_OPENMP
+		#pragma omp critical (cn_series_maximum)
+#endif
+		{
+			if (local_value > max_value || (local_value == max_value && local_index < max_index)) {
+				max_value = local_value;
+				max_index = local_index;
+			}
+		}
+	}
+
+	*out_max_value = max_value;
+	*out_max_index = max_index;
+}
+
+/* Computes the weights of each detector's matched filter output from its antenna patterns u[i*stride] and
+ * v[i*stride]. */
+static void CN_detector_weights_from_patterns(size_t num_detectors, const double *u, const double *v, size_t stride,
+		double *out_w_plus, double *out_w_minus)
+{
+	double UdotU_input;
+	double UdotV_input;
+	double VdotV_input;
+	size_t i;
+	double A_input;
+	double B_input;
+	double C_input;
+	double Delta_input;
+	double Delta_factor_input;
+	double D_input;
+	double P1_input;
+	double P2_input;
+	double P3_input;
+	double P4_input;
+	double G1_input;
+	double G2_input;
+	double O11_input;
+	double O12_input;
+	double O21_input;
+	double O22_input;
+
+	/* We need to make vectors with the same number of dimensions as the number of detectors in the network */
+	UdotU_input = 0.0;
+	UdotV_input = 0.0;
+	VdotV_input = 0.0;
+
+	/* dot product */
+	for (i = 0; i < num_detectors; i++) {
+		UdotU_input += u[i*stride] * u[i*stride];
+		UdotV_input += u[i*stride] * v[i*stride];
+		VdotV_input += v[i*stride] * v[i*stride];
+	}
+
+	A_input = UdotU_input;
+	B_input = UdotV_input;
+	C_input = VdotV_input;
+
+	Delta_input = (A_input*C_input) - (B_input*B_input);
+	Delta_factor_input = 1.0 / sqrt(2.0*Delta_input);
+
+	D_input = sqrt( gsl_pow_2(A_input-C_input) + 4.0*gsl_pow_2(B_input) ) ;
+
+	P1_input = (C_input-A_input-D_input);
+	P2_input = (C_input-A_input+D_input);
+	P3_input = sqrt(C_input+A_input+D_input);
+	P4_input = sqrt(C_input+A_input-D_input);
+
+	G1_input =  sqrt( gsl_pow_2(P1_input) +  4.0*gsl_pow_2(B_input)) / (2.0*B_input) ;
+	G2_input =  sqrt( gsl_pow_2(P2_input) +  4.0*gsl_pow_2(B_input)) / (2.0*B_input) ;
+
+	O11_input = Delta_factor_input * P3_input / G1_input ;
+	O12_input = Delta_factor_input * P3_input * P1_input / (2.0*B_input*G1_input) ;
+	O21_input = Delta_factor_input * P4_input / G2_input ;
+	O22_input  = Delta_factor_input * P4_input * P2_input / (2.0*B_input*G2_input);
+
+	for (i = 0; i < num_detectors; i++) {
+		double U_vec_input = u[i*stride];
+		double V_vec_input = v[i*stride];
+
+		out_w_plus[i] = (O11_input*U_vec_input +  O12_input*V_vec_input);
+		out_w_minus[i] = (O21_input*U_vec_input +  O22_input*V_vec_input);
+	}
+}
+
+/* Computes the weights of each detector's matched filter output and its time delay for the sky position, from
+ * the sky table if one is set. */
+static void CN_sky_position(detector_network_t *net, sky_t *sky, coherent_network_workspace_t *workspace)
+{
+	detector_sky_table_t *table = workspace->shared->sky_table;
+	size_t i;
+
+	/* w_plus_input and w_minus_input hold u and v until the weights overwrite them. Each weight only depends on
+	 * its own detector's u and v once the dot products are known. */
+	if (table == NULL || Detector_Sky_Table_lookup(table, sky, 1, workspace->w_plus_input, workspace->w_minus_input,
+			workspace->time_delays) != 0) {
+		for (i = 0; i < net->num_detectors; i++) {
+			double polarization_angle = 0.0; // Shihan said only u and v are needed for templates.
+			Detector_Antenna_Patterns_compute(net->detector[i], sky, polarization_angle,
+					workspace->ap_workspace, &workspace->ap[i]);
+			workspace->w_plus_input[i] = workspace->ap[i].u;
+			workspace->w_minus_input[i] = workspace->ap[i].v;
+
+			Detector_time_delay(net->detector[i], sky, &workspace->time_delays[i]);
+		}
+	}
+
+	CN_detector_weights_from_patterns(net->num_detectors, workspace->w_plus_input, workspace->w_minus_input, 1,
+			workspace->w_plus_input, workspace->w_minus_input);
+}
+
+/* Writes the analytic spectrum of sum i to fs[i], from terms[i] or in place for the compact layout. */
+static void CN_make_analytic( coherent_network_workspace_t *workspace, size_t i ) {
+	size_t f_low_index = workspace->sp_lookup->f_low_index;
+	size_t f_high_index = workspace->sp_lookup->f_high_index;
+
+	if (workspace->layout == CN_LAYOUT_COMPACT) {
+		SS_make_analytic_in_place( workspace->num_half_freq, f_low_index, f_high_index, workspace->num_time_samples,
+				workspace->ifft_offset, workspace->ifft_len, (gsl_complex*) workspace->fs[i] );
+	} else {
+		SS_make_analytic_shifted( workspace->num_half_freq, workspace->terms[i], f_low_index, f_high_index,
+				workspace->num_time_samples, workspace->ifft_offset, workspace->ifft_len, (gsl_complex*) workspace->fs[i] );
+	}
+}
+
+/* Whether the analytic series are expanded and transformed in single precision, see CN_PRECISION. */
+static int CN_single_precision_applies( coherent_network_workspace_t *workspace ) {
+	return workspace->precision != CN_PRECISION_DOUBLE && workspace->layout == CN_LAYOUT_DEFAULT
+			&& workspace->tc_window == NULL;
+}
+
+/* Writes the analytic spectrum of the one-sided sum as 2 * ifft_len floats. */
+static void CN_make_analytic_single( coherent_network_workspace_t *workspace, gsl_complex *sum, float *analytic ) {
+	SS_make_analytic_shifted_float( workspace->num_half_freq, sum, workspace->sp_lookup->f_low_index,
+			workspace->sp_lookup->f_high_index, workspace->num_time_samples, workspace->ifft_offset,
+			workspace->ifft_len, analytic );
+}
+
+/* The sum of squares of the single precision plus and minus series at sample j, accumulated in double. */
+static double CN_sum_of_squares_single( const float *fs_plus, const float *fs_minus, size_t ifft_len, size_t j ) {
+	double m = gsl_pow_2((double) fs_plus[2*j + 0]*ifft_len) + gsl_pow_2((double) fs_plus[2*j + 1]*ifft_len);
+	m += gsl_pow_2((double) fs_minus[2*j + 0]*ifft_len) + gsl_pow_2((double) fs_minus[2*j + 1]*ifft_len);
+	return m;
+}
+
+/* Keeps the largest relative deviation of the single precision statistic from the double precision one. */
+static void CN_record_precision_deviation( coherent_network_workspace_t *workspace, double value, double value_single ) {
+	if (value > 0.0) {
+		workspace->precision_deviation = GSL_MAX(workspace->precision_deviation, fabs(value_single - value) / value);
+	}
+}
+
+/* For CN_PRECISION_VALIDATE: transforms the sums again in single precision, overwriting fs, and compares the
+ * maximum with the one of the double precision series in temp_ifft. */
+static void CN_validate_precision( coherent_network_workspace_t *workspace, size_t series_len ) {
+	size_t ifft_len = workspace->ifft_len;
+	float *fs_single = (float*) workspace->fs[0];
+	double max_value = 0.0;
+	double max_value_single = 0.0;
+	size_t i, j;
+
+	for (i = 0; i < 2; i++) {
+		CN_make_analytic_single( workspace, workspace->terms[i], fs_single + i*2*ifft_len );
+	}
+	FFT_complex_inverse_many_single( ifft_len, 2, fs_single, workspace->fft_workspace );
+
+	for (j = 0; j < series_len; j++) {
+		max_value = GSL_MAX(max_value, workspace->temp_ifft[j]);
+		max_value_single = GSL_MAX(max_value_single,
+				CN_sum_of_squares_single(fs_single, fs_single + 2*ifft_len, ifft_len, j));
+	}
+
+	CN_record_precision_deviation( workspace, sqrt(max_value) / sqrt(2.0), sqrt(max_value_single) / sqrt(2.0) );
+}
+
+/* DANGER. This assumes that the coalece phase is 0 */
+void coherent_network_statistic(
+		detector_network_t* net,
+		double f_low,
+		double f_high,
+		inspiral_chirp_time_t *chirp,
+		sky_t *sky,
+		network_strain_half_fft_t *network_strain,
+		coherent_network_workspace_t *workspace,
+		double *out_network_css_value,
+		int *out_network_css_index,
+		char *out_network_css_filename)
+{
+	assert(net);
+	assert(chirp);
+	assert(sky);
+	assert(network_strain);
+	assert(workspace);
+	assert(out_network_css_value);
+	assert(out_network_css_index);
+
+	size_t i;
+	size_t tid;
+	size_t fid;
+	size_t j;
+	double max_value;
+	size_t max_index;
+
+	/* WARNING: This assumes that all of the signals have the same lengths. */
+	size_t num_time_samples = network_strain->num_time_samples;
+
+	/* The template is zero outside of the analysis band, so only these bins are processed. */
+	size_t f_low_index = workspace->sp_lookup->f_low_index;
+	size_t f_high_index = workspace->sp_lookup->f_high_index;
+	size_t band_len = f_high_index - f_low_index + 1;
+	size_t ifft_len = workspace->ifft_len;
+
+	/* The first index and number of values of the series that are computed */
+	size_t series_start = 0;
+	size_t series_len = ifft_len;
+	coherent_network_tc_window_t *window = workspace->tc_window;
+
+	assert(num_time_samples == workspace->num_time_samples);
+
+	if (window != NULL) {
+		series_start = window->start;
+		series_len = window->len;
+	}
+
+	CN_sky_position(net, sky, workspace);
+
+	/* The data divided by the ASD doesn't change during a search, so it is only computed for a new strain. */
+	CN_update_whitened_data(net, network_strain, workspace);
+
+	if (workspace->sky_cache != NULL) {
+		CN_sky_cache_series(chirp, workspace);
+	} else if (workspace->num_threads > 1) {
+		CN_matched_filters_parallel(chirp, workspace);
+	} else {
+		/* zero the memory. Only the analysis band is ever written, the rest was zeroed when the workspace was allocated. */
+		for (tid = 0; tid < 2; tid++) {
+			memset( workspace->band_terms[tid], 0, band_len * sizeof(gsl_complex) );
+		}
+
+		/* Loop over each detector to generate a template and do matched filtering.
+		 * The weighted sum over the detectors is linear, so it is accumulated on the one-sided spectrum. */
+		for (i = 0; i < net->num_detectors; i++) {
+			double inspiral_coalesce_phase;
+			gsl_complex* whitened_data;
+			double w_plus;
+			double w_minus;
+
+			/* For reconstruction use the phase as 0 */
+			inspiral_coalesce_phase = 0.0;
+
+			/*printf("g = %0.21e\n", workspace->normalization_factors[i]);*/
+
+			SP_compute(		workspace->time_delays[i], workspace->normalization_factors[i],
+							inspiral_coalesce_phase, chirp,
+							workspace->sp_lookup,
+							workspace->sp);
+
+			/*
+			printf("Detector SPA_0: %s\n", det->name);
+			for (j = 0; j < workspace->sp->len; j++) {
+				printf("%0.21e \t %0.21e\n", GSL_REAL(workspace->sp->spa_0[j]), GSL_IMAG(workspace->sp->spa_0[j]));
+			}
+	*/
+
+			whitened_data = workspace->whitened_data[i];
+
+			/* compute c_plus. c_minus would be i * c_plus since spa_90 = -i * spa_0. */
+			CN_do_work_whitened(band_len, workspace->sp->spa_0 + f_low_index, whitened_data, workspace->temp_array + f_low_index);
+
+			w_plus = workspace->w_plus_input[i];
+			w_minus = workspace->w_minus_input[i];
+
+			for (fid = 0; fid < band_len; fid++) {
+				gsl_complex t;
+
+				t = gsl_complex_mul_real(workspace->temp_array[f_low_index + fid], w_plus);
+				workspace->band_terms[0][fid] = gsl_complex_add( workspace->band_terms[0][fid], t);
+
+				t = gsl_complex_mul_real(workspace->temp_array[f_low_index + fid], w_minus);
+				workspace->band_terms[1][fid] = gsl_complex_add( workspace->band_terms[1][fid], t);
+			}
+		}
+
+	}
+
+	/* The sky cache interpolates its own series, so it is always in double precision */
+	int single_precision = workspace->sky_cache == NULL && CN_single_precision_applies(workspace);
+
+	if (single_precision && workspace->precision == CN_PRECISION_SINGLE) {
+		/* The float series fit in the first half of the fs block */
+		float *fs_single = (float*) workspace->fs[0];
+
+		for (i = 0; i < 2; i++) {
+			CN_make_analytic_single( workspace, workspace->terms[i], fs_single + i*2*ifft_len );
+		}
+		FFT_complex_inverse_many_single( ifft_len, 2, fs_single, workspace->fft_workspace );
+
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for private(j) num_threads(workspace->num_threads) if(workspace->num_threads > 1)
+#endif
+		for (j = 0; j < series_len; j++) {
+			workspace->temp_ifft[j] = CN_sum_of_squares_single(fs_single, fs_single + 2*ifft_len, ifft_len, j);
+		}
+	} else if (workspace->sky_cache == NULL) {
+		/* Expand each sum to its analytic spectrum directly in the FFT buffer. The buffer is overwritten by the
+		 * inverse FFT, so the bins outside of the band have to be cleared on every call. */
+		if (window != NULL) {
+			/* The window's blocks are shared, so the two series are done one after the other */
+			for (i = 0; i < 2; i++) {
+				CN_make_analytic( workspace, i );
+				CN_tc_window_transform( window, workspace->fs[i] );
+			}
+		} else if (workspace->num_threads > 1) {
+#ifdef HAVE_OPENMP
+			#pragma omp parallel for private(i) num_threads(2)
+#endif
+			for (i = 0; i < 2; i++) {
+				CN_make_analytic( workspace, i );
+				FFT_complex_inverse( ifft_len, workspace->fs[i],
+						(i == 0) ? workspace->fft_workspace : workspace->fft_workspace_minus );
+			}
+		} else {
+			for (i = 0; i < 2; i++) {
+				CN_make_analytic( workspace, i );
+			}
+			FFT_complex_inverse_many( ifft_len, 2, workspace->fs[0], workspace->fft_workspace );
+		}
+
+		/* For each analytic series the real part is the 0 degree filter output and the imaginary part is the
+		 * (negated) 90 degree filter output, so |z|^2 gives the sum of the squares of both quadratures.
+		 * In the compact layout value j overwrites fs[0][j], which is only safe going up one thread. */
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for private(j) num_threads(workspace->num_threads) \
+				if(workspace->num_threads > 1 && workspace->layout == CN_LAYOUT_DEFAULT)
+#endif
+		for (j = 0; j < series_len; j++) {
+			double m = 0.0;
+			m += gsl_pow_2(workspace->fs[0][2*j + 0]*ifft_len) + gsl_pow_2(workspace->fs[0][2*j + 1]*ifft_len);
+			m += gsl_pow_2(workspace->fs[1][2*j + 0]*ifft_len) + gsl_pow_2(workspace->fs[1][2*j + 1]*ifft_len);
+			workspace->temp_ifft[j] = m;
+		}
+
+		/* CN_PRECISION_VALIDATE */
+		if (single_precision) {
+			CN_validate_precision(workspace, series_len);
+		}
+	}
+
+	/*CN_save("tmp_ifft.dat", s, workspace->temp_ifft);*/
+
+	/* check statistical behavior of this time series */
+	if (workspace->max_num_peaks > 0) {
+		CN_series_peaks(workspace, series_len, workspace->temp_ifft);
+		max_value = workspace->peaks[0].value;
+		max_index = (size_t) workspace->peaks[0].index;
+	} else {
+		CN_series_maximum(workspace->num_threads, series_len, workspace->temp_ifft, &max_value, &max_index);
+	}
+
+	/* The sums of the matched filters are only there without the sky cache, and the compact layout transforms them */
+	gsl_complex **terms = (workspace->sky_cache == NULL && workspace->layout == CN_LAYOUT_DEFAULT) ? workspace->terms : NULL;
+
+	CN_interpolate_peak(workspace, terms, series_start, series_len, workspace->temp_ifft, max_index, &workspace->peak);
+	for (i = 0; i < workspace->num_peaks; i++) {
+		CN_interpolate_peak(workspace, terms, series_start, series_len, workspace->temp_ifft,
+				(size_t) workspace->peaks[i].index, &workspace->peaks[i]);
+	}
+
+	/* check, sqrt sbould behave according to chi */
+	/* check, use this with just noise and see if the mean is 4, std should be sqrt(8). Chi-sqre if not sqrt(max). Check 'max' dist.*/
+	double old_snr_definition = sqrt(max_value) / sqrt(2.0);
+
+	// temp hack to do this quickly
+	//workspace->temp_ifft[max_index] = 0.0;
+	//double std = gsl_stats_sd (workspace->temp_ifft, 1, workspace->num_time_samples);
+	//workspace->temp_ifft[max_index] = max_value;
+
+	//double new_snr_definition = max_value / std;
+	*out_network_css_value = old_snr_definition;
+	*out_network_css_index = CN_data_index(workspace, (series_start + max_index) % ifft_len);
+
+	/* In the binary formats the file collects the series of every call */
 	if (out_network_css_filename != NULL) {
-		CN_save( out_network_css_filename, num_time_samples, workspace->temp_ifft);
+		CN_workspace_save_series( workspace, out_network_css_filename, series_len, workspace->temp_ifft);
+	}
+}
+
+/* The analysis band of sum s (2*b for the plus and 2*b+1 for the minus sum of entry b), index 0 at f_low_index. */
+static gsl_complex* CN_batch_band_term( coherent_network_batch_workspace_t *batch, size_t s ) {
+	coherent_network_workspace_t *workspace = batch->workspace;
+	size_t f_low_index = workspace->sp_lookup->f_low_index;
+
+	if (workspace->layout == CN_LAYOUT_COMPACT) {
+		return (gsl_complex*) (batch->fs + s*2*workspace->ifft_len) + (f_low_index - workspace->ifft_offset);
+	}
+	return batch->terms + s*workspace->num_half_freq + f_low_index;
+}
+
+/* DANGER. Like coherent_network_statistic, this assumes that the coalece phase is 0 */
+void coherent_network_statistic_batch(
+		detector_network_t* net,
+		size_t num_templates,
+		inspiral_chirp_time_t *chirps,
+		sky_t *skies,
+		network_strain_half_fft_t *network_strain,
+		coherent_network_batch_workspace_t *batch,
+		double *out_network_css_values,
+		int *out_network_css_indices)
+{
+	assert(net);
+	assert(chirps);
+	assert(skies);
+	assert(network_strain);
+	assert(batch);
+	assert(out_network_css_values);
+	assert(out_network_css_indices);
+
+	coherent_network_workspace_t *workspace = batch->workspace;
+	size_t num_detectors = net->num_detectors;
+	size_t num_time_samples = network_strain->num_time_samples;
+	size_t num_half_freq = workspace->num_half_freq;
+	size_t f_low_index = workspace->sp_lookup->f_low_index;
+	size_t f_high_index = workspace->sp_lookup->f_high_index;
+	size_t band_len = batch->band_len;
+	size_t ifft_len = workspace->ifft_len;
+	coherent_network_tc_window_t *window = workspace->tc_window;
+	size_t series_start = (window != NULL) ? window->start : 0;
+	size_t series_len = (window != NULL) ? window->len : ifft_len;
+	size_t start, count, b, i, j, fid;
+
+	assert(num_detectors == workspace->num_detectors);
+	assert(num_time_samples == workspace->num_time_samples);
+
+	CN_update_whitened_data(net, network_strain, workspace);
+
+	for (start = 0; start < num_templates; start += batch->capacity) {
+		count = GSL_MIN(batch->capacity, num_templates - start);
+
+		/* The antenna patterns and time delays of every template and detector, detector i's at [i*count, (i+1)*count). */
+		if (workspace->shared->sky_table != NULL) {
+			for (b = 0; b < count; b++) {
+				if (Detector_Sky_Table_lookup(workspace->shared->sky_table, &skies[start + b], count,
+						batch->antenna_u + b, batch->antenna_v + b, batch->time_delays + b) != 0) {
+					/* outside of the table, computed with the workspace's weights as scratch */
+					Detector_Sky_Batch_compute(workspace->shared->sky_batch, 1, &skies[start + b], 0.0,
+							workspace->w_plus_input, workspace->w_minus_input, NULL, NULL, workspace->time_delays);
+					for (i = 0; i < num_detectors; i++) {
+						batch->antenna_u[i*count + b] = workspace->w_plus_input[i];
+						batch->antenna_v[i*count + b] = workspace->w_minus_input[i];
+						batch->time_delays[i*count + b] = workspace->time_delays[i];
+					}
+				}
+			}
+		} else {
+			Detector_Sky_Batch_compute(workspace->shared->sky_batch, count, skies + start, 0.0,
+					batch->antenna_u, batch->antenna_v, NULL, NULL, batch->time_delays);
+		}
+
+		for (b = 0; b < count; b++) {
+			CN_detector_weights_from_patterns(num_detectors, batch->antenna_u + b, batch->antenna_v + b, count,
+					batch->w_plus_input + b*num_detectors, batch->w_minus_input + b*num_detectors);
+		}
+
+		for (b = 0; b < 2*count; b++) {
+			memset( CN_batch_band_term(batch, b), 0, band_len * sizeof(gsl_complex) );
+		}
+
+		/* One detector at a time, so that its whitened data stays in cache for every template of the batch. */
+		for (i = 0; i < num_detectors; i++) {
+			gsl_complex *whitened_data = workspace->whitened_data[i];
+
+			SP_compute_batch(count, batch->time_delays + i*count, workspace->normalization_factors[i],
+					batch->coalesce_phases, chirps + start,
+					workspace->sp_lookup, batch->sp_batch, batch->sp);
+
+			for (b = 0; b < count; b++) {
+				double w_plus = batch->w_plus_input[b*num_detectors + i];
+				double w_minus = batch->w_minus_input[b*num_detectors + i];
+				gsl_complex *term_plus = CN_batch_band_term(batch, 2*b + 0);
+				gsl_complex *term_minus = CN_batch_band_term(batch, 2*b + 1);
+
+				CN_do_work_whitened(band_len, batch->sp[b]->spa_0 + f_low_index, whitened_data, workspace->temp_array);
+
+				for (fid = 0; fid < band_len; fid++) {
+					gsl_complex t;
+
+					t = gsl_complex_mul_real(workspace->temp_array[fid], w_plus);
+					term_plus[fid] = gsl_complex_add( term_plus[fid], t);
+
+					t = gsl_complex_mul_real(workspace->temp_array[fid], w_minus);
+					term_minus[fid] = gsl_complex_add( term_minus[fid], t);
+				}
+			}
+		}
+
+		/* The float series of the sums fit in the first half of fs */
+		int single_precision = CN_single_precision_applies(workspace);
+		int transform_single = single_precision && workspace->precision == CN_PRECISION_SINGLE;
+		float *fs_single = (float*) batch->fs;
+
+		for (b = 0; b < 2*count; b++) {
+			if (transform_single) {
+				CN_make_analytic_single( workspace, batch->terms + b*num_half_freq, fs_single + b*2*ifft_len );
+			} else if (workspace->layout == CN_LAYOUT_COMPACT) {
+				SS_make_analytic_in_place( num_half_freq, f_low_index, f_high_index,
+						num_time_samples, workspace->ifft_offset, ifft_len, (gsl_complex*) (batch->fs + b*2*ifft_len) );
+			} else {
+				SS_make_analytic_shifted( num_half_freq, batch->terms + b*num_half_freq, f_low_index, f_high_index,
+						num_time_samples, workspace->ifft_offset, ifft_len, (gsl_complex*) (batch->fs + b*2*ifft_len) );
+			}
+		}
+
+		if (window != NULL) {
+			for (b = 0; b < 2*count; b++) {
+				CN_tc_window_transform( window, batch->fs + b*2*ifft_len );
+			}
+		} else if (transform_single) {
+			FFT_complex_inverse_many_single( ifft_len, 2*count, fs_single, workspace->fft_workspace );
+		} else {
+			/* The 2 * count series are contiguous, so they are done with one multi-transform plan */
+			FFT_complex_inverse_many( ifft_len, 2*count, batch->fs, workspace->fft_workspace );
+		}
+
+		for (b = 0; b < count; b++) {
+			double *fs_plus = batch->fs + (2*b + 0)*2*ifft_len;
+			double *fs_minus = batch->fs + (2*b + 1)*2*ifft_len;
+			double max_value = -1.0;
+			size_t max_index = 0;
+
+			/* Same sum of squares as coherent_network_statistic */
+			for (j = 0; j < series_len; j++) {
+				double m;
+				if (transform_single) {
+					m = CN_sum_of_squares_single(fs_single + (2*b + 0)*2*ifft_len, fs_single + (2*b + 1)*2*ifft_len,
+							ifft_len, j);
+				} else {
+					m = gsl_pow_2(fs_plus[2*j + 0]*ifft_len) + gsl_pow_2(fs_plus[2*j + 1]*ifft_len);
+					m += gsl_pow_2(fs_minus[2*j + 0]*ifft_len) + gsl_pow_2(fs_minus[2*j + 1]*ifft_len);
+				}
+				if (m > max_value) {
+					max_value = m;
+					max_index = j;
+				}
+			}
+
+			out_network_css_values[start + b] = sqrt(max_value) / sqrt(2.0);
+			out_network_css_indices[start + b] = CN_data_index(workspace, (series_start + max_index) % ifft_len);
+		}
+
+		/* CN_PRECISION_VALIDATE: the batch again in single precision, compared with the double precision values */
+		if (single_precision && workspace->precision == CN_PRECISION_VALIDATE) {
+			for (b = 0; b < 2*count; b++) {
+				CN_make_analytic_single( workspace, batch->terms + b*num_half_freq, fs_single + b*2*ifft_len );
+			}
+			FFT_complex_inverse_many_single( ifft_len, 2*count, fs_single, workspace->fft_workspace );
+
+			for (b = 0; b < count; b++) {
+				double max_value_single = 0.0;
+				for (j = 0; j < series_len; j++) {
+					max_value_single = GSL_MAX(max_value_single, CN_sum_of_squares_single(fs_single + (2*b + 0)*2*ifft_len,
+							fs_single + (2*b + 1)*2*ifft_len, ifft_len, j));
+				}
+				CN_record_precision_deviation( workspace, out_network_css_values[start + b],
+						sqrt(max_value_single) / sqrt(2.0) );
+			}
+		}
 	}
 }
@@ -6,12 +6,15 @@
 #include <stdlib.h>
 
 #include <gsl/gsl_cblas.h>
-#include <gsl/gsl_fft_complex.h>
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_statistics_double.h>
 
 #include "detector_antenna_patterns.h"
 #include "detector_network.h"
+#include "detector_sky_batch.h"
+#include "detector_sky_table.h"
+#include "fft.h"
+#include "hdf5_file.h"
 #include "inspiral_chirp_time.h"
 #include "inspiral_stationary_phase.h"
 #include "spectral_density.h"
@@ -21,59 +24,479 @@
 extern "C" {
 #endif
 
-/* There is one helper per detector */
-typedef struct coherent_network_helper_s {
-	double w_plus_input;
-	double w_minus_input;
-	gsl_complex *c_plus;
-	gsl_complex *c_minus;
+void CN_template_chirp_time(double f_low, double chirp_time0, double chirp_time1_5, inspiral_chirp_time_t *ct);
 
-} coherent_network_helper_t;
+/* How the analytic series are shortened before the inverse FFT. The statistic only has content in the
+ * analysis band, so the series can be transformed at a lower rate:
+ *   CN_REDUCTION_DECIMATE keeps the bins [0, f_high] and CN_REDUCTION_HETERODYNE shifts [f_low, f_high] down to 0.
+ * Both give the statistic at fewer, evenly spaced times, and the returned index is mapped back to the data's rate.
+ */
+typedef enum {
+	CN_REDUCTION_NONE = 0,
+	CN_REDUCTION_DECIMATE,
+	CN_REDUCTION_HETERODYNE
+} CN_REDUCTION;
 
-void CN_template_chirp_time(double f_low, double chirp_time0, double chirp_time1_5, inspiral_chirp_time_t *ct);
+/* Parses "none", "decimate" or "heterodyne". NULL, e.g. a missing setting, is "none". */
+CN_REDUCTION CN_reduction_from_string(const char *name);
+
+/* How the peak of the statistic is located between its samples:
+ *   CN_PEAK_INTERPOLATION_PARABOLIC fits a parabola through the largest sample and its neighbours, and
+ *   CN_PEAK_INTERPOLATION_SINC maximizes the band limited statistic itself, evaluated from the matched filter
+ *   spectra (equivalent to sinc interpolation of the series). It falls back to a parabola with a sky cache.
+ */
+typedef enum {
+	CN_PEAK_INTERPOLATION_NONE = 0,
+	CN_PEAK_INTERPOLATION_PARABOLIC,
+	CN_PEAK_INTERPOLATION_SINC
+} CN_PEAK_INTERPOLATION;
+
+/* Parses "none", "parabolic" or "sinc". NULL, e.g. a missing setting, is "none". */
+CN_PEAK_INTERPOLATION CN_peak_interpolation_from_string(const char *name);
+
+/* How the scratch memory of a workspace is laid out:
+ *   CN_LAYOUT_DEFAULT keeps the one-sided sums (terms), the analytic series (fs) and the statistic (temp_ifft) in
+ *   their own buffers, and CN_LAYOUT_COMPACT reuses fs for all three. The sums are accumulated where the inverse
+ *   FFT reads them, expanded in place, and the statistic overwrites the transformed series. The template's buffer
+ *   also holds the matched filter output. That saves about 3/4 of num_time_samples complex values per workspace.
+ * The results are the same, except that sinc peak interpolation falls back to a parabola in the compact layout
+ * since the sums are gone after the inverse FFT, and the statistic is formed on the calling thread.
+ */
+typedef enum {
+	CN_LAYOUT_DEFAULT = 0,
+	CN_LAYOUT_COMPACT
+} CN_LAYOUT;
+
+/* Parses "default" or "compact". NULL, e.g. a missing setting, is "default". */
+CN_LAYOUT CN_layout_from_string(const char *name);
+
+/* The precision of the analytic series and their inverse FFTs, which are most of the work of an evaluation:
+ *   CN_PRECISION_SINGLE expands and transforms them as floats, in the first half of the fs buffers, and
+ *   CN_PRECISION_VALIDATE returns the double precision statistic, but also computes it in single precision and
+ *   keeps the largest relative deviation between the two in the workspace's precision_deviation.
+ * The templates, the matched filters and their sums, and the sums of squares stay in double. Single precision is
+ * only used in the default layout without a sky cache or tc window, otherwise the statistic is computed in double.
+ */
+typedef enum {
+	CN_PRECISION_DOUBLE = 0,
+	CN_PRECISION_SINGLE,
+	CN_PRECISION_VALIDATE
+} CN_PRECISION;
+
+/* Parses "double", "single" or "validate". NULL, e.g. a missing setting, is "double". */
+CN_PRECISION CN_precision_from_string(const char *name);
+
+/* How the statistic series are saved. CN_SAVE_TEXT writes one "%e" line per value, replacing the file.
+ * CN_SAVE_BINARY appends the values to the file as raw little-endian doubles, and CN_SAVE_HDF5 appends them
+ * as a row of the 2-D dataset CN_SAVE_HDF5_DATASET, so the series of many templates can share one file.
+ */
+typedef enum {
+	CN_SAVE_TEXT = 0,
+	CN_SAVE_BINARY,
+	CN_SAVE_HDF5
+} CN_SAVE_FORMAT;
+
+#define CN_SAVE_HDF5_DATASET "network_statistic"
+
+/* Parses "text", "bin" or "h5". NULL, e.g. a missing setting, is "text". */
+CN_SAVE_FORMAT CN_save_format_from_string(const char *name);
+
+/* A peak of the statistic series. */
+typedef struct coherent_network_peak_s {
+	/* the statistic, like out_network_css_value */
+	double value;
+
+	/* the time sample of the data, a fraction with interpolation. Divide by the sampling frequency for tc. */
+	double index;
+
+} coherent_network_peak_t;
+
+/* The alignment (bytes) of the workspaces' buffers: a cache line, an AVX-512 vector and FFTW's alignment. */
+#define CN_ALIGNMENT 64
+
+/* Number of chirps whose detector series are kept by a sky cache by default. */
+#define CN_SKY_CACHE_DEFAULT_CAPACITY 4
+
+/* How many times the analysis bandwidth the cached series are sampled at. The series are interpolated with
+ * cubic polynomials, so this sets the accuracy: about 1e-2 relative at 4 and 1e-3 at 8. */
+#define CN_SKY_CACHE_DEFAULT_UPSAMPLE 8
+
+/* The analytic matched filter series of every detector for one chirp, computed without a time delay. The key is
+ * the whole chirp time, so chirps whose tc, chirp_time1 or chirp_time2 weren't derived from chirp_time0 and
+ * chirp_time1_5 by CN_template_chirp_time get their own entries. */
+typedef struct coherent_network_sky_cache_entry_s {
+	int valid;
+	inspiral_chirp_time_t chirp;
+
+	/* the last time the entry was used, for choosing which entry to replace */
+	unsigned long last_used;
+
+	/* num_detectors series of len complex values, one after another */
+	gsl_complex *series;
+
+} coherent_network_sky_cache_entry_t;
+
+/* For a fixed chirp, a sky position only shifts each detector's matched filter series by the detector's time
+ * delay and changes the weights. The cache keeps the unshifted series of the most recently used chirps, so
+ * another sky position for one of them is a weighted sum of interpolated series without any FFTs.
+ *
+ * The series are heterodyned by center_index bins, which keeps them smooth enough to interpolate. They are
+ * len samples long over the same duration as the data.
+ */
+typedef struct coherent_network_sky_cache_s {
+	size_t capacity;
+	size_t num_detectors;
+	size_t len;
+	size_t center_index;
+
+	/* Converts a time delay (s) to data samples */
+	double samples_per_second;
+
+	unsigned long clock;
+	size_t hits;
+	size_t misses;
+
+	coherent_network_sky_cache_entry_t *entries;
+	fft_workspace_t *fft_workspace;
+
+	/* The bytes allocated for the cache and its entries */
+	size_t bytes;
+
+} coherent_network_sky_cache_t;
+
+/* The statistic restricted to a window of coalescence times. The window is the len consecutive indices of the
+ * ifft_len series from start, wrapping around the end. Splitting ifft_len = fft_len * num_blocks, the fft_len
+ * outputs from start are num_blocks transforms of length fft_len combined with twiddles. Only the blocks with bins
+ * of the band are transformed, and only len values are searched. The split with the lowest FFT_cost_estimate is
+ * used, or the full inverse FFT when no split is cheaper.
+ */
+typedef struct coherent_network_tc_window_s {
+	/* the requested window (s) */
+	double t_min;
+	double t_max;
+
+	size_t start;
+	size_t len;
+
+	/* the nonzero bins of the analytic spectrum */
+	size_t band_first;
+	size_t band_len;
+
+	/* a divisor of ifft_len that is at least len, or ifft_len with num_blocks = 0 for the full inverse FFT */
+	size_t fft_len;
+	size_t num_blocks;
+
+	/* the blocks with bins of the band, min(num_blocks, band_len) */
+	size_t num_active;
+
+	/* the estimated costs of the window and of the full inverse FFT, in the units of FFT_cost_estimate */
+	double cost;
+	double full_cost;
+
+	/* exp(2 pi i k start / ifft_len) for each bin k of the band */
+	gsl_complex *shift;
+
+	/* exp(2 pi i q m / ifft_len) for active block q and output m, num_active x len */
+	gsl_complex *twiddle;
+
+	/* the active blocks, num_active x fft_len, or the len outputs of the full inverse FFT */
+	gsl_complex *scratch;
+
+	fft_workspace_t *fft_workspace;
+
+	/* The bytes allocated for the window and its tables */
+	size_t bytes;
+
+} coherent_network_tc_window_t;
+
+/* The read-only tables of the statistic, which only depend on the network, the band and the strain. Workspaces
+ * allocated with CN_workspace_alloc_shared, e.g. one per thread, use the same tables instead of each computing
+ * and storing a copy. It is reference counted: every workspace holds a reference, and it is freed when the last
+ * one is released with CN_shared_free.
+ */
+typedef struct coherent_network_shared_s {
+	size_t num_detectors;
+
+	stationary_phase_workspace_t *sp_lookup;
+
+	/* g, normalization factor */
+	double *normalization_factors;
+
+	/* The detector tensors and locations, for the antenna patterns and time delays of a batch of templates */
+	detector_sky_batch_t *sky_batch;
+
+	/* NULL unless set with CN_shared_set_sky_table. */
+	detector_sky_table_t *sky_table;
+
+	/* The data of each detector divided by its ASD over the analysis band, one array per detector.
+	 * Index 0 corresponds to sp_lookup->f_low_index. It is computed again whenever the statistic is called with
+	 * a strain of another generation than whitened_data_generation (0 before the first), so a strain that is
+	 * modified in place has to be marked with network_strain_half_fft_modified.
+	 */
+	gsl_complex **whitened_data;
+	unsigned long whitened_data_generation;
+
+	/* Incremented every time the whitened data is computed, so that workspaces know when it changed */
+	unsigned long whitened_data_version;
+
+	size_t num_references;
+
+	/* The bytes allocated with the tables, without the sky table, see CN_shared_footprint */
+	size_t bytes;
+
+} coherent_network_shared_t;
 
-coherent_network_helper_t* CN_helper_alloc(size_t num_time_samples);
+coherent_network_shared_t* CN_shared_alloc(detector_network_t *net, double f_low, double f_high);
 
-void CN_helper_free( coherent_network_helper_t* helper);
+/* Releases a reference. */
+void CN_shared_free( coherent_network_shared_t *shared );
+
+/* Interpolates the antenna patterns and time delays of the templates from the table, instead of computing them,
+ * for every workspace using the shared tables. The shared tables take ownership of the table. Sky positions
+ * outside of the table are computed. NULL goes back to computing all of them. */
+void CN_shared_set_sky_table( coherent_network_shared_t *shared, detector_sky_table_t *table );
 
 typedef struct coherent_network_workspace_s {
 	size_t num_time_samples;
+	size_t num_half_freq;
 
-	size_t num_helpers;
-	coherent_network_helper_t **helpers;
+	/* The weights of each detector's matched filter output. One per detector. */
+	size_t num_detectors;
+	double *w_plus_input;
+	double *w_minus_input;
 
 	stationary_phase_workspace_t *sp_lookup;
 	stationary_phase_t *sp;
 
+	/* See CN_LAYOUT. The buffers below are aligned to CN_ALIGNMENT bytes. */
+	CN_LAYOUT layout;
+
 	/* temporary array that is repeatedly used.
-	 * Its size must be the same as the number of frequencies.
+	 * Its size must be the same as the number of frequencies. It is sp->spa_0 in the compact layout.
 	 */
 	gsl_complex *temp_array;
 
+	/* The weighted sums over the detectors of the one-sided matched filter spectra (num_half_freq long).
+	 * terms[0] uses w_plus and terms[1] uses w_minus. The 90 degree filter is not stored since its spectrum
+	 * is i * the 0 degree one. Both are NULL in the compact layout.
+	 */
 	gsl_complex **terms;
+
+	/* The analysis band of each sum, index 0 at f_low_index. In the compact layout it is inside fs[i], at the
+	 * position of its analytic bins. */
+	gsl_complex *band_terms[2];
+
+	/* The analytic series are ifft_len long, with one-sided bin ifft_offset at index 0.
+	 * Without a reduction they are num_time_samples long with no offset. */
+	CN_REDUCTION reduction;
+	size_t ifft_len;
+	size_t ifft_offset;
+
+	/* The analytic spectra of the terms, inverse transformed in place (2 * ifft_len long).
+	 * fs[1] directly follows fs[0] in memory. */
 	double **fs;
 
+	/* The statistic series (num_time_samples long). It is fs[0] in the compact layout. */
 	double *temp_ifft;
-	gsl_fft_complex_wavetable *fft_wavetable;
-	gsl_fft_complex_workspace *fft_workspace;
+	fft_workspace_t *fft_workspace;
 
 	detector_antenna_patterns_workspace_t *ap_workspace;
 	detector_antenna_patterns_t *ap;
 
-	/* g, normalization factor */
+	/* The time delay of each detector for the sky position of the call */
+	double *time_delays;
+
+	/* The tables, and the version of the whitened data that the sky cache was computed from. sp_lookup,
+	 * normalization_factors and whitened_data point to the shared ones, and must not be modified. */
+	coherent_network_shared_t *shared;
+	unsigned long whitened_data_version;
 	double *normalization_factors;
+	gsl_complex **whitened_data;
+
+	/* NULL unless enabled with CN_workspace_enable_sky_cache. */
+	coherent_network_sky_cache_t *sky_cache;
+
+	/* NULL unless set with CN_workspace_set_tc_window. */
+	coherent_network_tc_window_t *tc_window;
+
+	/* See CN_PRECISION. precision_deviation is the largest relative deviation of the single precision statistic
+	 * from the double precision one since CN_workspace_set_precision, for CN_PRECISION_VALIDATE. */
+	CN_PRECISION precision;
+	double precision_deviation;
+
+	/* After each call of coherent_network_statistic, peak is the maximum located with peak_interpolation.
+	 * With max_num_peaks > 0, peaks[0 .. num_peaks) are also the largest values that are at least
+	 * min_peak_separation time samples apart, largest first, found in the same pass as the maximum. */
+	CN_PEAK_INTERPOLATION peak_interpolation;
+	coherent_network_peak_t peak;
+	size_t max_num_peaks;
+	double min_peak_separation;
+	size_t num_peaks;
+	coherent_network_peak_t *peaks;
+
+	/* Threads used inside one evaluation, see CN_workspace_set_num_threads. The rest is only allocated for
+	 * more than one thread: a template and matched filter output (band only) per detector, and an FFT
+	 * workspace for the minus series so that both series can be transformed at once. */
+	size_t num_threads;
+	stationary_phase_t **detector_sp;
+	gsl_complex *detector_filters;
+	fft_workspace_t *fft_workspace_minus;
+
+	/* The bytes allocated by the workspace, recorded when they are allocated, see CN_workspace_footprint: the
+	 * memory kept until CN_workspace_free, the default layout's buffers, the buffers for more than one thread
+	 * and the peaks. The FFT workspaces, the sky cache and the tc window are counted on their own. */
+	size_t bytes;
+	size_t layout_bytes;
+	size_t thread_bytes;
+	size_t peak_bytes;
+
+	/* The format of the series saved by coherent_network_statistic, see CN_workspace_set_series_format. With
+	 * CN_SAVE_HDF5 the file of the last series stays open until the filename changes or the series is closed. */
+	CN_SAVE_FORMAT series_format;
+	char *series_filename;
+	hdf5_row_writer_t *series_writer;
 
 } coherent_network_workspace_t;
 
 coherent_network_workspace_t* CN_workspace_alloc(size_t num_time_samples, detector_network_t *net, size_t num_half_freq,
 		double f_low, double f_high);
 
+/* Allocates a workspace that uses the shared tables, and only has its own scratch memory. */
+coherent_network_workspace_t* CN_workspace_alloc_shared(size_t num_time_samples, detector_network_t *net, size_t num_half_freq,
+		coherent_network_shared_t *shared);
+
 void CN_workspace_free( coherent_network_workspace_t *workspace );
 
-void CN_do_work(size_t num_time_samples, size_t f_low_index, size_t f_high_index, gsl_complex *spa, asd_t *asd, gsl_complex *whitened_data, gsl_complex *temp, gsl_complex *out_c);
+/* Changes the length of the inverse FFTs. A batch workspace is changed through its workspace member. */
+void CN_workspace_set_reduction( coherent_network_workspace_t *workspace, CN_REDUCTION reduction );
+
+/* Changes the layout of the scratch memory. A batch workspace is changed with CN_batch_workspace_set_layout. */
+void CN_workspace_set_layout( coherent_network_workspace_t *workspace, CN_LAYOUT layout );
+
+/* Changes the precision of the inverse FFTs and clears precision_deviation. A batch workspace is changed through
+ * its workspace member. */
+void CN_workspace_set_precision( coherent_network_workspace_t *workspace, CN_PRECISION precision );
+
+/* The bytes allocated for the workspace's own memory, including the FFT scratch, the sky cache, the tc window and
+ * the buffers for more than one thread, as recorded when they were allocated. The shared tables are counted once
+ * with CN_shared_footprint. */
+size_t CN_workspace_footprint( const coherent_network_workspace_t *workspace );
+
+/* The bytes allocated for the shared tables and the sky table. */
+size_t CN_shared_footprint( const coherent_network_shared_t *shared );
+
+/* Sets the number of OpenMP threads that coherent_network_statistic uses for one evaluation: the detectors'
+ * templates and matched filters, the two inverse FFTs and the search for the maximum are split between them.
+ * The results don't depend on the number of threads. 0 uses omp_get_max_threads(). Inside a parallel region,
+ * e.g. the PSO's loop over particles, the extra threads are only used if nested parallelism is enabled
+ * (OMP_MAX_ACTIVE_LEVELS), otherwise the evaluation runs on the calling thread as before.
+ */
+void CN_workspace_set_num_threads( coherent_network_workspace_t *workspace, size_t num_threads );
+
+/* Makes coherent_network_statistic keep the detector series of the last 'capacity' chirps, so that other sky
+ * positions with the same chirp times are evaluated by interpolation. The values then agree with the FFT path
+ * to the accuracy given by 'upsample' (see CN_SKY_CACHE_DEFAULT_UPSAMPLE). A capacity of 0 disables the cache.
+ */
+void CN_workspace_enable_sky_cache( coherent_network_workspace_t *workspace, size_t capacity, size_t upsample );
+
+/* Only computes the statistic for coalescence times (lags) from t_min to t_max seconds, e.g. around a known
+ * event or a previous estimate. The returned index is still a time sample of the data, and a saved series only
+ * has the values in the window. Times wrap around the end of the data like the lags do.
+ */
+void CN_workspace_set_tc_window( coherent_network_workspace_t *workspace, double t_min, double t_max );
+
+/* Goes back to computing every lag. */
+void CN_workspace_clear_tc_window( coherent_network_workspace_t *workspace );
+
+/* Sets how workspace->peak is located. The returned value and index of the statistic don't change. */
+void CN_workspace_set_peak_interpolation( coherent_network_workspace_t *workspace, CN_PEAK_INTERPOLATION interpolation );
+
+/* Makes coherent_network_statistic also list up to num_peaks peaks in workspace->peaks, each at least
+ * min_separation time samples of the data from the others. A larger value replaces the smaller peaks near it,
+ * so a value that was only suppressed by a peak which is replaced later isn't listed. 0 peaks disables it.
+ */
+void CN_workspace_set_num_peaks( coherent_network_workspace_t *workspace, size_t num_peaks, double min_separation );
+
+/* Sets the format in which coherent_network_statistic saves the series, CN_SAVE_TEXT by default. The format
+ * doesn't depend on the filename's extension. */
+void CN_workspace_set_series_format( coherent_network_workspace_t *workspace, CN_SAVE_FORMAT format );
+
+/* Closes the HDF5 file of the saved series, if it is open, e.g. before the file is read. CN_workspace_free
+ * closes it too. */
+void CN_workspace_close_series( coherent_network_workspace_t *workspace );
+
+/* Number of templates that coherent_network_statistic_batch processes together by default. */
+#define CN_BATCH_DEFAULT_CAPACITY 8
+
+/* Workspace for evaluating the statistic for many templates at once. The per-call workspace provides the
+ * lookup, normalization factors, whitened data and antenna pattern scratch shared by all of the templates.
+ */
+typedef struct coherent_network_batch_workspace_s {
+	size_t capacity;
+
+	/* number of bins in the analysis band */
+	size_t band_len;
+
+	coherent_network_workspace_t *workspace;
+
+	stationary_phase_batch_workspace_t *sp_batch;
+
+	/* One template per batch entry, filled in for one detector at a time. */
+	stationary_phase_t **sp;
+	double *coalesce_phases;
+
+	/* The antenna patterns and time delays of the templates, num_detectors x capacity. For a batch of count
+	 * templates, detector i's values are at [i*count, (i+1)*count). */
+	double *antenna_u;
+	double *antenna_v;
+	double *time_delays;
+
+	/* Detector weights, capacity x num_detectors. */
+	double *w_plus_input;
+	double *w_minus_input;
+
+	/* The two one-sided weighted sums of each template (num_half_freq long), entry b at 2*b*num_half_freq (plus)
+	 * and (2*b+1)*num_half_freq (minus). NULL in the compact layout, where the band of each sum is in fs. */
+	gsl_complex *terms;
+
+	/* The 2 * capacity analytic series, each 2 * workspace->ifft_len doubles, one after another so that they
+	 * can be inverse transformed together. */
+	double *fs;
+
+	/* The bytes allocated by the batch, without its workspace, and for the default layout's sums */
+	size_t bytes;
+	size_t layout_bytes;
+
+} coherent_network_batch_workspace_t;
+
+coherent_network_batch_workspace_t* CN_batch_workspace_alloc(size_t capacity, size_t num_time_samples, detector_network_t *net,
+		size_t num_half_freq, double f_low, double f_high);
+
+coherent_network_batch_workspace_t* CN_batch_workspace_alloc_shared(size_t capacity, size_t num_time_samples,
+		detector_network_t *net, size_t num_half_freq, coherent_network_shared_t *shared);
+
+void CN_batch_workspace_free( coherent_network_batch_workspace_t *batch );
+
+/* Changes the layout of the batch's sums and of its workspace. */
+void CN_batch_workspace_set_layout( coherent_network_batch_workspace_t *batch, CN_LAYOUT layout );
+
+size_t CN_batch_workspace_footprint( const coherent_network_batch_workspace_t *batch );
+
+void CN_do_work(size_t f_low_index, size_t f_high_index, gsl_complex *spa, asd_t *asd, gsl_complex *half_fft_data, gsl_complex *out_temp);
+
+void CN_do_work_whitened(size_t band_len, gsl_complex *spa_band, gsl_complex *whitened_data_band, gsl_complex *out_temp_band);
+
+/* Computes the whitened data of the workspace's shared tables. It must not be called while other threads are
+ * evaluating the statistic with the same shared tables. */
+void CN_whiten_data(detector_network_t *net, network_strain_half_fft_t *network_strain, coherent_network_workspace_t *workspace);
+
+/* The filename extension for a format, "" for text. */
+const char* CN_save_format_extension(CN_SAVE_FORMAT format);
 
 void CN_save(char* filename, size_t len, double* tmp_ifft);
 
+void CN_save_with_format(const char *filename, CN_SAVE_FORMAT format, size_t len, const double *series);
+
 void coherent_network_statistic(
 		detector_network_t* net,
 		double f_low,
@@ -86,6 +509,20 @@ void coherent_network_statistic(
 		int *out_network_css_index,
 		char *out_network_css_filename);
 
+/* Computes the statistic for num_templates (chirp, sky) pairs. Gives the same results as calling
+ * coherent_network_statistic for each pair, but the templates, matched filters and inverse FFTs are done
+ * a batch at a time.
+ */
+void coherent_network_statistic_batch(
+		detector_network_t* net,
+		size_t num_templates,
+		inspiral_chirp_time_t *chirps,
+		sky_t *skies,
+		network_strain_half_fft_t *network_strain,
+		coherent_network_batch_workspace_t *batch,
+		double *out_network_css_values,
+		int *out_network_css_indices);
+
 #if defined (__cplusplus)
 }
 #endif
@@ -3,11 +3,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <gsl/gsl_cblas.h>
 #include <gsl/gsl_complex.h>
 #include <gsl/gsl_complex_math.h>
 #include <gsl/gsl_math.h>
 
 #include "inspiral_stationary_phase.h"
+#include "vector_math.h"
+#include "vector_math_simd.h"
 
 
 int find_index_low(double f_low, size_t len, double *f_array) {
@@ -54,6 +57,14 @@ void SP_workspace_init(size_t len_f_array, double *f_array, stationary_phase_wor
 		lookup->chirp_time_1_coeff[j] =  2.0 * M_PI * lookup->f_low * pow(f_fac, -5.0 / 3.0);
 		lookup->chirp_time1_5_coeff[j] = -2.0 * M_PI * lookup->f_low * 3.0 * pow(f_fac,-2.0 / 3.0) / 2.0;
 		lookup->chirp_time2_coeff[j] = 2.0 * M_PI * lookup->f_low * 3.0 * pow(f_fac, -1.0 / 3.0);
+
+		lookup->phase_coeff_matrix[j*SP_NUM_PHASE_TERMS + 0] = lookup->chirp_tc_coeff[j];
+		lookup->phase_coeff_matrix[j*SP_NUM_PHASE_TERMS + 1] = lookup->constant_coeff[j];
+		lookup->phase_coeff_matrix[j*SP_NUM_PHASE_TERMS + 2] = lookup->chirp_time_0_coeff[j];
+		lookup->phase_coeff_matrix[j*SP_NUM_PHASE_TERMS + 3] = lookup->chirp_time_1_coeff[j];
+		lookup->phase_coeff_matrix[j*SP_NUM_PHASE_TERMS + 4] = lookup->chirp_time1_5_coeff[j];
+		lookup->phase_coeff_matrix[j*SP_NUM_PHASE_TERMS + 5] = lookup->chirp_time2_coeff[j];
+		lookup->phase_coeff_matrix[j*SP_NUM_PHASE_TERMS + 6] = 1.0;
 	}
 }
 
@@ -68,6 +79,8 @@ stationary_phase_workspace_t* SP_workspace_alloc(double f_low, double f_high, si
 		exit(-1);
 	}
 
+	lookup->bytes = sizeof(stationary_phase_workspace_t);
+
 	lookup->f_low = f_low;
 	lookup->f_high = f_high;
 
@@ -106,42 +119,56 @@ stationary_phase_workspace_t* SP_workspace_alloc(double f_low, double f_high, si
 		fprintf(stderr, "Error. Unable to allocate memory in SP_workspace_alloc(). Exiting.\n");
 		exit(-1);
 	}
+	lookup->bytes += lookup->len * sizeof(double);
 
 	lookup->chirp_tc_coeff = (double*) malloc (lookup->len * sizeof(double));
 	if (lookup->chirp_tc_coeff == NULL) {
 		fprintf(stderr, "Error. Unable to allocate memory in SP_workspace_alloc(). Exiting.\n");
 		exit(-1);
 	}
+	lookup->bytes += lookup->len * sizeof(double);
 
 	lookup->constant_coeff = (double*) malloc (lookup->len * sizeof(double));
 	if (lookup->constant_coeff == NULL) {
 		fprintf(stderr, "Error. Unable to allocate memory in SP_workspace_alloc(). Exiting.\n");
 		exit(-1);
 	}
+	lookup->bytes += lookup->len * sizeof(double);
 
 	lookup->chirp_time_0_coeff = (double*) malloc (lookup->len * sizeof(double));
 	if (lookup->chirp_time_0_coeff == NULL) {
 		fprintf(stderr, "Error. Unable to allocate memory in SP_workspace_alloc(). Exiting.\n");
 		exit(-1);
 	}
+	lookup->bytes += lookup->len * sizeof(double);
 
 	lookup->chirp_time_1_coeff = (double*) malloc (lookup->len * sizeof(double));
 	if (lookup->chirp_time_1_coeff == NULL) {
 		fprintf(stderr, "Error. Unable to allocate memory in SP_workspace_alloc(). Exiting.\n");
 		exit(-1);
 	}
+	lookup->bytes += lookup->len * sizeof(double);
 
 	lookup->chirp_time1_5_coeff = (double*) malloc (lookup->len * sizeof(double));
 	if (lookup->chirp_time1_5_coeff == NULL) {
 		fprintf(stderr, "Error. Unable to allocate memory in SP_workspace_alloc(). Exiting.\n");
 		exit(-1);
 	}
+	lookup->bytes += lookup->len * sizeof(double);
 
 	lookup->chirp_time2_coeff = (double*) malloc (lookup->len * sizeof(double));
 	if (lookup->chirp_time2_coeff == NULL) {
 		fprintf(stderr, "Error. Unable to allocate memory in SP_workspace_alloc(). Exiting.\n");
 		exit(-1);
 	}
+	lookup->bytes += lookup->len * sizeof(double);
+
+	lookup->phase_coeff_matrix = (double*) malloc (SP_NUM_PHASE_TERMS * lookup->len * sizeof(double));
+	if (lookup->phase_coeff_matrix == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory in SP_workspace_alloc(). Exiting.\n");
+		exit(-1);
+	}
+	lookup->bytes += SP_NUM_PHASE_TERMS * lookup->len * sizeof(double);
 
 	/* Lookup is now set up and can be initialized with the coefficients. */
 	SP_workspace_init(len_f_array, f_array, lookup);
@@ -180,9 +207,18 @@ void SP_workspace_free( stationary_phase_workspace_t *lookup) {
 	free(lookup->chirp_time2_coeff);
 	lookup->chirp_time2_coeff = NULL;
 
+	assert(lookup->phase_coeff_matrix != NULL);
+	free(lookup->phase_coeff_matrix);
+	lookup->phase_coeff_matrix = NULL;
+
 	free(lookup);
 }
 
+size_t SP_workspace_footprint( const stationary_phase_workspace_t *lookup ) {
+	assert(lookup != NULL);
+
+	return lookup->bytes;
+}
 
 stationary_phase_t* SP_alloc(size_t num_half_frequencies) {
 	size_t i;
@@ -201,16 +237,10 @@ stationary_phase_t* SP_alloc(size_t num_half_frequencies) {
 		fprintf(stderr, "Error. Unable to allocate memory in SP_malloc. Exiting.\n");
 		exit(-1);
 	}
-
-	sp->spa_90 = (gsl_complex*) malloc(sp->len * sizeof(gsl_complex));
-	if (sp->spa_90 == NULL) {
-		fprintf(stderr, "Error. Unable to allocate memory in SP_malloc. Exiting.\n");
-		exit(-1);
-	}
+	sp->bytes = sizeof(stationary_phase_t) + sp->len * sizeof(gsl_complex);
 
 	for (i = 0; i < sp->len; i++) {
 		sp->spa_0[i] = gsl_complex_rect(0.0, 0.0);
-		sp->spa_90[i] = gsl_complex_rect(0.0, 0.0);
 	}
 
 	return sp;
@@ -223,13 +253,15 @@ void SP_free(stationary_phase_t* sp) {
 	free(sp->spa_0);
 	sp->spa_0 = NULL;
 
-	assert(sp->spa_90);
-	free(sp->spa_90);
-	sp->spa_90 = NULL;
-
 	free(sp);
 }
 
+size_t SP_footprint( const stationary_phase_t *sp ) {
+	assert(sp != NULL);
+
+	return sp->bytes;
+}
+
 void SP_save(char* filename, asd_t* asd, stationary_phase_t* sp) {
 	assert(filename != NULL);
 	assert(asd != NULL);
@@ -244,8 +276,9 @@ void SP_save(char* filename, asd_t* asd, stationary_phase_t* sp) {
 		exit(-1);
 	}
 
+	/* The last column is the real part of the 90 degree template, spa_90 = -i * spa_0. */
 	for (i = 0; i < sp->len; i++) {
-		fprintf(file, "%e %e %e\n", asd->asd[i], GSL_REAL(sp->spa_0[i]), GSL_REAL(sp->spa_90[i]));
+		fprintf(file, "%e %e %e\n", asd->asd[i], GSL_REAL(sp->spa_0[i]), GSL_IMAG(sp->spa_0[i]));
 	}
 
 	fclose(file);
@@ -280,6 +313,144 @@ double SP_normalization_factor(asd_t* asd, stationary_phase_workspace_t *lookup)
 	return sqrt(sum);
 }
 
+/* Computes a single frequency bin of the template. j is the index into the lookup arrays. */
+static void SP_compute_bin(size_t j,
+		double detector_time_delay, double detector_normalization_factor,
+		double inspiral_coalesce_phase, inspiral_chirp_time_t *chirp,
+		stationary_phase_workspace_t *lookup,
+		stationary_phase_t *out_sp)
+{
+	double amp_2pn = (1.0 / detector_normalization_factor) * lookup->g_coeff[j];
+
+	// This can be done as a matrix calculation
+	double phase_2pn =
+			lookup->chirp_tc_coeff[j] * (chirp->tc - detector_time_delay)
+			- 2.0 * inspiral_coalesce_phase
+			+ lookup->constant_coeff[j]
+			+ lookup->chirp_time_0_coeff[j] * chirp->chirp_time0
+			+ lookup->chirp_time_1_coeff[j] * chirp->chirp_time1
+			+ lookup->chirp_time1_5_coeff[j] * chirp->chirp_time1_5
+			+ lookup->chirp_time2_coeff[j] * chirp->chirp_time2;
+
+	gsl_complex exp_phase = gsl_complex_exp(gsl_complex_rect(0.0, -1.0*phase_2pn));
+	out_sp->spa_0[lookup->f_low_index + j] = gsl_complex_mul_real(exp_phase, amp_2pn);
+}
+
+#if VM_HAVE_X86_SIMD
+/* The SIMD versions evaluate the phase with the same operations in the same order as SP_compute_bin,
+ * so only the sine and cosine differ from the scalar version (by an ulp or so). */
+static VM_TARGET_AVX2 void SP_compute_avx2(
+		double detector_time_delay, double detector_normalization_factor,
+		double inspiral_coalesce_phase, inspiral_chirp_time_t *chirp,
+		stationary_phase_workspace_t *lookup,
+		stationary_phase_t *out_sp)
+{
+	size_t j;
+	double *out = (double*) (out_sp->spa_0 + lookup->f_low_index);
+
+	__m256d inv_norm = _mm256_set1_pd(1.0 / detector_normalization_factor);
+	__m256d tc = _mm256_set1_pd(chirp->tc - detector_time_delay);
+	__m256d two_phase = _mm256_set1_pd(2.0 * inspiral_coalesce_phase);
+	__m256d t0 = _mm256_set1_pd(chirp->chirp_time0);
+	__m256d t1 = _mm256_set1_pd(chirp->chirp_time1);
+	__m256d t1_5 = _mm256_set1_pd(chirp->chirp_time1_5);
+	__m256d t2 = _mm256_set1_pd(chirp->chirp_time2);
+	__m256d sign = _mm256_set1_pd(-0.0);
+
+	for (j = 0; j + 4 <= lookup->len; j += 4) {
+		__m256d phase, amp, s, c, re, im, lo, hi;
+
+		phase = _mm256_mul_pd(_mm256_loadu_pd(lookup->chirp_tc_coeff + j), tc);
+		phase = _mm256_sub_pd(phase, two_phase);
+		phase = _mm256_add_pd(phase, _mm256_loadu_pd(lookup->constant_coeff + j));
+		phase = _mm256_add_pd(phase, _mm256_mul_pd(_mm256_loadu_pd(lookup->chirp_time_0_coeff + j), t0));
+		phase = _mm256_add_pd(phase, _mm256_mul_pd(_mm256_loadu_pd(lookup->chirp_time_1_coeff + j), t1));
+		phase = _mm256_add_pd(phase, _mm256_mul_pd(_mm256_loadu_pd(lookup->chirp_time1_5_coeff + j), t1_5));
+		phase = _mm256_add_pd(phase, _mm256_mul_pd(_mm256_loadu_pd(lookup->chirp_time2_coeff + j), t2));
+
+		if (!VM_sincos_in_range_avx2(phase)) {
+			size_t m;
+			for (m = j; m < j + 4; m++) {
+				SP_compute_bin(m, detector_time_delay, detector_normalization_factor, inspiral_coalesce_phase, chirp, lookup, out_sp);
+			}
+			continue;
+		}
+
+		VM_sincos_avx2(phase, &s, &c);
+		amp = _mm256_mul_pd(inv_norm, _mm256_loadu_pd(lookup->g_coeff + j));
+
+		/* amp * exp(-i phase) */
+		re = _mm256_mul_pd(c, amp);
+		im = _mm256_mul_pd(_mm256_xor_pd(s, sign), amp);
+
+		/* interleave into complex pairs */
+		lo = _mm256_unpacklo_pd(re, im);
+		hi = _mm256_unpackhi_pd(re, im);
+		_mm256_storeu_pd(out + 2*j, _mm256_permute2f128_pd(lo, hi, 0x20));
+		_mm256_storeu_pd(out + 2*j + 4, _mm256_permute2f128_pd(lo, hi, 0x31));
+	}
+
+	for (; j < lookup->len; j++) {
+		SP_compute_bin(j, detector_time_delay, detector_normalization_factor, inspiral_coalesce_phase, chirp, lookup, out_sp);
+	}
+}
+
+static VM_TARGET_AVX512 void SP_compute_avx512(
+		double detector_time_delay, double detector_normalization_factor,
+		double inspiral_coalesce_phase, inspiral_chirp_time_t *chirp,
+		stationary_phase_workspace_t *lookup,
+		stationary_phase_t *out_sp)
+{
+	size_t j;
+	double *out = (double*) (out_sp->spa_0 + lookup->f_low_index);
+
+	__m512d inv_norm = _mm512_set1_pd(1.0 / detector_normalization_factor);
+	__m512d tc = _mm512_set1_pd(chirp->tc - detector_time_delay);
+	__m512d two_phase = _mm512_set1_pd(2.0 * inspiral_coalesce_phase);
+	__m512d t0 = _mm512_set1_pd(chirp->chirp_time0);
+	__m512d t1 = _mm512_set1_pd(chirp->chirp_time1);
+	__m512d t1_5 = _mm512_set1_pd(chirp->chirp_time1_5);
+	__m512d t2 = _mm512_set1_pd(chirp->chirp_time2);
+	__m512i first_half = _mm512_set_epi64(11, 3, 10, 2, 9, 1, 8, 0);
+	__m512i second_half = _mm512_set_epi64(15, 7, 14, 6, 13, 5, 12, 4);
+
+	for (j = 0; j + 8 <= lookup->len; j += 8) {
+		__m512d phase, amp, s, c, re, im;
+
+		phase = _mm512_mul_pd(_mm512_loadu_pd(lookup->chirp_tc_coeff + j), tc);
+		phase = _mm512_sub_pd(phase, two_phase);
+		phase = _mm512_add_pd(phase, _mm512_loadu_pd(lookup->constant_coeff + j));
+		phase = _mm512_add_pd(phase, _mm512_mul_pd(_mm512_loadu_pd(lookup->chirp_time_0_coeff + j), t0));
+		phase = _mm512_add_pd(phase, _mm512_mul_pd(_mm512_loadu_pd(lookup->chirp_time_1_coeff + j), t1));
+		phase = _mm512_add_pd(phase, _mm512_mul_pd(_mm512_loadu_pd(lookup->chirp_time1_5_coeff + j), t1_5));
+		phase = _mm512_add_pd(phase, _mm512_mul_pd(_mm512_loadu_pd(lookup->chirp_time2_coeff + j), t2));
+
+		if (!VM_sincos_in_range_avx512(phase)) {
+			size_t m;
+			for (m = j; m < j + 8; m++) {
+				SP_compute_bin(m, detector_time_delay, detector_normalization_factor, inspiral_coalesce_phase, chirp, lookup, out_sp);
+			}
+			continue;
+		}
+
+		VM_sincos_avx512(phase, &s, &c);
+		amp = _mm512_mul_pd(inv_norm, _mm512_loadu_pd(lookup->g_coeff + j));
+
+		/* amp * exp(-i phase) */
+		re = _mm512_mul_pd(c, amp);
+		im = _mm512_mul_pd(_mm512_sub_pd(_mm512_setzero_pd(), s), amp);
+
+		/* interleave into complex pairs */
+		_mm512_storeu_pd(out + 2*j, _mm512_permutex2var_pd(re, first_half, im));
+		_mm512_storeu_pd(out + 2*j + 8, _mm512_permutex2var_pd(re, second_half, im));
+	}
+
+	for (; j < lookup->len; j++) {
+		SP_compute_bin(j, detector_time_delay, detector_normalization_factor, inspiral_coalesce_phase, chirp, lookup, out_sp);
+	}
+}
+#endif
+
 void SP_compute(
 		double detector_time_delay, double detector_normalization_factor,
 		double inspiral_coalesce_phase, inspiral_chirp_time_t *chirp,
@@ -292,21 +463,124 @@ void SP_compute(
 
 	size_t i;
 
-	for (i = 0; i < lookup->len; i++) {
-		double amp_2pn = (1.0 / detector_normalization_factor) * lookup->g_coeff[i];
-
-		// This can be done as a matrix calculation
-		double phase_2pn =
-				lookup->chirp_tc_coeff[i] * (chirp->tc - detector_time_delay)
-				- 2.0 * inspiral_coalesce_phase
-				+ lookup->constant_coeff[i]
-				+ lookup->chirp_time_0_coeff[i] * chirp->chirp_time0
-				+ lookup->chirp_time_1_coeff[i] * chirp->chirp_time1
-				+ lookup->chirp_time1_5_coeff[i] * chirp->chirp_time1_5
-				+ lookup->chirp_time2_coeff[i] * chirp->chirp_time2;
-
-		gsl_complex exp_phase = gsl_complex_exp(gsl_complex_rect(0.0, -1.0*phase_2pn));
-		out_sp->spa_0[lookup->f_low_index + i] = gsl_complex_mul_real(exp_phase, amp_2pn);
-		out_sp->spa_90[lookup->f_low_index + i] = gsl_complex_mul_imag(out_sp->spa_0[lookup->f_low_index + i], -1.0);
+	switch (VM_simd_level()) {
+#if VM_HAVE_X86_SIMD
+	case VM_SIMD_AVX512:
+		SP_compute_avx512(detector_time_delay, detector_normalization_factor, inspiral_coalesce_phase, chirp, lookup, out_sp);
+		break;
+	case VM_SIMD_AVX2:
+		SP_compute_avx2(detector_time_delay, detector_normalization_factor, inspiral_coalesce_phase, chirp, lookup, out_sp);
+		break;
+#endif
+	default:
+		for (i = 0; i < lookup->len; i++) {
+			SP_compute_bin(i, detector_time_delay, detector_normalization_factor, inspiral_coalesce_phase, chirp, lookup, out_sp);
+		}
+		break;
+	}
+}
+
+stationary_phase_batch_workspace_t* SP_batch_workspace_alloc(size_t capacity, stationary_phase_workspace_t *lookup) {
+	assert(lookup != NULL);
+	assert(capacity > 0);
+
+	stationary_phase_batch_workspace_t *batch = (stationary_phase_batch_workspace_t*) malloc( sizeof(stationary_phase_batch_workspace_t) );
+	if (batch == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory in SP_batch_workspace_alloc(). Exiting.\n");
+		exit(-1);
+	}
+
+	batch->capacity = capacity;
+	batch->len = lookup->len;
+	batch->tile_len = GSL_MIN(lookup->len, SP_BATCH_TILE_LEN);
+
+	batch->template_terms = (double*) malloc( capacity * SP_NUM_PHASE_TERMS * sizeof(double) );
+	if (batch->template_terms == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory in SP_batch_workspace_alloc(). Exiting.\n");
+		exit(-1);
+	}
+	batch->bytes = sizeof(stationary_phase_batch_workspace_t) + capacity * SP_NUM_PHASE_TERMS * sizeof(double);
+
+	batch->phases = (double*) malloc( capacity * batch->tile_len * sizeof(double) );
+	if (batch->phases == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory in SP_batch_workspace_alloc(). Exiting.\n");
+		exit(-1);
+	}
+	batch->bytes += capacity * batch->tile_len * sizeof(double);
+
+	return batch;
+}
+
+size_t SP_batch_workspace_footprint( const stationary_phase_batch_workspace_t *batch ) {
+	assert(batch != NULL);
+
+	return batch->bytes;
+}
+
+void SP_batch_workspace_free(stationary_phase_batch_workspace_t *batch) {
+	assert(batch != NULL);
+
+	free(batch->template_terms);
+	batch->template_terms = NULL;
+
+	free(batch->phases);
+	batch->phases = NULL;
+
+	free(batch);
+}
+
+void SP_compute_batch(
+		size_t num_templates,
+		double *detector_time_delays, double detector_normalization_factor,
+		double *inspiral_coalesce_phases, inspiral_chirp_time_t *chirps,
+		stationary_phase_workspace_t *lookup,
+		stationary_phase_batch_workspace_t *batch,
+		stationary_phase_t **out_sp)
+{
+	assert(detector_time_delays != NULL);
+	assert(inspiral_coalesce_phases != NULL);
+	assert(chirps != NULL);
+	assert(lookup != NULL);
+	assert(batch != NULL);
+	assert(out_sp != NULL);
+	assert(batch->len == lookup->len);
+
+	size_t start, b, tile;
+
+	for (start = 0; start < num_templates; start += batch->capacity) {
+		size_t count = GSL_MIN(batch->capacity, num_templates - start);
+
+		/* one row of terms per template, in the same order as the columns of the coefficient matrix */
+		for (b = 0; b < count; b++) {
+			inspiral_chirp_time_t *chirp = &chirps[start + b];
+			double *row = batch->template_terms + b*SP_NUM_PHASE_TERMS;
+
+			row[0] = chirp->tc - detector_time_delays[start + b];
+			row[1] = 1.0;
+			row[2] = chirp->chirp_time0;
+			row[3] = chirp->chirp_time1;
+			row[4] = chirp->chirp_time1_5;
+			row[5] = chirp->chirp_time2;
+			row[6] = -2.0 * inspiral_coalesce_phases[start + b];
+		}
+
+		for (tile = 0; tile < lookup->len; tile += batch->tile_len) {
+			size_t tile_len = GSL_MIN(batch->tile_len, lookup->len - tile);
+
+			/* phases (count x tile_len) = template_terms (count x 7) * phase_coeff_matrix[tile]^T (7 x tile_len) */
+			cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans,
+					(int) count, (int) tile_len, SP_NUM_PHASE_TERMS,
+					1.0, batch->template_terms, SP_NUM_PHASE_TERMS,
+					lookup->phase_coeff_matrix + tile*SP_NUM_PHASE_TERMS, SP_NUM_PHASE_TERMS,
+					0.0, batch->phases, (int) tile_len);
+
+			for (b = 0; b < count; b++) {
+				stationary_phase_t *sp = out_sp[start + b];
+				assert(sp != NULL);
+
+				VM_conj_polar(tile_len, 1.0 / detector_normalization_factor, lookup->g_coeff + tile,
+						batch->phases + b*tile_len, (double*) (sp->spa_0 + lookup->f_low_index + tile));
+			}
+		}
 	}
 }
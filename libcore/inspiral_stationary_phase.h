@@ -26,12 +26,49 @@ typedef struct stationary_phase_workspace_s {
 	double *chirp_time1_5_coeff;
 	double *chirp_time2_coeff;
 
+	/* The same coefficients as a (len x SP_NUM_PHASE_TERMS) row-major matrix for SP_compute_batch.
+	 * The columns are: tc, constant, chirp_time0, chirp_time1, chirp_time1_5, chirp_time2, 1.
+	 */
+	double *phase_coeff_matrix;
+
+	/* The bytes allocated, see SP_workspace_footprint */
+	size_t bytes;
+
 } stationary_phase_workspace_t;
 
+/* Number of columns of the phase coefficient matrix. */
+#define SP_NUM_PHASE_TERMS 7
+
+/* Number of frequencies per matrix product in SP_compute_batch. This keeps the phases in the cache
+ * until they are exponentiated. */
+#define SP_BATCH_TILE_LEN 1024
+
+/* Scratch space for computing a batch of templates at once. The phases of up to 'capacity' templates
+ * are computed with one matrix product per tile of frequencies, larger batches are done in chunks. */
+typedef struct stationary_phase_batch_workspace_s {
+	size_t capacity;
+	size_t len;
+	size_t tile_len;
+
+	/* (capacity x SP_NUM_PHASE_TERMS) template terms, one row per template */
+	double *template_terms;
+
+	/* (capacity x tile_len) phases, one row per template */
+	double *phases;
+
+	/* The bytes allocated, see SP_batch_workspace_footprint */
+	size_t bytes;
+
+} stationary_phase_batch_workspace_t;
+
+/* Only the 0 degree template is stored. The 90 degree template is always -i * spa_0 and is
+ * accounted for by the analytic signal in the network statistic. */
 typedef struct stationary_phase_s {
 	size_t 			len;
 	gsl_complex		*spa_0;
-	gsl_complex		*spa_90;
+
+	/* The bytes allocated, see SP_footprint */
+	size_t			bytes;
 
 } stationary_phase_t;
 
@@ -46,6 +83,9 @@ stationary_phase_workspace_t* SP_workspace_alloc(double f_low, double f_high, si
 
 void SP_workspace_free( stationary_phase_workspace_t *lookup);
 
+/* The bytes allocated for the lookup, recorded when it was allocated. */
+size_t SP_workspace_footprint( const stationary_phase_workspace_t *lookup );
+
 /* This is called by SP_workspace_alloc and shouldn't be called otherwise. */
 void SP_workspace_init(size_t len_f_array, double *f_array, stationary_phase_workspace_t *lookup);
 
@@ -56,6 +96,9 @@ stationary_phase_t* SP_alloc(size_t num_half_frequencies);
 
 void SP_free(stationary_phase_t *sp);
 
+/* The bytes allocated for the template. */
+size_t SP_footprint( const stationary_phase_t *sp );
+
 double SP_normalization_factor(asd_t *asd, stationary_phase_workspace_t *lookup);
 
 void SP_compute(
@@ -64,6 +107,24 @@ void SP_compute(
 		stationary_phase_workspace_t *lookup,
 		stationary_phase_t *out_sp);
 
+/* Computes the templates of num_templates chirps. Template b uses detector_time_delays[b],
+ * coalesce_phases[b] and chirps[b], and is written to out_sp[b]. The normalization factor is that of
+ * the detector, so it is common to every template.
+ */
+void SP_compute_batch(
+		size_t num_templates,
+		double *detector_time_delays, double detector_normalization_factor,
+		double *inspiral_coalesce_phases, inspiral_chirp_time_t *chirps,
+		stationary_phase_workspace_t *lookup,
+		stationary_phase_batch_workspace_t *batch,
+		stationary_phase_t **out_sp);
+
+stationary_phase_batch_workspace_t* SP_batch_workspace_alloc(size_t capacity, stationary_phase_workspace_t *lookup);
+
+void SP_batch_workspace_free(stationary_phase_batch_workspace_t *batch);
+
+size_t SP_batch_workspace_footprint( const stationary_phase_batch_workspace_t *batch );
+
 void SP_save(char *filename, asd_t *asd, stationary_phase_t *sp);
 
 #if defined (__cplusplus)
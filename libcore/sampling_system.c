@@ -2,13 +2,13 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <gsl/gsl_complex.h>
 #include <gsl/gsl_complex_math.h>
 #include <gsl/gsl_math.h>
-#include <gsl/gsl_fft_real.h>
-#include <gsl/gsl_fft_halfcomplex.h>
 
+#include "fft.h"
 #include "sampling_system.h"
 
 int SS_has_nyquist_term(size_t N) {
@@ -114,6 +114,154 @@ void SS_make_two_sided_real (size_t M, double *one_sided, size_t N, double *two_
 	}
 }
 
+/* Takes a one_sided complex array and writes the spectrum of the corresponding analytic signal.
+ * The DC and Nyquist terms are copied, the positive frequencies are doubled and the negative frequencies are zero.
+ * The real part of the inverse FFT of the result equals the inverse FFT of the two-sided (Hermitian) spectrum. */
+void SS_make_analytic (size_t M, gsl_complex *one_sided, size_t N, gsl_complex *analytic) {
+	assert(one_sided != NULL);
+	assert(analytic != NULL);
+	assert(M <= N);
+	assert(one_sided != analytic);
+
+	size_t m;
+
+	/* Check that the dimensions make sense */
+	if (GSL_IS_ODD(N) && M != (N+1)/2) {
+		/* error */
+		fprintf(stderr, "Error. SS_make_analytic failed. One-sided length is (%lu) and two-sided length is (%lu). Exiting.\n",
+				M, N);
+		exit(-1);
+	} else if (GSL_IS_EVEN(N) && M != (N/2 + 1)) {
+		/* error */
+		fprintf(stderr, "Error. SS_make_analytic failed. One-sided length is (%lu) and two-sided length is (%lu). Exiting.\n",
+						M, N);
+		exit(-1);
+	}
+
+	/* last positive frequency term that has a mirrored partner */
+	size_t c = M - 1;
+	if (SS_has_nyquist_term(N)) {
+		c--;
+	}
+
+	analytic[0] = one_sided[0];
+
+	for (m = 1; m <= c; m++) {
+		analytic[m] = gsl_complex_mul_real( one_sided[m], 2.0 );
+	}
+
+	/* the Nyquist term is its own mirror, so it isn't doubled. */
+	if (SS_has_nyquist_term(N)) {
+		analytic[M-1] = one_sided[M-1];
+	}
+
+	for (m = M; m < N; m++) {
+		analytic[m] = gsl_complex_rect(0.0, 0.0);
+	}
+}
+
+/* Same as SS_make_analytic, but only the one-sided terms in [index_low, index_high] are read.
+ * All other terms of the analytic spectrum are set to zero. */
+void SS_make_analytic_band (size_t M, gsl_complex *one_sided, size_t index_low, size_t index_high, size_t N, gsl_complex *analytic) {
+	assert(one_sided != NULL);
+	assert(analytic != NULL);
+	assert(M <= N);
+	assert(one_sided != analytic);
+	assert(index_low <= index_high);
+	assert(index_high < M);
+
+	/* Check that the dimensions make sense */
+	if (GSL_IS_ODD(N) && M != (N+1)/2) {
+		/* error */
+		fprintf(stderr, "Error. SS_make_analytic_band failed. One-sided length is (%lu) and two-sided length is (%lu). Exiting.\n",
+				M, N);
+		exit(-1);
+	} else if (GSL_IS_EVEN(N) && M != (N/2 + 1)) {
+		/* error */
+		fprintf(stderr, "Error. SS_make_analytic_band failed. One-sided length is (%lu) and two-sided length is (%lu). Exiting.\n",
+						M, N);
+		exit(-1);
+	}
+
+	SS_make_analytic_shifted( M, one_sided, index_low, index_high, N, 0, N, analytic );
+}
+
+/* Same as SS_make_analytic_band, but one-sided term m is written to analytic[m - offset] of an L long spectrum. */
+void SS_make_analytic_shifted (size_t M, gsl_complex *one_sided, size_t index_low, size_t index_high, size_t N,
+		size_t offset, size_t L, gsl_complex *analytic) {
+	assert(one_sided != NULL);
+	assert(analytic != NULL);
+	assert(one_sided != analytic);
+	assert(offset <= index_low);
+	assert(index_low <= index_high);
+	assert(index_high < M);
+	assert(index_high - offset < L);
+
+	size_t m;
+
+	memset( analytic, 0, (index_low - offset) * sizeof(gsl_complex) );
+
+	for (m = index_low; m <= index_high; m++) {
+		analytic[m - offset] = gsl_complex_mul_real( one_sided[m], 2.0 );
+	}
+
+	/* the DC and Nyquist terms are their own mirror, so they aren't doubled. */
+	if (index_low == 0) {
+		analytic[0] = one_sided[0];
+	}
+	if (SS_has_nyquist_term(N) && index_high == M - 1) {
+		analytic[M-1 - offset] = one_sided[M-1];
+	}
+
+	memset( analytic + (index_high - offset) + 1, 0, (L - (index_high - offset) - 1) * sizeof(gsl_complex) );
+}
+
+void SS_make_analytic_shifted_float (size_t M, gsl_complex *one_sided, size_t index_low, size_t index_high, size_t N,
+		size_t offset, size_t L, float *analytic) {
+	assert(one_sided != NULL);
+	assert(analytic != NULL);
+	assert(offset <= index_low);
+	assert(index_low <= index_high);
+	assert(index_high < M);
+	assert(index_high - offset < L);
+
+	size_t m;
+
+	memset( analytic, 0, 2 * (index_low - offset) * sizeof(float) );
+
+	for (m = index_low; m <= index_high; m++) {
+		/* the DC and Nyquist terms are their own mirror, so they aren't doubled. */
+		double scale = (m == 0 || (SS_has_nyquist_term(N) && m == M - 1)) ? 1.0 : 2.0;
+		analytic[2*(m - offset)] = (float) (scale * GSL_REAL(one_sided[m]));
+		analytic[2*(m - offset) + 1] = (float) (scale * GSL_IMAG(one_sided[m]));
+	}
+
+	memset( analytic + 2*(index_high - offset + 1), 0, 2 * (L - (index_high - offset) - 1) * sizeof(float) );
+}
+
+void SS_make_analytic_in_place (size_t M, size_t index_low, size_t index_high, size_t N,
+		size_t offset, size_t L, gsl_complex *analytic) {
+	assert(analytic != NULL);
+	assert(offset <= index_low);
+	assert(index_low <= index_high);
+	assert(index_high < M);
+	assert(index_high - offset < L);
+
+	size_t m;
+
+	memset( analytic, 0, (index_low - offset) * sizeof(gsl_complex) );
+
+	for (m = index_low; m <= index_high; m++) {
+		/* the DC and Nyquist terms are their own mirror, so they aren't doubled. */
+		if (m == 0 || (SS_has_nyquist_term(N) && m == M - 1)) {
+			continue;
+		}
+		analytic[m - offset] = gsl_complex_mul_real( analytic[m - offset], 2.0 );
+	}
+
+	memset( analytic + (index_high - offset) + 1, 0, (L - (index_high - offset) - 1) * sizeof(gsl_complex) );
+}
+
 void SS_frequency_array(double samplingFrequency, size_t num_total_samples, size_t num_desired_freq_samples, double *frequencies)
 {
 	assert(frequencies != NULL);
@@ -136,12 +284,73 @@ void SS_time_array(double samplingFrequency, size_t num_desired_time_samples, do
 	}
 }
 
+int SS_is_fft_friendly(size_t N) {
+	/* keeps the Nyquist bin, see the header */
+	if (N == 0 || GSL_IS_ODD(N)) {
+		return 0;
+	}
+
+	while (N % 2 == 0) N /= 2;
+	while (N % 3 == 0) N /= 3;
+	while (N % 5 == 0) N /= 5;
+
+	return N == 1;
+}
+
+size_t SS_fft_friendly_length(size_t N, SS_FFT_LENGTH_POLICY policy) {
+	assert(N >= 2);
+
+	size_t M = N;
+
+	switch (policy) {
+	case SS_FFT_LENGTH_PAD:
+		while (!SS_is_fft_friendly(M)) {
+			M++;
+		}
+		break;
+	case SS_FFT_LENGTH_CROP:
+		while (!SS_is_fft_friendly(M)) {
+			M--;
+		}
+		break;
+	default:
+		break;
+	}
+
+	return M;
+}
+
+SS_FFT_LENGTH_POLICY SS_fft_length_policy_from_string(const char *name) {
+	if (name == NULL || strcmp(name, "keep") == 0) {
+		return SS_FFT_LENGTH_KEEP;
+	}
+	if (strcmp(name, "pad") == 0) {
+		return SS_FFT_LENGTH_PAD;
+	}
+	if (strcmp(name, "crop") == 0) {
+		return SS_FFT_LENGTH_CROP;
+	}
+
+	fprintf(stderr, "Error. Unknown FFT length policy (%s). Use keep, pad or crop. Exiting.\n", name);
+	exit(-1);
+}
+
+const char* SS_fft_length_policy_name(SS_FFT_LENGTH_POLICY policy) {
+	switch (policy) {
+	case SS_FFT_LENGTH_KEEP: return "keep";
+	case SS_FFT_LENGTH_PAD: return "pad";
+	case SS_FFT_LENGTH_CROP: return "crop";
+	}
+	return "unknown";
+}
+
 /* This function colours a time series by multiplying by the ASD in the frequency domain */
-void SS_colour_timeseries( psd_t *psd_one_sided, size_t num_time_samples, double *timeseries) {
+void SS_colour_timeseries( psd_t *psd_one_sided, size_t num_time_samples, double *timeseries, fft_workspace_t *fft_workspace) {
 	assert(psd_one_sided != NULL);
 	assert(timeseries != NULL);
+	assert(fft_workspace != NULL);
 
-	size_t k, l;
+	size_t l;
 
 	if (psd_one_sided->type != PSD_ONE_SIDED) {
 		fprintf(stderr, "SS_colour_timeseries: Error. Algorithm only works with one_sided PSD. Exiting.\n");
@@ -156,45 +365,45 @@ void SS_colour_timeseries( psd_t *psd_one_sided, size_t num_time_samples, double
 	asd_t * asd_one_sided = ASD_alloc( psd_one_sided->len );
 	ASD_init_from_psd( psd_one_sided, asd_one_sided );
 
-	gsl_fft_real_wavetable *fft_real_wavetable = gsl_fft_real_wavetable_alloc( num_time_samples );
-	gsl_fft_halfcomplex_wavetable *fft_complex_wavetable = gsl_fft_halfcomplex_wavetable_alloc( num_time_samples );
-	gsl_fft_real_workspace *fft_workspace = gsl_fft_real_workspace_alloc( num_time_samples );
+	size_t num_half = SS_half_size(num_time_samples);
+	gsl_complex *half_fft = (gsl_complex*) malloc( num_half * sizeof(gsl_complex) );
+	if (half_fft == NULL) {
+		fprintf(stderr, "SS_colour_timeseries: Error. Unable to allocate memory. Exiting.\n");
+		exit(-1);
+	}
 
-	gsl_fft_real_transform(timeseries, 1, num_time_samples, fft_real_wavetable, fft_workspace);
+	FFT_real_forward( num_time_samples, timeseries, half_fft, fft_workspace );
 
 	// DC term doesn't have an imaginary component
-	timeseries[0] *= asd_one_sided->asd[0];
+	half_fft[0] = gsl_complex_mul_real( half_fft[0], asd_one_sided->asd[0] );
 
 	size_t lu = SS_last_unique_index( num_time_samples );
 	if (SS_has_nyquist_term(num_time_samples)) {
 		lu--;
 	}
 
-	/* The GSL fft arranges the data as REAL, IMAG pairs except for the DC and Nyquist Terms. */
-	for (k = 1, l = 1; l <= lu; k+=2, l++) {
-		double s = asd_one_sided->asd[l] / sqrt(2.0);
-		timeseries[k+0] *= s;
-		timeseries[k+1] *= s;
+	for (l = 1; l <= lu; l++) {
+		half_fft[l] = gsl_complex_mul_real( half_fft[l], asd_one_sided->asd[l] / sqrt(2.0) );
 	}
 
 	// If nyquist term is present, it doesn't have an imaginary component
 	if (SS_has_nyquist_term(num_time_samples)) {
-		timeseries[num_time_samples-1] *= asd_one_sided->asd[asd_one_sided->len-1];
+		half_fft[num_half-1] = gsl_complex_mul_real( half_fft[num_half-1], asd_one_sided->asd[asd_one_sided->len-1] );
 	}
 
-	gsl_fft_halfcomplex_inverse( timeseries, 1, num_time_samples, fft_complex_wavetable, fft_workspace );
+	FFT_real_inverse( num_time_samples, half_fft, timeseries, fft_workspace );
 
-	gsl_fft_real_workspace_free( fft_workspace );
-	gsl_fft_halfcomplex_wavetable_free( fft_complex_wavetable );
-	gsl_fft_real_wavetable_free( fft_real_wavetable );
+	free( half_fft );
+	ASD_free( asd_one_sided );
 }
 
 /* This function whitens a time series by dividing by the ASD in the frequency domain */
-void SS_whiten_timeseries( psd_t *psd_one_sided, size_t num_time_samples, double *timeseries) {
+void SS_whiten_timeseries( psd_t *psd_one_sided, size_t num_time_samples, double *timeseries, fft_workspace_t *fft_workspace) {
 	assert(psd_one_sided != NULL);
 	assert(timeseries != NULL);
+	assert(fft_workspace != NULL);
 
-	size_t k, l;
+	size_t l;
 
 	if (psd_one_sided->type != PSD_ONE_SIDED) {
 		fprintf(stderr, "SS_whiten_timeseries: Error. Algorithm only works with one_sided PSD. Exiting.\n");
@@ -209,35 +418,34 @@ void SS_whiten_timeseries( psd_t *psd_one_sided, size_t num_time_samples, double
 	asd_t * asd_one_sided = ASD_alloc( psd_one_sided->len );
 	ASD_init_from_psd( psd_one_sided, asd_one_sided );
 
-	gsl_fft_real_wavetable *fft_real_wavetable = gsl_fft_real_wavetable_alloc( num_time_samples );
-	gsl_fft_halfcomplex_wavetable *fft_complex_wavetable = gsl_fft_halfcomplex_wavetable_alloc( num_time_samples );
-	gsl_fft_real_workspace *fft_workspace = gsl_fft_real_workspace_alloc( num_time_samples );
+	size_t num_half = SS_half_size(num_time_samples);
+	gsl_complex *half_fft = (gsl_complex*) malloc( num_half * sizeof(gsl_complex) );
+	if (half_fft == NULL) {
+		fprintf(stderr, "SS_whiten_timeseries: Error. Unable to allocate memory. Exiting.\n");
+		exit(-1);
+	}
 
-	gsl_fft_real_transform(timeseries, 1, num_time_samples, fft_real_wavetable, fft_workspace);
+	FFT_real_forward( num_time_samples, timeseries, half_fft, fft_workspace );
 
 	// DC term doesn't have an imaginary component
-	timeseries[0] /= asd_one_sided->asd[0];
+	half_fft[0] = gsl_complex_div_real( half_fft[0], asd_one_sided->asd[0] );
 
 	size_t lu = SS_last_unique_index( num_time_samples );
 	if (SS_has_nyquist_term(num_time_samples)) {
 		lu--;
 	}
 
-	/* The GSL fft arranges the data as REAL, IMAG pairs except for the DC and Nyquist Terms. */
-	for (k = 1, l = 1; l <= lu; k+=2, l++) {
-		double s = asd_one_sided->asd[l] / sqrt(2.0);
-		timeseries[k+0] /= s;
-		timeseries[k+1] /= s;
+	for (l = 1; l <= lu; l++) {
+		half_fft[l] = gsl_complex_div_real( half_fft[l], asd_one_sided->asd[l] / sqrt(2.0) );
 	}
 
 	// If nyquist term is present, it doesn't have an imaginary component
 	if (SS_has_nyquist_term(num_time_samples)) {
-		timeseries[num_time_samples-1] /= asd_one_sided->asd[asd_one_sided->len-1];
+		half_fft[num_half-1] = gsl_complex_div_real( half_fft[num_half-1], asd_one_sided->asd[asd_one_sided->len-1] );
 	}
 
-	gsl_fft_halfcomplex_inverse( timeseries, 1, num_time_samples, fft_complex_wavetable, fft_workspace );
+	FFT_real_inverse( num_time_samples, half_fft, timeseries, fft_workspace );
 
-	gsl_fft_real_workspace_free( fft_workspace );
-	gsl_fft_halfcomplex_wavetable_free( fft_complex_wavetable );
-	gsl_fft_real_wavetable_free( fft_real_wavetable );
+	free( half_fft );
+	ASD_free( asd_one_sided );
 }
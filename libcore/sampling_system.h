@@ -5,12 +5,21 @@
 
 #include <gsl/gsl_complex.h>
 
+#include "fft.h"
 #include "spectral_density.h"
 
 #if defined (__cplusplus)
 extern "C" {
 #endif
 
+/* How a time series length that is slow to transform is changed. Padding appends zeros to the end
+ * and cropping removes samples from the end, so the time indices of the kept samples are unchanged. */
+typedef enum {
+	SS_FFT_LENGTH_KEEP = 0,
+	SS_FFT_LENGTH_PAD,
+	SS_FFT_LENGTH_CROP
+} SS_FFT_LENGTH_POLICY;
+
 int SS_has_nyquist_term(size_t N);
 
 /* Returns the Nyquist array index for a C indexed-array */
@@ -29,16 +38,56 @@ void SS_make_two_sided (size_t M, gsl_complex *one_sided, size_t N, gsl_complex
 /* Takes a one_sided real array and adds the corresponding mirrored side. */
 void SS_make_two_sided_real (size_t M, double *one_sided, size_t N, double *two_sided);
 
+/* Takes a one_sided complex array and writes the spectrum of the analytic signal: DC and Nyquist
+ * unchanged, positive frequencies doubled, negative frequencies zero. */
+void SS_make_analytic (size_t M, gsl_complex *one_sided, size_t N, gsl_complex *analytic);
+
+/* Same as SS_make_analytic, but only the one-sided terms in [index_low, index_high] are used. The rest are zero. */
+void SS_make_analytic_band (size_t M, gsl_complex *one_sided, size_t index_low, size_t index_high, size_t N, gsl_complex *analytic);
+
+/* Same as SS_make_analytic_band, but the band is written to a spectrum of length L with one-sided term m at
+ * index m - offset. Shifting the band down to offset 0 only changes the phase of the analytic signal, and L can
+ * be as short as the band, which gives the signal at a lower sampling rate. */
+void SS_make_analytic_shifted (size_t M, gsl_complex *one_sided, size_t index_low, size_t index_high, size_t N,
+		size_t offset, size_t L, gsl_complex *analytic);
+
+/* Same as SS_make_analytic_shifted, but the spectrum is written in single precision as L interleaved
+ * (real, imag) float pairs. */
+void SS_make_analytic_shifted_float (size_t M, gsl_complex *one_sided, size_t index_low, size_t index_high, size_t N,
+		size_t offset, size_t L, float *analytic);
+
+/* Same as SS_make_analytic_shifted, but one-sided term m is already at analytic[m - offset], so the band is only
+ * doubled and the rest of the L values are cleared. */
+void SS_make_analytic_in_place (size_t M, size_t index_low, size_t index_high, size_t N,
+		size_t offset, size_t L, gsl_complex *analytic);
+
 /* Write the fft frequencies */
 void SS_frequency_array(double samplingFrequency, size_t num_total_samples, size_t num_desired_freq_samples, double *frequencies);
 
 void SS_time_array(double samplingFrequency, size_t num_desired_time_samples, double *times);
 
-/* This function colours a time series by multiplying by the ASD in the frequency domain */
-void SS_colour_timeseries( psd_t *psd_one_sided, size_t num_time_samples, double *timeseries);
+/* Returns 1 if N is even and has no prime factors other than 2, 3 and 5, which every FFT backend transforms quickly.
+ * Odd lengths are rejected even when they are a product of 3s and 5s: the one-sided spectrum of an odd length has
+ * no Nyquist bin (SS_has_nyquist_term), so padding or cropping to one would change the layout of the half FFTs that
+ * the data and the templates share. The backends' real transforms are also fastest for even lengths, which they
+ * compute as a complex transform of half the length. */
+int SS_is_fft_friendly(size_t N);
+
+/* Returns the nearest FFT friendly length at or above N (SS_FFT_LENGTH_PAD) or at or below N (SS_FFT_LENGTH_CROP).
+ * SS_FFT_LENGTH_KEEP returns N. */
+size_t SS_fft_friendly_length(size_t N, SS_FFT_LENGTH_POLICY policy);
+
+/* Parses "keep", "pad" or "crop". NULL, e.g. a missing setting, is "keep". */
+SS_FFT_LENGTH_POLICY SS_fft_length_policy_from_string(const char *name);
+
+const char* SS_fft_length_policy_name(SS_FFT_LENGTH_POLICY policy);
+
+/* This function colours a time series by multiplying by the ASD in the frequency domain. The workspace is for
+ * transforms of length num_time_samples, so that it can be reused for many series. */
+void SS_colour_timeseries( psd_t *psd_one_sided, size_t num_time_samples, double *timeseries, fft_workspace_t *fft_workspace);
 
 /* This function whitens a time series by dividing by the ASD in the frequency domain */
-void SS_whiten_timeseries( psd_t *psd_one_sided, size_t num_time_samples, double *timeseries);
+void SS_whiten_timeseries( psd_t *psd_one_sided, size_t num_time_samples, double *timeseries, fft_workspace_t *fft_workspace);
 
 #if defined (__cplusplus)
 }
@@ -6,6 +6,7 @@
 #include <string.h>
 
 #include <gsl/gsl_interp.h>
+#include <gsl/gsl_math.h>
 
 #include "hdf5_file.h"
 #include "inspiral_stationary_phase.h" /* needed for find_index */
@@ -224,6 +225,33 @@ psd_t* PSD_nonuniform_to_uniform(psd_t *nonuniform, size_t num_time_samples, dou
 	return psd;
 }
 
+/* The PSD at the frequencies of num_time_samples samples, e.g. after the data was padded or cropped. The values
+ * are interpolated linearly, and the ends are held beyond the frequencies of the PSD. */
+psd_t* PSD_resample(psd_t *psd, size_t num_time_samples, double sampling_frequency) {
+	assert(psd != NULL);
+	assert(psd->len >= 2);
+
+	size_t j;
+	double f_min = psd->f[0];
+	double f_max = psd->f[psd->len - 1];
+
+	psd_t *resampled = PSD_alloc( SS_half_size( num_time_samples ) );
+	resampled->type = psd->type;
+	SS_frequency_array(sampling_frequency, num_time_samples, resampled->len, resampled->f);
+
+	gsl_interp* interp = gsl_interp_alloc(gsl_interp_linear, psd->len);
+	gsl_interp_accel* acc = gsl_interp_accel_alloc();
+	gsl_interp_init(interp, psd->f, psd->psd, psd->len);
+	for (j = 0; j < resampled->len; j++) {
+		double f = GSL_MIN(GSL_MAX(resampled->f[j], f_min), f_max);
+		resampled->psd[j] = gsl_interp_eval(interp, psd->f, psd->psd, f, acc);
+	}
+	gsl_interp_accel_free(acc);
+	gsl_interp_free(interp);
+
+	return resampled;
+}
+
 void PSD_flatten_edges(double f_low, double f_high, psd_t *psd) {
 	assert(psd != 0);
 	assert(f_low >= 0.0);
@@ -44,6 +44,8 @@ psd_t* PSD_load( const char *hdf_filename );
 void PSD_save( const char *hdf_filename, psd_t *psd );
 
 psd_t* PSD_nonuniform_to_uniform(psd_t *nonuniform, size_t num_time_samples, double sampling_frequency);
+/* Interpolates a PSD to the frequencies of num_time_samples samples. */
+psd_t* PSD_resample(psd_t *psd, size_t num_time_samples, double sampling_frequency);
 void PSD_flatten_edges(double f_low, double f_high, psd_t *psd);
 psd_t* PSD_make_suitable_for_network_analysis(psd_t *nonuniform, size_t num_time_samples, double sampling_frequency, double f_low, double f_high);
 
@@ -1,10 +1,19 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
 
 #include <gsl/gsl_complex.h>
-#include <gsl/gsl_fft_complex.h>
+#include <gsl/gsl_math.h>
 
+#include "detector_mapping.h"
+#include "detector_network.h"
+#include "fft.h"
+#include "hdf5_file.h"
 #include "sampling_system.h"
 #include "strain.h"
 
@@ -94,10 +103,7 @@ strain_full_fft_t* strain_half_to_full(strain_half_fft_t *one_sided) {
 
 strain_t* strain_full_fft_to_strain( strain_full_fft_t* fft) {
 	size_t j;
-	gsl_fft_complex_wavetable *fft_wavetable;
-	gsl_fft_complex_workspace *fft_workspace;
-	fft_wavetable = gsl_fft_complex_wavetable_alloc( fft->full_len );
-	fft_workspace = gsl_fft_complex_workspace_alloc( fft->full_len );
+	fft_workspace_t *fft_workspace = FFT_workspace_alloc( fft->full_len );
 
 	/* GSL needs an input linear array arranged as (real, complex) pairs in sequence. */
 	double *template_ifft = (double*) malloc( 2 * fft->full_len * sizeof(double) );
@@ -111,7 +117,7 @@ strain_t* strain_full_fft_to_strain( strain_full_fft_t* fft) {
 	}
 
 	/* Compute the ifft */
-	gsl_fft_complex_inverse( template_ifft, 1, fft->full_len, fft_wavetable, fft_workspace );
+	FFT_complex_inverse( fft->full_len, template_ifft, fft_workspace );
 
 	strain_t *strain = strain_alloc(fft->full_len);
 
@@ -121,12 +127,23 @@ strain_t* strain_full_fft_to_strain( strain_full_fft_t* fft) {
 	}
 
 	free(template_ifft);
-	gsl_fft_complex_workspace_free( fft_workspace );
-	gsl_fft_complex_wavetable_free( fft_wavetable );
+	FFT_workspace_free( fft_workspace );
 
 	return strain;
 }
 
+/* The last generation given to a network strain */
+static unsigned long network_strain_generation = 0;
+
+static unsigned long network_strain_next_generation() {
+	unsigned long generation;
+#ifdef HAVE_OPENMP
+	#pragma omp atomic capture
+#endif
+	generation = ++network_strain_generation;
+	return generation;
+}
+
 network_strain_half_fft_t* network_strain_half_fft_alloc(size_t num_strains, size_t num_time_samples) {
 	size_t i;
 
@@ -148,6 +165,8 @@ network_strain_half_fft_t* network_strain_half_fft_alloc(size_t num_strains, siz
 		network_strain->strains[i] = strain_half_fft_alloc( network_strain->num_time_samples );
 	}
 
+	network_strain->generation = network_strain_next_generation();
+
 	return network_strain;
 }
 
@@ -161,3 +180,79 @@ void network_strain_half_fft_free(network_strain_half_fft_t *network_strain) {
 	free(network_strain);
 	network_strain = NULL;
 }
+
+void network_strain_half_fft_modified(network_strain_half_fft_t *network_strain) {
+	assert(network_strain != NULL);
+
+	network_strain->generation = network_strain_next_generation();
+}
+
+network_strain_half_fft_t* network_strain_half_fft_resize(network_strain_half_fft_t *network_strain, size_t num_time_samples,
+		detector_network_t *net, double sampling_frequency, double f_low, double f_high) {
+	assert(network_strain != NULL);
+	assert(net != NULL);
+	assert(net->num_detectors == network_strain->num_strains);
+
+	size_t i;
+	size_t old_num_time_samples = network_strain->num_time_samples;
+	size_t len = GSL_MAX(old_num_time_samples, num_time_samples);
+
+	network_strain_half_fft_t *resized = network_strain_half_fft_alloc( network_strain->num_strains, num_time_samples );
+
+	double *samples = (double*) malloc( len * sizeof(double) );
+	if (samples == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory in network_strain_half_fft_resize. Exiting.\n");
+		exit(-1);
+	}
+
+	fft_workspace_t *old_workspace = FFT_workspace_alloc( old_num_time_samples );
+	fft_workspace_t *new_workspace = FFT_workspace_alloc( num_time_samples );
+
+	for (i = 0; i < network_strain->num_strains; i++) {
+		/* zeros after the old samples pad the series, and a shorter transform crops it */
+		memset( samples, 0, len * sizeof(double) );
+		FFT_real_inverse( old_num_time_samples, network_strain->strains[i]->half_fft, samples, old_workspace );
+		FFT_real_forward( num_time_samples, samples, resized->strains[i]->half_fft, new_workspace );
+	}
+
+	FFT_workspace_free( old_workspace );
+	FFT_workspace_free( new_workspace );
+	free( samples );
+
+	/* The bins are sampling_frequency / num_time_samples apart now, so the whitening needs the PSDs there too */
+	Detector_Network_resample_psds( net, num_time_samples, sampling_frequency, f_low, f_high );
+
+	return resized;
+}
+
+network_strain_half_fft_t* network_strain_half_fft_load_planned(const char *detector_mapping_file,
+		SS_FFT_LENGTH_POLICY policy, double sampling_frequency, double f_low, double f_high,
+		strain_half_fft_load_function_ptr load, detector_network_t **out_net) {
+	assert(detector_mapping_file != NULL);
+	assert(load != NULL);
+	assert(out_net != NULL);
+
+	size_t i;
+
+	detector_network_mapping_t *dmap = Detector_Network_Mapping_load( detector_mapping_file );
+	size_t num_time_samples = hdf5_get_num_time_samples( dmap->data_filenames[0] );
+	size_t planned_num_time_samples;
+	detector_network_t *net = Detector_Network_load_planned( detector_mapping_file, num_time_samples,
+			policy, sampling_frequency, f_low, f_high, &planned_num_time_samples );
+
+	network_strain_half_fft_t *network_strain = network_strain_half_fft_alloc( dmap->num_detectors, num_time_samples );
+	for (i = 0; i < net->num_detectors; i++) {
+		load( dmap->data_filenames[i], network_strain->strains[i] );
+	}
+	Detector_Network_Mapping_close( dmap );
+
+	if (planned_num_time_samples != num_time_samples) {
+		network_strain_half_fft_t *resized = network_strain_half_fft_resize( network_strain, planned_num_time_samples,
+				net, sampling_frequency, f_low, f_high );
+		network_strain_half_fft_free( network_strain );
+		network_strain = resized;
+	}
+
+	*out_net = net;
+	return network_strain;
+}
@@ -5,6 +5,8 @@
 
 #include <gsl/gsl_complex.h>
 
+#include "detector_network.h"
+
 #if defined (__cplusplus)
 extern "C" {
 #endif
@@ -39,6 +41,11 @@ typedef struct network_strain_half_fft_s {
 
 	strain_half_fft_t **strains;
 
+	/* Identifies the data, for the caches computed from it like the network statistic's whitened data. Every
+	 * network_strain_half_fft_alloc and network_strain_half_fft_modified takes the next value of one counter for
+	 * the whole program, so two strains allocated at the same address don't share it either. */
+	unsigned long generation;
+
 } network_strain_half_fft_t;
 
 
@@ -57,6 +64,25 @@ strain_t* strain_full_fft_to_strain( strain_full_fft_t* fft);
 network_strain_half_fft_t* network_strain_half_fft_alloc(size_t num_strains, size_t num_time_samples);
 void network_strain_half_fft_free(network_strain_half_fft_t *strains);
 
+/* Call after changing the data of the strains in place, so that the caches computed from the old data aren't used. */
+void network_strain_half_fft_modified(network_strain_half_fft_t *strains);
+
+/* Returns a copy of the strains with num_time_samples samples in the time domain, either zero-padded or cropped at the end.
+ * The PSDs and ASDs of the network are interpolated to the new bins with Detector_Network_resample_psds, so the
+ * f_low and f_high indices of anything allocated afterwards match the resized strains. */
+network_strain_half_fft_t* network_strain_half_fft_resize(network_strain_half_fft_t *strains, size_t num_time_samples,
+		detector_network_t *net, double sampling_frequency, double f_low, double f_high);
+
+/* Fills strain with the one-sided spectrum of the data in the file */
+typedef void (*strain_half_fft_load_function_ptr)(const char *filename, strain_half_fft_t *strain);
+
+/* Loads the network of the detector mapping file with Detector_Network_load_planned, and the data of its detectors
+ * with load. The policy decides how a data length that is slow to transform is changed (keep, pad or crop), and the
+ * data is resized to the planned length. Returns the data and writes the network to out_net. */
+network_strain_half_fft_t* network_strain_half_fft_load_planned(const char *detector_mapping_file,
+		SS_FFT_LENGTH_POLICY policy, double sampling_frequency, double f_low, double f_high,
+		strain_half_fft_load_function_ptr load, detector_network_t **out_net);
+
 #if defined (__cplusplus)
 }
 #endif
@@ -0,0 +1,187 @@
+#include <assert.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "vector_math.h"
+#include "vector_math_simd.h"
+
+/* -1 until the CPU has been checked */
+static int vm_simd_level = -1;
+
+static VM_SIMD_LEVEL VM_detect_simd_level(void) {
+#if VM_HAVE_X86_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		return VM_SIMD_AVX512;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		return VM_SIMD_AVX2;
+	}
+#endif
+	return VM_SIMD_NONE;
+}
+
+VM_SIMD_LEVEL VM_simd_level(void) {
+	if (vm_simd_level < 0) {
+		vm_simd_level = VM_detect_simd_level();
+	}
+	return (VM_SIMD_LEVEL) vm_simd_level;
+}
+
+void VM_set_simd_level(VM_SIMD_LEVEL level) {
+	VM_SIMD_LEVEL supported = VM_detect_simd_level();
+	vm_simd_level = (level > supported) ? supported : level;
+}
+
+const char* VM_simd_level_name(VM_SIMD_LEVEL level) {
+	switch (level) {
+	case VM_SIMD_NONE: return "none";
+	case VM_SIMD_AVX2: return "avx2";
+	case VM_SIMD_AVX512: return "avx512";
+	}
+	return "unknown";
+}
+
+static void VM_sincos_scalar(size_t n, const double *x, double *out_sin, double *out_cos) {
+	size_t i;
+	for (i = 0; i < n; i++) {
+		out_sin[i] = sin(x[i]);
+		out_cos[i] = cos(x[i]);
+	}
+}
+
+static void VM_conj_polar_scalar(size_t n, double scale, const double *amp, const double *phase, double *out_complex) {
+	size_t i;
+	for (i = 0; i < n; i++) {
+		double a = scale * amp[i];
+		out_complex[2*i + 0] = a * cos(phase[i]);
+		out_complex[2*i + 1] = a * -sin(phase[i]);
+	}
+}
+
+#if VM_HAVE_X86_SIMD
+static VM_TARGET_AVX2 void VM_sincos_array_avx2(size_t n, const double *x, double *out_sin, double *out_cos) {
+	size_t i;
+	__m256d s, c;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m256d v = _mm256_loadu_pd(x + i);
+		if (!VM_sincos_in_range_avx2(v)) {
+			VM_sincos_scalar(4, x + i, out_sin + i, out_cos + i);
+			continue;
+		}
+		VM_sincos_avx2(v, &s, &c);
+		_mm256_storeu_pd(out_sin + i, s);
+		_mm256_storeu_pd(out_cos + i, c);
+	}
+	VM_sincos_scalar(n - i, x + i, out_sin + i, out_cos + i);
+}
+
+static VM_TARGET_AVX512 void VM_sincos_array_avx512(size_t n, const double *x, double *out_sin, double *out_cos) {
+	size_t i;
+	__m512d s, c;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m512d v = _mm512_loadu_pd(x + i);
+		if (!VM_sincos_in_range_avx512(v)) {
+			VM_sincos_scalar(8, x + i, out_sin + i, out_cos + i);
+			continue;
+		}
+		VM_sincos_avx512(v, &s, &c);
+		_mm512_storeu_pd(out_sin + i, s);
+		_mm512_storeu_pd(out_cos + i, c);
+	}
+	VM_sincos_scalar(n - i, x + i, out_sin + i, out_cos + i);
+}
+
+static VM_TARGET_AVX2 void VM_conj_polar_avx2(size_t n, double scale, const double *amp, const double *phase, double *out_complex) {
+	size_t i;
+	__m256d s, c, a, re, im, lo, hi;
+	__m256d vscale = _mm256_set1_pd(scale);
+	__m256d sign = _mm256_set1_pd(-0.0);
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m256d v = _mm256_loadu_pd(phase + i);
+		if (!VM_sincos_in_range_avx2(v)) {
+			VM_conj_polar_scalar(4, scale, amp + i, phase + i, out_complex + 2*i);
+			continue;
+		}
+		VM_sincos_avx2(v, &s, &c);
+		a = _mm256_mul_pd(vscale, _mm256_loadu_pd(amp + i));
+		re = _mm256_mul_pd(a, c);
+		im = _mm256_mul_pd(a, _mm256_xor_pd(s, sign));
+
+		lo = _mm256_unpacklo_pd(re, im);
+		hi = _mm256_unpackhi_pd(re, im);
+		_mm256_storeu_pd(out_complex + 2*i, _mm256_permute2f128_pd(lo, hi, 0x20));
+		_mm256_storeu_pd(out_complex + 2*i + 4, _mm256_permute2f128_pd(lo, hi, 0x31));
+	}
+	VM_conj_polar_scalar(n - i, scale, amp + i, phase + i, out_complex + 2*i);
+}
+
+static VM_TARGET_AVX512 void VM_conj_polar_avx512(size_t n, double scale, const double *amp, const double *phase, double *out_complex) {
+	size_t i;
+	__m512d s, c, a, re, im;
+	__m512d vscale = _mm512_set1_pd(scale);
+	__m512i first_half = _mm512_set_epi64(11, 3, 10, 2, 9, 1, 8, 0);
+	__m512i second_half = _mm512_set_epi64(15, 7, 14, 6, 13, 5, 12, 4);
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m512d v = _mm512_loadu_pd(phase + i);
+		if (!VM_sincos_in_range_avx512(v)) {
+			VM_conj_polar_scalar(8, scale, amp + i, phase + i, out_complex + 2*i);
+			continue;
+		}
+		VM_sincos_avx512(v, &s, &c);
+		a = _mm512_mul_pd(vscale, _mm512_loadu_pd(amp + i));
+		re = _mm512_mul_pd(a, c);
+		im = _mm512_mul_pd(a, _mm512_sub_pd(_mm512_setzero_pd(), s));
+
+		_mm512_storeu_pd(out_complex + 2*i, _mm512_permutex2var_pd(re, first_half, im));
+		_mm512_storeu_pd(out_complex + 2*i + 8, _mm512_permutex2var_pd(re, second_half, im));
+	}
+	VM_conj_polar_scalar(n - i, scale, amp + i, phase + i, out_complex + 2*i);
+}
+#endif
+
+void VM_sincos(size_t n, const double *x, double *out_sin, double *out_cos) {
+	assert(x != NULL);
+	assert(out_sin != NULL);
+	assert(out_cos != NULL);
+
+	switch (VM_simd_level()) {
+#if VM_HAVE_X86_SIMD
+	case VM_SIMD_AVX512:
+		VM_sincos_array_avx512(n, x, out_sin, out_cos);
+		break;
+	case VM_SIMD_AVX2:
+		VM_sincos_array_avx2(n, x, out_sin, out_cos);
+		break;
+#endif
+	default:
+		VM_sincos_scalar(n, x, out_sin, out_cos);
+		break;
+	}
+}
+
+void VM_conj_polar(size_t n, double scale, const double *amp, const double *phase, double *out_complex) {
+	assert(amp != NULL);
+	assert(phase != NULL);
+	assert(out_complex != NULL);
+
+	switch (VM_simd_level()) {
+#if VM_HAVE_X86_SIMD
+	case VM_SIMD_AVX512:
+		VM_conj_polar_avx512(n, scale, amp, phase, out_complex);
+		break;
+	case VM_SIMD_AVX2:
+		VM_conj_polar_avx2(n, scale, amp, phase, out_complex);
+		break;
+#endif
+	default:
+		VM_conj_polar_scalar(n, scale, amp, phase, out_complex);
+		break;
+	}
+}
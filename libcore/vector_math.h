@@ -0,0 +1,43 @@
+#ifndef VECTOR_MATH_H_
+#define VECTOR_MATH_H_
+
+#include <stddef.h>
+
+/* The SIMD kernels use GCC/Clang target attributes and x86 intrinsics. Everywhere else only the scalar
+ * (libm) versions are used. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define VM_HAVE_X86_SIMD 1
+#else
+	#define VM_HAVE_X86_SIMD 0
+#endif
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+typedef enum {
+	VM_SIMD_NONE = 0,
+	VM_SIMD_AVX2,
+	VM_SIMD_AVX512
+} VM_SIMD_LEVEL;
+
+/* Returns the best instruction set supported by the CPU, or the level set by VM_set_simd_level. */
+VM_SIMD_LEVEL VM_simd_level(void);
+
+/* Forces a SIMD level, e.g. VM_SIMD_NONE to run the scalar reference code.
+ * A level above what the CPU supports is lowered to the supported one. */
+void VM_set_simd_level(VM_SIMD_LEVEL level);
+
+const char* VM_simd_level_name(VM_SIMD_LEVEL level);
+
+/* out_sin[i] = sin(x[i]), out_cos[i] = cos(x[i]). Agrees with libm to a few ulp. */
+void VM_sincos(size_t n, const double *x, double *out_sin, double *out_cos);
+
+/* Writes the interleaved complex values (scale * amp[i]) * exp(-i phase[i]). */
+void VM_conj_polar(size_t n, double scale, const double *amp, const double *phase, double *out_complex);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* VECTOR_MATH_H_ */
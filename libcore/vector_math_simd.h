@@ -0,0 +1,146 @@
+#ifndef VECTOR_MATH_SIMD_H_
+#define VECTOR_MATH_SIMD_H_
+
+/* Inline SIMD kernels shared by the libcore modules. This header is internal to libcore.
+ *
+ * Every function that uses these kernels must be declared with the same VM_TARGET_* attribute, otherwise
+ * the compiler will not inline them. Floating point contraction is turned off so that products and sums
+ * are rounded exactly like the scalar code, which keeps the SIMD results within an ulp of it.
+ */
+
+#include "vector_math.h"
+
+#if VM_HAVE_X86_SIMD
+
+#include <immintrin.h>
+
+#define VM_TARGET_AVX2 __attribute__((target("avx2"), optimize("fp-contract=off")))
+#define VM_TARGET_AVX512 __attribute__((target("avx512f"), optimize("fp-contract=off")))
+
+/* pi/2 split into three parts (fdlibm). The first two have 33 significant bits, so k * part is exact
+ * for |k| < 2^20. */
+#define VM_PIO2_1 1.57079632673412561417e+00
+#define VM_PIO2_2 6.07710050630396597660e-11
+#define VM_PIO2_3 2.02226624879595063154e-21
+#define VM_TWO_OVER_PI 6.36619772367581382433e-01
+
+/* Arguments above this use libm, since k * VM_PIO2_1 would no longer be exact. */
+#define VM_SINCOS_MAX_ARG 1.0e6
+
+/* sin and cos kernel coefficients on [-pi/4, pi/4] (fdlibm) */
+#define VM_S1 -1.66666666666666324348e-01
+#define VM_S2  8.33333333332248946124e-03
+#define VM_S3 -1.98412698298579493134e-04
+#define VM_S4  2.75573137070700676789e-06
+#define VM_S5 -2.50507602534068634195e-08
+#define VM_S6  1.58969099521155010221e-10
+
+#define VM_C1  4.16666666666666019037e-02
+#define VM_C2 -1.38888888888741095749e-03
+#define VM_C3  2.48015872894767294178e-05
+#define VM_C4 -2.75573143513906633035e-07
+#define VM_C5  2.08757232129817482790e-09
+#define VM_C6 -1.13596475577881948265e-11
+
+/* Returns non-zero if every lane can be handled by VM_sincos_avx2 (this is false for NaN). */
+static inline VM_TARGET_AVX2 int VM_sincos_in_range_avx2(__m256d x) {
+	__m256d abs_x = _mm256_andnot_pd(_mm256_set1_pd(-0.0), x);
+	return _mm256_movemask_pd( _mm256_cmp_pd(abs_x, _mm256_set1_pd(VM_SINCOS_MAX_ARG), _CMP_LE_OQ) ) == 0xF;
+}
+
+static inline VM_TARGET_AVX2 void VM_sincos_avx2(__m256d x, __m256d *out_sin, __m256d *out_cos) {
+	__m256d k, r, z, v, s, c, hz, w, q, swap, neg_s, neg_c, sign;
+
+	/* reduce to r in [-pi/4, pi/4], x = k pi/2 + r */
+	k = _mm256_round_pd( _mm256_mul_pd(x, _mm256_set1_pd(VM_TWO_OVER_PI)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC );
+	r = _mm256_sub_pd(x, _mm256_mul_pd(k, _mm256_set1_pd(VM_PIO2_1)));
+	r = _mm256_sub_pd(r, _mm256_mul_pd(k, _mm256_set1_pd(VM_PIO2_2)));
+	r = _mm256_sub_pd(r, _mm256_mul_pd(k, _mm256_set1_pd(VM_PIO2_3)));
+
+	z = _mm256_mul_pd(r, r);
+
+	/* sin(r) = r + r^3 (S1 + z (S2 + ... )) */
+	v = _mm256_add_pd(_mm256_set1_pd(VM_S5), _mm256_mul_pd(z, _mm256_set1_pd(VM_S6)));
+	v = _mm256_add_pd(_mm256_set1_pd(VM_S4), _mm256_mul_pd(z, v));
+	v = _mm256_add_pd(_mm256_set1_pd(VM_S3), _mm256_mul_pd(z, v));
+	v = _mm256_add_pd(_mm256_set1_pd(VM_S2), _mm256_mul_pd(z, v));
+	v = _mm256_add_pd(_mm256_set1_pd(VM_S1), _mm256_mul_pd(z, v));
+	s = _mm256_add_pd(r, _mm256_mul_pd(_mm256_mul_pd(z, r), v));
+
+	/* cos(r) = 1 - z/2 + z^2 (C1 + z (C2 + ... )) */
+	v = _mm256_add_pd(_mm256_set1_pd(VM_C5), _mm256_mul_pd(z, _mm256_set1_pd(VM_C6)));
+	v = _mm256_add_pd(_mm256_set1_pd(VM_C4), _mm256_mul_pd(z, v));
+	v = _mm256_add_pd(_mm256_set1_pd(VM_C3), _mm256_mul_pd(z, v));
+	v = _mm256_add_pd(_mm256_set1_pd(VM_C2), _mm256_mul_pd(z, v));
+	v = _mm256_add_pd(_mm256_set1_pd(VM_C1), _mm256_mul_pd(z, v));
+	v = _mm256_mul_pd(_mm256_mul_pd(z, z), v);
+	hz = _mm256_mul_pd(_mm256_set1_pd(0.5), z);
+	w = _mm256_sub_pd(_mm256_set1_pd(1.0), hz);
+	c = _mm256_add_pd(w, _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), w), hz), v));
+
+	/* quadrant q = k mod 4 selects and negates the results */
+	q = _mm256_sub_pd(k, _mm256_mul_pd(_mm256_set1_pd(4.0), _mm256_floor_pd(_mm256_mul_pd(k, _mm256_set1_pd(0.25)))));
+	swap = _mm256_or_pd( _mm256_cmp_pd(q, _mm256_set1_pd(1.0), _CMP_EQ_OQ), _mm256_cmp_pd(q, _mm256_set1_pd(3.0), _CMP_EQ_OQ) );
+	neg_s = _mm256_cmp_pd(q, _mm256_set1_pd(2.0), _CMP_GE_OQ);
+	neg_c = _mm256_or_pd( _mm256_cmp_pd(q, _mm256_set1_pd(1.0), _CMP_EQ_OQ), _mm256_cmp_pd(q, _mm256_set1_pd(2.0), _CMP_EQ_OQ) );
+
+	sign = _mm256_set1_pd(-0.0);
+	*out_sin = _mm256_xor_pd( _mm256_blendv_pd(s, c, swap), _mm256_and_pd(neg_s, sign) );
+	*out_cos = _mm256_xor_pd( _mm256_blendv_pd(c, s, swap), _mm256_and_pd(neg_c, sign) );
+}
+
+/* Returns non-zero if every lane can be handled by VM_sincos_avx512 (this is false for NaN). */
+static inline VM_TARGET_AVX512 int VM_sincos_in_range_avx512(__m512d x) {
+	__m512d abs_x = _mm512_abs_pd(x);
+	return _mm512_cmp_pd_mask(abs_x, _mm512_set1_pd(VM_SINCOS_MAX_ARG), _CMP_LE_OQ) == 0xFF;
+}
+
+static inline VM_TARGET_AVX512 void VM_sincos_avx512(__m512d x, __m512d *out_sin, __m512d *out_cos) {
+	__m512d k, r, z, v, s, c, hz, w, q, sin_val, cos_val;
+	__m512i sign;
+	__mmask8 swap, neg_s, neg_c;
+
+	/* reduce to r in [-pi/4, pi/4], x = k pi/2 + r */
+	k = _mm512_roundscale_pd( _mm512_mul_pd(x, _mm512_set1_pd(VM_TWO_OVER_PI)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC );
+	r = _mm512_sub_pd(x, _mm512_mul_pd(k, _mm512_set1_pd(VM_PIO2_1)));
+	r = _mm512_sub_pd(r, _mm512_mul_pd(k, _mm512_set1_pd(VM_PIO2_2)));
+	r = _mm512_sub_pd(r, _mm512_mul_pd(k, _mm512_set1_pd(VM_PIO2_3)));
+
+	z = _mm512_mul_pd(r, r);
+
+	/* sin(r) = r + r^3 (S1 + z (S2 + ... )) */
+	v = _mm512_add_pd(_mm512_set1_pd(VM_S5), _mm512_mul_pd(z, _mm512_set1_pd(VM_S6)));
+	v = _mm512_add_pd(_mm512_set1_pd(VM_S4), _mm512_mul_pd(z, v));
+	v = _mm512_add_pd(_mm512_set1_pd(VM_S3), _mm512_mul_pd(z, v));
+	v = _mm512_add_pd(_mm512_set1_pd(VM_S2), _mm512_mul_pd(z, v));
+	v = _mm512_add_pd(_mm512_set1_pd(VM_S1), _mm512_mul_pd(z, v));
+	s = _mm512_add_pd(r, _mm512_mul_pd(_mm512_mul_pd(z, r), v));
+
+	/* cos(r) = 1 - z/2 + z^2 (C1 + z (C2 + ... )) */
+	v = _mm512_add_pd(_mm512_set1_pd(VM_C5), _mm512_mul_pd(z, _mm512_set1_pd(VM_C6)));
+	v = _mm512_add_pd(_mm512_set1_pd(VM_C4), _mm512_mul_pd(z, v));
+	v = _mm512_add_pd(_mm512_set1_pd(VM_C3), _mm512_mul_pd(z, v));
+	v = _mm512_add_pd(_mm512_set1_pd(VM_C2), _mm512_mul_pd(z, v));
+	v = _mm512_add_pd(_mm512_set1_pd(VM_C1), _mm512_mul_pd(z, v));
+	v = _mm512_mul_pd(_mm512_mul_pd(z, z), v);
+	hz = _mm512_mul_pd(_mm512_set1_pd(0.5), z);
+	w = _mm512_sub_pd(_mm512_set1_pd(1.0), hz);
+	c = _mm512_add_pd(w, _mm512_add_pd(_mm512_sub_pd(_mm512_sub_pd(_mm512_set1_pd(1.0), w), hz), v));
+
+	/* quadrant q = k mod 4 selects and negates the results */
+	q = _mm512_sub_pd(k, _mm512_mul_pd(_mm512_set1_pd(4.0),
+			_mm512_roundscale_pd(_mm512_mul_pd(k, _mm512_set1_pd(0.25)), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)));
+	swap = _mm512_cmp_pd_mask(q, _mm512_set1_pd(1.0), _CMP_EQ_OQ) | _mm512_cmp_pd_mask(q, _mm512_set1_pd(3.0), _CMP_EQ_OQ);
+	neg_s = _mm512_cmp_pd_mask(q, _mm512_set1_pd(2.0), _CMP_GE_OQ);
+	neg_c = _mm512_cmp_pd_mask(q, _mm512_set1_pd(1.0), _CMP_EQ_OQ) | _mm512_cmp_pd_mask(q, _mm512_set1_pd(2.0), _CMP_EQ_OQ);
+
+	sin_val = _mm512_mask_blend_pd(swap, s, c);
+	cos_val = _mm512_mask_blend_pd(swap, c, s);
+	sign = _mm512_set1_epi64( (long long) 0x8000000000000000ULL );
+	*out_sin = _mm512_castsi512_pd( _mm512_mask_xor_epi64(_mm512_castpd_si512(sin_val), neg_s, _mm512_castpd_si512(sin_val), sign) );
+	*out_cos = _mm512_castsi512_pd( _mm512_mask_xor_epi64(_mm512_castpd_si512(cos_val), neg_c, _mm512_castpd_si512(cos_val), sign) );
+}
+
+#endif /* VM_HAVE_X86_SIMD */
+
+#endif /* VECTOR_MATH_SIMD_H_ */
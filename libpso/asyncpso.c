@@ -0,0 +1,326 @@
+/*
+ * asyncpso.c
+ *
+ * Asynchronous (barrier free) local best PSO.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_math.h>
+
+#include "pso.h"
+#include "ptapso_maxphase.h"
+#include "parallel.h"
+
+/* The pbest of every particle, published for its neighbors. Only the thread that is updating a particle
+   writes its entry, and the others read it without locking: the version is odd while the entry is being
+   written, so a reader that sees an odd or a changed version reads it again (a sequence lock). */
+typedef struct asyncpso_board_s {
+	size_t nDim;
+	unsigned long *version;
+	double *fitVal;
+	double *coord;
+} asyncpso_board_t;
+
+static asyncpso_board_t* asyncpso_board_alloc(size_t popsize, size_t nDim) {
+	size_t i;
+	asyncpso_board_t *b = (asyncpso_board_t*) malloc(sizeof(asyncpso_board_t));
+	if (b == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: asyncpso_board_alloc(). Exiting.\n");
+		exit(-1);
+	}
+
+	b->nDim = nDim;
+	b->version = (unsigned long*) malloc(GSL_MAX(popsize, 1) * sizeof(unsigned long));
+	if (b->version == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: asyncpso_board_alloc(). Exiting.\n");
+		exit(-1);
+	}
+	b->fitVal = pso_aligned_alloc(popsize);
+	b->coord = pso_aligned_alloc(popsize * nDim);
+	memset(b->coord, 0, popsize * nDim * sizeof(double));
+
+	for (i = 0; i < popsize; i++) {
+		b->version[i] = 0;
+		b->fitVal[i] = GSL_POSINF;
+	}
+	return b;
+}
+
+static void asyncpso_board_free(asyncpso_board_t *b) {
+	free(b->version);
+	free(b->fitVal);
+	free(b->coord);
+	free(b);
+}
+
+static void asyncpso_board_publish(asyncpso_board_t *b, size_t particle, double fitVal, const double *coord) {
+#ifdef HAVE_OPENMP
+	#pragma omp atomic
+#endif
+	b->version[particle]++;
+#ifdef HAVE_OPENMP
+	#pragma omp flush
+#endif
+	b->fitVal[particle] = fitVal;
+	memcpy(b->coord + particle*b->nDim, coord, b->nDim * sizeof(double));
+#ifdef HAVE_OPENMP
+	#pragma omp flush
+	#pragma omp atomic
+#endif
+	b->version[particle]++;
+}
+
+/* Returns the published fitness of the particle and copies its coordinates to coord if it isn't NULL. */
+static double asyncpso_board_read(asyncpso_board_t *b, size_t particle, double *coord) {
+	unsigned long before, after;
+	double fitVal;
+
+	do {
+#ifdef HAVE_OPENMP
+		#pragma omp atomic read
+#endif
+		before = b->version[particle];
+#ifdef HAVE_OPENMP
+		#pragma omp flush
+#endif
+		fitVal = b->fitVal[particle];
+		if (coord != NULL) {
+			memcpy(coord, b->coord + particle*b->nDim, b->nDim * sizeof(double));
+		}
+#ifdef HAVE_OPENMP
+		#pragma omp flush
+		#pragma omp atomic read
+#endif
+		after = b->version[particle];
+	} while ((before & 1) || before != after);
+
+	return fitVal;
+}
+
+/*!
+Asynchronous version of \ref lbestpso: there is no barrier at the end of an iteration. Each particle's pbest,
+neighborhood best, velocity and position are updated as soon as its own evaluation finishes, and it goes back
+to a queue of particles that are waiting to be evaluated. The threads take the particles from the queue, so
+the slowest evaluation doesn't hold up the others.
+
+Notes:
+   - Local best PSO with the particle and its two nearest neighbors in a ring topology. The neighborhood best
+     is the best pbest of the neighborhood, that the particles publish without locks as they improve.
+   - The inertia weight decays linearly with the number of updates of each particle.
+   - The total number of fitness evaluations is popsize*maxSteps, like the synchronous versions. A callback is
+     made every popsize*interval evaluations.
+   - The local minimizer (locMinIter), the batch fitness function, the island migration and the debug dump
+     are not used.
+   - The results depend on the timing of the threads, unless there is only one.
+*/
+void asyncpso(size_t nDim, /*!< Number of search dimensions */
+            fitness_function_ptr fitfunc, /*!< Pointer to Fitness function */
+            void *ffParams, /*!< Fitness function parameter structure */
+            current_result_callback_params_t *callback_params, /* Pointer to callback function parameter structure */
+            struct psoParamStruct *psoParams, /*!< PSO parameter structure */
+            struct returnData *psoResults /*!< Output structure */){
+
+	clock_t time_start = clock();
+
+	gsl_rng *rngGen = psoParams->rngGen;
+	const pso_rng_t *counterRng = psoParams->counterRng;
+	struct fitFuncParams *fp = (struct fitFuncParams *) ffParams;
+
+	size_t lpParticles;
+	/* Number of particles */
+	const size_t popsize = psoParams->popsize;
+	/* Number of fitness evaluations of the whole run */
+	const size_t maxEvals = popsize * psoParams->maxSteps;
+	/* Information about the particles is stored in contiguous arrays. */
+	struct swarmInfo *swarm = swarminfo_alloc(popsize, nDim);
+	if (counterRng != NULL){
+		swarminfo_init_counter(swarm, counterRng);
+	}
+	else{
+		initPsoSwarm(swarm, rngGen);
+	}
+	asyncpso_board_t *board = asyncpso_board_alloc(popsize, nDim);
+
+	/* Number of updates of each particle */
+	size_t *partIter = (size_t *) calloc(GSL_MAX(popsize, 1), sizeof(size_t));
+	/* The queue of particles waiting to be evaluated, all of them to start with */
+	size_t *queue = (size_t *) malloc(GSL_MAX(popsize, 1) * sizeof(size_t));
+	if (partIter == NULL || queue == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: asyncpso(). Exiting.\n");
+		exit(-1);
+	}
+	for (lpParticles = 0; lpParticles < popsize; lpParticles++){
+		queue[lpParticles] = lpParticles;
+	}
+	size_t queueHead = 0, queueCount = popsize;
+	/* Number of evaluations handed out, and actually computed */
+	size_t evalsIssued = 0, evalsComputed = 0;
+
+#ifdef HAVE_OPENMP
+	/* A thread holds at most one particle, so with fewer threads than particles (or one thread) the queue isn't
+	   empty when a thread takes from it, and no thread spins waiting for a particle */
+	const size_t num_threads = GSL_MAX(GSL_MIN(parallel_get_max_threads(), popsize - 1), 1);
+	#pragma omp parallel num_threads(num_threads)
+#endif
+	{
+		double *nbrCoord = pso_aligned_alloc(nDim);
+
+		for (;;){
+			size_t particle = 0, ticket = 0, lpc;
+			int done = 0, havePart = 0;
+
+			/* Take the next particle from the queue */
+#ifdef HAVE_OPENMP
+			#pragma omp critical (asyncpso_queue)
+#endif
+			{
+				if (evalsIssued >= maxEvals){
+					done = 1;
+				}
+				else if (queueCount > 0){
+					particle = queue[queueHead];
+					queueHead = (queueHead + 1) % popsize;
+					queueCount--;
+					ticket = evalsIssued++;
+					havePart = 1;
+				}
+			}
+			if (done){
+				break;
+			}
+			if (!havePart){
+				continue;
+			}
+
+			/* Evaluate fitness. The particle's entries of the swarm belong to this thread until it is queued again. */
+			swarm->partSnrCurr[particle] = fitfunc(swarm->partCoordVecs[particle], ffParams);
+			swarm->partFitOK[particle] = fp->fitEvalFlag[parallel_get_thread_num()];
+			if (swarm->partFitOK[particle]){
+				swarm->partFitEvals[particle] += 1;
+#ifdef HAVE_OPENMP
+				#pragma omp atomic
+#endif
+				evalsComputed++;
+			}
+
+			/* Update and publish pbest */
+			if (swarm->partSnrPbest[particle] > swarm->partSnrCurr[particle]){
+				swarm->partSnrPbest[particle] = swarm->partSnrCurr[particle];
+				memcpy(swarm->partPbest + particle*nDim, swarm->partCoord + particle*nDim, nDim * sizeof(double));
+				asyncpso_board_publish(board, particle, swarm->partSnrPbest[particle],
+						swarm->partPbest + particle*nDim);
+			}
+
+			/* Update the neighborhood best with the published pbest of the neighbors */
+			if (swarm->partSnrPbest[particle] < swarm->partSnrLbest[particle]){
+				swarm->partSnrLbest[particle] = swarm->partSnrPbest[particle];
+				memcpy(swarm->partLocalBest + particle*nDim, swarm->partPbest + particle*nDim, nDim * sizeof(double));
+			}
+			size_t nbrs[2] = {(particle + popsize - 1) % popsize, (particle + 1) % popsize};
+			for (lpc = 0; lpc < 2; lpc++){
+				double nbrFitVal = asyncpso_board_read(board, nbrs[lpc], nbrCoord);
+				if (nbrFitVal < swarm->partSnrLbest[particle]){
+					swarm->partSnrLbest[particle] = nbrFitVal;
+					memcpy(swarm->partLocalBest + particle*nDim, nbrCoord, nDim * sizeof(double));
+				}
+			}
+
+			/* Inertia weight, random weights, velocity and position update of the particle */
+			size_t iter = ++partIter[particle];
+			double inertia = psoParams->dcLaw_a - (psoParams->dcLaw_b/psoParams->dcLaw_c) * iter;
+			if (inertia < psoParams->dcLaw_d){
+				inertia = psoParams->dcLaw_d;
+			}
+			if (counterRng != NULL){
+				for (lpc = 0; lpc < nDim; lpc++){
+					swarm->chi1[particle*nDim + lpc] = pso_rng_uniform(counterRng, iter, particle, PSO_RNG_CHI1, lpc);
+					swarm->chi2[particle*nDim + lpc] = pso_rng_uniform(counterRng, iter, particle, PSO_RNG_CHI2, lpc);
+				}
+			}
+			else{
+#ifdef HAVE_OPENMP
+				#pragma omp critical (asyncpso_rng)
+#endif
+				{
+					for (lpc = 0; lpc < nDim; lpc++){
+						swarm->chi1[particle*nDim + lpc] = gsl_rng_uniform(rngGen);
+					}
+					for (lpc = 0; lpc < nDim; lpc++){
+						swarm->chi2[particle*nDim + lpc] = gsl_rng_uniform(rngGen);
+					}
+				}
+			}
+			swarminfo_particle_velocity_update(swarm, particle, inertia, psoParams->c1, psoParams->c2,
+					psoParams->max_velocity);
+
+			/* Queue the particle for its next evaluation */
+#ifdef HAVE_OPENMP
+			#pragma omp critical (asyncpso_queue)
+#endif
+			{
+				queue[(queueHead + queueCount) % popsize] = particle;
+				queueCount++;
+			}
+
+			if (callback_params != NULL && (ticket + 1) % (popsize * callback_params->interval) == 0){
+#ifdef HAVE_OPENMP
+				#pragma omp critical (asyncpso_callback)
+#endif
+				{
+					/* The best published pbest so far */
+					size_t best = 0;
+					double bestFitVal = GSL_POSINF;
+					for (lpc = 0; lpc < popsize; lpc++){
+						double fitVal = asyncpso_board_read(board, lpc, NULL);
+						if (fitVal < bestFitVal){
+							bestFitVal = fitVal;
+							best = lpc;
+						}
+					}
+					asyncpso_board_read(board, best, nbrCoord);
+					gsl_vector_view bestCoord = gsl_vector_view_array(nbrCoord, nDim);
+					gsl_vector_memcpy(psoResults->bestLocation, &bestCoord.vector);
+					psoResults->bestFitVal = bestFitVal;
+					psoResults->totalIterations = (ticket + 1) / popsize;
+#ifdef HAVE_OPENMP
+					#pragma omp atomic read
+#endif
+					psoResults->totalFuncEvals = evalsComputed;
+					psoResults->computationTimeSecs = ((double) (clock() - time_start)) / CLOCKS_PER_SEC;
+
+					/* Call the callback function */
+					callback_params->callback( callback_params->callback_params, psoResults );
+				}
+			}
+		}
+
+		free(nbrCoord);
+	}
+
+	/* Prepare output: the best pbest of the swarm */
+	size_t best = 0;
+	psoResults->bestFitVal = GSL_POSINF;
+	psoResults->totalFuncEvals = 0;
+	for (lpParticles = 0; lpParticles < popsize; lpParticles++){
+		if (swarm->partSnrPbest[lpParticles] < psoResults->bestFitVal){
+			psoResults->bestFitVal = swarm->partSnrPbest[lpParticles];
+			best = lpParticles;
+		}
+		psoResults->totalFuncEvals += swarm->partFitEvals[lpParticles];
+	}
+	gsl_vector_view bestCoord = gsl_vector_view_array(swarm->partPbest + best*nDim, nDim);
+	gsl_vector_memcpy(psoResults->bestLocation, &bestCoord.vector);
+	psoResults->totalIterations = psoParams->maxSteps;
+	psoResults->computationTimeSecs = ((double) (clock() - time_start)) / CLOCKS_PER_SEC;
+
+	free(partIter);
+	free(queue);
+	asyncpso_board_free(board);
+	/* Deallocate the swarm */
+	swarminfo_free(swarm);
+}
@@ -1,6 +1,7 @@
 #include "pso.h"
 #include <stdio.h>
 #include <stddef.h>
+#include <string.h>
 #include <time.h>
 #include <gsl/gsl_multimin.h>
 #include <gsl/gsl_vector.h>
@@ -72,23 +73,21 @@ void gbestpso(size_t nDim, /*!< Number of search dimensions */
 	const size_t popsize = psoParams->popsize;
 	/* Number of iterations */
 	const size_t maxSteps = psoParams->maxSteps;
-	/* Information about a particles is stored in a struct array.
+	/* Information about the particles is stored in contiguous arrays.
 	*/
-    struct particleInfo pop[popsize];
+	struct swarmInfo *swarm = swarminfo_alloc(popsize, nDim);
 	/* initialize particles */
-	for (lpParticles = 0; lpParticles < popsize; lpParticles++){
-	      initPsoParticles(&pop[lpParticles], nDim, rngGen);
-    }	
+	if (psoParams->counterRng != NULL){
+		swarminfo_init_counter(swarm, psoParams->counterRng);
+	}
+	else{
+		initPsoSwarm(swarm, rngGen);
+	}
 	/* Variables needed to find and track gbest */
 	double gbestFitVal = GSL_POSINF;
 	gsl_vector *gbestCoord = gsl_vector_alloc(nDim);
-	gsl_vector *partSnrCurrCol = gsl_vector_alloc(popsize);
 	size_t bestfitParticle;
 	double currBestFitVal;
-	/* Variables needed to keep track of number of fitness function evaluations */
-	unsigned char computeOK;
-	size_t funcCount;
-	
 	/* Variables needed in PSO dynamical equation update */
 	// size_t lpNbrs; /* Loop counter over nearest neighbors */
 // 	size_t nNbrs = 3;
@@ -97,12 +96,6 @@ void gbestpso(size_t nDim, /*!< Number of search dimensions */
 // 	size_t lbestPart; /* local best particle */
 // 	double lbestFit; /* Fitness of local best particle */
 	
-	/* Variables needed for PSO dynamical equations */
-	size_t lpCoord;
-	gsl_vector *accVecPbest = gsl_vector_alloc(nDim);
-	gsl_vector *accVecLbest = gsl_vector_alloc(nDim);
-	gsl_vector *chi1Vec = gsl_vector_alloc(nDim);
-	gsl_vector *chi2Vec = gsl_vector_alloc(nDim);
 	
 	/* 
 	   Start PSO iterations from the second iteration since the first is used
@@ -113,40 +106,17 @@ void gbestpso(size_t nDim, /*!< Number of search dimensions */
 
 		if (psoParams->debugDumpFile != NULL){
 			fprintf(psoParams->debugDumpFile,"Loop %zu \n",lpPsoIter);
-			particleInfoDump(psoParams->debugDumpFile,pop,popsize);
+			swarmInfoDump(psoParams->debugDumpFile,swarm);
 		}		
         /* Calculate fitness values */
-#ifdef HAVE_OPENMP
-		#pragma omp parallel for
-#endif
-		for (lpParticles = 0; lpParticles < popsize; lpParticles++){
-			/* Evaluate fitness */
-			pop[lpParticles].partSnrCurr = fitfunc(pop[lpParticles].partCoord,ffParams);
-			//fprintf(stderr, "Done evaluating the fitness function...\n");
-			/* Separately store all fitness values -- needed to find best particle */
-			gsl_vector_set(partSnrCurrCol,lpParticles,pop[lpParticles].partSnrCurr);
-			/* Check if fitness function was actually evaluated or not */
-	        computeOK = ((struct fitFuncParams *)ffParams)->fitEvalFlag[parallel_get_thread_num()];
-	        funcCount = 0;
-	        if (computeOK){
-			    /* Increment fitness function evaluation count */
-	            funcCount = 1;
-			}
-	        pop[lpParticles].partFitEvals += funcCount;
-			/* Update pbest fitness and coordinates if needed */
-	        if (pop[lpParticles].partSnrPbest > pop[lpParticles].partSnrCurr){
-	            pop[lpParticles].partSnrPbest = pop[lpParticles].partSnrCurr;
-
-	            /* This is causing a segfault using openmp */
-	            gsl_vector_memcpy(pop[lpParticles].partPbest,pop[lpParticles].partCoord);
-	        }
-	    }
+		evalPsoSwarm(swarm, fitfunc, ffParams, psoParams);
+		/* Exchange the best particles with the other islands, if any */
+		swarminfo_migrate(swarm, psoParams->migration, lpPsoIter);
 		
-		//fprintf(stderr, "Done openmp parallel for loop.\n");
 
 		/* Find the best particle in the current iteration */
-		bestfitParticle = gsl_vector_min_index(partSnrCurrCol);
-	    currBestFitVal = pop[bestfitParticle].partSnrCurr; 
+		bestfitParticle = swarminfo_best_particle(swarm);
+	    currBestFitVal = swarm->partSnrCurr[bestfitParticle];
 	    if (gbestFitVal > currBestFitVal){
 		/* 
 		   Do local minimization iterations since gbest has changed.
@@ -172,13 +142,12 @@ void gbestpso(size_t nDim, /*!< Number of search dimensions */
 	        //pop[bestfitParticle].partFitEvals += funcCount;
 			
 			/* Update particle pbest */
-			pop[bestfitParticle].partSnrPbest = pop[bestfitParticle].partSnrCurr;
-			gsl_vector_memcpy(pop[bestfitParticle].partPbest,pop[bestfitParticle].partCoord);
+			swarm->partSnrPbest[bestfitParticle] = swarm->partSnrCurr[bestfitParticle];
+			memcpy(swarm->partPbest + bestfitParticle*nDim, swarm->partCoord + bestfitParticle*nDim,
+			       nDim * sizeof(double));
 			/* Update gbest */
-			gbestFitVal = pop[bestfitParticle].partSnrCurr;
-			gsl_vector_memcpy(gbestCoord,pop[bestfitParticle].partCoord);
-			/* Update list of fitness Values */
-			gsl_vector_set(partSnrCurrCol,bestfitParticle,pop[bestfitParticle].partSnrCurr);
+			gbestFitVal = swarm->partSnrCurr[bestfitParticle];
+			gsl_vector_memcpy(gbestCoord,swarm->partCoordVecs[bestfitParticle]);
 		}
 		
 		/* Get lbest */
@@ -207,64 +176,33 @@ void gbestpso(size_t nDim, /*!< Number of search dimensions */
 			   // 	               gsl_vector_memcpy(pop[lpParticles].partLocalBest,
 			   // 				                     pop[lbestPart].partCoord);
 			   // 	           }
-			pop[lpParticles].partSnrLbest = gbestFitVal;
-			gsl_vector_memcpy(pop[lpParticles].partLocalBest, pop[bestfitParticle].partCoord);
+			swarm->partSnrLbest[lpParticles] = gbestFitVal;
+			memcpy(swarm->partLocalBest + lpParticles*nDim, swarm->partCoord + bestfitParticle*nDim,
+			       nDim * sizeof(double));
 		}
         
 
-	    for (lpParticles = 0; lpParticles < popsize; lpParticles++){
-			/* Update inertia Weight */
-		    pop[lpParticles].partInertia = psoParams->dcLaw_a-(psoParams->dcLaw_b/psoParams->dcLaw_c)*lpPsoIter;
-			if (pop[lpParticles].partInertia < psoParams->dcLaw_d)
-				pop[lpParticles].partInertia = psoParams->dcLaw_d;
-		    /* Acceleration vector to pbest */
-			gsl_vector_memcpy(accVecPbest,pop[lpParticles].partPbest);
-			gsl_vector_sub(accVecPbest,pop[lpParticles].partCoord);
-			/* Acceleration vector to lbest */
-			gsl_vector_memcpy(accVecLbest,pop[lpParticles].partLocalBest);
-			gsl_vector_sub(accVecLbest,pop[lpParticles].partCoord);
-			/* Random weights for acceleration components */
-			for (lpCoord = 0; lpCoord < nDim; lpCoord++){
-				gsl_vector_set(chi1Vec,lpCoord,gsl_rng_uniform(rngGen));
-			}
-			for (lpCoord = 0; lpCoord < nDim; lpCoord++){
-				gsl_vector_set(chi2Vec,lpCoord,gsl_rng_uniform(rngGen));
-			}
-			/* Multiply random weights */
-			gsl_vector_mul(accVecPbest,chi1Vec);
-			gsl_vector_mul(accVecLbest,chi2Vec);
-			/* Scale with acceleration constants */
-			gsl_vector_scale(accVecPbest,psoParams->c1);
-			gsl_vector_scale(accVecLbest,psoParams->c2);
-            /* Velocity update 			
-		        pop(k,partVelCols)=partInertia*pop(k,partVelCols)+...
-		                           c1*(pop(k,partPbestCols)-pop(k,partCoordCols))*chi1+...
-		                           c2*(pop(k,partLocalBestCols)-pop(k,partCoordCols))*chi2;
-			*/
-			gsl_vector_scale(pop[lpParticles].partVel,pop[lpParticles].partInertia);
-			gsl_vector_add(pop[lpParticles].partVel,accVecPbest);
-			gsl_vector_add(pop[lpParticles].partVel,accVecLbest);
-			/*
-			  Apply max. velocity threshold
-		        maxvBustCompPos = find(pop(k,partVelCols) > max_velocity);
-		        maxvBustCompNeg = find(pop(k,partVelCols) < -max_velocity);
-		        if ~isempty(maxvBustCompPos)
-		            pop(k,partVelCols(maxvBustCompPos))= max_velocity;
-		        end
-		        if ~isempty(maxvBustCompNeg)
-		            pop(k,partVelCols(maxvBustCompNeg))= -max_velocity(1);
-		        end
-			*/
-			limitVecComponent(pop[lpParticles].partVel, - psoParams->max_velocity, psoParams->max_velocity);
-			/* 
-				Position Update
-			*/
-	        gsl_vector_add(pop[lpParticles].partCoord,pop[lpParticles].partVel);        
-	    }
+		/* Update inertia Weight */
+	    swarm->partInertia = psoParams->dcLaw_a-(psoParams->dcLaw_b/psoParams->dcLaw_c)*lpPsoIter;
+		if (swarm->partInertia < psoParams->dcLaw_d)
+			swarm->partInertia = psoParams->dcLaw_d;
+		/* Random weights for acceleration components */
+		if (psoParams->counterRng != NULL){
+			swarminfo_draw_weights_counter(swarm, psoParams->counterRng, lpPsoIter);
+		}
+		else{
+			swarminfo_draw_weights(swarm, rngGen);
+		}
+        /* Velocity update, max. velocity threshold and position update of the whole swarm
+	        pop(k,partVelCols)=partInertia*pop(k,partVelCols)+...
+	                           c1*(pop(k,partPbestCols)-pop(k,partCoordCols))*chi1+...
+	                           c2*(pop(k,partLocalBestCols)-pop(k,partCoordCols))*chi2;
+		*/
+		swarminfo_velocity_update(swarm, psoParams->c1, psoParams->c2, psoParams->max_velocity);
 		
 		if (psoParams->debugDumpFile != NULL){
 			fprintf(psoParams->debugDumpFile,"After dynamical update\n");   
-			particleInfoDump(psoParams->debugDumpFile,pop,popsize);
+			swarmInfoDump(psoParams->debugDumpFile,swarm);
 			fprintf(psoParams->debugDumpFile,"--------\n");			      
 	    }
 
@@ -275,7 +213,7 @@ void gbestpso(size_t nDim, /*!< Number of search dimensions */
 				/* 	actualEvaluations = sum(pop(:,partFitEvalsCols)); */
 				psoResults->totalFuncEvals = 0;
 				for (lpParticles = 0; lpParticles < popsize; lpParticles ++){
-					psoResults->totalFuncEvals += pop[lpParticles].partFitEvals;
+					psoResults->totalFuncEvals += swarm->partFitEvals[lpParticles];
 				}
 				gsl_vector_memcpy(psoResults->bestLocation, gbestCoord);
 				psoResults->bestFitVal = gbestFitVal;
@@ -294,7 +232,7 @@ void gbestpso(size_t nDim, /*!< Number of search dimensions */
 	/* 	actualEvaluations = sum(pop(:,partFitEvalsCols)); */
 	psoResults->totalFuncEvals = 0;
 	for (lpParticles = 0; lpParticles < popsize; lpParticles ++){
-		psoResults->totalFuncEvals += pop[lpParticles].partFitEvals;
+		psoResults->totalFuncEvals += swarm->partFitEvals[lpParticles];
 	}
 	gsl_vector_memcpy(psoResults->bestLocation, gbestCoord);
 	psoResults->bestFitVal = gbestFitVal;
@@ -306,13 +244,6 @@ void gbestpso(size_t nDim, /*!< Number of search dimensions */
 	/* Deallocate vectors */
 	//gsl_vector_free(locMinStp);
 	gsl_vector_free(gbestCoord);
-	gsl_vector_free(partSnrCurrCol);
-	gsl_vector_free(accVecPbest);
-    gsl_vector_free(accVecLbest); 
-	gsl_vector_free(chi1Vec);
-	gsl_vector_free(chi2Vec); 
-	/* Deallocate members of pop */
-	for(lpParticles = 0; lpParticles < popsize; lpParticles++){
-		particleinfo_free(&pop[lpParticles]);
-	}
+	/* Deallocate the swarm */
+	swarminfo_free(swarm);
 }
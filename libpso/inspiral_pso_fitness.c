@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
@@ -40,17 +41,21 @@ pso_fitness_function_parameters_t* pso_fitness_function_parameters_alloc(
 		exit(-1);
 	}
 
+	/* The lookup, normalization factors and whitened data are read-only, so every thread uses the same ones */
+	coherent_network_shared_t *shared = CN_shared_alloc(network, f_low, f_high);
 	for (i = 0; i < parallel_get_max_threads(); i++) {
-		params->workspace[i] = CN_workspace_alloc(
-				network_strain->num_time_samples, network, network->detector[0]->asd->len,
-				f_low, f_high);
+		params->workspace[i] = CN_workspace_alloc_shared(
+				network_strain->num_time_samples, network, network->detector[0]->asd->len, shared);
 	}
+	CN_shared_free(shared);
 
 	/* Setup the parameter structure for the pso fitness function */
 	params->f_low = f_low;
 	params->f_high = f_high;
 	params->network = network;
 	params->network_strain = network_strain;
+	params->batch = NULL;
+	params->migration = NULL;
 
 	fprintf(stderr, "Number of threads: %lu\n", parallel_get_max_threads());
 
@@ -70,9 +75,57 @@ void pso_fitness_function_parameters_free(pso_fitness_function_parameters_t *par
 	free(params->workspace);
 	params->workspace = NULL;
 
+	if (params->batch != NULL) {
+		for (i = 0; i < parallel_get_max_threads(); i++) {
+			pso_fitness_batch_free(params->batch[i]);
+		}
+		free(params->batch);
+		params->batch = NULL;
+	}
+
 	free(params);
 }
 
+pso_fitness_batch_t* pso_fitness_batch_alloc(size_t capacity, pso_fitness_function_parameters_t *params) {
+	assert(params != NULL);
+	assert(capacity > 0);
+
+	pso_fitness_batch_t *batch = (pso_fitness_batch_t*) malloc( sizeof(pso_fitness_batch_t) );
+	if (batch == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: pso_fitness_batch_alloc(). Exiting.\n");
+		exit(-1);
+	}
+
+	batch->workspace = CN_batch_workspace_alloc_shared(
+			GSL_MIN(capacity, CN_BATCH_DEFAULT_CAPACITY), params->network_strain->num_time_samples,
+			params->network, params->network->detector[0]->asd->len, params->workspace[0]->shared);
+	batch->capacity = capacity;
+	batch->valid_point = (size_t*) malloc( capacity * sizeof(size_t) );
+	batch->chirp_times = (inspiral_chirp_time_t*) malloc( capacity * sizeof(inspiral_chirp_time_t) );
+	batch->skies = (sky_t*) malloc( capacity * sizeof(sky_t) );
+	batch->values = (double*) malloc( capacity * sizeof(double) );
+	batch->indices = (int*) malloc( capacity * sizeof(int) );
+	if (batch->valid_point == NULL || batch->chirp_times == NULL || batch->skies == NULL
+			|| batch->values == NULL || batch->indices == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: pso_fitness_batch_alloc(). Exiting.\n");
+		exit(-1);
+	}
+
+	return batch;
+}
+
+void pso_fitness_batch_free(pso_fitness_batch_t *batch) {
+	assert(batch != NULL);
+
+	CN_batch_workspace_free(batch->workspace);
+	free(batch->valid_point);
+	free(batch->chirp_times);
+	free(batch->skies);
+	free(batch->values);
+	free(batch->indices);
+	free(batch);
+}
+
 double pso_fitness_function(gsl_vector *xVec, void  *inParamsPointer){
 	assert(xVec != NULL);
 	assert(inParamsPointer != NULL);
@@ -142,6 +195,66 @@ double pso_fitness_function(gsl_vector *xVec, void  *inParamsPointer){
    return fitFuncVal;
 }
 
+/* Batch version of pso_fitness_function. The valid points are evaluated together with
+   coherent_network_statistic_batch, with the batch of the calling thread, up to its capacity at a time. */
+void pso_fitness_function_batch(size_t num_points, gsl_vector **xVecs, void *inParamsPointer,
+		double *out_fitness, unsigned char *out_computed) {
+	assert(xVecs != NULL);
+	assert(inParamsPointer != NULL);
+	assert(out_fitness != NULL);
+	assert(out_computed != NULL);
+
+	struct fitFuncParams *inParams = (struct fitFuncParams *)inParamsPointer;
+	struct pso_fitness_function_parameters_s *splParams = (struct pso_fitness_function_parameters_s *)inParams->splParams;
+	assert(splParams->batch != NULL);
+
+	size_t thread_num = parallel_get_thread_num();
+	gsl_vector *realCoord = inParams->realCoord[thread_num];
+	pso_fitness_batch_t *batch = splParams->batch[thread_num];
+
+	size_t i, start, count, num_valid;
+
+	for (start = 0; start < num_points; start += count) {
+		count = GSL_MIN(batch->capacity, num_points - start);
+
+		num_valid = 0;
+		for (i = start; i < start + count; i++) {
+			if (chkstdsrchrng(xVecs[i])) {
+				s2rvector(xVecs[i],inParams->rmin,inParams->rangeVec,realCoord);
+
+				batch->skies[num_valid].ra = gsl_vector_get(realCoord, 0);
+				batch->skies[num_valid].dec = gsl_vector_get(realCoord, 1);
+				CN_template_chirp_time(splParams->f_low, gsl_vector_get(realCoord, 2), gsl_vector_get(realCoord, 3),
+						&batch->chirp_times[num_valid]);
+
+				batch->valid_point[num_valid] = i;
+				num_valid++;
+
+				out_computed[i] = 1;
+			} else {
+				out_fitness[i] = GSL_POSINF;
+				out_computed[i] = 0;
+			}
+		}
+
+		coherent_network_statistic_batch(
+				splParams->network,
+				num_valid,
+				batch->chirp_times,
+				batch->skies,
+				splParams->network_strain,
+				batch->workspace,
+				batch->values,
+				batch->indices);
+
+		/* The statistic is larger for better matches, but PSO is finding
+		   minimums, so multiply by -1.0. */
+		for (i = 0; i < num_valid; i++) {
+			out_fitness[batch->valid_point[i]] = -1.0 * batch->values[i];
+		}
+	}
+}
+
 pso_ranges_t* pso_ranges_alloc(const char *pso_settings_filename) {
 	pso_ranges_t *r = (pso_ranges_t*) malloc( sizeof(pso_ranges_t) );
 	if (r == 0) {
@@ -327,6 +440,160 @@ int pso_estimate_parameters(const char *pso_settings_filename, pso_fitness_funct
 	psoParams.rngGen = rngGen;
 	psoParams.debugDumpFile = NULL; /*fopen("ptapso_dump.txt","w"); */
 
+	/* Optionally draw the random numbers from counter-based streams keyed by the seed: taus or philox */
+	pso_rng_t *counterRng = NULL;
+	const char *pso_rng = settings_file_get_value(settings_file, "pso_rng");
+	if (pso_rng != NULL && strcmp(pso_rng, "philox") == 0) {
+		counterRng = pso_rng_alloc(seed, 0);
+	} else if (pso_rng != NULL && strcmp(pso_rng, "taus") != 0) {
+		fprintf(stderr, "Error. pso_rng in the pso settings file must be 'taus' or 'philox'. Exiting.\n");
+		exit(-1);
+	}
+	psoParams.counterRng = counterRng;
+
+	/* Exchange the best particles with the other islands, if any */
+	psoParams.migration = splParams->migration;
+
+	/* Optionally evaluate the swarm in batches: each thread evaluates its share of the particles with one call */
+	psoParams.batchFitfunc = NULL;
+	const char *batch_fitness = settings_file_get_value(settings_file, "batch_fitness");
+	if (batch_fitness != NULL && atoi(batch_fitness) != 0) {
+		if (splParams->batch == NULL) {
+			size_t num_threads = parallel_get_max_threads();
+			size_t capacity = GSL_MAX((psoParams.popsize + num_threads - 1) / num_threads, 1);
+
+			splParams->batch = (pso_fitness_batch_t**) malloc( num_threads * sizeof(pso_fitness_batch_t*) );
+			if (splParams->batch == NULL) {
+				fprintf(stderr, "Error. Unable to allocate memory: pso_estimate_parameters(). Exiting.\n");
+				exit(-1);
+			}
+			for (lpc = 0; lpc < num_threads; lpc++) {
+				splParams->batch[lpc] = pso_fitness_batch_alloc(capacity, splParams);
+			}
+		}
+		psoParams.batchFitfunc = pso_fitness_function_batch;
+	}
+
+	/* Optionally run the network statistic at a reduced rate: none, decimate or heterodyne */
+	CN_REDUCTION reduction = CN_reduction_from_string(settings_file_get_value(settings_file, "cn_reduction"));
+	for (lpc = 0; lpc < parallel_get_max_threads(); lpc++) {
+		CN_workspace_set_reduction(splParams->workspace[lpc], reduction);
+	}
+	for (lpc = 0; splParams->batch != NULL && lpc < parallel_get_max_threads(); lpc++) {
+		CN_workspace_set_reduction(splParams->batch[lpc]->workspace->workspace, reduction);
+	}
+	printf("Network statistic inverse FFT length: %lu of %lu time samples.\n",
+			splParams->workspace[0]->ifft_len, splParams->network_strain->num_time_samples);
+
+	/* Optionally use more threads inside each evaluation. They are only used if nested OpenMP parallelism
+	   is enabled, since the particles are already evaluated in parallel. */
+	const char *cn_threads = settings_file_get_value(settings_file, "cn_threads");
+	if (cn_threads != NULL) {
+		char *end;
+		long cn_num_threads = strtol(cn_threads, &end, 10);
+		if (end == cn_threads || *end != '\0' || cn_num_threads < 0) {
+			fprintf(stderr, "Error. cn_threads (%s) in the pso settings file must be an integer >= 0. Exiting.\n", cn_threads);
+			exit(-1);
+		}
+		for (lpc = 0; lpc < parallel_get_max_threads(); lpc++) {
+			CN_workspace_set_num_threads(splParams->workspace[lpc], (size_t) cn_num_threads);
+		}
+	}
+
+	/* Optionally keep the detector series of the last few chirps of each thread, so that sky positions with
+	   the same chirp times are interpolated instead of transformed. It isn't used by the batch fitness. */
+	const char *sky_cache = settings_file_get_value(settings_file, "sky_cache");
+	if (sky_cache != NULL) {
+		int sky_cache_capacity = atoi(sky_cache);
+		if (sky_cache_capacity < 0) {
+			fprintf(stderr, "Error. sky_cache (%d) in the pso settings file must be >= 0. Exiting.\n", sky_cache_capacity);
+			exit(-1);
+		}
+		for (lpc = 0; lpc < parallel_get_max_threads(); lpc++) {
+			CN_workspace_enable_sky_cache(splParams->workspace[lpc], sky_cache_capacity, CN_SKY_CACHE_DEFAULT_UPSAMPLE);
+		}
+	}
+
+	/* Optionally interpolate the antenna patterns and time delays from a table of sky positions. It is loaded
+	   from sky_table_file if that exists, otherwise it is built with sky_table_resolution (radians) and saved
+	   to sky_table_file if that is set. A loaded table coarser than sky_table_resolution is built again. */
+	const char *sky_table_file = settings_file_get_value(settings_file, "sky_table_file");
+	const char *sky_table_resolution = settings_file_get_value(settings_file, "sky_table_resolution");
+	if (sky_table_file != NULL || (sky_table_resolution != NULL && atof(sky_table_resolution) > 0.0)) {
+		detector_network_t *net = splParams->network;
+		detector_sky_table_t *sky_table = NULL;
+
+		if (sky_table_file != NULL) {
+			sky_table = Detector_Sky_Table_load(sky_table_file);
+			if (sky_table != NULL && !Detector_Sky_Table_matches(sky_table, net->num_detectors, net->detector)) {
+				fprintf(stderr, "Error. The sky table (%s) was computed for a different detector network. Exiting.\n", sky_table_file);
+				exit(-1);
+			}
+			if (sky_table != NULL && sky_table_resolution != NULL && atof(sky_table_resolution) > 0.0
+					&& !Detector_Sky_Table_has_resolution(sky_table, atof(sky_table_resolution))) {
+				printf("The sky table (%s) is coarser than sky_table_resolution (%g), building it again.\n",
+						sky_table_file, atof(sky_table_resolution));
+				Detector_Sky_Table_free(sky_table);
+				sky_table = NULL;
+			}
+		}
+		if (sky_table == NULL) {
+			if (sky_table_resolution == NULL || atof(sky_table_resolution) <= 0.0) {
+				fprintf(stderr, "Error. The sky table (%s) doesn't exist and sky_table_resolution isn't set. Exiting.\n", sky_table_file);
+				exit(-1);
+			}
+			sky_table = Detector_Sky_Table_build(net->num_detectors, net->detector, atof(sky_table_resolution));
+			if (sky_table_file != NULL) {
+				Detector_Sky_Table_save(sky_table, sky_table_file);
+			}
+		}
+
+		printf("Sky table: %lu x %lu positions, error bounds %g (u, v) and %g s (time delay).\n",
+				sky_table->num_ra, sky_table->num_dec, sky_table->error_bound_uv, sky_table->error_bound_time_delay);
+		CN_shared_set_sky_table(splParams->workspace[0]->shared, sky_table);
+	}
+
+	/* Optionally only search coalescence times from tc_window_min to tc_window_max seconds */
+	const char *tc_window_min = settings_file_get_value(settings_file, "tc_window_min");
+	const char *tc_window_max = settings_file_get_value(settings_file, "tc_window_max");
+	if (tc_window_min != NULL && tc_window_max != NULL) {
+		for (lpc = 0; lpc < parallel_get_max_threads(); lpc++) {
+			CN_workspace_set_tc_window(splParams->workspace[lpc], atof(tc_window_min), atof(tc_window_max));
+		}
+		for (lpc = 0; splParams->batch != NULL && lpc < parallel_get_max_threads(); lpc++) {
+			CN_workspace_set_tc_window(splParams->batch[lpc]->workspace->workspace, atof(tc_window_min), atof(tc_window_max));
+		}
+		printf("Network statistic tc window: %lu of %lu lags.\n",
+				splParams->workspace[0]->tc_window->len, splParams->workspace[0]->ifft_len);
+	}
+
+	/* Optionally reuse the inverse FFT buffers for the sums and the statistic: default or compact */
+	CN_LAYOUT layout = CN_layout_from_string(settings_file_get_value(settings_file, "cn_layout"));
+	for (lpc = 0; lpc < parallel_get_max_threads(); lpc++) {
+		CN_workspace_set_layout(splParams->workspace[lpc], layout);
+	}
+	for (lpc = 0; splParams->batch != NULL && lpc < parallel_get_max_threads(); lpc++) {
+		CN_batch_workspace_set_layout(splParams->batch[lpc]->workspace, layout);
+	}
+
+	/* Optionally transform in single precision: double, single, or validate to also report the deviation of single */
+	CN_PRECISION precision = CN_precision_from_string(settings_file_get_value(settings_file, "cn_precision"));
+	for (lpc = 0; lpc < parallel_get_max_threads(); lpc++) {
+		CN_workspace_set_precision(splParams->workspace[lpc], precision);
+	}
+	for (lpc = 0; splParams->batch != NULL && lpc < parallel_get_max_threads(); lpc++) {
+		CN_workspace_set_precision(splParams->batch[lpc]->workspace->workspace, precision);
+	}
+
+	/* The memory of the statistic, for sizing jobs by the number of threads */
+	printf("Network statistic memory: %.2f MB per thread (%lu threads), %.2f MB shared",
+			CN_workspace_footprint(splParams->workspace[0]) / 1048576.0, parallel_get_max_threads(),
+			CN_shared_footprint(splParams->workspace[0]->shared) / 1048576.0);
+	if (splParams->batch != NULL) {
+		printf(", %.2f MB batch per thread", CN_batch_workspace_footprint(splParams->batch[0]->workspace) / 1048576.0);
+	}
+	printf(".\n");
+
 	const char *pso_version_p = settings_file_get_value(settings_file, "pso_version");
 	char *pso_version;
 	pso_version = malloc( sizeof(char) * (strlen(pso_version_p)+1) );
@@ -340,19 +607,38 @@ int pso_estimate_parameters(const char *pso_settings_filename, pso_fitness_funct
 	printf("Closed the PSO settings file.\n");
 
 	/* Now call the desired PSO implementation */
+	double wtime_start = parallel_get_wtime();
 	if (strcmp(pso_version, "lbest")==0) {
 		lbestpso(nDim, fitfunc, inParams, callback_params, &psoParams, psoResults);
 	} else if (strcmp(pso_version, "gbest")==0) {
 		gbestpso(nDim, fitfunc, inParams, callback_params, &psoParams, psoResults);
 	} else if (strcmp(pso_version, "spso")==0) {
 		spso(nDim, fitfunc, inParams, callback_params, &psoParams, psoResults);
+	} else if (strcmp(pso_version, "async")==0) {
+		asyncpso(nDim, fitfunc, inParams, callback_params, &psoParams, psoResults);
 	} else {
-		fprintf(stderr, "Error. pso_version in the pso settings file must be 'lbest', 'gbest', or 'spso'. Exiting.\n");
+		fprintf(stderr, "Error. pso_version in the pso settings file must be 'lbest', 'gbest', 'spso', or 'async'. Exiting.\n");
 		exit(-1);
 	}
+	double wtime = parallel_get_wtime() - wtime_start;
+
+	/* The throughput, for comparing the versions with the same fitness function and threads */
+	printf("PSO (%s): %lu fitness evaluations in %.2f s wall time, %.1f evaluations per second.\n", pso_version,
+			psoResults->totalFuncEvals, wtime, psoResults->totalFuncEvals / GSL_MAX(wtime, 1.0e-9));
 
 	free(pso_version);
 
+	if (precision == CN_PRECISION_VALIDATE) {
+		double deviation = 0.0;
+		for (lpc = 0; lpc < parallel_get_max_threads(); lpc++) {
+			deviation = GSL_MAX(deviation, splParams->workspace[lpc]->precision_deviation);
+		}
+		for (lpc = 0; splParams->batch != NULL && lpc < parallel_get_max_threads(); lpc++) {
+			deviation = GSL_MAX(deviation, splParams->batch[lpc]->workspace->workspace->precision_deviation);
+		}
+		printf("Network statistic single precision max relative deviation: %g\n", deviation);
+	}
+
 	return_data_to_pso_results( pso_ranges, psoResults, result );
 
 	/* Free allocated memory */
@@ -360,6 +646,9 @@ int pso_estimate_parameters(const char *pso_settings_filename, pso_fitness_funct
 	ffparam_free(inParams);
 	returnData_free(psoResults);
 	gsl_rng_free(rngGen);
+	if (counterRng != NULL) {
+		pso_rng_free(counterRng);
+	}
 
 	return 0;
 }
@@ -35,12 +35,32 @@ typedef struct pso_result_s {
 
 } pso_result_t;
 
+/* The batch workspace and the scratch of pso_fitness_function_batch for one thread. They are allocated once,
+   for up to capacity points per call of coherent_network_statistic_batch. */
+typedef struct pso_fitness_batch_s {
+	coherent_network_batch_workspace_t *workspace;
+	size_t capacity;
+	size_t *valid_point;
+	inspiral_chirp_time_t *chirp_times;
+	sky_t *skies;
+	double *values;
+	int *indices;
+} pso_fitness_batch_t;
+
 typedef struct pso_fitness_function_parameters_s {
 	double f_low;
 	double f_high;
 	detector_network_t *network;
 	network_strain_half_fft_t *network_strain;
 	coherent_network_workspace_t **workspace;
+
+	/* Used by pso_fitness_function_batch, one per thread like workspace. It is allocated by
+	   pso_estimate_parameters when batch_fitness is enabled in the PSO settings, otherwise it is NULL. */
+	pso_fitness_batch_t **batch;
+
+	/* Optional island model migration used by pso_estimate_parameters, e.g. between MPI ranks. It is NULL,
+	   unless set by the caller, if the swarm searches alone. */
+	const pso_migration_t *migration;
 } pso_fitness_function_parameters_t;
 
 typedef struct pso_ranges_s {
@@ -55,8 +75,15 @@ pso_fitness_function_parameters_t* pso_fitness_function_parameters_alloc(
 
 void pso_fitness_function_parameters_free(pso_fitness_function_parameters_t *params);
 
+pso_fitness_batch_t* pso_fitness_batch_alloc(size_t capacity, pso_fitness_function_parameters_t *params);
+
+void pso_fitness_batch_free(pso_fitness_batch_t *batch);
+
 double pso_fitness_function(gsl_vector *xVec, void  *inParamsPointer);
 
+void pso_fitness_function_batch(size_t num_points, gsl_vector **xVecs, void *inParamsPointer,
+		double *out_fitness, unsigned char *out_computed);
+
 int pso_estimate_parameters(const char *pso_settings_file, pso_fitness_function_parameters_t *splParams, current_result_callback_params_t *callback_params, gslseed_t seed, pso_result_t* result);
 
 pso_ranges_t* pso_ranges_alloc(const char *pso_settings_filename);
@@ -11,6 +11,8 @@
 	#include "config.h"
 #endif
 
+#include <time.h>
+
 #ifdef HAVE_OPENMP
 	#include "omp.h"
 
@@ -22,6 +24,14 @@ size_t parallel_get_max_threads() {
 	return omp_get_max_threads();
 }
 
+void parallel_set_num_threads(size_t num_threads) {
+	omp_set_num_threads(num_threads);
+}
+
+double parallel_get_wtime() {
+	return omp_get_wtime();
+}
+
 #else
 
 size_t parallel_get_thread_num() {
@@ -32,4 +42,14 @@ size_t parallel_get_max_threads() {
 	return 1;
 }
 
+void parallel_set_num_threads(size_t num_threads) {
+	(void) num_threads;
+}
+
+double parallel_get_wtime() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + 1.0e-9 * t.tv_nsec;
+}
+
 #endif
@@ -21,6 +21,12 @@ extern "C" {
 size_t parallel_get_thread_num();
 size_t parallel_get_max_threads();
 
+/* Sets the number of threads of the following parallel regions. Without OpenMP there is only one. */
+void parallel_set_num_threads(size_t num_threads);
+
+/* Wall clock time (seconds) from an arbitrary start, for timing parallel code, where clock() adds up the threads. */
+double parallel_get_wtime();
+
 #if defined (__cplusplus)
 }
 #endif
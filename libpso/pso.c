@@ -5,8 +5,11 @@
  *      Author: marcnormandin
  */
 
+#include <math.h>
 #include <stdio.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include <gsl/gsl_multimin.h>
 #include <gsl/gsl_vector.h>
 #include <gsl/gsl_matrix.h>
@@ -30,51 +33,359 @@ double dummyfitfunc(const gsl_vector *xVec, void *dffParams){
 	return funcVal;
 }
 
-/*! Initializer of particle position, velocity, and other properties. */
-void initPsoParticles(struct particleInfo *p, size_t nDim, gsl_rng *rngGen){
+/*! Allocates num_values doubles aligned to PSO_SWARM_ALIGNMENT bytes. Free with free(). */
+double * pso_aligned_alloc(size_t num_values){
+	void *p = NULL;
+
+	if (posix_memalign(&p, PSO_SWARM_ALIGNMENT, GSL_MAX(num_values, 1) * sizeof(double)) != 0) {
+		fprintf(stderr, "Error. Unable to allocate memory: pso_aligned_alloc(). Exiting.\n");
+		exit(-1);
+	}
+	return (double *) p;
+}
+
+/*! Allocate storage for a swarm of popsize particles in nDim dimensions */
+struct swarmInfo * swarminfo_alloc(size_t popsize, size_t nDim){
+	size_t lpParticles;
+	struct swarmInfo *s = (struct swarmInfo *) malloc(sizeof(struct swarmInfo));
+	if (s == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: swarminfo_alloc(). Exiting.\n");
+		exit(-1);
+	}
+
+	s->nDim = nDim;
+	s->popsize = popsize;
+	s->partCoord = pso_aligned_alloc(popsize * nDim); /* Current coordinates */
+	s->partVel = pso_aligned_alloc(popsize * nDim);  /* Current velocity */
+	s->partPbest = pso_aligned_alloc(popsize * nDim); /* Coordinates of pbest */
+	s->partLocalBest = pso_aligned_alloc(popsize * nDim); /* Coordinates of neighborhood best */
+	s->chi1 = pso_aligned_alloc(popsize * nDim);
+	s->chi2 = pso_aligned_alloc(popsize * nDim);
+	s->partSnrPbest = pso_aligned_alloc(popsize);
+	s->partSnrCurr = pso_aligned_alloc(popsize);
+	s->partSnrLbest = pso_aligned_alloc(popsize);
+	s->partInertia = 0;
+
+	s->partFitEvals = (size_t *) malloc(GSL_MAX(popsize, 1) * sizeof(size_t));
+	s->partFitOK = (unsigned char *) malloc(GSL_MAX(popsize, 1) * sizeof(unsigned char));
+	s->partCoordViews = (gsl_vector_view *) malloc(GSL_MAX(popsize, 1) * sizeof(gsl_vector_view));
+	s->partCoordVecs = (gsl_vector **) malloc(GSL_MAX(popsize, 1) * sizeof(gsl_vector *));
+	if (s->partFitEvals == NULL || s->partFitOK == NULL || s->partCoordViews == NULL || s->partCoordVecs == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: swarminfo_alloc(). Exiting.\n");
+		exit(-1);
+	}
+
+	for (lpParticles = 0; lpParticles < popsize; lpParticles++){
+		s->partCoordViews[lpParticles] = gsl_vector_view_array(s->partCoord + lpParticles*nDim, nDim);
+		s->partCoordVecs[lpParticles] = &s->partCoordViews[lpParticles].vector;
+	}
+
+	return s;
+}
+
+/*! Free the storage assigned to a swarm */
+void swarminfo_free(struct swarmInfo *s){
+	free(s->partCoord);
+	free(s->partVel);
+	free(s->partPbest);
+	free(s->partLocalBest);
+	free(s->chi1);
+	free(s->chi2);
+	free(s->partSnrPbest);
+	free(s->partSnrCurr);
+	free(s->partSnrLbest);
+	free(s->partFitEvals);
+	free(s->partFitOK);
+	free(s->partCoordViews);
+	free(s->partCoordVecs);
+	free(s);
+}
+
+/*! Initializer of particle positions, velocities, and other properties. The random numbers are drawn
+    particle by particle, the coordinates and then the velocity of each. */
+void initPsoSwarm(struct swarmInfo *s, gsl_rng *rngGen){
 
 	double rngNum;
-	size_t lpCoord;
+	size_t lpParticles, lpCoord;
+	const size_t nDim = s->nDim;
+
+	for (lpParticles = 0; lpParticles < s->popsize; lpParticles++){
+		double *partCoord = s->partCoord + lpParticles*nDim;
+		double *partVel = s->partVel + lpParticles*nDim;
+
+		for (lpCoord = 0; lpCoord < nDim; lpCoord++){
+			rngNum = gsl_rng_uniform(rngGen);
+			partCoord[lpCoord] = rngNum;
+		}
+
+		for (lpCoord = 0; lpCoord < nDim; lpCoord++){
+			rngNum = gsl_rng_uniform(rngGen);
+			partVel[lpCoord] = - partCoord[lpCoord] + rngNum;
+		}
+
+		s->partSnrPbest[lpParticles] = GSL_POSINF;
+		s->partSnrCurr[lpParticles] = 0;
+		s->partSnrLbest[lpParticles] = GSL_POSINF;
+		s->partFitEvals[lpParticles] = 0;
+		s->partFitOK[lpParticles] = 0;
+	}
+
+	memcpy(s->partPbest, s->partCoord, s->popsize * nDim * sizeof(double));
+	s->partInertia = 0;
+}
+
+/*! Like initPsoSwarm, with the counter-based random numbers of iteration 0. */
+void swarminfo_init_counter(struct swarmInfo *s, const pso_rng_t *rng){
+
+	size_t lpParticles, lpCoord;
+	const size_t nDim = s->nDim;
+
+#ifdef HAVE_OPENMP
+	#pragma omp parallel for private(lpCoord) schedule(static) if(s->popsize * nDim >= PSO_PARALLEL_MIN_VALUES)
+#endif
+	for (lpParticles = 0; lpParticles < s->popsize; lpParticles++){
+		double *partCoord = s->partCoord + lpParticles*nDim;
+		double *partVel = s->partVel + lpParticles*nDim;
+
+		for (lpCoord = 0; lpCoord < nDim; lpCoord++){
+			partCoord[lpCoord] = pso_rng_uniform(rng, 0, lpParticles, PSO_RNG_INIT_COORD, lpCoord);
+			partVel[lpCoord] = - partCoord[lpCoord] + pso_rng_uniform(rng, 0, lpParticles, PSO_RNG_INIT_VEL, lpCoord);
+		}
+
+		s->partSnrPbest[lpParticles] = GSL_POSINF;
+		s->partSnrCurr[lpParticles] = 0;
+		s->partSnrLbest[lpParticles] = GSL_POSINF;
+		s->partFitEvals[lpParticles] = 0;
+		s->partFitOK[lpParticles] = 0;
+	}
+
+	memcpy(s->partPbest, s->partCoord, s->popsize * nDim * sizeof(double));
+	s->partInertia = 0;
+}
+
+/*! Evaluates the fitness of every particle, with psoParams->batchFitfunc if it is set and otherwise with
+    fitfunc, then updates the fitness evaluation counts and pbest of each particle.
+
+    With OpenMP the particles are handed out one at a time to the threads (the cost of an evaluation varies
+    a lot, e.g. with the chirp length), and each thread only writes the fitness and status of the particles
+    it evaluated. The counts and pbest are then updated serially in particle order, so the results are the
+    same for any number of threads. fitfunc must be safe to call from several threads, and report whether
+    the fitness was computed in fitEvalFlag[parallel_get_thread_num()] of its struct fitFuncParams.
+*/
+void evalPsoSwarm(struct swarmInfo *s, fitness_function_ptr fitfunc, void *ffParams,
+		struct psoParamStruct *psoParams){
+
+	if (psoParams->batchFitfunc != NULL){
+		evalPsoSwarmBatch(s, ffParams, psoParams);
+		return;
+	}
+
+	size_t lpParticles;
+	const size_t popsize = s->popsize;
+	struct fitFuncParams *fp = (struct fitFuncParams *) ffParams;
+
+#ifdef HAVE_OPENMP
+	#pragma omp parallel for schedule(dynamic, 1)
+#endif
+	for (lpParticles = 0; lpParticles < popsize; lpParticles++){
+		s->partSnrCurr[lpParticles] = fitfunc(s->partCoordVecs[lpParticles], ffParams);
+		/* The flag is read by the thread that set it, before its next evaluation */
+		s->partFitOK[lpParticles] = fp->fitEvalFlag[parallel_get_thread_num()];
+	}
+
+	swarminfo_update_pbest(s);
+}
+
+/*! Evaluates the fitness of every particle with psoParams->batchFitfunc, one call per thread for a contiguous
+    chunk of the swarm, then updates the fitness evaluation counts and pbest of each particle. */
+void evalPsoSwarmBatch(struct swarmInfo *s, void *ffParams, struct psoParamStruct *psoParams){
+
+	size_t lpChunks;
+	const size_t popsize = s->popsize;
+	const size_t numChunks = GSL_MAX(GSL_MIN(parallel_get_max_threads(), popsize), 1);
+
+#ifdef HAVE_OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (lpChunks = 0; lpChunks < numChunks; lpChunks++){
+		size_t start = lpChunks * popsize / numChunks;
+		size_t end = (lpChunks + 1) * popsize / numChunks;
+		psoParams->batchFitfunc(end - start, s->partCoordVecs + start, ffParams, s->partSnrCurr + start,
+				s->partFitOK + start);
+	}
+
+	swarminfo_update_pbest(s);
+}
+
+/*! Counts the fitness evaluations of the particles whose last fitness was computed and updates pbest of
+    the particles whose current fitness is better. */
+void swarminfo_update_pbest(struct swarmInfo *s){
+
+	size_t lpParticles;
+	const size_t nDim = s->nDim;
+
+	for (lpParticles = 0; lpParticles < s->popsize; lpParticles++){
+		if (s->partFitOK[lpParticles]){
+			s->partFitEvals[lpParticles] += 1;
+		}
+		/* Update pbest fitness and coordinates if needed */
+		if (s->partSnrPbest[lpParticles] > s->partSnrCurr[lpParticles]){
+			s->partSnrPbest[lpParticles] = s->partSnrCurr[lpParticles];
+			memcpy(s->partPbest + lpParticles*nDim, s->partCoord + lpParticles*nDim, nDim * sizeof(double));
+		}
+	}
+}
 
-	particleinfo_alloc(p,nDim);
+/*! Index of the particle with the smallest current fitness, the first one if there are several, like
+    gsl_vector_min_index. */
+size_t swarminfo_best_particle(const struct swarmInfo *s){
+	size_t lpParticles;
+	size_t best = 0;
+	double bestFit = s->partSnrCurr[0];
 
-	for (lpCoord = 0; lpCoord < nDim; lpCoord++){
-		rngNum = gsl_rng_uniform(rngGen);
-		gsl_vector_set(p->partCoord,lpCoord,rngNum);
+	for (lpParticles = 0; lpParticles < s->popsize; lpParticles++){
+		double x = s->partSnrCurr[lpParticles];
+		if (x < bestFit){
+			bestFit = x;
+			best = lpParticles;
+		}
+		if (isnan(x)){
+			return lpParticles;
+		}
+	}
+	return best;
+}
+
+/*! Island model migration, if the iteration is a multiple of migration->interval: sends the particle with the
+    best pbest to the other islands, and puts each immigrant that is better than the worst pbest in place of
+    that particle (coordinates, current fitness and pbest), so its neighbors see it in the next lbest or gbest
+    update. The velocity of the particle is kept. Does nothing if migration is NULL. */
+void swarminfo_migrate(struct swarmInfo *s, const pso_migration_t *migration, size_t iteration){
+	size_t lpParticles, lpImmigrants, numImmigrants;
+	const size_t nDim = s->nDim;
+
+	if (migration == NULL || migration->interval == 0 || iteration % migration->interval != 0 || s->popsize == 0){
+		return;
 	}
 
-	for (lpCoord = 0; lpCoord < nDim; lpCoord++){
-		rngNum = gsl_rng_uniform(rngGen);
-		rngNum = - gsl_vector_get(p->partCoord,lpCoord)
-			     + rngNum;
-		gsl_vector_set(p->partVel,lpCoord,rngNum);
+	size_t best = 0;
+	for (lpParticles = 1; lpParticles < s->popsize; lpParticles++){
+		if (s->partSnrPbest[lpParticles] < s->partSnrPbest[best]){
+			best = lpParticles;
+		}
 	}
 
-	if(gsl_vector_memcpy(p->partPbest, p->partCoord))
-		printf("Error in copying vectors\n");
+	double *immigrantCoords = pso_aligned_alloc(migration->maxImmigrants * nDim);
+	double *immigrantFitVals = pso_aligned_alloc(migration->maxImmigrants);
 
-	p->partSnrPbest = GSL_POSINF;
-	p->partSnrCurr = 0;
-	p->partSnrLbest = GSL_POSINF;
-	p->partInertia = 0;
-	p->partFitEvals = 0;
+	numImmigrants = migration->exchange(migration->params, nDim, s->partPbest + best*nDim, s->partSnrPbest[best],
+			migration->maxImmigrants, immigrantCoords, immigrantFitVals);
+
+	for (lpImmigrants = 0; lpImmigrants < GSL_MIN(numImmigrants, migration->maxImmigrants); lpImmigrants++){
+		size_t worst = 0;
+		for (lpParticles = 1; lpParticles < s->popsize; lpParticles++){
+			if (s->partSnrPbest[lpParticles] > s->partSnrPbest[worst]){
+				worst = lpParticles;
+			}
+		}
+		if (!(immigrantFitVals[lpImmigrants] < s->partSnrPbest[worst])){
+			continue;
+		}
+
+		memcpy(s->partCoord + worst*nDim, immigrantCoords + lpImmigrants*nDim, nDim * sizeof(double));
+		memcpy(s->partPbest + worst*nDim, immigrantCoords + lpImmigrants*nDim, nDim * sizeof(double));
+		s->partSnrCurr[worst] = immigrantFitVals[lpImmigrants];
+		s->partSnrPbest[worst] = immigrantFitVals[lpImmigrants];
+	}
+
+	free(immigrantCoords);
+	free(immigrantFitVals);
 }
 
+/*! Draws the random weights chi1 and chi2 of the velocity update, in the same order as they were drawn one
+    particle at a time: the nDim values of chi1 and then of chi2 for each particle. */
+void swarminfo_draw_weights(struct swarmInfo *s, gsl_rng *rngGen){
+	size_t lpParticles, lpCoord;
+	const size_t nDim = s->nDim;
 
-/*! Allocate storage for members of particleInfo structure */
-void particleinfo_alloc(struct particleInfo *p, size_t nDim){
-	p->partCoord = gsl_vector_alloc(nDim); /* Current coordinates */
-	p->partVel = gsl_vector_alloc(nDim);  /* Current velocity */
-	p->partPbest = gsl_vector_alloc(nDim); /* Coordinates of pbest */
-	p->partLocalBest = gsl_vector_alloc(nDim); /* Coordinates of neighborhood best */
+	for (lpParticles = 0; lpParticles < s->popsize; lpParticles++){
+		for (lpCoord = 0; lpCoord < nDim; lpCoord++){
+			s->chi1[lpParticles*nDim + lpCoord] = gsl_rng_uniform(rngGen);
+		}
+		for (lpCoord = 0; lpCoord < nDim; lpCoord++){
+			s->chi2[lpParticles*nDim + lpCoord] = gsl_rng_uniform(rngGen);
+		}
+	}
 }
 
-/*! Free the storage assigned to members of particleInfo structure */
-void particleinfo_free(struct particleInfo *p){
-	gsl_vector_free(p->partCoord);
-	gsl_vector_free(p->partVel);
-	gsl_vector_free(p->partPbest);
-	gsl_vector_free(p->partLocalBest);
+/*! Like swarminfo_draw_weights, with the counter-based random numbers of the iteration. */
+void swarminfo_draw_weights_counter(struct swarmInfo *s, const pso_rng_t *rng, size_t iteration){
+	size_t lpParticles, lpCoord;
+	const size_t nDim = s->nDim;
+
+#ifdef HAVE_OPENMP
+	#pragma omp parallel for private(lpCoord) schedule(static) if(s->popsize * nDim >= PSO_PARALLEL_MIN_VALUES)
+#endif
+	for (lpParticles = 0; lpParticles < s->popsize; lpParticles++){
+		for (lpCoord = 0; lpCoord < nDim; lpCoord++){
+			s->chi1[lpParticles*nDim + lpCoord] = pso_rng_uniform(rng, iteration, lpParticles, PSO_RNG_CHI1, lpCoord);
+			s->chi2[lpParticles*nDim + lpCoord] = pso_rng_uniform(rng, iteration, lpParticles, PSO_RNG_CHI2, lpCoord);
+		}
+	}
+}
+
+/*! Velocity update of every particle with the current inertia and random weights, velocity clamping
+    and position update, as one loop over the whole swarm:
+        partVel = partInertia*partVel + c1*(partPbest - partCoord)*chi1 + c2*(partLocalBest - partCoord)*chi2
+        partVel is limited to [-max_velocity, max_velocity]
+        partCoord = partCoord + partVel
+    The operations are done in the same order as with the gsl_vector functions, so the results are identical.
+*/
+void swarminfo_velocity_update(struct swarmInfo *s, double c1, double c2, double max_velocity){
+	size_t lpc;
+	const size_t len = s->popsize * s->nDim;
+	const double inertia = s->partInertia;
+	double * restrict partCoord = s->partCoord;
+	double * restrict partVel = s->partVel;
+	const double * restrict partPbest = s->partPbest;
+	const double * restrict partLocalBest = s->partLocalBest;
+	const double * restrict chi1 = s->chi1;
+	const double * restrict chi2 = s->chi2;
+
+	for (lpc = 0; lpc < len; lpc++){
+		double accPbest = (partPbest[lpc] - partCoord[lpc]) * chi1[lpc] * c1;
+		double accLbest = (partLocalBest[lpc] - partCoord[lpc]) * chi2[lpc] * c2;
+		double vel = partVel[lpc] * inertia + accPbest + accLbest;
+
+		vel = (vel < -max_velocity) ? -max_velocity : ((vel > max_velocity) ? max_velocity : vel);
+
+		partVel[lpc] = vel;
+		partCoord[lpc] += vel;
+	}
+}
+
+/*! Like swarminfo_velocity_update for one particle, with its own inertia weight. */
+void swarminfo_particle_velocity_update(struct swarmInfo *s, size_t particle, double inertia, double c1, double c2,
+		double max_velocity){
+	size_t lpc;
+	const size_t nDim = s->nDim;
+	double * restrict partCoord = s->partCoord + particle*nDim;
+	double * restrict partVel = s->partVel + particle*nDim;
+	const double * restrict partPbest = s->partPbest + particle*nDim;
+	const double * restrict partLocalBest = s->partLocalBest + particle*nDim;
+	const double * restrict chi1 = s->chi1 + particle*nDim;
+	const double * restrict chi2 = s->chi2 + particle*nDim;
+
+	for (lpc = 0; lpc < nDim; lpc++){
+		double accPbest = (partPbest[lpc] - partCoord[lpc]) * chi1[lpc] * c1;
+		double accLbest = (partLocalBest[lpc] - partCoord[lpc]) * chi2[lpc] * c2;
+		double vel = partVel[lpc] * inertia + accPbest + accLbest;
+
+		vel = (vel < -max_velocity) ? -max_velocity : ((vel > max_velocity) ? max_velocity : vel);
+
+		partVel[lpc] = vel;
+		partCoord[lpc] += vel;
+	}
 }
 
 /*! Allocate storage for returnData struct members */
@@ -92,88 +403,54 @@ void returnData_free(struct returnData *psoResults){
 }
 
 
-/*! Dump information stored in particleInfo struct */
-void particleinfo_fwrite(FILE *outF, struct particleInfo *p){
+/*! Dump information stored in swarmInfo struct for one particle */
+void swarminfo_fwrite(FILE *outF, struct swarmInfo *s, size_t particle){
 
-	size_t nDim = p->partCoord->size;
+	size_t nDim = s->nDim;
 	size_t lpc;
 
 	fprintf(outF,"Particle locations in standardized coordinates\n");
 	for (lpc = 0; lpc < nDim; lpc++){
-		fprintf(outF,"%f ",gsl_vector_get(p->partCoord,lpc));
+		fprintf(outF,"%f ",s->partCoord[particle*nDim + lpc]);
 	}
 	fprintf(outF,"\n");
 	fprintf(outF,"Particle velocities in standardized coordinates\n");
 	for (lpc = 0; lpc < nDim; lpc++){
-		fprintf(outF,"%f ",gsl_vector_get(p->partVel,lpc));
+		fprintf(outF,"%f ",s->partVel[particle*nDim + lpc]);
 	}
 	fprintf(outF,"\n -------- \n");
 }
 
-/*! Dump particleInfo struct array information as a matrix
+/*! Dump swarmInfo struct information as a matrix
 with all information pertaining to one particle in a row.
 */
-void particleInfoDump(FILE *outF, struct particleInfo *p, size_t popsize){
-	if (outF == NULL) {
-		return;
-	}
-
-	size_t nDim = p[0].partCoord->size;
-	size_t lpParticles, lpCoord;
-
-	for (lpParticles = 0; lpParticles < popsize; lpParticles++){
-		for(lpCoord = 0; lpCoord < nDim; lpCoord++){
-			fprintf(outF,"%lf ",gsl_vector_get(p[lpParticles].partCoord,lpCoord));
-		}
-		for(lpCoord = 0; lpCoord < nDim; lpCoord++){
-			fprintf(outF,"%lf ",gsl_vector_get(p[lpParticles].partVel,lpCoord));
-		}
-		for(lpCoord = 0; lpCoord < nDim; lpCoord++){
-			fprintf(outF,"%lf ",gsl_vector_get(p[lpParticles].partPbest,lpCoord));
-		}
-		fprintf(outF,"%lf ",p[lpParticles].partSnrPbest);
-		fprintf(outF,"%lf ",p[lpParticles].partSnrCurr);
-		fprintf(outF,"%lf ",p[lpParticles].partSnrLbest);
-		fprintf(outF,"%lf ",p[lpParticles].partInertia);
-		for(lpCoord = 0; lpCoord < nDim; lpCoord++){
-			fprintf(outF,"%lf ",gsl_vector_get(p[lpParticles].partLocalBest,lpCoord));
-		}
-		fprintf(outF,"X ");
-		fprintf(outF,"%zu ",p[lpParticles].partFitEvals);
-		fprintf(outF,"\n");
-	}
-}
-
-/*! Write the current global best information to file.
-*/
-void particleGBestWriteToFile(FILE *outF, struct particleInfo *p, size_t popsize){
+void swarmInfoDump(FILE *outF, struct swarmInfo *s){
 	if (outF == NULL) {
 		return;
 	}
 
-	size_t nDim = p[0].partCoord->size;
+	size_t nDim = s->nDim;
 	size_t lpParticles, lpCoord;
 
-	for (lpParticles = 0; lpParticles < popsize; lpParticles++){
+	for (lpParticles = 0; lpParticles < s->popsize; lpParticles++){
 		for(lpCoord = 0; lpCoord < nDim; lpCoord++){
-			fprintf(outF,"%lf ",gsl_vector_get(p[lpParticles].partCoord,lpCoord));
+			fprintf(outF,"%lf ",s->partCoord[lpParticles*nDim + lpCoord]);
 		}
 		for(lpCoord = 0; lpCoord < nDim; lpCoord++){
-			fprintf(outF,"%lf ",gsl_vector_get(p[lpParticles].partVel,lpCoord));
+			fprintf(outF,"%lf ",s->partVel[lpParticles*nDim + lpCoord]);
 		}
 		for(lpCoord = 0; lpCoord < nDim; lpCoord++){
-			fprintf(outF,"%lf ",gsl_vector_get(p[lpParticles].partPbest,lpCoord));
+			fprintf(outF,"%lf ",s->partPbest[lpParticles*nDim + lpCoord]);
 		}
-		fprintf(outF,"%lf ",p[lpParticles].partSnrPbest);
-		fprintf(outF,"%lf ",p[lpParticles].partSnrCurr);
-		fprintf(outF,"%lf ",p[lpParticles].partSnrLbest);
-		fprintf(outF,"%lf ",p[lpParticles].partInertia);
+		fprintf(outF,"%lf ",s->partSnrPbest[lpParticles]);
+		fprintf(outF,"%lf ",s->partSnrCurr[lpParticles]);
+		fprintf(outF,"%lf ",s->partSnrLbest[lpParticles]);
+		fprintf(outF,"%lf ",s->partInertia);
 		for(lpCoord = 0; lpCoord < nDim; lpCoord++){
-			fprintf(outF,"%lf ",gsl_vector_get(p[lpParticles].partLocalBest,lpCoord));
+			fprintf(outF,"%lf ",s->partLocalBest[lpParticles*nDim + lpCoord]);
 		}
 		fprintf(outF,"X ");
-		fprintf(outF,"%zu ",p[lpParticles].partFitEvals);
+		fprintf(outF,"%zu ",s->partFitEvals[lpParticles]);
 		fprintf(outF,"\n");
 	}
 }
-
@@ -4,6 +4,8 @@
 #include <gsl/gsl_vector.h>
 #include <gsl/gsl_rng.h>
 
+#include "pso_rng.h"
+
 #if defined (__cplusplus)
 extern "C" {
 #endif
@@ -19,6 +21,10 @@ typedef struct returnData {
 
 typedef double (*fitness_function_ptr)(gsl_vector *, void *);
 
+/* Evaluates the fitness of several points in one call: (number of points, points, fitness function parameters,
+   output fitness values, output flags that are set to 1 if the fitness was actually computed, else 0). */
+typedef void (*fitness_function_batch_ptr)(size_t, gsl_vector **, void *, double *, unsigned char *);
+
 /* This called every N iterations with the current best results. */
 typedef void (*current_result_function_ptr)(void* callback_params, returnData_t *);
 
@@ -27,6 +33,20 @@ typedef void (*current_result_function_ptr)(void* callback_params, returnData_t
 \brief Header file for \ref ptapso.c
 */
 
+/* Exchanges the best particles of swarms (islands) that search the same fitness function, e.g. one on each
+   MPI rank: (migration parameters, number of dimensions, coordinates and fitness of this island's emigrant,
+   max number of immigrants, output coordinates (one row of nDim each) and fitness of the immigrants).
+   Returns the number of immigrants, that may be 0 if none have arrived yet. */
+typedef size_t (*migration_function_ptr)(void *, size_t, const double *, double, size_t, double *, double *);
+
+/*! Island model migration of \ref lbestpso, \ref gbestpso and \ref spso. */
+typedef struct pso_migration_s {
+	migration_function_ptr exchange; /*!< Sends the emigrant and receives the immigrants */
+	void *params; /*!< Parameters of exchange, e.g. the MPI communicator */
+	size_t interval; /*!< Number of iterations between migrations */
+	size_t maxImmigrants; /*!< Max number of immigrants of a migration */
+} pso_migration_t;
+
 /*! \brief PSO parameter structure 
 
 Notes: 
@@ -57,23 +77,56 @@ struct psoParamStruct {
 	*/
 	double locMinStpSz;
 	gsl_rng *rngGen; /*!< Pointer to GSL random number generator */
+	/*! Optional counter-based random numbers. If not NULL, they are used instead of rngGen, so the
+	   random numbers of each particle don't depend on the order they are drawn in, and they are
+	   drawn in parallel.
+	*/
+	const pso_rng_t *counterRng;
 	/*! Pointer to ascii file where to dump info. Set to NULL if not dumping. */
 	FILE *debugDumpFile;
+	/*! Optional batch version of the fitness function. If not NULL, it is used
+	   to evaluate the particles of an iteration, with one call per thread for its
+	   contiguous chunk of the swarm, so it must be thread safe like the fitness
+	   function. The local minimizer still uses the single point fitness function.
+	*/
+	fitness_function_batch_ptr batchFitfunc;
+	/*! Optional island model. If not NULL, every migration->interval iterations the best pbest of the swarm
+	   is sent to the other islands, and the immigrants replace the particles with the worst pbest.
+	*/
+	const pso_migration_t *migration;
 };
 
 
 
-/*! Struct to contain particle information (instead of the plain matrix used in the Matlab code). */
-struct particleInfo{
-	gsl_vector *partCoord; /*!< Current coordinates */
-	gsl_vector *partVel;  /*!<  Current velocity */
-	gsl_vector *partPbest; /*!<  Coordinates of pbest */
-	gsl_vector *partLocalBest; /*!<  Coordinates of neighborhood best */
-	double partSnrPbest; /*!<  pbest fitness value */
-	double partSnrCurr;  /*!<  Current fitness value */
-	double partSnrLbest; /*!<  Best fitness in neighborhood */
-	double partInertia;  /*!<  Current inertia weight */
-	size_t partFitEvals; /*!<  Number of fitness function evaluations */
+/*! Alignment (bytes) of the swarm's arrays: a cache line and an AVX-512 vector. */
+#define PSO_SWARM_ALIGNMENT 64
+
+/*! Smallest number of values (popsize*nDim) for which the random numbers are drawn in parallel. */
+#define PSO_PARALLEL_MIN_VALUES 4096
+
+/*! Struct to contain the information of every particle of a swarm (instead of the plain matrix used in the
+   Matlab code). Each array holds the values of all of the particles one after another, e.g. the coordinates of
+   particle k are partCoord[k*nDim] to partCoord[(k+1)*nDim - 1], so the dynamical equations are single loops
+   over popsize*nDim values. The arrays are aligned to PSO_SWARM_ALIGNMENT bytes.
+*/
+struct swarmInfo{
+	size_t nDim; /*!< Number of search dimensions */
+	size_t popsize; /*!< Number of particles */
+	double *partCoord; /*!< Current coordinates */
+	double *partVel;  /*!<  Current velocity */
+	double *partPbest; /*!<  Coordinates of pbest */
+	double *partLocalBest; /*!<  Coordinates of neighborhood best */
+	double *partSnrPbest; /*!<  pbest fitness value, one per particle */
+	double *partSnrCurr;  /*!<  Current fitness value, one per particle */
+	double *partSnrLbest; /*!<  Best fitness in neighborhood, one per particle */
+	size_t *partFitEvals; /*!<  Number of fitness function evaluations, one per particle */
+	unsigned char *partFitOK; /*!<  1 if the last fitness of the particle was actually computed, else 0 */
+	double partInertia;  /*!<  Current inertia weight, the same for every particle */
+	double *chi1; /*!< Random weights of the acceleration to pbest */
+	double *chi2; /*!< Random weights of the acceleration to the neighborhood best */
+	/*! The coordinates of each particle as a gsl_vector, for the fitness functions */
+	gsl_vector_view *partCoordViews;
+	gsl_vector **partCoordVecs;
 };
 
 /*! Struct to allow fitness functions without a const gsl_vector * input
@@ -116,19 +169,48 @@ void spso(size_t nDim, /*!< Number of search dimensions */
             struct psoParamStruct *psoParams, /*!< PSO parameter structure */
             struct returnData *psoResults /*!< Output structure */);
 
-void initPsoParticles(struct particleInfo *, size_t , gsl_rng *);
+void asyncpso(size_t nDim, /*!< Number of search dimensions */
+            fitness_function_ptr fitfunc, /*!< Pointer to Fitness function */
+            void *ffParams, /*!< Fitness function parameter structure */
+            current_result_callback_params_t *, /* Pointer to callback function parameter structure */
+            struct psoParamStruct *psoParams, /*!< PSO parameter structure */
+            struct returnData *psoResults /*!< Output structure */);
+
+double * pso_aligned_alloc(size_t);
+
+struct swarmInfo * swarminfo_alloc(size_t, size_t);
+
+void swarminfo_free(struct swarmInfo *);
+
+void initPsoSwarm(struct swarmInfo *, gsl_rng *);
+
+void swarminfo_init_counter(struct swarmInfo *, const pso_rng_t *);
+
+void evalPsoSwarm(struct swarmInfo *, fitness_function_ptr, void *, struct psoParamStruct *);
+
+void evalPsoSwarmBatch(struct swarmInfo *, void *, struct psoParamStruct *);
+
+void swarminfo_update_pbest(struct swarmInfo *);
+
+size_t swarminfo_best_particle(const struct swarmInfo *);
+
+void swarminfo_migrate(struct swarmInfo *, const pso_migration_t *, size_t);
+
+void swarminfo_draw_weights(struct swarmInfo *, gsl_rng *);
+
+void swarminfo_draw_weights_counter(struct swarmInfo *, const pso_rng_t *, size_t);
 
-void particleinfo_alloc(struct particleInfo *, size_t);
+void swarminfo_velocity_update(struct swarmInfo *, double, double, double);
 
-void particleinfo_free(struct particleInfo *);
+void swarminfo_particle_velocity_update(struct swarmInfo *, size_t, double, double, double, double);
 
 struct returnData * returnData_alloc(size_t );
 
 void returnData_free(struct returnData *);
 
-void particleinfo_fwrite(FILE *, struct particleInfo *);
+void swarminfo_fwrite(FILE *, struct swarmInfo *, size_t);
 
-void particleInfoDump(FILE *, struct particleInfo *, size_t );
+void swarmInfoDump(FILE *, struct swarmInfo *);
 
 #if defined (__cplusplus)
 }
@@ -0,0 +1,95 @@
+/*
+ * pso_rng.c
+ *
+ * Counter-based random numbers for the PSO optimizers.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gsl/gsl_math.h>
+
+#include "pso_rng.h"
+
+/* Philox4x32 multipliers and Weyl key increments */
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+pso_rng_t* pso_rng_alloc(unsigned long seed, size_t run) {
+	pso_rng_t *rng = (pso_rng_t*) malloc(sizeof(pso_rng_t));
+	if (rng == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: pso_rng_alloc(). Exiting.\n");
+		exit(-1);
+	}
+
+	rng->key[0] = (uint32_t) seed;
+	rng->key[1] = (uint32_t) ((uint64_t) seed >> 32);
+	rng->run = (uint32_t) run;
+
+	return rng;
+}
+
+void pso_rng_free(pso_rng_t *rng) {
+	free(rng);
+}
+
+void pso_rng_philox(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]) {
+	uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+	uint32_t k0 = key[0], k1 = key[1];
+	int r;
+
+	for (r = 0; r < PHILOX_ROUNDS; r++) {
+		uint64_t p0 = (uint64_t) PHILOX_M0 * c0;
+		uint64_t p1 = (uint64_t) PHILOX_M1 * c2;
+
+		c0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+		c1 = (uint32_t) p1;
+		c2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+		c3 = (uint32_t) p0;
+
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+	out[3] = c3;
+}
+
+/* The two 53 bit uniform numbers of the block of index: each block of 128 bits holds indices 2j and 2j+1.
+   The stream is in the low byte of the last word of the counter and the run in the rest. */
+static void pso_rng_block(const pso_rng_t *rng, size_t iteration, size_t particle, PSO_RNG_STREAM stream,
+		size_t index, double u[2]) {
+	uint32_t counter[4], out[4];
+
+	counter[0] = (uint32_t) (index >> 1);
+	counter[1] = (uint32_t) particle;
+	counter[2] = (uint32_t) iteration;
+	counter[3] = (rng->run << 8) | (uint32_t) stream;
+
+	pso_rng_philox(counter, rng->key, out);
+
+	u[0] = (double) ((((uint64_t) out[0] << 32) | out[1]) >> 11) * 0x1.0p-53;
+	u[1] = (double) ((((uint64_t) out[2] << 32) | out[3]) >> 11) * 0x1.0p-53;
+}
+
+double pso_rng_uniform(const pso_rng_t *rng, size_t iteration, size_t particle, PSO_RNG_STREAM stream, size_t index) {
+	double u[2];
+	pso_rng_block(rng, iteration, particle, stream, index, u);
+	return u[index & 1];
+}
+
+/* Box-Muller transform of the block of index: the even index is the cosine and the odd one the sine. */
+double pso_rng_gaussian(const pso_rng_t *rng, size_t iteration, size_t particle, PSO_RNG_STREAM stream, size_t index) {
+	double u[2];
+	pso_rng_block(rng, iteration, particle, stream, index, u);
+
+	double radius = sqrt(-2.0 * log(1.0 - u[0]));
+	double angle = 2.0 * M_PI * u[1];
+	return radius * ((index & 1) ? sin(angle) : cos(angle));
+}
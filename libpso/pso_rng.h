@@ -0,0 +1,59 @@
+/*
+ * pso_rng.h
+ *
+ * Counter-based random numbers for the PSO optimizers.
+ */
+
+#ifndef LIBPSO_PSO_RNG_H_
+#define LIBPSO_PSO_RNG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/*! The random numbers drawn by the optimizers. Each one is a separate stream, so changing how many
+    numbers one of them uses doesn't change the others. */
+typedef enum {
+	PSO_RNG_INIT_COORD = 0, /*!< Initial coordinates */
+	PSO_RNG_INIT_VEL,       /*!< Initial velocities */
+	PSO_RNG_CHI1,           /*!< Random weights of the acceleration to pbest */
+	PSO_RNG_CHI2,           /*!< Random weights of the acceleration to the neighborhood best */
+	PSO_RNG_SPSO_GAUSSIAN,  /*!< SPSO: direction of the point in the hypersphere */
+	PSO_RNG_SPSO_RADIUS,    /*!< SPSO: radius of the point in the hypersphere */
+	PSO_RNG_SPSO_NEIGHBORS, /*!< SPSO: random neighbors */
+	PSO_RNG_NUM_STREAMS
+} PSO_RNG_STREAM;
+
+/*! Counter-based random numbers (Philox4x32-10, Salmon et al. 2011). Every number is a function of
+   (seed, run, iteration, particle, stream, index) only, with no state that changes as numbers are drawn,
+   so they can be drawn in any order, by any thread or rank, and the results stay the same.
+
+   It is read-only after pso_rng_alloc, so one can be used by any number of threads.
+*/
+typedef struct pso_rng_s {
+	uint32_t key[2]; /*!< From the seed */
+	uint32_t run;    /*!< Separates the runs that use the same seed, e.g. one per rank */
+} pso_rng_t;
+
+/* The seed is e.g. one from random_seed(). */
+pso_rng_t* pso_rng_alloc(unsigned long seed, size_t run);
+
+void pso_rng_free(pso_rng_t *rng);
+
+/* Philox4x32-10 of the 128 bit counter with the 64 bit key. */
+void pso_rng_philox(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]);
+
+/* Uniform random number in [0, 1). A stream should only be used for either uniform or gaussian numbers. */
+double pso_rng_uniform(const pso_rng_t *rng, size_t iteration, size_t particle, PSO_RNG_STREAM stream, size_t index);
+
+/* Gaussian random number with zero mean and unit standard deviation. */
+double pso_rng_gaussian(const pso_rng_t *rng, size_t iteration, size_t particle, PSO_RNG_STREAM stream, size_t index);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* LIBPSO_PSO_RNG_H_ */
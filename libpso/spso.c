@@ -22,6 +22,8 @@
 #include <time.h>
 #include <math.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "pso.h" //for initializing variables and
 #include "ptapso_maxphase.h" //for fitfunc struct
@@ -63,8 +65,8 @@ void spso(size_t nDim, /*!< Number of search dimensions */
     //}
     
     
-    //particles
-    struct particleInfo pop[popsize];
+    //particles, in contiguous arrays
+    struct swarmInfo *swarm = swarminfo_alloc(popsize, nDim);
     //neighborhoods
     const int k = 3; //number of neighbors (excluding self) that each particle has
     gsl_matrix_int *neighborhoods = gsl_matrix_int_alloc(k,psoParams->popsize); //neighbors. Collumn n contains the indexes for particle n's neighbors
@@ -76,8 +78,6 @@ void spso(size_t nDim, /*!< Number of search dimensions */
     gsl_vector *gbestCoord = gsl_vector_alloc(nDim);
     size_t bestfitParticle;
     
-    gsl_vector *partSnrCurrCol = gsl_vector_alloc(popsize); //gets updated to the most recent set of particle fitness evaluations.
-    
     int rand_neighbor; //For selecting a random neighbor
     size_t lpNbrs; /* Loop counter over nearest neighbors */
     double nbrFitVal; /*Fitness of a neighbor */
@@ -85,61 +85,33 @@ void spso(size_t nDim, /*!< Number of search dimensions */
     size_t lbestPart; /* local best particle */
     double lbestFit; /* Fitness of local best particle */
     
-    //vectors for velocity update (center  of gravity)
-    gsl_vector *G = gsl_vector_alloc(nDim); //center of gravity for velocity update
+    //arrays for velocity update (center  of gravity), popsize*nDim like the swarm's
+    double *G = pso_aligned_alloc(popsize * nDim); //center of gravity for velocity update
     double G_x_mag; //magnitude of ||G-x||
     double xprim_mag; //magnitude of x'
-    gsl_vector *x_prime = gsl_vector_alloc(nDim); //xprime vector
-    double rng_normal_distro; //to store random numbers from normal distribution
-    double radius; //stores the chosen radius of the hypersphere
-    
-    double scaled_vel; //scaled velocity for confinement
+    double *x_prime = pso_aligned_alloc(popsize * nDim); //xprime vectors
+    double *radius = pso_aligned_alloc(popsize); //stores the uniform random number of the radius of each hypersphere
     
-    /* Variables needed to keep track of number of fitness function evaluations */
-    unsigned char computeOK;
-    size_t funcCount;
+    size_t lpc; //loop over all of the values of the swarm
     
     //initialize all particle values (vel,position...)
-    for (lpParticles=0; lpParticles < popsize; lpParticles++) {
-        initPsoParticles(&pop[lpParticles], nDim, rngGen);
-        pop[lpParticles].partInertia = 1.0/(2.0*gsl_sf_log(2.0)); //set inertias to value specified on pg 7
+    if (psoParams->counterRng != NULL) {
+        swarminfo_init_counter(swarm, psoParams->counterRng);
+    } else {
+        initPsoSwarm(swarm, rngGen);
     }
+    swarm->partInertia = 1.0/(2.0*gsl_sf_log(2.0)); //set inertias to value specified on pg 7
     
     //start PSO loop
     for (lpPsoIter=1; lpPsoIter<maxSteps; lpPsoIter++) {
         
-#ifdef HAVE_OMP
-#pragma omp parallel for
-#endif
-        for (lpParticles = 0; lpParticles < popsize; lpParticles++){
-            //Calculate G
-            
-            /* Evaluate fitness */
-            pop[lpParticles].partSnrCurr = fitfunc(pop[lpParticles].partCoord,ffParams);
-            //fprintf(stderr, "Done evaluating the fitness function...\n");
-            /* Separately store all fitness values -- needed to find best particle */
-            gsl_vector_set(partSnrCurrCol,lpParticles,pop[lpParticles].partSnrCurr);
-            /* Check if fitness function was actually evaluated or not */
-            computeOK = ((struct fitFuncParams *)ffParams)->fitEvalFlag[parallel_get_thread_num()];
-            funcCount = 0;
-            if (computeOK){
-                /* Increment fitness function evaluation count */
-                funcCount = 1;
-            }
-            pop[lpParticles].partFitEvals += funcCount;
-            /* Update pbest fitness and coordinates if needed */
-            if (pop[lpParticles].partSnrPbest > pop[lpParticles].partSnrCurr){ //minimize the function
-                pop[lpParticles].partSnrPbest = pop[lpParticles].partSnrCurr;
-                
-                /* This is causing a segfault using openmp */
-                gsl_vector_memcpy(pop[lpParticles].partPbest,pop[lpParticles].partCoord);
-            }
-            
-        } //end paralell fitness loop
+        evalPsoSwarm(swarm, fitfunc, ffParams, psoParams);
+        /* Exchange the best particles with the other islands, if any */
+        swarminfo_migrate(swarm, psoParams->migration, lpPsoIter);
         
         /* Find the best particle in the current iteration */
-        bestfitParticle = gsl_vector_min_index(partSnrCurrCol);
-        currBestFitVal = pop[bestfitParticle].partSnrCurr;
+        bestfitParticle = swarminfo_best_particle(swarm);
+        currBestFitVal = swarm->partSnrCurr[bestfitParticle];
         if (currBestFitVal >= gbestFitVal || lpPsoIter==1){ // if this is the first iteration (need to create neighborhoods) or fitness does not improve
             //assigns particles their new random neighbors
             for (lpParticles=0;lpParticles<(neighborhoods->size2); lpParticles++) {
@@ -148,98 +120,134 @@ void spso(size_t nDim, /*!< Number of search dimensions */
                 for (lpNeighbors=0; lpNeighbors < (neighborhoods->size1); lpNeighbors++) {
                     //for each of the particles neighbors (excluding self)
                     //assign random integer
-                    rand_neighbor = (int)(gsl_rng_uniform_int(rngGen, neighborhoods->size2));
+                    if (psoParams->counterRng != NULL) {
+                        rand_neighbor = (int)(neighborhoods->size2 * pso_rng_uniform(psoParams->counterRng, lpPsoIter,
+                                              lpParticles, PSO_RNG_SPSO_NEIGHBORS, lpNeighbors));
+                    } else {
+                        rand_neighbor = (int)(gsl_rng_uniform_int(rngGen, neighborhoods->size2));
+                    }
                     gsl_matrix_int_set(neighborhoods,lpNeighbors,lpParticles, rand_neighbor);
                 }
             } //end particle for loop
             
         } else { // if PSO did improve during an iteration...
             /* Update gbest */
-            gbestFitVal = pop[bestfitParticle].partSnrCurr;
-            gsl_vector_memcpy(gbestCoord,pop[bestfitParticle].partCoord);
+            gbestFitVal = swarm->partSnrCurr[bestfitParticle];
+            gsl_vector_memcpy(gbestCoord,swarm->partCoordVecs[bestfitParticle]);
         }
         
         //update lbest values
         for (lpParticles = 0; lpParticles < popsize; lpParticles++) {
             lbestPart = lpParticles; //start with the current particle's new fitness, as all particles are the neighbors of themselves.
-            lbestFit = gsl_vector_get(partSnrCurrCol, lbestPart); // get particles fitness
+            lbestFit = swarm->partSnrCurr[lbestPart]; // get particles fitness
             for (lpNbrs = 0; lpNbrs < k; lpNbrs++) { //loop over all of the neighbors
                 nbrIndex = (size_t)(gsl_matrix_int_get(neighborhoods, lpNbrs, lpParticles)); //get index of neighbor particle from matrix. Convert to size_t to match lbestPart
-                nbrFitVal = gsl_vector_get(partSnrCurrCol, nbrIndex);
+                nbrFitVal = swarm->partSnrCurr[nbrIndex];
                 if (nbrFitVal < lbestFit) { // if this neighbor has the best so far
                     lbestPart = nbrIndex;
                     lbestFit = nbrFitVal; //assign to next best
                 } //end  if
             } // end for loop over neighbors
-            if (lbestFit < pop[lpParticles].partSnrLbest) { //if we have discovered a position that is better in the neighborhood
-                pop[lpParticles].partSnrLbest =  lbestFit;
-                gsl_vector_memcpy(pop[lpParticles].partLocalBest, pop[lbestPart].partCoord);
+            if (lbestFit < swarm->partSnrLbest[lpParticles]) { //if we have discovered a position that is better in the neighborhood
+                swarm->partSnrLbest[lpParticles] =  lbestFit;
+                memcpy(swarm->partLocalBest + lpParticles*nDim, swarm->partCoord + lbestPart*nDim,
+                       nDim * sizeof(double));
             }
         } //end particle neighbor sharing loop
         
         for (lpParticles = 0; lpParticles < popsize; lpParticles++) {
+            const double *x = swarm->partCoord + lpParticles*nDim;
+            const double *pbest = swarm->partPbest + lpParticles*nDim;
+            const double *lbest = swarm->partLocalBest + lpParticles*nDim;
+            double *g = G + lpParticles*nDim;
+            
+            int lbest_is_pbest = 1;
+            for (lpDimentions = 0; lpDimentions < nDim; lpDimentions++) {
+                if (pbest[lpDimentions] != lbest[lpDimentions]) {
+                    lbest_is_pbest = 0;
+                }
+            }
             
-            if (gsl_vector_equal(pop[lpParticles].partPbest , pop[lpParticles].partLocalBest)) { //if the local best is the pbest (G calc changes)
-                gsl_vector_memcpy(G, pop[lpParticles].partPbest); //copy pbest to G to begin calculation
-                gsl_vector_sub(G, pop[lpParticles].partCoord); //subtract position from pbest
-                gsl_vector_scale(G, (psoParams->c1)/2.0); //scale vector by c/2
-                gsl_vector_add(G, pop[lpParticles].partCoord); // add to the current position
+            if (lbest_is_pbest) { //if the local best is the pbest (G calc changes)
+                for (lpDimentions = 0; lpDimentions < nDim; lpDimentions++) {
+                    g[lpDimentions] = (pbest[lpDimentions] - x[lpDimentions]) * ((psoParams->c1)/2.0) + x[lpDimentions]; // pos + (pbest - pos) * c/2
+                }
             } else {
                 //if lbest != pbest use appropriate G calculation
-                gsl_vector_memcpy(G, pop[lpParticles].partCoord); //copy current position to begin calculation
-                gsl_vector_scale(G, -2.0); //negitive to accout for subtraction
-                gsl_vector_add(G, pop[lpParticles].partLocalBest); // add local best
-                gsl_vector_add(G, pop[lpParticles].partPbest); //add personal best
-                gsl_vector_scale(G, (psoParams->c1)/3.0); //scale by c/3
-                gsl_vector_add(G, pop[lpParticles].partCoord); //add position, finishing g calculation
+                for (lpDimentions = 0; lpDimentions < nDim; lpDimentions++) {
+                    g[lpDimentions] = (x[lpDimentions] * -2.0 + lbest[lpDimentions] + pbest[lpDimentions]) * ((psoParams->c1)/3.0)
+                                      + x[lpDimentions]; // pos + (lbest + pbest - 2 pos) * c/3
+                }
             } //end else
             
-            G_x_mag = 0;
-            for (lpDimentions=0; lpDimentions<nDim; lpDimentions++) { //calculate the ||G-pos|| for radius
-                G_x_mag += gsl_pow_2(gsl_vector_get(G, lpDimentions)-gsl_vector_get(pop[lpParticles].partCoord, lpDimentions));
+            //http://mathworld.wolfram.com/HyperspherePointPicking.html - Explains hypersphere point picking
+            //Does not specify std of distro, but assuming 1. Drawn in the same order as one particle at a time.
+            if (psoParams->counterRng == NULL) {
+                for (lpDimentions = 0; lpDimentions < nDim; lpDimentions++) {
+                    x_prime[lpParticles*nDim + lpDimentions] = gsl_ran_gaussian(rngGen, 1.0);
+                }
+                radius[lpParticles] = gsl_rng_uniform(rngGen); //radius  is <= ||G-x|| uniform
             }
-            G_x_mag = sqrt(G_x_mag); //finish magnitude calculation
+        }
+        
+        //with counter-based random numbers the points are drawn for every particle at once, in any order
+        if (psoParams->counterRng != NULL) {
+            const pso_rng_t *counterRng = psoParams->counterRng;
+#ifdef HAVE_OPENMP
+#pragma omp parallel for private(lpDimentions) schedule(static) if(popsize * nDim >= PSO_PARALLEL_MIN_VALUES)
+#endif
+            for (lpParticles = 0; lpParticles < popsize; lpParticles++) {
+                for (lpDimentions = 0; lpDimentions < nDim; lpDimentions++) {
+                    x_prime[lpParticles*nDim + lpDimentions] = pso_rng_gaussian(counterRng, lpPsoIter, lpParticles,
+                                                                                PSO_RNG_SPSO_GAUSSIAN, lpDimentions);
+                }
+                radius[lpParticles] = pso_rng_uniform(counterRng, lpPsoIter, lpParticles, PSO_RNG_SPSO_RADIUS, 0);
+            }
+        }
+        
+        for (lpParticles = 0; lpParticles < popsize; lpParticles++) {
+            const double *x = swarm->partCoord + lpParticles*nDim;
+            const double *g = G + lpParticles*nDim;
+            double *xp = x_prime + lpParticles*nDim;
             
-            //http://mathworld.wolfram.com/HyperspherePointPicking.html - Explains hypersphere point picking
-            //Does not specify std of distro, but assuming 1
+            G_x_mag = 0;
             xprim_mag = 0;
-            for (lpDimentions = 0; lpDimentions < nDim; lpDimentions++) {
-                //assign each index to random number for gauss distro
-                rng_normal_distro = gsl_ran_gaussian(rngGen, 1.0);
-                gsl_vector_set(x_prime, lpDimentions, rng_normal_distro);
-                xprim_mag += gsl_pow_2(rng_normal_distro); // sum to find magnitude of vector
+            for (lpDimentions=0; lpDimentions<nDim; lpDimentions++) { //calculate the ||G-pos|| for radius and ||x'||
+                G_x_mag += gsl_pow_2(g[lpDimentions]-x[lpDimentions]);
+                xprim_mag += gsl_pow_2(xp[lpDimentions]);
             }
+            G_x_mag = sqrt(G_x_mag); //finish magnitude calculation
             xprim_mag = sqrt(xprim_mag); //find the magnitude (sqrt of squared components)
             
-            radius = gsl_rng_uniform(rngGen) * G_x_mag; //radius  is <= ||G-x|| uniform
-            
-            gsl_vector_scale(x_prime, radius/xprim_mag); // scale to point on hypersphere w chosen radius
-            gsl_vector_add(x_prime, G); //move center of hypersphere to G. This finailizes x_prime
-            
-            //update velocity
-            gsl_vector_scale(pop[lpParticles].partVel, pop[lpParticles].partInertia); //multiply  by  inertia
-            gsl_vector_add(pop[lpParticles].partVel, x_prime); //add x_prime
-            gsl_vector_sub(pop[lpParticles].partVel, pop[lpParticles].partCoord); //subtract position. Finishes vel update
-            
-            //update position
-            gsl_vector_add(pop[lpParticles].partCoord, pop[lpParticles].partVel);
-            
+            double scale = (radius[lpParticles] * G_x_mag) / xprim_mag; // scale to point on hypersphere w chosen radius
+            for (lpDimentions = 0; lpDimentions < nDim; lpDimentions++) {
+                xp[lpDimentions] = xp[lpDimentions] * scale + g[lpDimentions]; //move center of hypersphere to G. This finailizes x_prime
+            }
+        }
+        
+        //update velocity and position of the whole swarm, and apply confinement. Absorbing
+        {
+            const double inertia = swarm->partInertia;
+            double * restrict partCoord = swarm->partCoord;
+            double * restrict partVel = swarm->partVel;
+            const double * restrict xp = x_prime;
             
-            //apply confinement. Absorbing
-            for (lpDimentions = 0; lpDimentions<nDim; lpDimentions++) {
-                double cur_xi = gsl_vector_get(pop[lpParticles].partCoord, lpDimentions);
+            for (lpc = 0; lpc < popsize * nDim; lpc++) {
+                double vel = partVel[lpc] * inertia + xp[lpc] - partCoord[lpc]; //multiply by inertia, add x_prime, subtract position
+                double cur_xi = partCoord[lpc] + vel;
+                
                 if (cur_xi > 1.0) { //if particle is above upper bound
-                    gsl_vector_set(pop[lpParticles].partCoord, lpDimentions, 1.0);
-                    scaled_vel = gsl_vector_get(pop[lpParticles].partVel, lpDimentions) * -0.5;
-                    gsl_vector_set(pop[lpParticles].partVel, lpDimentions, scaled_vel);
-                } else if  (cur_xi < 0.0) { //if particle is below lower bound
-                    gsl_vector_set(pop[lpParticles].partCoord, lpDimentions, 0.0);
-                    scaled_vel = gsl_vector_get(pop[lpParticles].partVel, lpDimentions) * -0.5;
-                    gsl_vector_set(pop[lpParticles].partVel, lpDimentions, scaled_vel);
-                }  //end else if for bc
-            } // end constraint for loop
-            
-        }// end particle loop
+                    cur_xi = 1.0;
+                    vel *= -0.5;
+                } else if (cur_xi < 0.0) { //if particle is below lower bound
+                    cur_xi = 0.0;
+                    vel *= -0.5;
+                }
+                
+                partVel[lpc] = vel;
+                partCoord[lpc] = cur_xi;
+            }
+        }
         
     } //end pso loop
     
@@ -252,19 +260,17 @@ void spso(size_t nDim, /*!< Number of search dimensions */
     psoResults->totalFuncEvals = 0;
     
     for (lpParticles = 0; lpParticles < popsize; lpParticles ++){
-        psoResults->totalFuncEvals += pop[lpParticles].partFitEvals;
+        psoResults->totalFuncEvals += swarm->partFitEvals[lpParticles];
     }
     
     //free all the vectors!
-    gsl_vector_free(G);
-    gsl_vector_free(x_prime);
+    free(G);
+    free(x_prime);
+    free(radius);
     gsl_vector_free(bestCoord);
-    gsl_vector_free(partSnrCurrCol);
     gsl_matrix_int_free(neighborhoods);
-    /* Deallocate members of pop */
-    for(lpParticles = 0; lpParticles < popsize; lpParticles++){
-        particleinfo_free(&pop[lpParticles]);
-    }
+    /* Deallocate the swarm */
+    swarminfo_free(swarm);
 } //end function def
 
 
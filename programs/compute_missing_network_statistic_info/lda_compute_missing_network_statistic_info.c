@@ -100,6 +100,9 @@ compute_workspace_t* compute_workspace_alloc(
 				network_strain->num_time_samples, network, network->detector[0]->asd->len,
 				f_low, f_high);
 
+	/* Only one template is evaluated at a time, so it can use every thread */
+	CN_workspace_set_num_threads(params->workspace, 0);
+
 	/* Setup the parameter structure for the pso fitness function */
 	params->f_low = f_low;
 	params->f_high = f_high;
@@ -277,8 +280,6 @@ void est_params_print(est_params_t *est_params) {
 }
 
 int main(int argc, char* argv[]) {
-	size_t i;
-
 	/* somehow these need to be set */
 	if (argc != 3) {
 		printf("argc = %d\n", argc);
@@ -308,17 +309,25 @@ int main(int argc, char* argv[]) {
 	const double f_high = atof(settings_file_get_value(settings_file, "f_high"));
 	const double sampling_frequency = atof(settings_file_get_value(settings_file, "sampling_frequency"));
 
-	settings_file_close(settings_file);
+	const SS_FFT_LENGTH_POLICY fft_length_policy =
+			SS_fft_length_policy_from_string(settings_file_get_value(settings_file, "fft_length_policy"));
 
-	detector_network_mapping_t *dmap = Detector_Network_Mapping_load( dmap_filename );
-	size_t num_time_samples = hdf5_get_num_time_samples( dmap->data_filenames[0] );
-	detector_network_t *net = Detector_Network_load(
-			dmap_filename, num_time_samples, sampling_frequency, f_low, f_high );
+	/* Optional. The format of the saved statistic series: text, bin or h5. */
+	const CN_SAVE_FORMAT series_format =
+			CN_save_format_from_string(settings_file_get_value(settings_file, "series_format"));
 
-	network_strain_half_fft_t *network_strain = network_strain_half_fft_alloc(dmap->num_detectors, num_time_samples );
-	for (i = 0; i < net->num_detectors; i++) {
-		load_shihan_inspiral_data( dmap->data_filenames[i], network_strain->strains[i] );
-	}
+	/* Optional. How tc is located between samples: none, parabolic or sinc. */
+	const CN_PEAK_INTERPOLATION peak_interpolation =
+			CN_peak_interpolation_from_string(settings_file_get_value(settings_file, "peak_interpolation"));
+
+	/* Optional. The layout of the statistic's scratch memory: default or compact. */
+	const CN_LAYOUT layout = CN_layout_from_string(settings_file_get_value(settings_file, "cn_layout"));
+
+	settings_file_close(settings_file);
+
+	detector_network_t *net;
+	network_strain_half_fft_t *network_strain = network_strain_half_fft_load_planned( dmap_filename,
+			fft_length_policy, sampling_frequency, f_low, f_high, load_shihan_inspiral_data, &net );
 
 	// COMPUTE
 	char rerun_filename[MAX_FILENAME_LEN];
@@ -326,16 +335,29 @@ int main(int argc, char* argv[]) {
 
 	est_params_t est_params;
 	init_est_params(arg_pso_run_file, &est_params);
+
+	/* The binary formats append, so start a new file */
+	strncat(est_params.out_network_css_filename, CN_save_format_extension(series_format),
+			MAX_FILENAME_LEN - strlen(est_params.out_network_css_filename) - 1);
+	if (series_format != CN_SAVE_TEXT) {
+		remove(est_params.out_network_css_filename);
+	}
 	//printf("TEST: %s\n", est_params.out_network_css_filename);
 	//est_params.out_network_css_filename[0] = 'M';
 	//est_params.out_network_css_filename[1] = '\0';
 	//est_params_print(&est_params);
 
 	compute_workspace_t *workspace = compute_workspace_alloc(f_low, f_high, net, network_strain);
+	CN_workspace_set_peak_interpolation(workspace->workspace, peak_interpolation);
+	CN_workspace_set_layout(workspace->workspace, layout);
+	CN_workspace_set_series_format(workspace->workspace, series_format);
+	fprintf(stderr, "Network statistic memory: %.2f MB workspace, %.2f MB shared.\n",
+			CN_workspace_footprint(workspace->workspace) / 1048576.0,
+			CN_shared_footprint(workspace->workspace->shared) / 1048576.0);
 	compute_missing(workspace, &est_params);	
 
-	// convert the tc_index into the tc value
-	est_params.new_tc_value = ((double) est_params.new_css_index) / sampling_frequency;
+	// convert the tc_index into the tc value, between samples with interpolation
+	est_params.new_tc_value = workspace->workspace->peak.index / sampling_frequency;
 
 	est_params_print(&est_params);
 
@@ -98,6 +98,9 @@ compute_workspace_t* compute_workspace_alloc(
 				network_strain->num_time_samples, network, network->detector[0]->asd->len,
 				f_low, f_high);
 
+	/* Only one template is evaluated at a time, so it can use every thread */
+	CN_workspace_set_num_threads(params->workspace, 0);
+
 	/* Setup the parameter structure for the pso fitness function */
 	params->f_low = f_low;
 	params->f_high = f_high;
@@ -174,17 +177,28 @@ int main(int argc, char* argv[]) {
 	const double f_high = atof(settings_file_get_value(settings_file, "f_high"));
 	const double sampling_frequency = atof(settings_file_get_value(settings_file, "sampling_frequency"));
 
-	settings_file_close(settings_file);
+	const SS_FFT_LENGTH_POLICY fft_length_policy =
+			SS_fft_length_policy_from_string(settings_file_get_value(settings_file, "fft_length_policy"));
 
-	detector_network_mapping_t *dmap = Detector_Network_Mapping_load( arg_dmap_filename );
-	size_t num_time_samples = hdf5_get_num_time_samples( dmap->data_filenames[0] );
-	detector_network_t *net = Detector_Network_load(
-			arg_dmap_filename, num_time_samples, sampling_frequency, f_low, f_high );
+	/* Optional. How tc is located between samples (none, parabolic or sinc), and how many peaks to list. */
+	const CN_PEAK_INTERPOLATION peak_interpolation =
+			CN_peak_interpolation_from_string(settings_file_get_value(settings_file, "peak_interpolation"));
+	const char *num_peaks_value = settings_file_get_value(settings_file, "num_peaks");
+	const char *peak_separation_value = settings_file_get_value(settings_file, "peak_separation");
+	const size_t num_peaks = (num_peaks_value != NULL) ? atoi(num_peaks_value) : 0;
+	const double peak_separation = (peak_separation_value != NULL) ? atof(peak_separation_value) : 0.0;
 
-	network_strain_half_fft_t *network_strain = network_strain_half_fft_alloc(dmap->num_detectors, num_time_samples );
-	for (i = 0; i < net->num_detectors; i++) {
-		load_shihan_inspiral_data( dmap->data_filenames[i], network_strain->strains[i] );
-	}
+	/* Optional. The layout of the statistic's scratch memory: default or compact. */
+	const CN_LAYOUT layout = CN_layout_from_string(settings_file_get_value(settings_file, "cn_layout"));
+
+	/* Optional. The precision of the inverse FFTs: double, single, or validate to compare single with double. */
+	const CN_PRECISION precision = CN_precision_from_string(settings_file_get_value(settings_file, "cn_precision"));
+
+	settings_file_close(settings_file);
+
+	detector_network_t *net;
+	network_strain_half_fft_t *network_strain = network_strain_half_fft_load_planned( arg_dmap_filename,
+			fft_length_policy, sampling_frequency, f_low, f_high, load_shihan_inspiral_data, &net );
 
 
 	// Make the template paramater structure holding the template parametes to evaluate
@@ -202,15 +216,32 @@ int main(int argc, char* argv[]) {
 
 	// Perform the fitness function computation
 	compute_workspace_t *workspace = compute_workspace_alloc(f_low, f_high, net, network_strain);
+	CN_workspace_set_peak_interpolation(workspace->workspace, peak_interpolation);
+	CN_workspace_set_num_peaks(workspace->workspace, num_peaks, peak_separation * sampling_frequency);
+	CN_workspace_set_layout(workspace->workspace, layout);
+	CN_workspace_set_precision(workspace->workspace, precision);
+	fprintf(stderr, "Network statistic memory: %.2f MB workspace, %.2f MB shared.\n",
+			CN_workspace_footprint(workspace->workspace) / 1048576.0,
+			CN_shared_footprint(workspace->workspace->shared) / 1048576.0);
 	compute_statistic(workspace, &params, &result, css_time_series);	
 
-	// convert the index of the tc into the tc value in seconds
-	result.tc_seconds = ((double) result.css_index) / sampling_frequency;
+	// convert the index of the tc into the tc value in seconds, between samples with interpolation
+	result.tc_seconds = workspace->workspace->peak.index / sampling_frequency;
 
 	// print the results to the screen
 	printf("css_value at tc_index: %20.17g\n", result.css_value);
 	printf("tc_index: %20zu\n", result.css_index);
 	printf("tc_seconds: %20.17g\n", result.tc_seconds);
+	if (peak_interpolation != CN_PEAK_INTERPOLATION_NONE) {
+		printf("interpolated css_value: %20.17g\n", workspace->workspace->peak.value);
+	}
+	for (i = 0; i < workspace->workspace->num_peaks; i++) {
+		printf("peak %zu: css_value %20.17g tc_seconds %20.17g\n", i,
+				workspace->workspace->peaks[i].value, workspace->workspace->peaks[i].index / sampling_frequency);
+	}
+	if (precision == CN_PRECISION_VALIDATE) {
+		printf("single precision max relative deviation: %g\n", workspace->workspace->precision_deviation);
+	}
 
 
 	// Clean up
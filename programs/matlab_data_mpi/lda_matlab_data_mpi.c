@@ -39,6 +39,7 @@
 #include "detector_mapping.h"
 #include "hdf5_file.h"
 #include "sampling_system.h"
+#include "pso_island_mpi.h"
 
 
 void load_shihan_inspiral_data( const char* hdf_filename, strain_half_fft_t *strain){
@@ -121,19 +122,14 @@ int main(int argc, char* argv[]) {
 	const double f_high = atof(settings_file_get_value(settings_file, "f_high"));
 	const double sampling_frequency = atof(settings_file_get_value(settings_file, "sampling_frequency"));
 
-	settings_file_close(settings_file);
-
-	detector_network_mapping_t *dmap = Detector_Network_Mapping_load( arg_detector_mapping_file );
+	const SS_FFT_LENGTH_POLICY fft_length_policy =
+			SS_fft_length_policy_from_string(settings_file_get_value(settings_file, "fft_length_policy"));
 
-	size_t num_time_samples = hdf5_get_num_time_samples( dmap->data_filenames[0] );
+	settings_file_close(settings_file);
 
-	detector_network_t *net = Detector_Network_load(
-			arg_detector_mapping_file, num_time_samples, sampling_frequency, f_low, f_high );
-
-	network_strain_half_fft_t *network_strain = network_strain_half_fft_alloc(dmap->num_detectors, num_time_samples );
-	for (i = 0; i < net->num_detectors; i++) {
-		load_shihan_inspiral_data( dmap->data_filenames[i], network_strain->strains[i] );
-	}
+	detector_network_t *net;
+	network_strain_half_fft_t *network_strain = network_strain_half_fft_load_planned( arg_detector_mapping_file,
+			fft_length_policy, sampling_frequency, f_low, f_high, load_shihan_inspiral_data, &net );
 
 	/* Random number generator */
 	gsl_rng *rng = random_alloc(seed);
@@ -141,12 +137,6 @@ int main(int argc, char* argv[]) {
 	pso_fitness_function_parameters_t *fitness_function_params =
 			pso_fitness_function_parameters_alloc(f_low, f_high, net, network_strain);
 
-	gslseed_t *seeds = (gslseed_t*) malloc ( arg_num_pso_evaluations * sizeof(gslseed_t) );
-	for (i = 0; i < arg_num_pso_evaluations; i++) {
-		seeds[i] = random_seed(rng);
-	}
-
-
 	double buff[8];
 	int num_workers;
 	int num_jobs = arg_num_pso_evaluations;
@@ -155,6 +145,60 @@ int main(int argc, char* argv[]) {
 	num_workers--; /* Rank 0 doesn't do any pso evaluations */
 	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 	int tag = 0;
+
+	/* Optional island model: if island_migration_interval is set in the PSO settings, the workers run one
+	   search together, each with its own swarm, and every island_migration_interval iterations they send their
+	   best particle to another worker (island_topology ring or random), and take up to island_migrants of the
+	   ones sent to them. Each worker runs one trial, so the number of trials is the number of workers. */
+	size_t island_interval = 0;
+	PSO_ISLAND_TOPOLOGY island_topology = PSO_ISLAND_RING;
+	size_t island_migrants = 1;
+	settings_file_t *pso_settings_file = settings_file_open(arg_pso_settings_file);
+	if (pso_settings_file != NULL) {
+		const char *value = settings_file_get_value(pso_settings_file, "island_migration_interval");
+		if (value != NULL) {
+			int interval = atoi(value);
+			if (interval < 0) {
+				fprintf(stderr, "Error. island_migration_interval (%d) in the pso settings file must be >= 0. Exiting.\n", interval);
+				exit(-1);
+			}
+			island_interval = interval;
+		}
+		island_topology = PSO_island_topology_from_string(settings_file_get_value(pso_settings_file, "island_topology"));
+		value = settings_file_get_value(pso_settings_file, "island_migrants");
+		if (value != NULL) {
+			int migrants = atoi(value);
+			if (migrants < 0) {
+				fprintf(stderr, "Error. island_migrants (%d) in the pso settings file must be >= 0. Exiting.\n", migrants);
+				exit(-1);
+			}
+			island_migrants = migrants;
+		}
+		settings_file_close(pso_settings_file);
+	}
+
+	/* The particles migrate in the search space, so the islands need its number of dimensions */
+	pso_ranges_t *pso_ranges = pso_ranges_alloc(arg_pso_settings_file);
+	size_t island_num_dim = pso_ranges->nDim;
+	pso_ranges_free(pso_ranges);
+
+	/* The workers' communicator. Rank 0 isn't in it. */
+	MPI_Comm island_comm;
+	MPI_Comm_split(MPI_COMM_WORLD, (island_interval > 0 && rank != 0) ? 1 : MPI_UNDEFINED, rank, &island_comm);
+	if (island_interval > 0) {
+		num_jobs = num_workers;
+		if (rank == 0) {
+			printf("Island model: %d islands migrating every %lu iterations (%s topology, %lu migrants).\n",
+					num_workers, island_interval, island_topology == PSO_ISLAND_RING ? "ring" : "random",
+					island_migrants);
+		}
+	}
+
+	gslseed_t *seeds = (gslseed_t*) malloc ( num_jobs * sizeof(gslseed_t) );
+	for (i = 0; i < num_jobs; i++) {
+		seeds[i] = random_seed(rng);
+	}
+
 	if (rank == 0) {
 		int num_jobs_done = 0;
 
@@ -194,8 +238,19 @@ int main(int argc, char* argv[]) {
 				break;
 			}
 
+			pso_island_mpi_t *island = NULL;
+			if (island_comm != MPI_COMM_NULL) {
+				island = PSO_island_mpi_alloc(island_comm, island_num_dim, island_topology, island_interval, island_migrants, seeds[r]);
+				fitness_function_params->migration = &island->migration;
+			}
+
 			pso_result_t pso_result;
-			pso_estimate_parameters(arg_pso_settings_file, fitness_function_params, seeds[r], &pso_result);
+			pso_estimate_parameters(arg_pso_settings_file, fitness_function_params, NULL, seeds[r], &pso_result);
+
+			if (island != NULL) {
+				fitness_function_params->migration = NULL;
+				PSO_island_mpi_free(island);
+			}
 			buff[0] = pso_result.ra;
 			buff[1] = pso_result.dec;
 			buff[2] = pso_result.chirp_t0;
@@ -210,6 +265,9 @@ int main(int argc, char* argv[]) {
 		}
 	}
 	MPI_Barrier(MPI_COMM_WORLD);
+	if (island_comm != MPI_COMM_NULL) {
+		MPI_Comm_free(&island_comm);
+	}
 
 	free(seeds);
 
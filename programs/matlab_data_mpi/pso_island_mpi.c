@@ -0,0 +1,165 @@
+/*
+ * pso_island_mpi.c
+ *
+ * Island model migration of the PSO swarms between MPI ranks.
+ */
+
+#include "pso_island_mpi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gsl/gsl_rng.h>
+
+#include "random.h"
+
+#define PSO_ISLAND_TAG 17
+
+PSO_ISLAND_TOPOLOGY PSO_island_topology_from_string(const char *topology) {
+	if (topology == NULL || strcmp(topology, "ring") == 0) {
+		return PSO_ISLAND_RING;
+	}
+	if (strcmp(topology, "random") == 0) {
+		return PSO_ISLAND_RANDOM;
+	}
+
+	fprintf(stderr, "Error. Unknown island topology (%s). Use ring or random. Exiting.\n", topology);
+	exit(-1);
+}
+
+static void PSO_island_mpi_post_recv(pso_island_mpi_t *island) {
+	MPI_Irecv(island->recv_buffer, (int) island->nDim + 1, MPI_DOUBLE, MPI_ANY_SOURCE, PSO_ISLAND_TAG,
+			island->comm, &island->recv_request);
+}
+
+pso_island_mpi_t* PSO_island_mpi_alloc(MPI_Comm comm, size_t nDim, PSO_ISLAND_TOPOLOGY topology,
+		size_t interval, size_t max_immigrants, gslseed_t seed) {
+	pso_island_mpi_t *island = (pso_island_mpi_t*) malloc(sizeof(pso_island_mpi_t));
+	if (island == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: PSO_island_mpi_alloc(). Exiting.\n");
+		exit(-1);
+	}
+
+	/* A communicator of its own, so that the messages of consecutive islands on comm can't be mixed up */
+	MPI_Comm_dup(comm, &island->comm);
+	MPI_Comm_rank(island->comm, &island->rank);
+	MPI_Comm_size(island->comm, &island->size);
+	island->topology = topology;
+	island->nDim = nDim;
+	island->rng = random_alloc(seed);
+
+	island->send_buffer = (double*) malloc((nDim + 1) * sizeof(double));
+	island->recv_buffer = (double*) malloc((nDim + 1) * sizeof(double));
+	island->num_sent = (int*) calloc(island->size, sizeof(int));
+	if (island->send_buffer == NULL || island->recv_buffer == NULL || island->num_sent == NULL) {
+		fprintf(stderr, "Error. Unable to allocate memory: PSO_island_mpi_alloc(). Exiting.\n");
+		exit(-1);
+	}
+	island->send_pending = 0;
+	island->num_received = 0;
+
+	island->migration.exchange = PSO_island_mpi_exchange;
+	island->migration.params = island;
+	island->migration.interval = interval;
+	island->migration.maxImmigrants = max_immigrants;
+
+	PSO_island_mpi_post_recv(island);
+
+	return island;
+}
+
+void PSO_island_mpi_free(pso_island_mpi_t *island) {
+	int num_expected;
+
+	if (island->send_pending) {
+		MPI_Wait(&island->send_request, MPI_STATUS_IGNORE);
+	}
+
+	/* Every island learns how many messages were sent to it, and receives the ones it hasn't yet, so that
+	   no message is left unmatched. */
+	MPI_Reduce_scatter_block(island->num_sent, &num_expected, 1, MPI_INT, MPI_SUM, island->comm);
+	while (island->num_received < num_expected) {
+		MPI_Wait(&island->recv_request, MPI_STATUS_IGNORE);
+		island->num_received++;
+		PSO_island_mpi_post_recv(island);
+	}
+	MPI_Cancel(&island->recv_request);
+	MPI_Wait(&island->recv_request, MPI_STATUS_IGNORE);
+
+	MPI_Comm_free(&island->comm);
+	random_free(island->rng);
+	free(island->send_buffer);
+	free(island->recv_buffer);
+	free(island->num_sent);
+	free(island);
+}
+
+size_t PSO_island_mpi_exchange(void *island_params, size_t nDim, const double *emigrant_coord,
+		double emigrant_fitness, size_t max_immigrants, double *immigrant_coords, double *immigrant_fitness) {
+	pso_island_mpi_t *island = (pso_island_mpi_t*) island_params;
+	size_t i, num_immigrants = 0;
+	int flag;
+
+	if (island->size < 2) {
+		return 0;
+	}
+
+	/* Send the emigrant, unless the previous one is still on its way */
+	if (island->send_pending) {
+		MPI_Test(&island->send_request, &flag, MPI_STATUS_IGNORE);
+		island->send_pending = !flag;
+	}
+	if (!island->send_pending) {
+		int destination;
+		if (island->topology == PSO_ISLAND_RANDOM) {
+			destination = (int) gsl_rng_uniform_int(island->rng, island->size - 1);
+			if (destination >= island->rank) {
+				destination++;
+			}
+		} else {
+			destination = (island->rank + 1) % island->size;
+		}
+
+		memcpy(island->send_buffer, emigrant_coord, nDim * sizeof(double));
+		island->send_buffer[nDim] = emigrant_fitness;
+		MPI_Isend(island->send_buffer, (int) nDim + 1, MPI_DOUBLE, destination, PSO_ISLAND_TAG, island->comm,
+				&island->send_request);
+		island->send_pending = 1;
+		island->num_sent[destination]++;
+	}
+
+	/* Take every immigrant that has arrived, keeping the best max_immigrants */
+	for (;;) {
+		MPI_Test(&island->recv_request, &flag, MPI_STATUS_IGNORE);
+		if (!flag) {
+			break;
+		}
+		island->num_received++;
+
+		double fitness = island->recv_buffer[nDim];
+		size_t slot = num_immigrants;
+		if (num_immigrants == max_immigrants) {
+			/* Replace the worst one, if this one is better */
+			slot = 0;
+			for (i = 1; i < num_immigrants; i++) {
+				if (immigrant_fitness[i] > immigrant_fitness[slot]) {
+					slot = i;
+				}
+			}
+			if (max_immigrants == 0 || !(fitness < immigrant_fitness[slot])) {
+				slot = max_immigrants;
+			}
+		} else {
+			num_immigrants++;
+		}
+		if (slot < max_immigrants) {
+			memcpy(immigrant_coords + slot*nDim, island->recv_buffer, nDim * sizeof(double));
+			immigrant_fitness[slot] = fitness;
+		}
+
+		PSO_island_mpi_post_recv(island);
+	}
+
+	return num_immigrants;
+}
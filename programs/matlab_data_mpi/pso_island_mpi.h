@@ -0,0 +1,69 @@
+/*
+ * pso_island_mpi.h
+ *
+ * Island model migration of the PSO swarms between MPI ranks.
+ */
+
+#ifndef PROGRAMS_PSO_ISLAND_MPI_H_
+#define PROGRAMS_PSO_ISLAND_MPI_H_
+
+#include <stddef.h>
+#include <mpi.h>
+#include <gsl/gsl_rng.h>
+
+#include "pso.h"
+#include "random.h"
+
+/* Where each island sends its best particle: the next rank, or a random other rank at each migration. */
+typedef enum {
+	PSO_ISLAND_RING = 0,
+	PSO_ISLAND_RANDOM
+} PSO_ISLAND_TOPOLOGY;
+
+/* Parses ring or random. NULL gives the default, ring. */
+PSO_ISLAND_TOPOLOGY PSO_island_topology_from_string(const char *topology);
+
+/* One island of a communicator. The messages are non-blocking: an island that is ahead doesn't wait for the
+   others, it only gets the immigrants that have arrived so far. */
+typedef struct pso_island_mpi_s {
+	MPI_Comm comm;
+	int rank;
+	int size;
+	PSO_ISLAND_TOPOLOGY topology;
+	size_t nDim;
+
+	/* Picks the destinations of the random topology */
+	gsl_rng *rng;
+
+	/* The emigrant being sent: coordinates, then fitness */
+	double *send_buffer;
+	MPI_Request send_request;
+	int send_pending;
+
+	/* The posted receive of the next immigrant, from any rank */
+	double *recv_buffer;
+	MPI_Request recv_request;
+
+	/* The number of messages sent to each rank and received, to receive all of them when it is freed */
+	int *num_sent;
+	int num_received;
+
+	/* The migration parameters for psoParamStruct, with PSO_island_mpi_exchange */
+	pso_migration_t migration;
+
+} pso_island_mpi_t;
+
+/* Collective over comm. Migrates every interval iterations, at most max_immigrants at a time. The messages go
+   through a duplicate of comm, so other islands and messages on comm don't interfere. */
+pso_island_mpi_t* PSO_island_mpi_alloc(MPI_Comm comm, size_t nDim, PSO_ISLAND_TOPOLOGY topology,
+		size_t interval, size_t max_immigrants, gslseed_t seed);
+
+/* Collective over comm. Receives the messages that are still on their way, then frees the island. */
+void PSO_island_mpi_free(pso_island_mpi_t *island);
+
+/* The migration_function_ptr of the islands: sends the emigrant to the next rank of the topology, unless the
+   previous one hasn't been delivered yet, and returns the best immigrants that have arrived. */
+size_t PSO_island_mpi_exchange(void *island_params, size_t nDim, const double *emigrant_coord,
+		double emigrant_fitness, size_t max_immigrants, double *immigrant_coords, double *immigrant_fitness);
+
+#endif /* PROGRAMS_PSO_ISLAND_MPI_H_ */
@@ -33,6 +33,7 @@
 #include "inspiral_chirp.h"
 #include "detector.h"
 #include "detector_network.h"
+#include "fft.h"
 #include "strain.h"
 #include "inspiral_stationary_phase.h"
 #include "inspiral_network_statistic.h"
@@ -106,8 +107,6 @@ void callback(void* params, returnData_t *pso_domain_result) {
 }
 
 int main(int argc, char* argv[]) {
-	size_t i;
-
 	/* somehow these need to be set */
 	if (argc != 7) {
 		printf("argc = %d\n", argc);
@@ -136,20 +135,30 @@ int main(int argc, char* argv[]) {
 	const double f_low = atof(settings_file_get_value(settings_file, "f_low"));
 	const double f_high = atof(settings_file_get_value(settings_file, "f_high"));
 	const double sampling_frequency = atof(settings_file_get_value(settings_file, "sampling_frequency"));
+
+	const SS_FFT_LENGTH_POLICY fft_length_policy =
+			SS_fft_length_policy_from_string(settings_file_get_value(settings_file, "fft_length_policy"));
 	const int arg_pso_record_interval = atoi(settings_file_get_value(settings_file, "pso_callback_interval"));
 
-	settings_file_close(settings_file);
+	/* Optional. FFTW plans found in a previous run are loaded from, and the new ones saved to, this file. */
+	char *fft_wisdom_file = NULL;
+	const char *fft_wisdom_file_p = settings_file_get_value(settings_file, "fft_wisdom_file");
+	if (fft_wisdom_file_p != NULL) {
+		fft_wisdom_file = malloc( sizeof(char) * (strlen(fft_wisdom_file_p)+1) );
+		strcpy(fft_wisdom_file, fft_wisdom_file_p);
+	}
 
-	detector_network_mapping_t *dmap = Detector_Network_Mapping_load( arg_detector_mapping_file );
-	size_t num_time_samples = hdf5_get_num_time_samples( dmap->data_filenames[0] );
-	detector_network_t *net = Detector_Network_load(
-			arg_detector_mapping_file, num_time_samples, sampling_frequency, f_low, f_high );
+	settings_file_close(settings_file);
 
-	network_strain_half_fft_t *network_strain = network_strain_half_fft_alloc(dmap->num_detectors, num_time_samples );
-	for (i = 0; i < net->num_detectors; i++) {
-		load_shihan_inspiral_data( dmap->data_filenames[i], network_strain->strains[i] );
+	printf("FFT backend: %s\n", FFT_backend_name());
+	if (fft_wisdom_file != NULL && FFT_wisdom_import(fft_wisdom_file) != 0) {
+		printf("No FFT wisdom was loaded from (%s).\n", fft_wisdom_file);
 	}
 
+	detector_network_t *net;
+	network_strain_half_fft_t *network_strain = network_strain_half_fft_load_planned( arg_detector_mapping_file,
+			fft_length_policy, sampling_frequency, f_low, f_high, load_shihan_inspiral_data, &net );
+
 	pso_fitness_function_parameters_t *fitness_function_params =
 				pso_fitness_function_parameters_alloc(f_low, f_high, net, network_strain);
 
@@ -180,5 +189,13 @@ int main(int argc, char* argv[]) {
 
 	Detector_Network_free(net);
 
+	if (fft_wisdom_file != NULL) {
+		if (FFT_wisdom_export(fft_wisdom_file) != 0) {
+			printf("Unable to save the FFT wisdom to (%s).\n", fft_wisdom_file);
+		}
+		free(fft_wisdom_file);
+	}
+	FFT_plan_cache_clear();
+
 	return 0;
 }
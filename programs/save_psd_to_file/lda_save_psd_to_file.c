@@ -1,22 +1,29 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include "detector_network.h"
+#include "sampling_system.h"
 #include "spectral_density.h"
 
 int main(int argc, char *argv[]) {
 
-	if (argc != 3) {
-		printf("Error: <input data filename> <output psd filename>\n. Exiting.\n");
+	if (argc < 3 || argc > 5) {
+		printf("Error: <input data filename> <output psd filename> [num time samples] [fft length policy: keep, pad or crop]\n. Exiting.\n");
 		exit(-1);
 	}
 
 	char *data_filename = argv[1];
 	char *output_filename = argv[2];
 
-	int num_time_samples = 131074;
+	/* The default is the length of the data this tool was first used with. It is slow to transform, so the
+	 * planning step warns about it unless a policy is given. */
+	size_t num_time_samples = (argc > 3) ? (size_t) atol(argv[3]) : 131074;
+	SS_FFT_LENGTH_POLICY policy = SS_fft_length_policy_from_string( (argc > 4) ? argv[4] : NULL );
 	double sampling_frequency = 2048.0;
 	double f_low = 10.0;
 	double f_high = 1000.0;
 
+	num_time_samples = Detector_Network_plan_num_time_samples( num_time_samples, policy );
+
 	psd_t *psd_unprocessed = PSD_load( data_filename );
 	psd_t *psd = PSD_make_suitable_for_network_analysis(psd_unprocessed, num_time_samples, sampling_frequency, f_low, f_high);
 
@@ -22,6 +22,7 @@
 #include "strain.h"
 #include "spectral_density.h"
 #include "sampling_system.h"
+#include "fft.h"
 #include "hdf5_file.h"
 #include "detector.h"
 #include "detector_network.h"
@@ -176,6 +177,7 @@ void simulate( simulation_settings_t *ps, detector_network_t *net) {
 
 	double *noise = (double*) malloc( ps->num_time_samples * sizeof(double) );
 	double *strain = (double*) malloc( ps->num_time_samples * sizeof(double) );
+	fft_workspace_t *fft_workspace = FFT_workspace_alloc( ps->num_time_samples );
 
 	for (i = 0; i < net->num_detectors; i++) {
 		//asd_t *asd_one_sided = net->detector[i]->asd;
@@ -198,7 +200,7 @@ void simulate( simulation_settings_t *ps, detector_network_t *net) {
 			}
 
 			/* Compute the coloured noise strain series */
-			SS_colour_timeseries( net->detector[i]->psd, ps->num_time_samples, noise);
+			SS_colour_timeseries( net->detector[i]->psd, ps->num_time_samples, noise, fft_workspace);
 
 			char buff2[255];
 			memset(buff2, '\0', 255 * sizeof(char));
@@ -216,6 +218,7 @@ void simulate( simulation_settings_t *ps, detector_network_t *net) {
 		}
 	}
 
+	FFT_workspace_free( fft_workspace );
 	free(strain);
 	free(noise);
 
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "sampling_system.h"
 #include "settings_file.h"
 #include "simulation_settings.h"
 #include "simulation_options.h"
@@ -43,6 +44,9 @@ void simulation_settings_init(int argc, char *argv[], simulation_settings_t *ps)
 	ps->f_low = atof(settings_file_get_value(settings_file, "f_low"));
 	ps->f_high = atof(settings_file_get_value(settings_file, "f_high"));
 	ps->num_time_samples = atoi(settings_file_get_value(settings_file, "num_time_samples"));
+	/* Optional. Nothing has been simulated yet, so a slow length can be replaced before the network is loaded. */
+	ps->num_time_samples = SS_fft_friendly_length( ps->num_time_samples,
+			SS_fft_length_policy_from_string(settings_file_get_value(settings_file, "fft_length_policy")) );
 	ps->sampling_frequency = atof(settings_file_get_value(settings_file, "sampling_frequency"));
 	ps->num_realizations = atoi(settings_file_get_value(settings_file, "num_realizations"));
 
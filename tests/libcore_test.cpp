@@ -25,8 +25,11 @@
 #include "../libcore/detector_antenna_patterns.h"
 #include "../libcore/detector_mapping.h"
 #include "../libcore/detector_network.h"
+#include "../libcore/detector_sky_batch.h"
+#include "../libcore/detector_sky_table.h"
 #include "../libcore/detector_time_delay.h"
 #include "../libcore/detector.h"
+#include "../libcore/fft.h"
 #include "../libcore/hdf5_file.h"
 #include "../libcore/inspiral_chirp_factors.h"
 #include "../libcore/inspiral_chirp.h"
@@ -37,6 +40,11 @@
 #include "../libcore/settings_file.h"
 #include "../libcore/spectral_density.h"
 #include "../libcore/strain.h"
+#include "../libcore/vector_math.h"
+#include "../libpso/inspiral_pso_fitness.h"
+#include "../libpso/parallel.h"
+#include "../libpso/pso.h"
+#include "../libpso/ptapso_maxphase.h"
 
 #ifdef HAVE_GTEST
 
@@ -64,6 +72,159 @@ TEST(SS_make_two_sided, matchesMatlab) {
 	}
 }
 
+TEST(SS_make_analytic, realPartMatchesTwoSided) {
+	size_t M = 6;
+	size_t N = 10;
+	gsl_complex *one_sided = (gsl_complex*) malloc( M * sizeof(gsl_complex) );
+	for (size_t i = 0; i < M; i++) {
+		one_sided[i] = gsl_complex_rect(i + 1.0, 2.0*i - 3.0);
+	}
+
+	gsl_complex *two_sided = (gsl_complex*) malloc( N * sizeof(gsl_complex) );
+	gsl_complex *analytic = (gsl_complex*) malloc( N * sizeof(gsl_complex) );
+
+	SS_make_two_sided (M, one_sided, N, two_sided);
+	SS_make_analytic (M, one_sided, N, analytic);
+
+	// compare the real parts of the inverse DFTs sample by sample
+	for (size_t n = 0; n < N; n++) {
+		double x_two = 0.0;
+		double x_analytic = 0.0;
+		for (size_t k = 0; k < N; k++) {
+			gsl_complex e = gsl_complex_polar(1.0, 2.0 * M_PI * k * n / N);
+			x_two += GSL_REAL( gsl_complex_mul(two_sided[k], e) );
+			x_analytic += GSL_REAL( gsl_complex_mul(analytic[k], e) );
+		}
+		EXPECT_NEAR(x_two, x_analytic, 1e-12);
+	}
+
+	free(one_sided);
+	free(two_sided);
+	free(analytic);
+}
+
+TEST(SS_make_analytic_band, matchesFullSpectrum) {
+	size_t M = 6;
+	size_t N = 10;
+	size_t index_low = 2;
+	size_t index_high = 5;
+	gsl_complex *one_sided = (gsl_complex*) malloc( M * sizeof(gsl_complex) );
+	for (size_t i = 0; i < M; i++) {
+		if (i >= index_low && i <= index_high) {
+			one_sided[i] = gsl_complex_rect(i + 1.0, 2.0*i - 3.0);
+		} else {
+			one_sided[i] = gsl_complex_rect(0.0, 0.0);
+		}
+	}
+
+	gsl_complex *full = (gsl_complex*) malloc( N * sizeof(gsl_complex) );
+	gsl_complex *band = (gsl_complex*) malloc( N * sizeof(gsl_complex) );
+	for (size_t i = 0; i < N; i++) {
+		band[i] = gsl_complex_rect(99.0, 99.0);
+	}
+
+	SS_make_analytic (M, one_sided, N, full);
+	SS_make_analytic_band (M, one_sided, index_low, index_high, N, band);
+
+	for (size_t i = 0; i < N; i++) {
+		EXPECT_EQ(GSL_REAL(full[i]), GSL_REAL(band[i]));
+		EXPECT_EQ(GSL_IMAG(full[i]), GSL_IMAG(band[i]));
+	}
+
+	free(one_sided);
+	free(full);
+	free(band);
+}
+
+TEST(FFT, realMatchesComplexTransform) {
+	size_t sizes[2] = {12, 15};
+
+	for (size_t s = 0; s < 2; s++) {
+		size_t n = sizes[s];
+		double samples[15];
+		double complex_data[2*15];
+		double round_trip[15];
+		gsl_complex half[15/2 + 1];
+
+		for (size_t j = 0; j < n; j++) {
+			samples[j] = sin(0.7*j) + 0.1*j;
+			complex_data[2*j + 0] = samples[j];
+			complex_data[2*j + 1] = 0.0;
+		}
+
+		fft_workspace_t *workspace = FFT_workspace_alloc(n);
+
+		FFT_complex_forward(n, complex_data, workspace);
+		FFT_real_forward(n, samples, half, workspace);
+		for (size_t k = 0; k <= n/2; k++) {
+			EXPECT_NEAR( GSL_REAL(half[k]), complex_data[2*k + 0], 1e-12 );
+			EXPECT_NEAR( GSL_IMAG(half[k]), complex_data[2*k + 1], 1e-12 );
+		}
+
+		FFT_real_inverse(n, half, round_trip, workspace);
+		for (size_t j = 0; j < n; j++) {
+			EXPECT_NEAR( round_trip[j], samples[j], 1e-12 );
+		}
+
+		FFT_complex_inverse(n, complex_data, workspace);
+		for (size_t j = 0; j < n; j++) {
+			EXPECT_NEAR( complex_data[2*j + 0], samples[j], 1e-12 );
+			EXPECT_NEAR( complex_data[2*j + 1], 0.0, 1e-12 );
+		}
+
+		FFT_workspace_free(workspace);
+	}
+}
+
+TEST(FFT, inverseManyMatchesSingleTransforms) {
+	const size_t n = 12;
+	const size_t howmany = 3;
+	double *data = NULL;
+	double expected[2*12*3];
+
+	/* aligned, so that FFTW transforms all of the series with one plan */
+	ASSERT_EQ( 0, posix_memalign((void**) &data, 64, 2 * n * howmany * sizeof(double)) );
+
+	for (size_t j = 0; j < 2 * n * howmany; j++) {
+		data[j] = cos(0.3*j) + 0.05*j;
+		expected[j] = data[j];
+	}
+
+	fft_workspace_t *workspace = FFT_workspace_alloc(n);
+
+	for (size_t m = 0; m < howmany; m++) {
+		FFT_complex_inverse(n, expected + 2*n*m, workspace);
+	}
+	FFT_complex_inverse_many(n, howmany, data, workspace);
+	for (size_t j = 0; j < 2 * n * howmany; j++) {
+		EXPECT_NEAR( expected[j], data[j], 1e-12 );
+	}
+
+	/* the workspace gets its plans from the cache again after it is cleared */
+	FFT_plan_cache_clear();
+	FFT_complex_inverse_many(n, 1, data, workspace);
+	FFT_complex_inverse(n, expected, workspace);
+	for (size_t j = 0; j < 2 * n; j++) {
+		EXPECT_NEAR( expected[j], data[j], 1e-12 );
+	}
+
+	FFT_workspace_free(workspace);
+	free(data);
+}
+
+TEST(SS_fft_friendly_length, padsAndCrops) {
+	EXPECT_TRUE( SS_is_fft_friendly(131072) );
+	EXPECT_FALSE( SS_is_fft_friendly(131074) );
+	EXPECT_FALSE( SS_is_fft_friendly(135) );
+
+	EXPECT_EQ( 131220u, SS_fft_friendly_length(131074, SS_FFT_LENGTH_PAD) );
+	EXPECT_EQ( 131072u, SS_fft_friendly_length(131074, SS_FFT_LENGTH_CROP) );
+	EXPECT_EQ( 131074u, SS_fft_friendly_length(131074, SS_FFT_LENGTH_KEEP) );
+	EXPECT_EQ( 120u, SS_fft_friendly_length(120, SS_FFT_LENGTH_PAD) );
+
+	EXPECT_GT( FFT_cost_estimate(131074) / FFT_cost_estimate(131072), 10.0 );
+}
+
 TEST(find_index_low, left_end) {
 	size_t N = 100;
 	double f_array[N];
@@ -522,6 +683,137 @@ TEST(Detector_time_delay, matchesMatlab_T1) {
 
 
 
+TEST(Detector_Sky_Batch_compute, matchesAntennaPatternsAndTimeDelay) {
+	size_t num_detectors = 7;
+	size_t num_skies = 1003; // more than one block, and a tail for the vector loops
+	double polarization_angle = 0.7;
+	DETECTOR_ID ids[7] = {L1, H1, H2, V1, K1, G1, T1};
+
+	detector_t *detectors[7];
+	for (size_t i = 0; i < num_detectors; i++) {
+		psd_t *psd = PSD_alloc(10);
+		psd->type = PSD_ONE_SIDED;
+		detectors[i] = Detector_alloc();
+		Detector_init(ids[i], psd, detectors[i]);
+	}
+
+	sky_t *skies = (sky_t*) malloc( num_skies * sizeof(sky_t) );
+	for (size_t k = 0; k < num_skies; k++) {
+		skies[k].ra = -M_PI + 2.0 * M_PI * k / num_skies;
+		skies[k].dec = 0.5 * M_PI * sin(0.37 * k);
+	}
+
+	double *u = (double*) malloc( num_detectors * num_skies * sizeof(double) );
+	double *v = (double*) malloc( num_detectors * num_skies * sizeof(double) );
+	double *f_plus = (double*) malloc( num_detectors * num_skies * sizeof(double) );
+	double *f_cross = (double*) malloc( num_detectors * num_skies * sizeof(double) );
+	double *time_delay = (double*) malloc( num_detectors * num_skies * sizeof(double) );
+
+	detector_sky_batch_t *batch = Detector_Sky_Batch_alloc(num_detectors, detectors);
+	detector_antenna_patterns_workspace_t *ws = Detector_Antenna_Patterns_workspace_alloc();
+
+	for (int level = VM_SIMD_NONE; level <= VM_SIMD_AVX512; level++) {
+		VM_set_simd_level( (VM_SIMD_LEVEL) level );
+		Detector_Sky_Batch_compute(batch, num_skies, skies, polarization_angle, u, v, f_plus, f_cross, time_delay);
+
+		for (size_t i = 0; i < num_detectors; i++) {
+			for (size_t k = 0; k < num_skies; k++) {
+				detector_antenna_patterns_t ap;
+				double td;
+				Detector_Antenna_Patterns_compute(detectors[i], &skies[k], polarization_angle, ws, &ap);
+				Detector_time_delay(detectors[i], &skies[k], &td);
+
+				ASSERT_NEAR( u[i*num_skies + k], ap.u, 1e-14 );
+				ASSERT_NEAR( v[i*num_skies + k], ap.v, 1e-14 );
+				ASSERT_NEAR( f_plus[i*num_skies + k], ap.f_plus, 1e-14 );
+				ASSERT_NEAR( f_cross[i*num_skies + k], ap.f_cross, 1e-14 );
+				ASSERT_NEAR( time_delay[i*num_skies + k], td, 1e-16 );
+			}
+		}
+	}
+	VM_set_simd_level(VM_SIMD_AVX512);
+
+	/* outputs that aren't needed are skipped */
+	Detector_Sky_Batch_compute(batch, num_skies, skies, polarization_angle, NULL, NULL, NULL, NULL, time_delay);
+
+	Detector_Antenna_Patterns_workspace_free(ws);
+	Detector_Sky_Batch_free(batch);
+	free(u);
+	free(v);
+	free(f_plus);
+	free(f_cross);
+	free(time_delay);
+	free(skies);
+	for (size_t i = 0; i < num_detectors; i++) {
+		Detector_free(detectors[i]);
+	}
+}
+
+TEST(Detector_Sky_Table, lookupWithinErrorBound) {
+	size_t num_detectors = 3;
+	DETECTOR_ID ids[3] = {H1, L1, V1};
+	char filename[] = "Detector_Sky_Table_test.bin";
+
+	detector_t *detectors[3];
+	for (size_t i = 0; i < num_detectors; i++) {
+		psd_t *psd = PSD_alloc(10);
+		psd->type = PSD_ONE_SIDED;
+		detectors[i] = Detector_alloc();
+		Detector_init(ids[i], psd, detectors[i]);
+	}
+
+	detector_sky_table_t *table = Detector_Sky_Table_build(num_detectors, detectors, 0.02);
+	EXPECT_NEAR( 4e-4, table->error_bound_uv, 1e-4 );
+	EXPECT_TRUE( Detector_Sky_Table_matches(table, num_detectors, detectors) );
+	EXPECT_FALSE( Detector_Sky_Table_matches(table, num_detectors - 1, detectors) );
+	EXPECT_TRUE( Detector_Sky_Table_has_resolution(table, 0.02) );
+	EXPECT_TRUE( Detector_Sky_Table_has_resolution(table, 0.05) );
+	EXPECT_FALSE( Detector_Sky_Table_has_resolution(table, 0.01) );
+
+	remove(filename);
+	EXPECT_TRUE( Detector_Sky_Table_load(filename) == NULL );
+	Detector_Sky_Table_save(table, filename);
+	detector_sky_table_t *loaded = Detector_Sky_Table_load(filename);
+	ASSERT_TRUE( loaded != NULL );
+	remove(filename);
+
+	detector_sky_batch_t *batch = Detector_Sky_Batch_alloc(num_detectors, detectors);
+	double max_error_uv = 0.0;
+	double max_error_td = 0.0;
+	for (size_t k = 0; k < 2000; k++) {
+		sky_t sky;
+		sky.ra = -7.0 + 14.0 * k / 2000.0; // more than one turn, either side of zero
+		sky.dec = 0.5 * M_PI * sin(0.61 * k); // includes the poles' neighbourhood
+
+		double u[3], v[3], td[3], u_table[3], v_table[3], td_table[3], u_loaded[3];
+		Detector_Sky_Batch_compute(batch, 1, &sky, 0.0, u, v, NULL, NULL, td);
+		ASSERT_EQ( 0, Detector_Sky_Table_lookup(table, &sky, 1, u_table, v_table, td_table) );
+		ASSERT_EQ( 0, Detector_Sky_Table_lookup(loaded, &sky, 1, u_loaded, NULL, NULL) );
+
+		for (size_t i = 0; i < num_detectors; i++) {
+			max_error_uv = GSL_MAX( max_error_uv, GSL_MAX(fabs(u_table[i] - u[i]), fabs(v_table[i] - v[i])) );
+			max_error_td = GSL_MAX( max_error_td, fabs(td_table[i] - td[i]) );
+			EXPECT_EQ( u_table[i], u_loaded[i] );
+		}
+	}
+	EXPECT_LT( max_error_uv, table->error_bound_uv );
+	EXPECT_LT( max_error_td, table->error_bound_time_delay );
+	EXPECT_GT( max_error_uv, 0.0 );
+
+	sky_t outside;
+	outside.ra = 0.0;
+	outside.dec = 2.0;
+	double u[3];
+	EXPECT_EQ( -1, Detector_Sky_Table_lookup(table, &outside, 1, u, NULL, NULL) );
+
+	Detector_Sky_Batch_free(batch);
+	Detector_Sky_Table_free(loaded);
+	Detector_Sky_Table_free(table);
+	for (size_t i = 0; i < num_detectors; i++) {
+		Detector_free(detectors[i]);
+	}
+}
+
 TEST(ChirpTime, matchesMatlab) {
 	// Inputs needed to compute the chirp times and other values
 	double m1 = 1.4 * GSL_CONST_MKSA_SOLAR_MASS;
@@ -661,6 +953,115 @@ TEST(SP_compute, valuesMatcheMatlabVersion) {
 	SP_workspace_free(w);
 }
 
+TEST(VM_sincos, matchesLibm) {
+	size_t n = 1003;
+	double *x = (double*) malloc( n * sizeof(double) );
+	double *s = (double*) malloc( n * sizeof(double) );
+	double *c = (double*) malloc( n * sizeof(double) );
+	for (size_t i = 0; i < n; i++) {
+		x[i] = (i - 500.0) * 997.13 + 0.1 * i;
+	}
+	x[3] = 5.0e6; // beyond the vector range reduction
+
+	for (int level = VM_SIMD_NONE; level <= VM_SIMD_AVX512; level++) {
+		VM_set_simd_level( (VM_SIMD_LEVEL) level );
+		VM_sincos(n, x, s, c);
+		for (size_t i = 0; i < n; i++) {
+			ASSERT_NEAR( s[i], sin(x[i]), 1e-15 );
+			ASSERT_NEAR( c[i], cos(x[i]), 1e-15 );
+		}
+	}
+	VM_set_simd_level(VM_SIMD_AVX512);
+
+	free(x);
+	free(s);
+	free(c);
+}
+
+TEST(SP_compute, simdMatchesScalar) {
+	size_t len_f_array = 4099;
+	double *f_array = (double*) malloc( len_f_array * sizeof(double) );
+	for (size_t i = 0; i < len_f_array; i++) {
+		f_array[i] = 0.25 * i;
+	}
+
+	inspiral_chirp_time_t ct;
+	ct.chirp_time0 = 30.0;
+	ct.chirp_time1 = 1.2;
+	ct.chirp_time1_5 = 2.5;
+	ct.chirp_time2 = 0.4;
+	ct.tc = 34.1;
+
+	stationary_phase_workspace_t *w = SP_workspace_alloc(10.0, 1000.0, len_f_array, f_array);
+	stationary_phase_t *ref = SP_alloc(len_f_array);
+	stationary_phase_t *s = SP_alloc(len_f_array);
+
+	VM_set_simd_level(VM_SIMD_NONE);
+	SP_compute(0.013, 0.037, 0.3, &ct, w, ref);
+
+	for (int level = VM_SIMD_AVX2; level <= VM_SIMD_AVX512; level++) {
+		VM_set_simd_level( (VM_SIMD_LEVEL) level );
+		SP_compute(0.013, 0.037, 0.3, &ct, w, s);
+		for (size_t i = 0; i < s->len; i++) {
+			ASSERT_NEAR( GSL_REAL(s->spa_0[i]), GSL_REAL(ref->spa_0[i]), 1e-12);
+			ASSERT_NEAR( GSL_IMAG(s->spa_0[i]), GSL_IMAG(ref->spa_0[i]), 1e-12);
+		}
+	}
+	VM_set_simd_level(VM_SIMD_AVX512);
+
+	SP_free(ref);
+	SP_free(s);
+	SP_workspace_free(w);
+	free(f_array);
+}
+
+TEST(SP_compute_batch, matchesSP_compute) {
+	size_t len_f_array = 4099;
+	size_t num_templates = 5;
+	double *f_array = (double*) malloc( len_f_array * sizeof(double) );
+	for (size_t i = 0; i < len_f_array; i++) {
+		f_array[i] = 0.25 * i;
+	}
+
+	stationary_phase_workspace_t *w = SP_workspace_alloc(10.0, 1000.0, len_f_array, f_array);
+
+	// capacity smaller than the number of templates so that the chunking is used
+	stationary_phase_batch_workspace_t *batch = SP_batch_workspace_alloc(2, w);
+
+	inspiral_chirp_time_t chirps[5];
+	double delays[5];
+	double phases[5];
+	stationary_phase_t *sp[5];
+	for (size_t b = 0; b < num_templates; b++) {
+		chirps[b].chirp_time0 = 1.0 + b;
+		chirps[b].chirp_time1 = 0.2 + 0.1*b;
+		chirps[b].chirp_time1_5 = 0.5 - 0.05*b;
+		chirps[b].chirp_time2 = 0.04;
+		chirps[b].tc = 1.5 + b;
+		delays[b] = 0.01 * b;
+		phases[b] = 0.1 * b;
+		sp[b] = SP_alloc(len_f_array);
+	}
+
+	SP_compute_batch(num_templates, delays, 0.037, phases, chirps, w, batch, sp);
+
+	stationary_phase_t *ref = SP_alloc(len_f_array);
+	for (size_t b = 0; b < num_templates; b++) {
+		SP_compute(delays[b], 0.037, phases[b], &chirps[b], w, ref);
+		// the matrix product sums the phase terms in a different order, so allow for the rounding of a large phase
+		for (size_t i = 0; i < ref->len; i++) {
+			ASSERT_NEAR( GSL_REAL(sp[b]->spa_0[i]), GSL_REAL(ref->spa_0[i]), 1e-9);
+			ASSERT_NEAR( GSL_IMAG(sp[b]->spa_0[i]), GSL_IMAG(ref->spa_0[i]), 1e-9);
+		}
+		SP_free(sp[b]);
+	}
+
+	SP_free(ref);
+	SP_batch_workspace_free(batch);
+	SP_workspace_free(w);
+	free(f_array);
+}
+
 TEST(SP_normalization, valuesMatchMatlabVersion) {
 	double f_low = 1.1;
 	double f_high = 9.0;
@@ -687,7 +1088,6 @@ TEST(SP_normalization, valuesMatchMatlabVersion) {
 
 TEST(coherent_network_statistic, CN_do_work) {
 	size_t i;
-	size_t num_time_samples = 10;
 	size_t half_size = 6;
 	size_t f_low_index = 1;
 	size_t f_high_index = 3;
@@ -725,52 +1125,78 @@ TEST(coherent_network_statistic, CN_do_work) {
 		temp[i] = gsl_complex_rect(0.0, 0.0);
 	}
 
-	gsl_complex *out_c = (gsl_complex*) malloc( num_time_samples * sizeof(gsl_complex) );
-	for (i = 0; i < num_time_samples; i++) {
-		out_c[i] = gsl_complex_rect(0.0, 0.0);
-	}
-
-	CN_do_work(num_time_samples, f_low_index, f_high_index, spa,
-			asd, half_fft_data, temp, out_c);
+	CN_do_work(f_low_index, f_high_index, spa,
+			asd, half_fft_data, temp);
 
-	/*for (i = 0; i < num_time_samples; i++) {
-		printf("%0.21e \t %0.21e\n", GSL_REAL(out_c[i]), GSL_IMAG(out_c[i]));
+	/*for (i = 0; i < half_size; i++) {
+		printf("%0.21e \t %0.21e\n", GSL_REAL(temp[i]), GSL_IMAG(temp[i]));
 	}*/
-	ASSERT_NEAR( GSL_REAL(out_c[0]), -14.0, 1e-9);
-	ASSERT_NEAR( GSL_IMAG(out_c[0]), 7.0, 1e-9);
+	// only the band [f_low_index, f_high_index] is written
+	ASSERT_NEAR( GSL_REAL(temp[0]), 0.0, 1e-9);
+	ASSERT_NEAR( GSL_IMAG(temp[0]), 0.0, 1e-9);
 
-	ASSERT_NEAR( GSL_REAL(out_c[1]), -0.80, 1e-9);
-	ASSERT_NEAR( GSL_IMAG(out_c[1]), -1.4, 1e-9);
+	ASSERT_NEAR( GSL_REAL(temp[1]), -0.80, 1e-9);
+	ASSERT_NEAR( GSL_IMAG(temp[1]), -1.4, 1e-9);
 
-	ASSERT_NEAR( GSL_REAL(out_c[2]), 0.8, 1e-9);
-	ASSERT_NEAR( GSL_IMAG(out_c[2]), 3.8, 1e-9);
+	ASSERT_NEAR( GSL_REAL(temp[2]), 0.8, 1e-9);
+	ASSERT_NEAR( GSL_IMAG(temp[2]), 3.8, 1e-9);
 
-	ASSERT_NEAR( GSL_REAL(out_c[3]), 0.0, 1e-9);
-	ASSERT_NEAR( GSL_IMAG(out_c[3]), 0.533333333333333, 1e-9);
+	ASSERT_NEAR( GSL_REAL(temp[3]), 0.0, 1e-9);
+	ASSERT_NEAR( GSL_IMAG(temp[3]), 0.533333333333333, 1e-9);
+
+	ASSERT_NEAR( GSL_REAL(temp[4]), 0.0, 1e-9);
+	ASSERT_NEAR( GSL_IMAG(temp[4]), 0.0, 1e-9);
+
+	ASSERT_NEAR( GSL_REAL(temp[5]), 0.0, 1e-9);
+	ASSERT_NEAR( GSL_IMAG(temp[5]), 0.0, 1e-9);
+
+	ASD_free(asd);
+	free(spa);
+	free(half_fft_data);
+	free(temp);
+}
 
-	ASSERT_NEAR( GSL_REAL(out_c[4]), 1.4, 1e-9);
-	ASSERT_NEAR( GSL_IMAG(out_c[4]), 1.4, 1e-9);
+TEST(coherent_network_statistic, CN_do_work_whitened_matchesCN_do_work) {
+	size_t i;
+	size_t half_size = 6;
+	size_t f_low_index = 1;
+	size_t f_high_index = 4;
+	size_t band_len = f_high_index - f_low_index + 1;
 
-	ASSERT_NEAR( GSL_REAL(out_c[5]), 6.0, 1e-9);
-	ASSERT_NEAR( GSL_IMAG(out_c[5]), 2.5, 1e-9);
+	asd_t *asd = ASD_alloc( half_size );
+	asd->type = ASD_ONE_SIDED;
+	gsl_complex *spa = (gsl_complex*) malloc( half_size * sizeof(gsl_complex) );
+	gsl_complex *half_fft_data = (gsl_complex*) malloc( half_size * sizeof(gsl_complex) );
+	gsl_complex *whitened = (gsl_complex*) malloc( band_len * sizeof(gsl_complex) );
+	gsl_complex *temp = (gsl_complex*) malloc( half_size * sizeof(gsl_complex) );
+	gsl_complex *temp_whitened = (gsl_complex*) malloc( band_len * sizeof(gsl_complex) );
 
-	ASSERT_NEAR( GSL_REAL(out_c[6]), 1.4, 1e-9);
-	ASSERT_NEAR( GSL_IMAG(out_c[6]), -1.4, 1e-9);
+	for (i = 0; i < half_size; i++ ) {
+		asd->f[i] = i;
+		asd->asd[i] = 1.0 + 3.0*i;
+		spa[i] = gsl_complex_rect(i, 2.0 - i);
+		half_fft_data[i] = gsl_complex_rect(7.0 - i, 0.5*i);
+		temp[i] = gsl_complex_rect(0.0, 0.0);
+	}
 
-	ASSERT_NEAR( GSL_REAL(out_c[7]), 0.0, 1e-9);
-	ASSERT_NEAR( GSL_IMAG(out_c[7]), -0.533333333333333, 1e-9);
+	for (i = f_low_index; i <= f_high_index; i++) {
+		whitened[i - f_low_index] = gsl_complex_div_real(half_fft_data[i], asd->asd[i]);
+	}
 
-	ASSERT_NEAR( GSL_REAL(out_c[8]), 0.8, 1e-9);
-	ASSERT_NEAR( GSL_IMAG(out_c[8]), -3.8, 1e-9);
+	CN_do_work(f_low_index, f_high_index, spa, asd, half_fft_data, temp);
+	CN_do_work_whitened(band_len, spa + f_low_index, whitened, temp_whitened);
 
-	ASSERT_NEAR( GSL_REAL(out_c[9]), -0.8, 1e-9);
-	ASSERT_NEAR( GSL_IMAG(out_c[9]), 1.4, 1e-9);
+	for (i = f_low_index; i <= f_high_index; i++) {
+		EXPECT_NEAR( GSL_REAL(temp[i]), GSL_REAL(temp_whitened[i - f_low_index]), 1e-12);
+		EXPECT_NEAR( GSL_IMAG(temp[i]), GSL_IMAG(temp_whitened[i - f_low_index]), 1e-12);
+	}
 
 	ASD_free(asd);
 	free(spa);
 	free(half_fft_data);
+	free(whitened);
 	free(temp);
-	free(out_c);
+	free(temp_whitened);
 }
 
 TEST(coherent_network_statistic, CN_compute_valuesMatchMatlabVersion) {
@@ -838,38 +1264,1982 @@ TEST(coherent_network_statistic, CN_compute_valuesMatchMatlabVersion) {
 			&network_snr_index,
 			NULL);
 
-	/*
-	for (int i = 0; i < num_detectors; i++) {
-		for (int j = 0; j < num_time_samples; j++) {
-			gsl_complex z = ws->helpers[i]->c_plus[j];
-		    fprintf(stderr, "Detector %d: c_plus = %0.21e %0.21e\n",
-		    		i, GSL_REAL(z), GSL_IMAG(z));
+	EXPECT_NEAR( network_snr, 1.307720293350521867382, 1e-12);
+
+	//fprintf(stderr, "network snr = %0.21e\n", network_snr);
+
+	CN_workspace_free(ws);
+
+	Detector_Network_free(net);
+
+	network_strain_half_fft_free(network_strain);
+
+}
+
+/* The data of the synthetic networks of the coherent network statistic tests: bin k of detector i is
+ * cos(a*k + i) + i sin(b*k - i). */
+static network_strain_half_fft_t* test_network_strain_alloc(size_t num_detectors, size_t num_time_samples,
+		double a, double b) {
+	network_strain_half_fft_t *network_strain = network_strain_half_fft_alloc(num_detectors, num_time_samples);
+	for (size_t i = 0; i < num_detectors; i++) {
+		for (size_t k = 0; k < network_strain->strains[i]->half_fft_len; k++) {
+			network_strain->strains[i]->half_fft[k] = gsl_complex_rect(cos(a*k + i), sin(b*k - i));
 		}
-		fprintf(stderr, "\n\n");
-	}*/
-	gsl_complex z = ws->helpers[0]->c_plus[0];
-	EXPECT_NEAR( GSL_REAL(z), 0.0, 1e-12 );
-	EXPECT_NEAR( GSL_IMAG(z), 0.0, 1e-12 );
+	}
+	return network_strain;
+}
+
+/* The first num_detectors of H1, L1 and V1, with the one sided PSD of detector i equal to 1 + 0.1*i. */
+static detector_network_t* test_network_alloc(size_t num_detectors, size_t len_f_array) {
+	DETECTOR_ID ids[3] = {H1,L1,V1};
 
-	z = ws->helpers[0]->c_plus[4];
-	EXPECT_NEAR( GSL_REAL(z), -0.438120135833806, 1e-12 );
-	EXPECT_NEAR( GSL_IMAG(z), -0.240969309587590, 1e-12 );
+	detector_network_t *net = Detector_Network_alloc( num_detectors );
+	for (size_t i = 0; i < num_detectors; i++) {
+		psd_t *psd = PSD_alloc(len_f_array);
+		for (size_t k = 0; k < len_f_array; k++) {
+			psd->f[k] = k;
+			psd->psd[k] = 1.0 + 0.1*i;
+			psd->type = PSD_ONE_SIDED;
+		}
+		Detector_init(ids[i], psd, net->detector[i]);
+	}
+	return net;
+}
 
-	z = ws->helpers[0]->c_plus[6];
-	EXPECT_NEAR( GSL_REAL(z), -0.438120135833806, 1e-12 );
-	EXPECT_NEAR( GSL_IMAG(z), 0.240969309587590, 1e-12 );
+TEST(coherent_network_statistic_batch, matchesSingleTemplate) {
+	size_t num_detectors = 3;
+	size_t num_time_samples = 16;
+	size_t num_templates = 5;
+	double f_low = 1.0;
+	double f_high = 6.0;
 
-	EXPECT_NEAR( network_snr, 1.307720293350521867382, 1e-12);
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 1.0, 2.0);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	inspiral_chirp_time_t chirps[5];
+	sky_t skies[5];
+	for (size_t b = 0; b < num_templates; b++) {
+		chirps[b].chirp_time0 = 4.0 + b;
+		chirps[b].chirp_time1 = 5.0;
+		chirps[b].chirp_time1_5 = 6.0 - 0.5*b;
+		chirps[b].chirp_time2 = 7.0;
+		chirps[b].tc = chirps[b].chirp_time0 + chirps[b].chirp_time1 - chirps[b].chirp_time1_5 + chirps[b].chirp_time2;
+		skies[b].ra = -2.0 + b;
+		skies[b].dec = 0.3 * b - 0.5;
+	}
 
-	//fprintf(stderr, "network snr = %0.21e\n", network_snr);
+	/* the capacity is smaller than the number of templates so that more than one batch is used */
+	coherent_network_workspace_t *ws = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_batch_workspace_t *batch = CN_batch_workspace_alloc(
+			2, num_time_samples, net, len_f_array, f_low, f_high);
+
+	double values[5];
+	int indices[5];
+	coherent_network_statistic_batch(net, num_templates, chirps, skies, network_strain, batch, values, indices);
+
+	for (size_t b = 0; b < num_templates; b++) {
+		double value;
+		int index;
+		coherent_network_statistic(net, f_low, f_high, &chirps[b], &skies[b], network_strain, ws, &value, &index, NULL);
+
+		EXPECT_NEAR( values[b], value, 1e-10 * value );
+		EXPECT_EQ( indices[b], index );
+	}
+
+	CN_batch_workspace_free(batch);
+	CN_workspace_free(ws);
+
+	Detector_Network_free(net);
+
+	network_strain_half_fft_free(network_strain);
+}
+
+TEST(coherent_network_statistic, reducedIfftLength) {
+	size_t num_detectors = 2;
+	size_t num_time_samples = 16;
+	size_t num_templates = 3;
+	double f_low = 1.0;
+	double f_high = 6.0;
 
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 1.0, 2.0);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	inspiral_chirp_time_t chirps[3];
+	sky_t skies[3];
+	for (size_t b = 0; b < num_templates; b++) {
+		chirps[b].chirp_time0 = 4.0 + b;
+		chirps[b].chirp_time1 = 5.0;
+		chirps[b].chirp_time1_5 = 6.0 - 0.5*b;
+		chirps[b].chirp_time2 = 7.0;
+		chirps[b].tc = chirps[b].chirp_time0 + chirps[b].chirp_time1 - chirps[b].chirp_time1_5 + chirps[b].chirp_time2;
+		skies[b].ra = -2.0 + b;
+		skies[b].dec = 0.3 * b - 0.5;
+	}
+
+	coherent_network_workspace_t *ws = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_batch_workspace_t *batch = CN_batch_workspace_alloc(
+			2, num_time_samples, net, len_f_array, f_low, f_high);
+
+	/* bins 0 to 6 fit in 8, so decimating gives every second time sample */
+	CN_workspace_set_reduction(ws, CN_REDUCTION_DECIMATE);
+	EXPECT_EQ( 8u, ws->ifft_len );
+
+	for (size_t b = 0; b < num_templates; b++) {
+		double value, reduced_value;
+		int index, reduced_index;
+
+		CN_workspace_set_reduction(ws, CN_REDUCTION_NONE);
+		coherent_network_statistic(net, f_low, f_high, &chirps[b], &skies[b], network_strain, ws, &value, &index, NULL);
+		CN_workspace_set_reduction(ws, CN_REDUCTION_DECIMATE);
+		coherent_network_statistic(net, f_low, f_high, &chirps[b], &skies[b], network_strain, ws, &reduced_value, &reduced_index, NULL);
+
+		EXPECT_LE( reduced_value, value * (1.0 + 1e-12) );
+		EXPECT_EQ( 0, reduced_index % 2 );
+		if (index % 2 == 0) {
+			EXPECT_NEAR( reduced_value, value, 1e-10 * value );
+			EXPECT_EQ( index, reduced_index );
+		}
+	}
+
+	/* the batch uses the same reduced series */
+	CN_workspace_set_reduction(ws, CN_REDUCTION_HETERODYNE);
+	CN_workspace_set_reduction(batch->workspace, CN_REDUCTION_HETERODYNE);
+	EXPECT_EQ( 6u, ws->ifft_len );
+
+	double values[3];
+	int indices[3];
+	coherent_network_statistic_batch(net, num_templates, chirps, skies, network_strain, batch, values, indices);
+
+	for (size_t b = 0; b < num_templates; b++) {
+		double value;
+		int index;
+		coherent_network_statistic(net, f_low, f_high, &chirps[b], &skies[b], network_strain, ws, &value, &index, NULL);
+
+		EXPECT_NEAR( values[b], value, 1e-10 * value );
+		EXPECT_EQ( indices[b], index );
+	}
+
+	CN_batch_workspace_free(batch);
+	CN_workspace_free(ws);
+
+	Detector_Network_free(net);
+
+	network_strain_half_fft_free(network_strain);
+}
+
+TEST(coherent_network_statistic, skyCacheMatchesFft) {
+	size_t num_detectors = 3;
+	size_t num_time_samples = 64;
+	double f_low = 3.0;
+	double f_high = 20.0;
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	inspiral_chirp_time_t chirp;
+	chirp.chirp_time0 = 4.0;
+	chirp.chirp_time1 = 5.0;
+	chirp.chirp_time1_5 = 6.0;
+	chirp.chirp_time2 = 7.0;
+	chirp.tc = 10.0;
+
+	coherent_network_workspace_t *ws = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_workspace_t *cached = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	CN_workspace_enable_sky_cache(cached, 2, 16);
+
+	for (size_t s = 0; s < 4; s++) {
+		sky_t sky;
+		sky.ra = -2.0 + s;
+		sky.dec = 0.3 * s - 0.5;
+
+		double value, cached_value;
+		int index, cached_index;
+		coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, NULL);
+		coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, cached, &cached_value, &cached_index, NULL);
+
+		EXPECT_NEAR( cached_value, value, 1e-3 * value );
+		EXPECT_EQ( index, cached_index );
+	}
+
+	/* the series are only computed for the first sky position */
+	EXPECT_EQ( 1u, cached->sky_cache->misses );
+	EXPECT_EQ( 3u, cached->sky_cache->hits );
+
+	CN_workspace_free(cached);
 	CN_workspace_free(ws);
 
 	Detector_Network_free(net);
 
 	network_strain_half_fft_free(network_strain);
+}
+
+TEST(coherent_network_statistic, threadsMatchSerial) {
+	size_t num_detectors = 3;
+	size_t num_time_samples = 64;
+	double f_low = 3.0;
+	double f_high = 20.0;
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	inspiral_chirp_time_t chirp;
+	chirp.chirp_time0 = 4.0;
+	chirp.chirp_time1 = 5.0;
+	chirp.chirp_time1_5 = 6.0;
+	chirp.chirp_time2 = 7.0;
+	chirp.tc = 10.0;
+
+	coherent_network_workspace_t *ws = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_workspace_t *threaded = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	CN_workspace_set_num_threads(threaded, 4);
+
+	for (size_t s = 0; s < 3; s++) {
+		sky_t sky;
+		sky.ra = -2.0 + s;
+		sky.dec = 0.3 * s - 0.5;
+
+		/* the reduced length has to be handled by the second FFT workspace too */
+		CN_REDUCTION reduction = (s == 2) ? CN_REDUCTION_HETERODYNE : CN_REDUCTION_NONE;
+		CN_workspace_set_reduction(ws, reduction);
+		CN_workspace_set_reduction(threaded, reduction);
+
+		double value, threaded_value;
+		int index, threaded_index;
+		coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, NULL);
+		coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, threaded, &threaded_value, &threaded_index, NULL);
+
+		EXPECT_EQ( value, threaded_value );
+		EXPECT_EQ( index, threaded_index );
+	}
+
+	CN_workspace_free(threaded);
+	CN_workspace_free(ws);
+
+	Detector_Network_free(net);
 
+	network_strain_half_fft_free(network_strain);
 }
 
-#endif
 
+TEST(coherent_network_statistic, tcWindowMatchesFullSeries) {
+	size_t num_detectors = 3;
+	size_t num_time_samples = 64;
+	double f_low = 3.0;
+	double f_high = 20.0;
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	inspiral_chirp_time_t chirp;
+	chirp.chirp_time0 = 4.0;
+	chirp.chirp_time1 = 5.0;
+	chirp.chirp_time1_5 = 6.0;
+	chirp.chirp_time2 = 7.0;
+	chirp.tc = 10.0;
+
+	sky_t sky;
+	sky.ra = 1.0;
+	sky.dec = 0.2;
+
+	coherent_network_workspace_t *ws = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_workspace_t *windowed = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+
+	double value, windowed_value;
+	int index, windowed_index;
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, NULL);
+
+	/* The data is sampled at 64 Hz. The second window wraps around the end. */
+	size_t starts[2] = {10, 59};
+	size_t lens[2] = {16, 9};
+	for (size_t w = 0; w < 2; w++) {
+		double t_min = (double) ((int) starts[w] - (w == 1 ? 64 : 0)) / 64.0;
+		CN_workspace_set_tc_window(windowed, t_min, t_min + (lens[w] - 1) / 64.0);
+		ASSERT_EQ( starts[w], windowed->tc_window->start );
+		ASSERT_EQ( lens[w], windowed->tc_window->len );
+
+		coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, windowed, &windowed_value, &windowed_index, NULL);
+
+		double max_value = -1.0;
+		size_t max_index = 0;
+		for (size_t m = 0; m < lens[w]; m++) {
+			size_t j = (starts[w] + m) % num_time_samples;
+			EXPECT_NEAR( ws->temp_ifft[j], windowed->temp_ifft[m], 1e-9 * ws->temp_ifft[j] );
+			if (ws->temp_ifft[j] > max_value) {
+				max_value = ws->temp_ifft[j];
+				max_index = j;
+			}
+		}
+		EXPECT_NEAR( sqrt(max_value / 2.0), windowed_value, 1e-9 * windowed_value );
+		EXPECT_EQ( (int) max_index, windowed_index );
+	}
+
+	CN_workspace_clear_tc_window(windowed);
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, windowed, &windowed_value, &windowed_index, NULL);
+	EXPECT_EQ( value, windowed_value );
+	EXPECT_EQ( index, windowed_index );
+
+	CN_workspace_free(windowed);
+	CN_workspace_free(ws);
+
+	Detector_Network_free(net);
+
+	network_strain_half_fft_free(network_strain);
+}
+
+
+/* Checks that the statistic of a window from start with len samples matches the full series, and returns the
+ * number of blocks and of transformed blocks the window uses. The data lasts 1 s. */
+static void test_tc_window_matches_full_series(size_t num_time_samples, double f_low, double f_high, size_t start,
+		size_t len, size_t *num_blocks, size_t *num_active) {
+	size_t num_detectors = 2;
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	inspiral_chirp_time_t chirp;
+	chirp.chirp_time0 = 4.0;
+	chirp.chirp_time1 = 5.0;
+	chirp.chirp_time1_5 = 6.0;
+	chirp.chirp_time2 = 7.0;
+	chirp.tc = 10.0;
+
+	sky_t sky;
+	sky.ra = 1.0;
+	sky.dec = 0.2;
+
+	coherent_network_workspace_t *ws = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_workspace_t *windowed = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+
+	double value, windowed_value;
+	int index, windowed_index;
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, NULL);
+
+	double t_min = (double) start / num_time_samples;
+	CN_workspace_set_tc_window(windowed, t_min, t_min + (len - 1.0) / num_time_samples);
+	ASSERT_EQ( start, windowed->tc_window->start );
+	ASSERT_EQ( len, windowed->tc_window->len );
+	*num_blocks = windowed->tc_window->num_blocks;
+	*num_active = windowed->tc_window->num_active;
+
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, windowed, &windowed_value, &windowed_index, NULL);
+
+	double max_value = -1.0;
+	size_t max_index = 0;
+	for (size_t m = 0; m < len; m++) {
+		size_t j = (start + m) % num_time_samples;
+		EXPECT_NEAR( ws->temp_ifft[j], windowed->temp_ifft[m], 1e-9 * ws->temp_ifft[j] );
+		if (ws->temp_ifft[j] > max_value) {
+			max_value = ws->temp_ifft[j];
+			max_index = j;
+		}
+	}
+	EXPECT_NEAR( sqrt(max_value / 2.0), windowed_value, 1e-9 * windowed_value );
+	EXPECT_EQ( (int) max_index, windowed_index );
+
+	CN_workspace_free(windowed);
+	CN_workspace_free(ws);
+
+	Detector_Network_free(net);
+
+	network_strain_half_fft_free(network_strain);
+}
+
+TEST(coherent_network_statistic, tcWindowOnlyTransformsBlocksOfTheBand) {
+	size_t num_blocks, num_active;
+
+	/* The 3 bins of the band are in 3 of the blocks */
+	test_tc_window_matches_full_series(256, 3.0, 5.0, 100, 20, &num_blocks, &num_active);
+	EXPECT_GT( num_blocks, 3u );
+	EXPECT_EQ( 3u, num_active );
+}
+
+TEST(coherent_network_statistic, tcWindowFallsBackToTheFullInverseFFT) {
+	size_t num_blocks, num_active;
+
+	/* 106 = 2 * 53 has no divisor between the window's length and itself */
+	test_tc_window_matches_full_series(106, 3.0, 20.0, 80, 60, &num_blocks, &num_active);
+	EXPECT_EQ( 0u, num_blocks );
+	EXPECT_EQ( 0u, num_active );
+}
+
+TEST(coherent_network_statistic, tcWindowCostsLessThanTheFullInverseFFT) {
+	/* As for the PSO: 32 s at 2048 Hz, 40 Hz to 1000 Hz, and a window of 0.5 s. With a frequency step of
+	 * 1 Hz, the data lasts 1 s and the frequencies are 32 times higher. */
+	size_t num_detectors = 2;
+	size_t num_time_samples = 65536;
+	double f_low = 40.0 * 32.0;
+	double f_high = 1000.0 * 32.0;
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	coherent_network_workspace_t *ws = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	CN_workspace_set_tc_window(ws, 0.2, 0.2 + 0.5 / 32.0);
+
+	CN_REDUCTION reductions[2] = {CN_REDUCTION_NONE, CN_REDUCTION_HETERODYNE};
+	for (size_t r = 0; r < 2; r++) {
+		CN_workspace_set_reduction(ws, reductions[r]);
+
+		coherent_network_tc_window_t *window = ws->tc_window;
+		EXPECT_GT( window->num_blocks, 1u );
+		EXPECT_EQ( window->num_active, window->num_blocks );
+		EXPECT_DOUBLE_EQ( FFT_cost_estimate(ws->ifft_len) + window->len, window->full_cost );
+
+		/* The cost that FFT_complex_inverse_many of all the blocks would have without the pruning */
+		EXPECT_LT( window->cost, window->num_blocks * (FFT_cost_estimate(window->fft_len) + 2.0 * window->len)
+				+ ws->ifft_len );
+		EXPECT_LT( window->cost, 0.8 * window->full_cost );
+	}
+
+	CN_workspace_free(ws);
+	Detector_Network_free(net);
+	network_strain_half_fft_free(network_strain);
+}
+
+TEST(coherent_network_statistic, peakInterpolationAndTopPeaks) {
+	size_t num_detectors = 3;
+	size_t num_time_samples = 64;
+	double f_low = 3.0;
+	double f_high = 20.0;
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	network_strain_half_fft_t *shifted_strain = network_strain_half_fft_alloc(
+			num_detectors, num_time_samples);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	inspiral_chirp_time_t chirp;
+	chirp.chirp_time0 = 4.0;
+	chirp.chirp_time1 = 5.0;
+	chirp.chirp_time1_5 = 6.0;
+	chirp.chirp_time2 = 7.0;
+	chirp.tc = 10.0;
+
+	sky_t sky;
+	sky.ra = 1.0;
+	sky.dec = 0.2;
+
+	coherent_network_workspace_t *ws = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	CN_workspace_set_num_peaks(ws, 3, 4.0);
+
+	double value;
+	int index;
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, NULL);
+
+	/* Without interpolation the first peak is the maximum, and the others are smaller and far enough away */
+	ASSERT_EQ( 3u, ws->num_peaks );
+	EXPECT_EQ( value, ws->peak.value );
+	EXPECT_EQ( (double) index, ws->peak.index );
+	EXPECT_EQ( value, ws->peaks[0].value );
+	EXPECT_EQ( (double) index, ws->peaks[0].index );
+	for (size_t p = 0; p < ws->num_peaks; p++) {
+		EXPECT_NEAR( sqrt(ws->temp_ifft[(size_t) ws->peaks[p].index] / 2.0), ws->peaks[p].value, 1e-12 );
+		for (size_t q = p + 1; q < ws->num_peaks; q++) {
+			EXPECT_GE( ws->peaks[p].value, ws->peaks[q].value );
+			EXPECT_GE( fabs(ws->peaks[p].index - ws->peaks[q].index), 4.0 );
+		}
+	}
+
+	CN_workspace_set_peak_interpolation(ws, CN_PEAK_INTERPOLATION_PARABOLIC);
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, NULL);
+	coherent_network_peak_t parabolic = ws->peak;
+	EXPECT_GE( parabolic.value, value );
+	EXPECT_LE( fabs(parabolic.index - index), 0.5 );
+
+	CN_workspace_set_peak_interpolation(ws, CN_PEAK_INTERPOLATION_SINC);
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, NULL);
+	coherent_network_peak_t sinc = ws->peak;
+	EXPECT_GE( sinc.value, value );
+	EXPECT_LE( fabs(sinc.index - index), 1.0 );
+
+	/* Moving the data earlier by the fractional part puts the peak on a sample */
+	double shift = sinc.index - floor(sinc.index);
+	for (size_t i = 0; i < num_detectors; i++) {
+		for (size_t k = 0; k < len_f_array; k++) {
+			shifted_strain->strains[i]->half_fft[k] = gsl_complex_mul( network_strain->strains[i]->half_fft[k],
+					gsl_complex_polar(1.0, 2.0 * M_PI * k * shift / num_time_samples) );
+		}
+	}
+
+	double shifted_value;
+	int shifted_index;
+	CN_workspace_set_peak_interpolation(ws, CN_PEAK_INTERPOLATION_NONE);
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, shifted_strain, ws, &shifted_value, &shifted_index, NULL);
+	EXPECT_EQ( (int) floor(sinc.index), shifted_index );
+	EXPECT_NEAR( shifted_value, sinc.value, 1e-9 * sinc.value );
+
+	CN_workspace_free(ws);
+
+	Detector_Network_free(net);
+
+	network_strain_half_fft_free(shifted_strain);
+	network_strain_half_fft_free(network_strain);
+}
+
+TEST(coherent_network_statistic, peaksAreSeparatedAcrossTheWrap) {
+	size_t num_detectors = 3;
+	size_t num_time_samples = 64;
+	double f_low = 3.0;
+	double f_high = 20.0;
+	double separation = 4.0;
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	network_strain_half_fft_t *shifted_strain = network_strain_half_fft_alloc(num_detectors, num_time_samples);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	inspiral_chirp_time_t chirp;
+	chirp.chirp_time0 = 4.0;
+	chirp.chirp_time1 = 5.0;
+	chirp.chirp_time1_5 = 6.0;
+	chirp.chirp_time2 = 7.0;
+	chirp.tc = 10.0;
+
+	sky_t sky;
+	sky.ra = 1.0;
+	sky.dec = 0.2;
+
+	coherent_network_workspace_t *ws = CN_workspace_alloc(num_time_samples, net, len_f_array, f_low, f_high);
+	CN_workspace_set_num_peaks(ws, 3, separation);
+
+	double value;
+	int index;
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, NULL);
+
+	/* Moving the data earlier by the index puts the peak at the start, so the series is large at both ends */
+	double shift = index;
+	for (size_t i = 0; i < num_detectors; i++) {
+		for (size_t k = 0; k < len_f_array; k++) {
+			shifted_strain->strains[i]->half_fft[k] = gsl_complex_mul( network_strain->strains[i]->half_fft[k],
+					gsl_complex_polar(1.0, 2.0 * M_PI * k * shift / num_time_samples) );
+		}
+	}
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, shifted_strain, ws, &value, &index, NULL);
+
+	ASSERT_EQ( 3u, ws->num_peaks );
+	EXPECT_EQ( 0, index );
+	for (size_t p = 0; p < ws->num_peaks; p++) {
+		for (size_t q = p + 1; q < ws->num_peaks; q++) {
+			double d = fabs(ws->peaks[p].index - ws->peaks[q].index);
+			EXPECT_GE( GSL_MIN(d, num_time_samples - d), separation );
+		}
+	}
+
+	CN_workspace_free(ws);
+	Detector_Network_free(net);
+	network_strain_half_fft_free(shifted_strain);
+	network_strain_half_fft_free(network_strain);
+}
+
+TEST(CN_save, binaryAndHdf5Append) {
+	double rows[2][5] = { {1.0, 2.5, -3.0, 4.0, 1e-300}, {6.0, 7.0, 8.0, 9.0, 10.0} };
+	char bin_filename[] = "CN_save_test.bin";
+	char h5_filename[] = "CN_save_test.h5";
+
+	remove(bin_filename);
+	remove(h5_filename);
+	for (size_t r = 0; r < 2; r++) {
+		CN_save_with_format(bin_filename, CN_SAVE_BINARY, 5, rows[r]);
+		CN_save_with_format(h5_filename, CN_SAVE_HDF5, 5, rows[r]);
+	}
+
+	/* Both files have the two series one after the other */
+	double bin_values[11];
+	FILE *file = fopen(bin_filename, "rb");
+	ASSERT_TRUE( file != NULL );
+	EXPECT_EQ( 10u, fread(bin_values, sizeof(double), 11, file) );
+	fclose(file);
+
+	ASSERT_EQ( 10u, hdf5_get_dataset_array_length(h5_filename, CN_SAVE_HDF5_DATASET) );
+	double h5_values[10];
+	hdf5_load_array(h5_filename, CN_SAVE_HDF5_DATASET, h5_values);
+
+	for (size_t i = 0; i < 10; i++) {
+		EXPECT_EQ( rows[i / 5][i % 5], bin_values[i] );
+		EXPECT_EQ( rows[i / 5][i % 5], h5_values[i] );
+	}
+
+	remove(bin_filename);
+	remove(h5_filename);
+}
+
+TEST(hdf5_row_writer, appendsToTheSameDataset) {
+	double rows[4][3] = { {1.0, 2.0, 3.0}, {-4.0, 5.5, 1e-300}, {7.0, 8.0, 9.0}, {10.0, 11.0, 12.0} };
+	char filename[] = "hdf5_row_writer_test.h5";
+
+	remove(filename);
+	hdf5_row_writer_t *writer = hdf5_row_writer_open(filename, "rows", 3);
+	for (size_t r = 0; r < 3; r++) {
+		hdf5_row_writer_append(writer, 3, rows[r]);
+	}
+	hdf5_row_writer_close(writer);
+
+	/* A row appended later goes after the writer's rows */
+	hdf5_append_row(filename, "rows", 3, rows[3]);
+
+	ASSERT_EQ( 12u, hdf5_get_dataset_array_length(filename, "rows") );
+	double values[12];
+	hdf5_load_array(filename, "rows", values);
+	for (size_t i = 0; i < 12; i++) {
+		EXPECT_EQ( rows[i / 3][i % 3], values[i] );
+	}
+
+	remove(filename);
+}
+
+TEST(coherent_network_statistic, savesSeriesInWorkspaceFormat) {
+	size_t num_detectors = 3;
+	size_t num_time_samples = 64;
+	size_t num_templates = 3;
+	double f_low = 3.0;
+	double f_high = 20.0;
+	char h5_filename[] = "CN_series_test_h5.series";
+	char bin_filename[] = "CN_series_test_bin.series";
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	sky_t sky;
+	sky.ra = 1.0;
+	sky.dec = 0.2;
+
+	coherent_network_workspace_t *h5_ws = CN_workspace_alloc(num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_workspace_t *bin_ws = CN_workspace_alloc(num_time_samples, net, len_f_array, f_low, f_high);
+	CN_workspace_set_series_format(h5_ws, CN_SAVE_HDF5);
+	CN_workspace_set_series_format(bin_ws, CN_SAVE_BINARY);
+
+	/* The format is the workspace's, whatever the extension */
+	remove(h5_filename);
+	remove(bin_filename);
+	double value;
+	int index;
+	for (size_t b = 0; b < num_templates; b++) {
+		inspiral_chirp_time_t chirp;
+		chirp.chirp_time0 = 4.0 + b;
+		chirp.chirp_time1 = 5.0;
+		chirp.chirp_time1_5 = 6.0 - 0.5*b;
+		chirp.chirp_time2 = 7.0;
+		chirp.tc = 10.0;
+
+		coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, h5_ws, &value, &index, h5_filename);
+		coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, bin_ws, &value, &index, bin_filename);
+	}
+	CN_workspace_close_series(h5_ws);
+
+	size_t len = hdf5_get_dataset_array_length(h5_filename, CN_SAVE_HDF5_DATASET);
+	ASSERT_EQ( 0u, len % num_templates );
+	ASSERT_LT( 0u, len );
+
+	double *h5_values = (double*) malloc(len * sizeof(double));
+	double *bin_values = (double*) malloc((len + 1) * sizeof(double));
+	hdf5_load_array(h5_filename, CN_SAVE_HDF5_DATASET, h5_values);
+	FILE *file = fopen(bin_filename, "rb");
+	ASSERT_TRUE( file != NULL );
+	EXPECT_EQ( len, fread(bin_values, sizeof(double), len + 1, file) );
+	fclose(file);
+
+	for (size_t i = 0; i < len; i++) {
+		EXPECT_EQ( bin_values[i], h5_values[i] );
+	}
+
+	free(h5_values);
+	free(bin_values);
+	remove(h5_filename);
+	remove(bin_filename);
+
+	CN_workspace_free(h5_ws);
+	CN_workspace_free(bin_ws);
+
+	Detector_Network_free(net);
+
+	network_strain_half_fft_free(network_strain);
+}
+
+TEST(hdf5_row_writer, exitsOnRowOfAnotherLength) {
+	double row[4] = {1.0, 2.0, 3.0, 4.0};
+	char filename[] = "hdf5_row_writer_length_test.h5";
+
+	remove(filename);
+	hdf5_row_writer_t *writer = hdf5_row_writer_open(filename, "rows", 3);
+	hdf5_row_writer_append(writer, 3, row);
+	EXPECT_EXIT( hdf5_row_writer_append(writer, 4, row), ::testing::ExitedWithCode(255), "are 3 long, not 4" );
+	hdf5_row_writer_close(writer);
+
+	EXPECT_EQ( 3u, hdf5_get_dataset_array_length(filename, "rows") );
+	remove(filename);
+}
+
+TEST(coherent_network_statistic, reductionChangeClosesSeriesFile) {
+	size_t num_detectors = 3;
+	size_t num_time_samples = 64;
+	double f_low = 3.0;
+	double f_high = 20.0;
+	char full_filename[] = "CN_series_test_full.series";
+	char heterodyne_filename[] = "CN_series_test_heterodyne.series";
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	sky_t sky;
+	sky.ra = 1.0;
+	sky.dec = 0.2;
+
+	inspiral_chirp_time_t chirp;
+	chirp.chirp_time0 = 4.0;
+	chirp.chirp_time1 = 5.0;
+	chirp.chirp_time1_5 = 6.0;
+	chirp.chirp_time2 = 7.0;
+	chirp.tc = 10.0;
+
+	coherent_network_workspace_t *ws = CN_workspace_alloc(num_time_samples, net, len_f_array, f_low, f_high);
+	CN_workspace_set_series_format(ws, CN_SAVE_HDF5);
+
+	remove(full_filename);
+	remove(heterodyne_filename);
+	double value;
+	int index;
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, full_filename);
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, full_filename);
+	ASSERT_TRUE( ws->series_writer != NULL );
+
+	/* The shorter series can't be rows of the open file */
+	CN_workspace_set_reduction(ws, CN_REDUCTION_HETERODYNE);
+	ASSERT_LT( ws->ifft_len, num_time_samples );
+	EXPECT_TRUE( ws->series_writer == NULL );
+
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, heterodyne_filename);
+	CN_workspace_close_series(ws);
+
+	EXPECT_EQ( 2 * num_time_samples, hdf5_get_dataset_array_length(full_filename, CN_SAVE_HDF5_DATASET) );
+	EXPECT_EQ( ws->ifft_len, hdf5_get_dataset_array_length(heterodyne_filename, CN_SAVE_HDF5_DATASET) );
+
+	/* Saving the shorter series in the first file fails instead of mixing the lengths */
+	EXPECT_EXIT( coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index,
+			full_filename), ::testing::ExitedWithCode(255), "aren't" );
+	EXPECT_EQ( 2 * num_time_samples, hdf5_get_dataset_array_length(full_filename, CN_SAVE_HDF5_DATASET) );
+
+	remove(full_filename);
+	remove(heterodyne_filename);
+
+	CN_workspace_free(ws);
+	Detector_Network_free(net);
+	network_strain_half_fft_free(network_strain);
+}
+
+
+TEST(coherent_network_statistic, sharedTablesMatchOwnTables) {
+	size_t num_detectors = 3;
+	size_t num_time_samples = 64;
+	double f_low = 3.0;
+	double f_high = 20.0;
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	inspiral_chirp_time_t chirp;
+	chirp.chirp_time0 = 4.0;
+	chirp.chirp_time1 = 5.0;
+	chirp.chirp_time1_5 = 6.0;
+	chirp.chirp_time2 = 7.0;
+	chirp.tc = 10.0;
+
+	sky_t sky;
+	sky.ra = 1.0;
+	sky.dec = 0.2;
+
+	coherent_network_workspace_t *ws = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+
+	coherent_network_shared_t *shared = CN_shared_alloc(net, f_low, f_high);
+	coherent_network_workspace_t *first = CN_workspace_alloc_shared(num_time_samples, net, len_f_array, shared);
+	coherent_network_workspace_t *second = CN_workspace_alloc_shared(num_time_samples, net, len_f_array, shared);
+	CN_shared_free(shared);
+	EXPECT_EQ( 2u, shared->num_references );
+	EXPECT_EQ( first->sp_lookup, second->sp_lookup );
+
+	double value, first_value, second_value;
+	int index, first_index, second_index;
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, NULL);
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, first, &first_value, &first_index, NULL);
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, second, &second_value, &second_index, NULL);
+
+	/* The data is only whitened by the first of the workspaces */
+	EXPECT_EQ( 1u, shared->whitened_data_version );
+	EXPECT_EQ( value, first_value );
+	EXPECT_EQ( index, first_index );
+	EXPECT_EQ( value, second_value );
+	EXPECT_EQ( index, second_index );
+
+	CN_workspace_free(first);
+	EXPECT_EQ( 1u, shared->num_references );
+	CN_workspace_free(second);
+	CN_workspace_free(ws);
+
+	Detector_Network_free(net);
+
+	network_strain_half_fft_free(network_strain);
+}
+
+TEST(coherent_network_statistic, whitenedDataFollowsTheStrain) {
+	size_t num_detectors = 3;
+	size_t num_time_samples = 64;
+	double f_low = 3.0;
+	double f_high = 20.0;
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	inspiral_chirp_time_t chirp;
+	chirp.chirp_time0 = 4.0;
+	chirp.chirp_time1 = 5.0;
+	chirp.chirp_time1_5 = 6.0;
+	chirp.chirp_time2 = 7.0;
+	chirp.tc = 10.0;
+
+	sky_t sky;
+	sky.ra = 1.0;
+	sky.dec = 0.2;
+
+	coherent_network_workspace_t *ws = CN_workspace_alloc(num_time_samples, net, len_f_array, f_low, f_high);
+
+	double value, expected_value;
+	int index, expected_index;
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, NULL);
+
+	/* The same strain modified in place */
+	for (size_t i = 0; i < num_detectors; i++) {
+		for (size_t k = 0; k < len_f_array; k++) {
+			network_strain->strains[i]->half_fft[k] = gsl_complex_rect(cos(1.1*k - i), sin(0.2*k + i));
+		}
+	}
+	unsigned long generation = network_strain->generation;
+	network_strain_half_fft_modified(network_strain);
+	EXPECT_NE( generation, network_strain->generation );
+
+	coherent_network_workspace_t *fresh = CN_workspace_alloc(num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, NULL);
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, fresh, &expected_value, &expected_index, NULL);
+	EXPECT_EQ( expected_value, value );
+	EXPECT_EQ( expected_index, index );
+	CN_workspace_free(fresh);
+
+	/* Another strain, which may be at the address of the freed one */
+	network_strain_half_fft_free(network_strain);
+	network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.5, 0.1);
+	EXPECT_NE( ws->shared->whitened_data_generation, network_strain->generation );
+
+	fresh = CN_workspace_alloc(num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, NULL);
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, fresh, &expected_value, &expected_index, NULL);
+	EXPECT_EQ( expected_value, value );
+	EXPECT_EQ( expected_index, index );
+	CN_workspace_free(fresh);
+
+	CN_workspace_free(ws);
+	Detector_Network_free(net);
+	network_strain_half_fft_free(network_strain);
+}
+
+TEST(coherent_network_statistic, footprintCountsTheAllocations) {
+	size_t num_detectors = 3;
+	size_t num_time_samples = 64;
+	double f_low = 3.0;
+	double f_high = 20.0;
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	coherent_network_workspace_t *ws = CN_workspace_alloc(num_time_samples, net, len_f_array, f_low, f_high);
+	size_t footprint = CN_workspace_footprint(ws);
+
+	/* The peaks are the only thing that is allocated */
+	CN_workspace_set_num_peaks(ws, 10, 2.0);
+	EXPECT_EQ( footprint + 10 * sizeof(coherent_network_peak_t), CN_workspace_footprint(ws) );
+	CN_workspace_set_num_peaks(ws, 0, 0.0);
+	EXPECT_EQ( footprint, CN_workspace_footprint(ws) );
+
+	/* What is freed is no longer counted */
+	CN_workspace_set_layout(ws, CN_LAYOUT_COMPACT);
+	EXPECT_EQ( footprint - (3 * len_f_array * sizeof(gsl_complex) + num_time_samples * sizeof(double)),
+			CN_workspace_footprint(ws) );
+	CN_workspace_set_layout(ws, CN_LAYOUT_DEFAULT);
+	EXPECT_EQ( footprint, CN_workspace_footprint(ws) );
+
+	CN_workspace_set_tc_window(ws, 0.1, 0.4);
+	EXPECT_GT( CN_workspace_footprint(ws), footprint );
+	CN_workspace_clear_tc_window(ws);
+	EXPECT_EQ( footprint, CN_workspace_footprint(ws) );
+
+	CN_workspace_free(ws);
+	Detector_Network_free(net);
+	network_strain_half_fft_free(network_strain);
+}
+
+TEST(network_strain_half_fft_resize, statisticOfTemplateMatchesAfterPadding) {
+	size_t num_detectors = 2;
+	size_t num_time_samples = 1010;
+	size_t padded_num_time_samples = SS_fft_friendly_length(num_time_samples, SS_FFT_LENGTH_PAD);
+	double sampling_frequency = 512.0;
+	double f_low = 20.0;
+	double f_high = 200.0;
+	DETECTOR_ID ids[2] = {H1, L1};
+
+	ASSERT_EQ( 1024u, padded_num_time_samples );
+
+	/* The PSDs are on the bins of the unpadded data */
+	size_t half_len = SS_half_size(num_time_samples);
+	detector_network_t *net = Detector_Network_alloc(num_detectors);
+	for (size_t i = 0; i < num_detectors; i++) {
+		psd_t *psd = PSD_alloc(half_len);
+		psd->type = PSD_ONE_SIDED;
+		SS_frequency_array(sampling_frequency, num_time_samples, half_len, psd->f);
+		for (size_t k = 0; k < half_len; k++) {
+			psd->psd[k] = (1.0 + 0.5*i) * (1.0 + gsl_pow_2(psd->f[k] / 100.0));
+		}
+		PSD_flatten_edges(f_low, f_high, psd);
+		Detector_init(ids[i], psd, net->detector[i]);
+	}
+
+	/* The data of each detector is the template coloured by its ASD. It starts 0.4 s in and lasts tc (0.8 s),
+	   so that it is inside the series and the zeros of the padding don't cut it. */
+	inspiral_chirp_time_t chirp;
+	CN_template_chirp_time(f_low, 0.5, 0.05, &chirp);
+	sky_t sky;
+	sky.ra = 1.0;
+	sky.dec = 0.2;
+
+	stationary_phase_workspace_t *lookup = SP_workspace_alloc(f_low, f_high, half_len, net->detector[0]->asd->f);
+	stationary_phase_t *sp = SP_alloc(half_len);
+	SP_compute(-0.4, 1.0, 0.0, &chirp, lookup, sp);
+	network_strain_half_fft_t *network_strain = network_strain_half_fft_alloc(num_detectors, num_time_samples);
+	for (size_t i = 0; i < num_detectors; i++) {
+		for (size_t k = 0; k < half_len; k++) {
+			network_strain->strains[i]->half_fft[k] = gsl_complex_mul_real(sp->spa_0[k], net->detector[i]->asd->asd[k]);
+		}
+	}
+	SP_free(sp);
+	SP_workspace_free(lookup);
+
+	double value, padded_value;
+	int index, padded_index;
+	coherent_network_workspace_t *ws = CN_workspace_alloc(num_time_samples, net, half_len, f_low, f_high);
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, network_strain, ws, &value, &index, NULL);
+	CN_workspace_free(ws);
+
+	network_strain_half_fft_t *padded = network_strain_half_fft_resize(network_strain, padded_num_time_samples,
+			net, sampling_frequency, f_low, f_high);
+
+	/* The PSDs are on the new bins, so f_low and f_high are at other indices */
+	size_t padded_half_len = SS_half_size(padded_num_time_samples);
+	ASSERT_EQ( padded_half_len, net->detector[0]->asd->len );
+	EXPECT_DOUBLE_EQ( sampling_frequency / padded_num_time_samples, net->detector[1]->psd->f[1] );
+
+	/* They are at those frequencies already, so resampling them again leaves them as they are */
+	psd_t *psd = net->detector[0]->psd;
+	Detector_Network_resample_psds(net, padded_num_time_samples, sampling_frequency, f_low, f_high);
+	EXPECT_EQ( psd, net->detector[0]->psd );
+
+	ws = CN_workspace_alloc(padded_num_time_samples, net, padded_half_len, f_low, f_high);
+	coherent_network_statistic(net, f_low, f_high, &chirp, &sky, padded, ws, &padded_value, &padded_index, NULL);
+	CN_workspace_free(ws);
+
+	EXPECT_NEAR( value, padded_value, 0.01 * value );
+	EXPECT_EQ( index, padded_index );
+
+	network_strain_half_fft_free(padded);
+	network_strain_half_fft_free(network_strain);
+	Detector_Network_free(net);
+}
+
+TEST(coherent_network_statistic, compactLayoutMatchesDefault) {
+	size_t num_detectors = 3;
+	size_t num_time_samples = 64;
+	size_t num_templates = 3;
+	double f_low = 3.0;
+	double f_high = 20.0;
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	inspiral_chirp_time_t chirps[3];
+	sky_t skies[3];
+	for (size_t b = 0; b < num_templates; b++) {
+		chirps[b].chirp_time0 = 4.0 + b;
+		chirps[b].chirp_time1 = 5.0;
+		chirps[b].chirp_time1_5 = 6.0 - 0.5*b;
+		chirps[b].chirp_time2 = 7.0;
+		chirps[b].tc = 10.0;
+		skies[b].ra = -2.0 + b;
+		skies[b].dec = 0.3 * b - 0.5;
+	}
+
+	coherent_network_workspace_t *ws = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_workspace_t *compact = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_batch_workspace_t *batch = CN_batch_workspace_alloc(
+			2, num_time_samples, net, len_f_array, f_low, f_high);
+
+	size_t footprint = CN_workspace_footprint(compact);
+	size_t batch_footprint = CN_batch_workspace_footprint(batch);
+	CN_workspace_set_layout(compact, CN_LAYOUT_COMPACT);
+	CN_batch_workspace_set_layout(batch, CN_LAYOUT_COMPACT);
+	EXPECT_LT( CN_workspace_footprint(compact), footprint );
+	EXPECT_LT( CN_batch_workspace_footprint(batch), batch_footprint );
+	EXPECT_EQ( 0, ((uintptr_t) compact->fs[0]) % CN_ALIGNMENT );
+
+	CN_REDUCTION reductions[2] = {CN_REDUCTION_NONE, CN_REDUCTION_HETERODYNE};
+	for (size_t r = 0; r < 2; r++) {
+		CN_workspace_set_reduction(ws, reductions[r]);
+		CN_workspace_set_reduction(compact, reductions[r]);
+		CN_workspace_set_reduction(batch->workspace, reductions[r]);
+
+		/* with and without a tc window */
+		for (size_t w = 0; w < 2; w++) {
+			if (w == 1) {
+				CN_workspace_set_tc_window(ws, 0.1, 0.4);
+				CN_workspace_set_tc_window(compact, 0.1, 0.4);
+				CN_workspace_set_tc_window(batch->workspace, 0.1, 0.4);
+			}
+
+			double values[3];
+			int indices[3];
+			coherent_network_statistic_batch(net, num_templates, chirps, skies, network_strain, batch, values, indices);
+
+			for (size_t b = 0; b < num_templates; b++) {
+				double value, compact_value;
+				int index, compact_index;
+				coherent_network_statistic(net, f_low, f_high, &chirps[b], &skies[b], network_strain, ws, &value, &index, NULL);
+				coherent_network_statistic(net, f_low, f_high, &chirps[b], &skies[b], network_strain, compact, &compact_value, &compact_index, NULL);
+
+				EXPECT_EQ( value, compact_value );
+				EXPECT_EQ( index, compact_index );
+				EXPECT_NEAR( values[b], value, 1e-10 * value );
+				EXPECT_EQ( indices[b], index );
+			}
+
+			CN_workspace_clear_tc_window(ws);
+			CN_workspace_clear_tc_window(compact);
+			CN_workspace_clear_tc_window(batch->workspace);
+		}
+	}
+
+	/* and back */
+	CN_workspace_set_layout(compact, CN_LAYOUT_DEFAULT);
+	CN_workspace_set_reduction(compact, CN_REDUCTION_NONE);
+	EXPECT_EQ( footprint, CN_workspace_footprint(compact) );
+
+	CN_batch_workspace_free(batch);
+	CN_workspace_free(compact);
+	CN_workspace_free(ws);
+
+	Detector_Network_free(net);
+
+	network_strain_half_fft_free(network_strain);
+}
+
+TEST(coherent_network_statistic, compactLayoutFollowsSwappedStrains) {
+	size_t num_detectors = 3;
+	size_t num_time_samples = 64;
+	double f_low = 3.0;
+	double f_high = 20.0;
+
+	network_strain_half_fft_t *strains[2];
+	strains[0] = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	strains[1] = test_network_strain_alloc(num_detectors, num_time_samples, 1.1, 0.2);
+	size_t len_f_array = strains[0]->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	inspiral_chirp_time_t chirp;
+	chirp.chirp_time0 = 4.0;
+	chirp.chirp_time1 = 5.0;
+	chirp.chirp_time1_5 = 6.0;
+	chirp.chirp_time2 = 7.0;
+	chirp.tc = 10.0;
+
+	sky_t sky;
+	sky.ra = 1.0;
+	sky.dec = 0.2;
+
+	/* Each strain has its own default workspace, and one compact workspace is used for both in turn */
+	coherent_network_workspace_t *ws[2];
+	ws[0] = CN_workspace_alloc(num_time_samples, net, len_f_array, f_low, f_high);
+	ws[1] = CN_workspace_alloc(num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_workspace_t *compact = CN_workspace_alloc(num_time_samples, net, len_f_array, f_low, f_high);
+	CN_workspace_set_layout(compact, CN_LAYOUT_COMPACT);
+
+	double value, compact_value;
+	int index, compact_index;
+	for (size_t n = 0; n < 5; n++) {
+		size_t s = n % 2;
+
+		/* The last time the first strain's data is swapped with the second's in place */
+		if (n == 4) {
+			for (size_t i = 0; i < num_detectors; i++) {
+				memcpy(strains[0]->strains[i]->half_fft, strains[1]->strains[i]->half_fft, len_f_array * sizeof(gsl_complex));
+			}
+			network_strain_half_fft_modified(strains[0]);
+			s = 1;
+		}
+
+		coherent_network_statistic(net, f_low, f_high, &chirp, &sky, strains[s], ws[s], &value, &index, NULL);
+		coherent_network_statistic(net, f_low, f_high, &chirp, &sky, n == 4 ? strains[0] : strains[s], compact,
+				&compact_value, &compact_index, NULL);
+		EXPECT_EQ( value, compact_value );
+		EXPECT_EQ( index, compact_index );
+	}
+
+	CN_workspace_free(compact);
+	CN_workspace_free(ws[1]);
+	CN_workspace_free(ws[0]);
+	Detector_Network_free(net);
+	network_strain_half_fft_free(strains[1]);
+	network_strain_half_fft_free(strains[0]);
+}
+
+TEST(coherent_network_statistic, skyTableNearComputed) {
+	size_t num_detectors = 3;
+	size_t num_time_samples = 64;
+	size_t num_templates = 4;
+	double f_low = 3.0;
+	double f_high = 20.0;
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	inspiral_chirp_time_t chirps[4];
+	sky_t skies[4];
+	for (size_t b = 0; b < num_templates; b++) {
+		CN_template_chirp_time(f_low, 2.0 + 0.5*b, 0.3, &chirps[b]);
+		skies[b].ra = -2.5 + 1.3*b;
+		skies[b].dec = 0.4*b - 0.7;
+	}
+
+	coherent_network_workspace_t *ws = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_workspace_t *ws_table = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_batch_workspace_t *batch = CN_batch_workspace_alloc_shared(
+			3, num_time_samples, net, len_f_array, ws_table->shared);
+
+	size_t bytes = CN_shared_footprint(ws_table->shared);
+	CN_shared_set_sky_table(ws_table->shared, Detector_Sky_Table_build(num_detectors, net->detector, 0.005));
+	EXPECT_GT( CN_shared_footprint(ws_table->shared), bytes );
+
+	double batch_values[4];
+	int batch_indices[4];
+	coherent_network_statistic_batch(net, num_templates, chirps, skies, network_strain, batch, batch_values, batch_indices);
+
+	for (size_t b = 0; b < num_templates; b++) {
+		double value, table_value;
+		int index, table_index;
+		coherent_network_statistic(net, f_low, f_high, &chirps[b], &skies[b], network_strain, ws, &value, &index, NULL);
+		coherent_network_statistic(net, f_low, f_high, &chirps[b], &skies[b], network_strain, ws_table,
+				&table_value, &table_index, NULL);
+
+		EXPECT_NEAR( table_value, value, 1e-3 * value );
+		EXPECT_EQ( table_index, index );
+		EXPECT_NEAR( batch_values[b], table_value, 1e-10 * table_value );
+		EXPECT_EQ( batch_indices[b], table_index );
+	}
+
+	CN_batch_workspace_free(batch);
+	CN_workspace_free(ws_table);
+	CN_workspace_free(ws);
+
+	Detector_Network_free(net);
+
+	network_strain_half_fft_free(network_strain);
+}
+
+TEST(coherent_network_statistic, singlePrecisionNearDouble) {
+	size_t num_detectors = 3;
+	size_t num_time_samples = 64;
+	size_t num_templates = 3;
+	double f_low = 3.0;
+	double f_high = 20.0;
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	inspiral_chirp_time_t chirps[3];
+	sky_t skies[3];
+	for (size_t b = 0; b < num_templates; b++) {
+		CN_template_chirp_time(f_low, 2.0 + 0.5*b, 0.3, &chirps[b]);
+		skies[b].ra = -2.0 + b;
+		skies[b].dec = 0.3 * b - 0.5;
+	}
+
+	EXPECT_EQ( CN_PRECISION_DOUBLE, CN_precision_from_string(NULL) );
+	EXPECT_EQ( CN_PRECISION_SINGLE, CN_precision_from_string("single") );
+	EXPECT_EQ( CN_PRECISION_VALIDATE, CN_precision_from_string("validate") );
+
+	coherent_network_workspace_t *ws = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_workspace_t *single = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_workspace_t *validate = CN_workspace_alloc(
+			num_time_samples, net, len_f_array, f_low, f_high);
+	coherent_network_batch_workspace_t *batch = CN_batch_workspace_alloc(
+			2, num_time_samples, net, len_f_array, f_low, f_high);
+
+	CN_workspace_set_precision(single, CN_PRECISION_SINGLE);
+	CN_workspace_set_precision(validate, CN_PRECISION_VALIDATE);
+	CN_workspace_set_precision(batch->workspace, CN_PRECISION_SINGLE);
+
+	double batch_values[3];
+	int batch_indices[3];
+	coherent_network_statistic_batch(net, num_templates, chirps, skies, network_strain, batch, batch_values, batch_indices);
+
+	double max_deviation = 0.0;
+	for (size_t b = 0; b < num_templates; b++) {
+		double value, single_value, validate_value;
+		int index, single_index, validate_index;
+		coherent_network_statistic(net, f_low, f_high, &chirps[b], &skies[b], network_strain, ws, &value, &index, NULL);
+		coherent_network_statistic(net, f_low, f_high, &chirps[b], &skies[b], network_strain, single,
+				&single_value, &single_index, NULL);
+		coherent_network_statistic(net, f_low, f_high, &chirps[b], &skies[b], network_strain, validate,
+				&validate_value, &validate_index, NULL);
+
+		EXPECT_NEAR( single_value, value, 1e-5 * value );
+		EXPECT_EQ( single_index, index );
+		EXPECT_NEAR( batch_values[b], single_value, 1e-10 * single_value );
+		EXPECT_EQ( batch_indices[b], single_index );
+
+		/* validation returns the double precision values */
+		EXPECT_EQ( validate_value, value );
+		EXPECT_EQ( validate_index, index );
+		max_deviation = GSL_MAX(max_deviation, fabs(single_value - value) / value);
+	}
+	EXPECT_NEAR( validate->precision_deviation, max_deviation, 1e-12 );
+	EXPECT_LT( validate->precision_deviation, 1e-5 );
+
+	CN_workspace_set_precision(validate, CN_PRECISION_DOUBLE);
+	EXPECT_EQ( 0.0, validate->precision_deviation );
+
+	CN_batch_workspace_free(batch);
+	CN_workspace_free(validate);
+	CN_workspace_free(single);
+	CN_workspace_free(ws);
+
+	Detector_Network_free(net);
+
+	network_strain_half_fft_free(network_strain);
+}
+
+TEST(swarminfo_alloc, alignedArraysAndCoordinateViews) {
+	const size_t popsize = 5;
+	const size_t nDim = 3;
+	struct swarmInfo *s = swarminfo_alloc(popsize, nDim);
+
+	EXPECT_EQ( popsize, s->popsize );
+	EXPECT_EQ( nDim, s->nDim );
+
+	double *arrays[] = { s->partCoord, s->partVel, s->partPbest, s->partLocalBest, s->chi1, s->chi2,
+			s->partSnrPbest, s->partSnrCurr, s->partSnrLbest };
+	for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+		EXPECT_EQ( 0u, ((uintptr_t) arrays[i]) % PSO_SWARM_ALIGNMENT );
+	}
+
+	/* the views are the rows of partCoord */
+	for (size_t k = 0; k < popsize; k++) {
+		EXPECT_EQ( nDim, s->partCoordVecs[k]->size );
+		EXPECT_EQ( s->partCoord + k*nDim, s->partCoordVecs[k]->data );
+	}
+
+	swarminfo_free(s);
+}
+
+TEST(initPsoSwarm, coordinatesInUnitCubeAndPbestIsStart) {
+	const size_t popsize = 10;
+	const size_t nDim = 4;
+	struct swarmInfo *s = swarminfo_alloc(popsize, nDim);
+	gsl_rng *rng = random_alloc(1234);
+
+	initPsoSwarm(s, rng);
+
+	for (size_t k = 0; k < popsize; k++) {
+		for (size_t d = 0; d < nDim; d++) {
+			double x = s->partCoord[k*nDim + d];
+			EXPECT_GE( x, 0.0 );
+			EXPECT_LT( x, 1.0 );
+			/* the velocity moves the particle to another point of the unit cube */
+			EXPECT_GE( x + s->partVel[k*nDim + d], 0.0 );
+			EXPECT_LT( x + s->partVel[k*nDim + d], 1.0 );
+			EXPECT_EQ( x, s->partPbest[k*nDim + d] );
+		}
+		EXPECT_EQ( GSL_POSINF, s->partSnrPbest[k] );
+		EXPECT_EQ( GSL_POSINF, s->partSnrLbest[k] );
+		EXPECT_EQ( 0u, s->partFitEvals[k] );
+		EXPECT_EQ( 0, s->partFitOK[k] );
+	}
+
+	random_free(rng);
+	swarminfo_free(s);
+}
+
+TEST(swarminfo_update_pbest, countsComputedFitnessAndKeepsBest) {
+	const size_t nDim = 2;
+	struct swarmInfo *s = swarminfo_alloc(3, nDim);
+	gsl_rng *rng = random_alloc(1234);
+
+	initPsoSwarm(s, rng);
+	s->partSnrPbest[0] = 1.0;
+	s->partSnrPbest[1] = 1.0;
+	s->partSnrPbest[2] = 1.0;
+	s->partSnrCurr[0] = 0.5;
+	s->partSnrCurr[1] = 2.0;
+	s->partSnrCurr[2] = GSL_POSINF;
+	s->partFitOK[0] = 1;
+	s->partFitOK[1] = 1;
+	s->partFitOK[2] = 0;
+	for (size_t d = 0; d < 3*nDim; d++) {
+		s->partCoord[d] = 0.25 + d;
+		s->partPbest[d] = -1.0;
+	}
+
+	swarminfo_update_pbest(s);
+
+	EXPECT_EQ( 0.5, s->partSnrPbest[0] );
+	EXPECT_EQ( 1.0, s->partSnrPbest[1] );
+	EXPECT_EQ( 1.0, s->partSnrPbest[2] );
+	for (size_t d = 0; d < nDim; d++) {
+		EXPECT_EQ( s->partCoord[d], s->partPbest[d] );
+		EXPECT_EQ( -1.0, s->partPbest[nDim + d] );
+		EXPECT_EQ( -1.0, s->partPbest[2*nDim + d] );
+	}
+	EXPECT_EQ( 1u, s->partFitEvals[0] );
+	EXPECT_EQ( 1u, s->partFitEvals[1] );
+	EXPECT_EQ( 0u, s->partFitEvals[2] );
+
+	random_free(rng);
+	swarminfo_free(s);
+}
+
+TEST(swarminfo_best_particle, firstSmallestLikeGsl) {
+	struct swarmInfo *s = swarminfo_alloc(5, 1);
+	double fitness[] = { 3.0, 1.0, 2.0, 1.0, 5.0 };
+	memcpy(s->partSnrCurr, fitness, sizeof(fitness));
+
+	gsl_vector_view view = gsl_vector_view_array(s->partSnrCurr, 5);
+	EXPECT_EQ( gsl_vector_min_index(&view.vector), swarminfo_best_particle(s) );
+	EXPECT_EQ( 1u, swarminfo_best_particle(s) );
+
+	s->partSnrCurr[3] = NAN;
+	EXPECT_EQ( 3u, swarminfo_best_particle(s) );
+
+	swarminfo_free(s);
+}
+
+TEST(swarminfo_velocity_update, matchesEquationsWithClamping) {
+	const size_t popsize = 4;
+	const size_t nDim = 3;
+	const double c1 = 1.5, c2 = 2.0, max_velocity = 0.2;
+	struct swarmInfo *s = swarminfo_alloc(popsize, nDim);
+	struct swarmInfo *p = swarminfo_alloc(popsize, nDim);
+	gsl_rng *rng = random_alloc(1234);
+
+	initPsoSwarm(s, rng);
+	for (size_t i = 0; i < popsize*nDim; i++) {
+		s->partPbest[i] = gsl_rng_uniform(rng);
+		s->partLocalBest[i] = gsl_rng_uniform(rng);
+	}
+	swarminfo_draw_weights(s, rng);
+	s->partInertia = 0.7;
+
+	/* a copy for the particle by particle update */
+	size_t len = popsize*nDim*sizeof(double);
+	memcpy(p->partCoord, s->partCoord, len);
+	memcpy(p->partVel, s->partVel, len);
+	memcpy(p->partPbest, s->partPbest, len);
+	memcpy(p->partLocalBest, s->partLocalBest, len);
+	memcpy(p->chi1, s->chi1, len);
+	memcpy(p->chi2, s->chi2, len);
+
+	double expected_coord[popsize*nDim];
+	double expected_vel[popsize*nDim];
+	for (size_t i = 0; i < popsize*nDim; i++) {
+		double vel = s->partVel[i] * s->partInertia
+				+ (s->partPbest[i] - s->partCoord[i]) * s->chi1[i] * c1
+				+ (s->partLocalBest[i] - s->partCoord[i]) * s->chi2[i] * c2;
+		vel = GSL_MIN(GSL_MAX(vel, -max_velocity), max_velocity);
+		expected_vel[i] = vel;
+		expected_coord[i] = s->partCoord[i] + vel;
+	}
+
+	swarminfo_velocity_update(s, c1, c2, max_velocity);
+	for (size_t k = 0; k < popsize; k++) {
+		swarminfo_particle_velocity_update(p, k, 0.7, c1, c2, max_velocity);
+	}
+
+	for (size_t i = 0; i < popsize*nDim; i++) {
+		EXPECT_EQ( expected_vel[i], s->partVel[i] );
+		EXPECT_EQ( expected_coord[i], s->partCoord[i] );
+		EXPECT_LE( fabs(s->partVel[i]), max_velocity );
+		EXPECT_EQ( s->partVel[i], p->partVel[i] );
+		EXPECT_EQ( s->partCoord[i], p->partCoord[i] );
+	}
+
+	random_free(rng);
+	swarminfo_free(p);
+	swarminfo_free(s);
+}
+
+TEST(swarminfo_draw_weights, sameOrderAsOneParticleAtATime) {
+	const size_t popsize = 3;
+	const size_t nDim = 2;
+	struct swarmInfo *s = swarminfo_alloc(popsize, nDim);
+	gsl_rng *rng = random_alloc(1234);
+	gsl_rng *expected = random_alloc(1234);
+
+	swarminfo_draw_weights(s, rng);
+
+	for (size_t k = 0; k < popsize; k++) {
+		for (size_t d = 0; d < nDim; d++) {
+			EXPECT_EQ( gsl_rng_uniform(expected), s->chi1[k*nDim + d] );
+		}
+		for (size_t d = 0; d < nDim; d++) {
+			EXPECT_EQ( gsl_rng_uniform(expected), s->chi2[k*nDim + d] );
+		}
+	}
+
+	random_free(expected);
+	random_free(rng);
+	swarminfo_free(s);
+}
+
+/* A migration that records the emigrant and returns a fixed list of immigrants */
+typedef struct {
+	size_t num_calls;
+	double emigrant[2];
+	double emigrant_fitness;
+	size_t num_immigrants;
+	double immigrant_coords[4];
+	double immigrant_fitness[2];
+} test_migration_t;
+
+static size_t test_migration_exchange(void *params, size_t nDim, const double *emigrant_coord, double emigrant_fitness,
+		size_t max_immigrants, double *immigrant_coords, double *immigrant_fitness) {
+	test_migration_t *m = (test_migration_t*) params;
+	size_t num = GSL_MIN(m->num_immigrants, max_immigrants);
+
+	m->num_calls++;
+	memcpy(m->emigrant, emigrant_coord, nDim * sizeof(double));
+	m->emigrant_fitness = emigrant_fitness;
+	memcpy(immigrant_coords, m->immigrant_coords, num * nDim * sizeof(double));
+	memcpy(immigrant_fitness, m->immigrant_fitness, num * sizeof(double));
+	return num;
+}
+
+TEST(swarminfo_migrate, sendsBestAndReplacesWorst) {
+	const size_t nDim = 2;
+	struct swarmInfo *s = swarminfo_alloc(4, nDim);
+	double pbest_fitness[] = { 3.0, 1.0, 4.0, 2.0 };
+	for (size_t k = 0; k < 4; k++) {
+		s->partSnrPbest[k] = pbest_fitness[k];
+		s->partSnrCurr[k] = pbest_fitness[k] + 1.0;
+		for (size_t d = 0; d < nDim; d++) {
+			s->partPbest[k*nDim + d] = 0.1*k + 0.01*d;
+			s->partCoord[k*nDim + d] = 0.5;
+			s->partVel[k*nDim + d] = 0.05;
+		}
+	}
+
+	/* the first immigrant is better than the worst pbest (particle 2) and the second isn't better than the
+	 * next worst (particle 0) */
+	test_migration_t m = { 0, { 0.0, 0.0 }, 0.0, 2, { 0.7, 0.8, 0.9, 0.95 }, { 0.5, 3.0 } };
+	pso_migration_t migration = { test_migration_exchange, &m, 5, 2 };
+
+	swarminfo_migrate(s, &migration, 3);
+	EXPECT_EQ( 0u, m.num_calls );
+	swarminfo_migrate(s, NULL, 5);
+	EXPECT_EQ( 0u, m.num_calls );
+
+	swarminfo_migrate(s, &migration, 10);
+	EXPECT_EQ( 1u, m.num_calls );
+	EXPECT_EQ( 1.0, m.emigrant_fitness );
+	EXPECT_EQ( s->partPbest[1*nDim + 0], m.emigrant[0] );
+	EXPECT_EQ( s->partPbest[1*nDim + 1], m.emigrant[1] );
+
+	EXPECT_EQ( 0.5, s->partSnrPbest[2] );
+	EXPECT_EQ( 0.5, s->partSnrCurr[2] );
+	EXPECT_EQ( 0.7, s->partCoord[2*nDim + 0] );
+	EXPECT_EQ( 0.8, s->partCoord[2*nDim + 1] );
+	EXPECT_EQ( 0.7, s->partPbest[2*nDim + 0] );
+	EXPECT_EQ( 0.8, s->partPbest[2*nDim + 1] );
+	EXPECT_EQ( 0.05, s->partVel[2*nDim + 0] );
+
+	/* the other particles are unchanged */
+	EXPECT_EQ( 3.0, s->partSnrPbest[0] );
+	EXPECT_EQ( 1.0, s->partSnrPbest[1] );
+	EXPECT_EQ( 2.0, s->partSnrPbest[3] );
+	EXPECT_EQ( 0.5, s->partCoord[0] );
+
+	swarminfo_free(s);
+}
+
+/* An island of an in-process migration: the emigrants it sent and how many of the other island's it received */
+typedef struct test_island_s {
+	size_t num_sent;
+	double sent_coords[8];
+	double sent_fitness[4];
+	size_t num_received;
+	struct test_island_s *other;
+} test_island_t;
+
+static size_t test_island_exchange(void *params, size_t nDim, const double *emigrant_coord, double emigrant_fitness,
+		size_t max_immigrants, double *immigrant_coords, double *immigrant_fitness) {
+	test_island_t *island = (test_island_t*) params;
+	test_island_t *other = island->other;
+	size_t num = 0;
+
+	memcpy(island->sent_coords + island->num_sent*nDim, emigrant_coord, nDim * sizeof(double));
+	island->sent_fitness[island->num_sent] = emigrant_fitness;
+	island->num_sent++;
+
+	while (other->num_received < other->num_sent && num < max_immigrants) {
+		memcpy(immigrant_coords + num*nDim, other->sent_coords + other->num_received*nDim, nDim * sizeof(double));
+		immigrant_fitness[num] = other->sent_fitness[other->num_received];
+		other->num_received++;
+		num++;
+	}
+	return num;
+}
+
+TEST(swarminfo_migrate, betweenTwoSwarms) {
+	const size_t nDim = 2;
+	const size_t popsize = 4;
+	struct swarmInfo *sender = swarminfo_alloc(popsize, nDim);
+	struct swarmInfo *receiver = swarminfo_alloc(popsize, nDim);
+	double sender_fitness[] = { 0.5, 2.0, 3.0, 4.0 };
+	double receiver_fitness[] = { 6.0, 5.0, 8.0, 7.0 };
+	for (size_t k = 0; k < popsize; k++) {
+		sender->partSnrPbest[k] = sender->partSnrCurr[k] = sender_fitness[k];
+		receiver->partSnrPbest[k] = receiver->partSnrCurr[k] = receiver_fitness[k];
+		for (size_t d = 0; d < nDim; d++) {
+			sender->partPbest[k*nDim + d] = sender->partCoord[k*nDim + d] = 0.1*k + 0.01*d;
+			receiver->partPbest[k*nDim + d] = receiver->partCoord[k*nDim + d] = 0.5 + 0.1*k + 0.01*d;
+		}
+	}
+
+	test_island_t sender_island, receiver_island;
+	memset(&sender_island, 0, sizeof(sender_island));
+	memset(&receiver_island, 0, sizeof(receiver_island));
+	sender_island.other = &receiver_island;
+	receiver_island.other = &sender_island;
+	pso_migration_t sender_migration = { test_island_exchange, &sender_island, 5, 2 };
+	pso_migration_t receiver_migration = { test_island_exchange, &receiver_island, 5, 2 };
+
+	/* The sender sends its best twice, and finds a better one in between */
+	swarminfo_migrate(sender, &sender_migration, 5);
+	sender->partSnrPbest[1] = sender->partSnrCurr[1] = 0.25;
+	swarminfo_migrate(sender, &sender_migration, 10);
+	EXPECT_EQ( 2u, sender_island.num_sent );
+	EXPECT_EQ( 0u, receiver_island.num_received );
+
+	/* Both replace the receiver's worst particles, the worst first */
+	swarminfo_migrate(receiver, &receiver_migration, 10);
+	EXPECT_EQ( 2u, sender_island.num_received );
+	EXPECT_EQ( 5.0, receiver_island.sent_fitness[0] );
+
+	EXPECT_EQ( 0.5, receiver->partSnrPbest[2] );
+	EXPECT_EQ( 0.25, receiver->partSnrPbest[3] );
+	EXPECT_EQ( 0.5, receiver->partSnrCurr[2] );
+	EXPECT_EQ( 0.25, receiver->partSnrCurr[3] );
+	for (size_t d = 0; d < nDim; d++) {
+		EXPECT_EQ( sender->partPbest[0*nDim + d], receiver->partPbest[2*nDim + d] );
+		EXPECT_EQ( sender->partPbest[1*nDim + d], receiver->partPbest[3*nDim + d] );
+		EXPECT_EQ( sender->partPbest[1*nDim + d], receiver->partCoord[3*nDim + d] );
+	}
+	EXPECT_EQ( 6.0, receiver->partSnrPbest[0] );
+	EXPECT_EQ( 5.0, receiver->partSnrPbest[1] );
+
+	/* The receiver's gbest is now the sender's */
+	size_t gbest = swarminfo_best_particle(receiver);
+	EXPECT_EQ( 3u, gbest );
+	EXPECT_EQ( sender->partSnrCurr[swarminfo_best_particle(sender)], receiver->partSnrCurr[gbest] );
+
+	/* The receiver's emigrant, sent before the immigrants arrived, isn't better than any of the sender's particles */
+	swarminfo_migrate(sender, &sender_migration, 15);
+	EXPECT_EQ( 1u, receiver_island.num_received );
+	for (size_t k = 0; k < popsize; k++) {
+		EXPECT_GT( 5.0, sender->partSnrPbest[k] );
+	}
+	EXPECT_EQ( 4.0, sender->partSnrPbest[3] );
+
+	swarminfo_free(sender);
+	swarminfo_free(receiver);
+}
+
+
+/* Shifted Rastrigin function on the standardized coordinates */
+static double test_pso_fitness(gsl_vector *x, void *params) {
+	struct fitFuncParams *fp = (struct fitFuncParams*) params;
+
+	if (!chkstdsrchrng(x)) {
+		fp->fitEvalFlag[parallel_get_thread_num()] = 0;
+		return GSL_POSINF;
+	}
+	fp->fitEvalFlag[parallel_get_thread_num()] = 1;
+
+	double sum = 0.0;
+	for (size_t i = 0; i < x->size; i++) {
+		double d = 10.24 * (gsl_vector_get(x, i) - 0.5) - 1.3;
+		sum += d*d - 10.0*cos(2.0*M_PI*d) + 10.0;
+	}
+	return sum;
+}
+
+typedef void (*test_pso_optimizer_t)(size_t, fitness_function_ptr, void *, current_result_callback_params_t*,
+		struct psoParamStruct *, struct returnData *);
+
+/* Runs the optimizer with num_threads threads, from the same seed every time */
+static struct returnData* test_pso_run(test_pso_optimizer_t optimizer, size_t num_threads) {
+	const size_t nDim = 4;
+
+	parallel_set_num_threads(num_threads);
+
+	/* one fitEvalFlag per thread */
+	struct fitFuncParams *fp = ffparam_alloc(nDim);
+	gsl_rng *rng = random_alloc(4321);
+
+	struct psoParamStruct params;
+	memset(&params, 0, sizeof(params));
+	params.popsize = 40;
+	params.maxSteps = 200;
+	params.c1 = 1.1931471806;
+	params.c2 = 2.0;
+	params.max_velocity = 0.2;
+	params.dcLaw_a = 0.9;
+	params.dcLaw_b = 0.4;
+	params.dcLaw_c = params.maxSteps;
+	params.dcLaw_d = 0.2;
+	params.locMinIter = 0;
+	params.rngGen = rng;
+
+	struct returnData *results = returnData_alloc(nDim);
+	optimizer(nDim, test_pso_fitness, fp, NULL, &params, results);
+
+	random_free(rng);
+	ffparam_free(fp);
+	return results;
+}
+
+/* Without OpenMP both runs use one thread */
+static void test_pso_same_for_thread_counts(test_pso_optimizer_t optimizer) {
+	size_t max_threads = parallel_get_max_threads();
+
+	struct returnData *serial = test_pso_run(optimizer, 1);
+	struct returnData *parallel = test_pso_run(optimizer, 4);
+
+	parallel_set_num_threads(max_threads);
+
+	EXPECT_EQ( serial->totalIterations, parallel->totalIterations );
+	EXPECT_EQ( serial->totalFuncEvals, parallel->totalFuncEvals );
+	EXPECT_EQ( 0, memcmp(&serial->bestFitVal, &parallel->bestFitVal, sizeof(double)) );
+	for (size_t i = 0; i < serial->bestLocation->size; i++) {
+		double a = gsl_vector_get(serial->bestLocation, i);
+		double b = gsl_vector_get(parallel->bestLocation, i);
+		EXPECT_EQ( 0, memcmp(&a, &b, sizeof(double)) );
+	}
+
+	returnData_free(parallel);
+	returnData_free(serial);
+}
+
+TEST(lbestpso, sameResultsForAnyNumberOfThreads) {
+	test_pso_same_for_thread_counts(lbestpso);
+}
+
+TEST(spso, sameResultsForAnyNumberOfThreads) {
+	test_pso_same_for_thread_counts(spso);
+}
+
+static size_t test_sphere_num_calls = 0;
+
+/* Sphere function with its minimum at 0.3 on the standardized coordinates */
+static double test_sphere_fitness(gsl_vector *x, void *params) {
+	struct fitFuncParams *fp = (struct fitFuncParams*) params;
+
+	test_sphere_num_calls++;
+	if (!chkstdsrchrng(x)) {
+		fp->fitEvalFlag[parallel_get_thread_num()] = 0;
+		return GSL_POSINF;
+	}
+	fp->fitEvalFlag[parallel_get_thread_num()] = 1;
+
+	double sum = 0.0;
+	for (size_t i = 0; i < x->size; i++) {
+		double d = gsl_vector_get(x, i) - 0.3;
+		sum += d*d;
+	}
+	return sum;
+}
+
+static struct returnData* test_asyncpso_sphere_run(void) {
+	const size_t nDim = 3;
+
+	struct fitFuncParams *fp = ffparam_alloc(nDim);
+	gsl_rng *rng = random_alloc(2468);
+
+	struct psoParamStruct params;
+	memset(&params, 0, sizeof(params));
+	params.popsize = 20;
+	params.maxSteps = 150;
+	params.c1 = 1.1931471806;
+	params.c2 = 1.1931471806;
+	params.max_velocity = 0.2;
+	params.dcLaw_a = 0.9;
+	params.dcLaw_b = 0.5;
+	params.dcLaw_c = params.maxSteps;
+	params.dcLaw_d = 0.4;
+	params.rngGen = rng;
+
+	struct returnData *results = returnData_alloc(nDim);
+	test_sphere_num_calls = 0;
+	asyncpso(nDim, test_sphere_fitness, fp, NULL, &params, results);
+	EXPECT_EQ( params.popsize * params.maxSteps, test_sphere_num_calls );
+
+	random_free(rng);
+	ffparam_free(fp);
+	return results;
+}
+
+/* With one thread the particles are evaluated in the queue's order, so the run is reproducible */
+TEST(asyncpso, singleThreadSphere) {
+	size_t max_threads = parallel_get_max_threads();
+	parallel_set_num_threads(1);
+	struct returnData *first = test_asyncpso_sphere_run();
+	struct returnData *second = test_asyncpso_sphere_run();
+	parallel_set_num_threads(max_threads);
+
+	/* The whole budget is used, and every evaluation in the search range is counted */
+	EXPECT_EQ( 150u, first->totalIterations );
+	EXPECT_GE( 20u * 150u, first->totalFuncEvals );
+	EXPECT_LT( 20u * 100u, first->totalFuncEvals );
+
+	EXPECT_GT( 1e-6, first->bestFitVal );
+	for (size_t i = 0; i < first->bestLocation->size; i++) {
+		EXPECT_NEAR( 0.3, gsl_vector_get(first->bestLocation, i), 1e-3 );
+	}
+
+	EXPECT_EQ( first->totalFuncEvals, second->totalFuncEvals );
+	EXPECT_EQ( 0, memcmp(&first->bestFitVal, &second->bestFitVal, sizeof(double)) );
+	for (size_t i = 0; i < first->bestLocation->size; i++) {
+		double a = gsl_vector_get(first->bestLocation, i);
+		double b = gsl_vector_get(second->bestLocation, i);
+		EXPECT_EQ( 0, memcmp(&a, &b, sizeof(double)) );
+	}
+
+	returnData_free(second);
+	returnData_free(first);
+}
+
+static size_t test_batch_num_calls = 0;
+
+/* Batch version of test_sphere_fitness, that counts its calls */
+static void test_sphere_fitness_batch(size_t num_points, gsl_vector **xVecs, void *params, double *out_fitness,
+		unsigned char *out_computed) {
+	struct fitFuncParams *fp = (struct fitFuncParams*) params;
+
+#ifdef HAVE_OPENMP
+	#pragma omp atomic
+#endif
+	test_batch_num_calls++;
+	for (size_t i = 0; i < num_points; i++) {
+		out_fitness[i] = test_sphere_fitness(xVecs[i], fp);
+		out_computed[i] = fp->fitEvalFlag[parallel_get_thread_num()];
+	}
+}
+
+TEST(evalPsoSwarmBatch, oneChunkPerThread) {
+	const size_t nDim = 3;
+	const size_t popsize = 37;
+	size_t max_threads = parallel_get_max_threads();
+
+	struct fitFuncParams *fp = ffparam_alloc(nDim);
+	gsl_rng *serial_rng = random_alloc(1357);
+	gsl_rng *batch_rng = random_alloc(1357);
+	struct swarmInfo *serial = swarminfo_alloc(popsize, nDim);
+	struct swarmInfo *batch = swarminfo_alloc(popsize, nDim);
+	initPsoSwarm(serial, serial_rng);
+	initPsoSwarm(batch, batch_rng);
+	/* a particle outside of the search range isn't counted */
+	serial->partCoord[5*nDim + 1] = 1.5;
+	batch->partCoord[5*nDim + 1] = 1.5;
+
+	struct psoParamStruct params;
+	memset(&params, 0, sizeof(params));
+	parallel_set_num_threads(1);
+	evalPsoSwarm(serial, test_sphere_fitness, fp, &params);
+
+	params.batchFitfunc = test_sphere_fitness_batch;
+	parallel_set_num_threads(4);
+	size_t num_threads = parallel_get_max_threads();
+	test_batch_num_calls = 0;
+	evalPsoSwarm(batch, test_sphere_fitness, fp, &params);
+	size_t num_calls = test_batch_num_calls;
+	parallel_set_num_threads(max_threads);
+
+	/* Without OpenMP there is one thread */
+	EXPECT_EQ( num_threads, num_calls );
+	EXPECT_EQ( 0, memcmp(serial->partSnrCurr, batch->partSnrCurr, popsize * sizeof(double)) );
+	EXPECT_EQ( 0, memcmp(serial->partSnrPbest, batch->partSnrPbest, popsize * sizeof(double)) );
+	EXPECT_EQ( 0, memcmp(serial->partPbest, batch->partPbest, popsize * nDim * sizeof(double)) );
+	for (size_t k = 0; k < popsize; k++) {
+		EXPECT_EQ( serial->partFitOK[k], batch->partFitOK[k] );
+		EXPECT_EQ( serial->partFitEvals[k], batch->partFitEvals[k] );
+	}
+	EXPECT_EQ( 0, batch->partFitOK[5] );
+	EXPECT_EQ( 1u, batch->partFitEvals[0] );
+
+	swarminfo_free(batch);
+	swarminfo_free(serial);
+	random_free(batch_rng);
+	random_free(serial_rng);
+	ffparam_free(fp);
+}
+
+/* The points are split into several calls of the statistic when there are more than the batch's capacity */
+TEST(pso_fitness_function_batch, matchesPsoFitnessFunction) {
+	const size_t nDim = 4;
+	const size_t num_points = 7;
+	size_t num_detectors = 3;
+	size_t num_time_samples = 64;
+	double f_low = 3.0;
+	double f_high = 20.0;
+	double rmin[] = { 0.0, -1.0, 3.0, 0.5 };
+	double range[] = { 2.0 * M_PI, 2.0, 3.0, 0.5 };
+
+	network_strain_half_fft_t *network_strain = test_network_strain_alloc(num_detectors, num_time_samples, 0.3, 0.7);
+	size_t len_f_array = network_strain->strains[0]->half_fft_len;
+	detector_network_t *net = test_network_alloc(num_detectors, len_f_array);
+
+	pso_fitness_function_parameters_t *splParams = pso_fitness_function_parameters_alloc(f_low, f_high, net, network_strain);
+	splParams->batch = (pso_fitness_batch_t**) malloc( parallel_get_max_threads() * sizeof(pso_fitness_batch_t*) );
+	for (size_t t = 0; t < parallel_get_max_threads(); t++) {
+		splParams->batch[t] = pso_fitness_batch_alloc(3, splParams);
+	}
+
+	struct fitFuncParams *fp = ffparam_alloc(nDim);
+	for (size_t d = 0; d < nDim; d++) {
+		gsl_vector_set(fp->rmin, d, rmin[d]);
+		gsl_vector_set(fp->rangeVec, d, range[d]);
+	}
+	fp->splParams = splParams;
+
+	gsl_vector *points[num_points];
+	for (size_t i = 0; i < num_points; i++) {
+		points[i] = gsl_vector_alloc(nDim);
+		for (size_t d = 0; d < nDim; d++) {
+			gsl_vector_set(points[i], d, 0.1 + 0.8 * ((i * 7 + d * 3) % 11) / 10.0);
+		}
+	}
+	gsl_vector_set(points[2], 0, -0.1);
+
+	double fitness[num_points];
+	unsigned char computed[num_points];
+	pso_fitness_function_batch(num_points, points, fp, fitness, computed);
+
+	for (size_t i = 0; i < num_points; i++) {
+		double expected = pso_fitness_function(points[i], fp);
+		EXPECT_EQ( fp->fitEvalFlag[parallel_get_thread_num()], computed[i] );
+		if (i == 2) {
+			EXPECT_EQ( 0, computed[i] );
+			EXPECT_EQ( GSL_POSINF, fitness[i] );
+		} else {
+			EXPECT_NEAR( expected, fitness[i], 1e-10 * fabs(expected) );
+		}
+	}
+
+	for (size_t i = 0; i < num_points; i++) {
+		gsl_vector_free(points[i]);
+	}
+	ffparam_free(fp);
+	pso_fitness_function_parameters_free(splParams);
+	Detector_Network_free(net);
+	network_strain_half_fft_free(network_strain);
+}
+
+
+/* Known answers of Philox4x32-10 from the Random123 distribution */
+TEST(pso_rng_philox, matchesRandom123KnownAnswers) {
+	const uint32_t counters[3][4] = {
+		{ 0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+		{ 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff },
+		{ 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 } };
+	const uint32_t keys[3][2] = {
+		{ 0x00000000, 0x00000000 },
+		{ 0xffffffff, 0xffffffff },
+		{ 0xa4093822, 0x299f31d0 } };
+	const uint32_t expected[3][4] = {
+		{ 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 },
+		{ 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd },
+		{ 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } };
+
+	for (size_t t = 0; t < 3; t++) {
+		uint32_t out[4];
+		pso_rng_philox(counters[t], keys[t], out);
+		for (size_t i = 0; i < 4; i++) {
+			EXPECT_EQ( expected[t][i], out[i] );
+		}
+	}
+}
+
+/* Large enough for the weights to be drawn in parallel */
+TEST(swarminfo_draw_weights_counter, sameForAnyNumberOfThreads) {
+	const size_t popsize = 256;
+	const size_t nDim = 32;
+	ASSERT_GE( popsize * nDim, (size_t) PSO_PARALLEL_MIN_VALUES );
+
+	size_t max_threads = parallel_get_max_threads();
+	pso_rng_t *rng = pso_rng_alloc(987654321, 3);
+	struct swarmInfo *serial = swarminfo_alloc(popsize, nDim);
+	struct swarmInfo *parallel = swarminfo_alloc(popsize, nDim);
+
+	parallel_set_num_threads(1);
+	swarminfo_draw_weights_counter(serial, rng, 7);
+	parallel_set_num_threads(4);
+	swarminfo_draw_weights_counter(parallel, rng, 7);
+	parallel_set_num_threads(max_threads);
+
+	EXPECT_EQ( 0, memcmp(serial->chi1, parallel->chi1, popsize * nDim * sizeof(double)) );
+	EXPECT_EQ( 0, memcmp(serial->chi2, parallel->chi2, popsize * nDim * sizeof(double)) );
+
+	/* the weights are the numbers of their particle, stream and index */
+	EXPECT_EQ( pso_rng_uniform(rng, 7, 5, PSO_RNG_CHI1, 3), serial->chi1[5*nDim + 3] );
+	EXPECT_EQ( pso_rng_uniform(rng, 7, 200, PSO_RNG_CHI2, 31), serial->chi2[200*nDim + 31] );
+
+	swarminfo_free(parallel);
+	swarminfo_free(serial);
+	pso_rng_free(rng);
+}
+
+#endif
\ No newline at end of file